@@ -28,6 +28,7 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include <Eigen/Core>
 #include <graph_core/graph/connection.h>
+#include <typeinfo>
 
 namespace graph
 {
@@ -140,6 +141,17 @@ public:
     return "";
   }
 
+  /**
+   * @brief Get a string identifying the collision checker, used to key the roadmaps cached by RoadmapCache.
+   * Two checkers with the same identity must give the same results. By default, it is made of the type of the checker,
+   * the group name and min_distance_; derived classes can add whatever else changes their results.
+   * @return The identity of the collision checker.
+   */
+  virtual std::string getIdentity()
+  {
+    return std::string(typeid(*this).name())+"/"+getGroupName()+"/"+std::to_string(min_distance_);
+  }
+
   /**
    * @brief getInitialized tells if the object has been initialised.
    * @return the 'initialized_' flag.
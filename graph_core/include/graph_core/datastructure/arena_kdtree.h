@@ -0,0 +1,398 @@
+/*
+Copyright (c) 2024, Manuel Beschi and Cesare Tonola, JRL-CARI CNR-STIIMA/UNIBS, manuel.beschi@unibs.it, c.tonola001@unibs.it
+Manuel Beschi manuel.beschi@unibs.it
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of the <organization> nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL <COPYRIGHT HOLDER> BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+PSEUDO CODE :
+- https://www.cs.cmu.edu/~ckingsf/bioinfo-lectures/kdtrees.pdf
+- http://andrewd.ces.clemson.edu/courses/cpsc805/references/nearest_search.pdf
+*/
+#pragma once
+
+#include <graph_core/datastructure/nearest_neighbors.h>
+namespace graph
+{
+namespace core
+{
+
+class ArenaKdTree;
+typedef std::shared_ptr<ArenaKdTree> ArenaKdTreePtr;
+
+/**
+ * @class ArenaKdTree
+ * @brief NearestNeighbors implementation using a k-d tree whose nodes are stored in a contiguous arena.
+ *
+ * Differently from KdTree, kd-nodes are not allocated one by one and linked through shared pointers.
+ * They are stored in a std::vector and linked through 32-bit indices, while their configurations are
+ * copied inline in a contiguous array. Searches therefore walk contiguous memory and do not touch the
+ * Node objects (nor their reference counters) until a result has to be returned.
+ * Insert, delete, restore and search functions have the same semantics of KdTree.
+ *
+ * The tree is kept balanced with the scapegoat rule: when an insertion creates a kd-node deeper than
+ * log(n)/log(1/alpha), the subtree of its lowest ancestor whose child contains more than alpha times its nodes
+ * is rebuilt with a median split. Rebuilds only relink the indices of the arena, nodes are not moved.
+ * This keeps the depth logarithmic also for the spatially correlated insertions of RRT-like planners,
+ * with amortized O(log n) insertions.
+ */
+class ArenaKdTree: public NearestNeighbors
+{
+public:
+
+  /**
+   * @brief print_deleted_nodes_ Flag to decide whether to also consider deleted nodes when the << operator is used.
+   */
+  bool print_deleted_nodes_;
+
+  /**
+   * @brief Constructor for the ArenaKdTree class.
+   */
+  ArenaKdTree(const cnr_logger::TraceLoggerPtr& logger);
+
+  /**
+   * @brief Implementation of the insert function for adding a node to the k-d tree.
+   *
+   * @param node The node to be inserted.
+   */
+  virtual void insert(const NodePtr& node) override;
+
+  /**
+   * @brief Implementation of the clear function to clear the nearest neighbors data structure.
+   * Additionally, it sets size_ and delted_nodes_ to zero. The memory of the arena is kept for later insertions.
+   * @return True if successful, false otherwise.
+   */
+  virtual bool clear() override;
+
+  /**
+   * @brief Build a balanced k-d tree from scratch with the given nodes.
+   *
+   * Nodes are stored in the arena in the given order, so the first one is the root of the k-d tree.
+   * The remaining nodes are linked splitting them recursively at the median (std::nth_element)
+   * along the cycling dimension. Construction is O(n log n) and the depth is logarithmic.
+   *
+   * @param nodes The nodes to store.
+   */
+  virtual void build(const std::vector<NodePtr>& nodes) override;
+
+  /**
+   * @brief Reserve memory for n nodes, avoiding reallocations of the arena during insertions.
+   * @param n The number of nodes.
+   */
+  void reserve(const size_t& n);
+
+  /**
+   * @brief Implementation of the nearestNeighbor function for finding the nearest neighbor in the k-d tree.
+   *
+   * @param configuration The configuration for which the nearest neighbor needs to be found.
+   * @param best Reference to the pointer to the best-matching node.
+   * @param best_distance Reference to the distance to the best-matching node.
+   */
+  virtual void nearestNeighbor(const Eigen::VectorXd& configuration,
+                               NodePtr &best,
+                               double &best_distance) override;
+
+  /**
+   * @brief Implementation of the near function for visiting the nodes within a specified radius in the k-d tree.
+   *
+   * @param configuration The reference configuration.
+   * @param radius The search radius.
+   * @param visitor Function called for each node found; the search stops as soon as it returns false.
+   * @return False if the search has been stopped by the visitor, true otherwise.
+   */
+  virtual bool near(const Eigen::VectorXd& configuration,
+                    const double& radius,
+                    const NearVisitor& visitor) override;
+
+  using NearestNeighbors::near;
+  using NearestNeighbors::nearestNeighbor;
+  using NearestNeighbors::kNearestNeighbors;
+
+  /**
+   * @brief Implementation of the kNearestNeighbors function for finding k nearest neighbors in the k-d tree.
+   *
+   * @param configuration The reference configuration.
+   * @param heap The heap collecting the nearest neighbors, with their squared distances. Its capacity defines k.
+   */
+  virtual void kNearestNeighbors(const Eigen::VectorXd& configuration,
+                                 KNearestNeighborsHeap& heap) override;
+
+  /**
+   * @brief Find the nearest neighbor of each configuration of a batch, see NearestNeighbors::nearestNeighbors.
+   *
+   * The queries are first sorted along a kd-tree of their own, so that consecutive queries are close to each other.
+   * Each search then starts with the nearest node of the previous query of its range as the best candidate,
+   * which prunes most of the branches from the first descent.
+   *
+   * @param configurations The configurations for which the nearest neighbors need to be found.
+   * @param nodes The flat buffer of the results, see NearestNeighbors::nearestNeighbors.
+   * @param n_threads The number of threads; 1 runs the queries in the calling thread, 0 uses all the threads of the pool.
+   * @param pool The threads running the queries, nullptr for WorkerPool::shared().
+   */
+  virtual void nearestNeighbors(const std::vector<Eigen::VectorXd>& configurations,
+                                std::vector<std::pair<double,Node*>>& nodes,
+                                const unsigned int& n_threads=1,
+                                const WorkerPoolPtr& pool=nullptr) override;
+
+  /**
+   * @brief Implementation of the findNode function for checking if a node exists in the k-d tree.
+   *
+   * @param node The node to check.
+   * @return True if the node exists, false otherwise.
+   */
+  virtual bool findNode(const NodePtr& node) override;
+
+  /**
+   * @brief Implementation of the deleteNode function for deleting a node from the k-d tree.
+   *
+   * The node is only marked as deleted. If the number of deleted nodes surpasses 'deleted_nodes_threshold_',
+   * the arena is rebuilt from scratch with the remaining nodes.
+   *
+   * @param node The node to delete.
+   * @param disconnect_node If true, disconnect the node from the graph.
+   * @return True if the deletion is successful, false otherwise.
+   */
+  virtual bool deleteNode(const NodePtr& node,
+                          const bool& disconnect_node=false) override;
+
+  /**
+   * @brief Implementation of the restoreNode function for restoring a previously deleted node.
+   *
+   * @param node The node to restore.
+   * @return True if the restoration is successful, false otherwise.
+   */
+  virtual bool restoreNode(const NodePtr& node) override;
+
+  /**
+   * @brief Implementation of the getNodes function for getting all nodes in the k-d tree.
+   * Nodes are returned in insertion order, so the first one is the first node inserted.
+   *
+   * @return A vector containing all nodes in the k-d tree.
+   */
+  virtual std::vector<NodePtr> getNodes() override;
+
+  /**
+   * @brief Implementation of the disconnectNodes function for disconnecting nodes in the k-d tree.
+   *
+   * @param white_list A vector of nodes to be excluded from the disconnection process.
+   */
+  virtual void disconnectNodes(const std::vector<NodePtr>& white_list) override;
+
+  /**
+   * @brief Statistics about the shape of the k-d tree.
+   */
+  struct Statistics
+  {
+    unsigned int max_depth;   //depth of the deepest kd-node (the root has depth 0)
+    double average_depth;     //average depth of the kd-nodes
+    double max_imbalance;     //max over the kd-nodes (root excluded) of (nodes in the largest child subtree)/(nodes in the subtree)
+    size_t partial_rebuilds;  //number of subtrees rebuilt by the scapegoat rule
+    size_t rebuilt_nodes;     //total number of kd-nodes relinked by the partial rebuilds
+  };
+
+  /**
+   * @brief Compute the depth and imbalance statistics of the k-d tree. Deleted nodes are considered.
+   * It visits the whole tree, so it is meant for diagnostics.
+   * @return The statistics.
+   */
+  Statistics statistics() const;
+
+  /**
+   * @brief balanceFactor Returns the balance factor alpha used by the scapegoat rule.
+   * @return balance_factor_
+   */
+  double balanceFactor();
+
+  /**
+   * @brief balanceFactor Sets the balance factor alpha used by the scapegoat rule.
+   * Lower values give a better balanced tree with more frequent rebuilds, 1.0 disables the rebuilds.
+   * @param alpha The balance factor, in (0.5,1].
+   */
+  void balanceFactor(const double& alpha);
+
+  /**
+   * @brief deletedNodesThreshold Returns the deleted_nodes_threshold_,
+   * which represents the number of nodes set as deleted beyond which the arena is built from scratch.
+   * @return deleted_nodes_threshold_
+   */
+  unsigned int deletedNodesThreshold();
+
+  /**
+   * @brief deletedNodesThreshold Sets the value of deleted_nodes_threshold_
+   * @param t The value of deleted_nodes_threshold_ to set.
+   */
+  void deletedNodesThreshold(const unsigned int t);
+
+  /**
+   * @brief Output stream operator for an ArenaKdTree.
+   *
+   * @param os The output stream where the ArenaKdTree information will be printed.
+   * @param kdtree The ArenaKdTree to be printed.
+   * @return A reference to the output stream for chaining.
+   */
+  friend std::ostream& operator<<(std::ostream& os, const ArenaKdTree& kdtree);
+
+protected:
+
+  /**
+   * @brief Index used to represent a missing child.
+   */
+  static constexpr uint32_t NONE = std::numeric_limits<uint32_t>::max();
+
+  /**
+   * @brief Element of the arena. The configuration of the kd-node is stored in configurations_,
+   * starting from position index*dof_.
+   */
+  struct KdEntry
+  {
+    NodePtr node;
+    uint32_t left;
+    uint32_t right;
+    uint32_t dimension;
+    uint32_t size; //number of kd-nodes in the subtree, deleted ones included
+    bool deleted;
+  };
+
+  /**
+   * @brief kdnodes_ The arena of kd-nodes. The root, if any, is the first element.
+   */
+  std::vector<KdEntry> kdnodes_;
+
+  /**
+   * @brief configurations_ The configurations of the kd-nodes scaled by scale_, stored contiguously.
+   */
+  std::vector<double> configurations_;
+
+  /**
+   * @brief scaled_configuration_ Buffer storing the configuration of the inserted node scaled by scale_.
+   */
+  Eigen::VectorXd scaled_configuration_;
+
+  /**
+   * @brief indices_ The arena index of each node (including the deleted ones), to find nodes in constant time.
+   */
+  std::unordered_map<const Node*,uint32_t> indices_;
+
+  /**
+   * @brief dof_ The dimension of the configurations, set by the first insertion.
+   */
+  unsigned int dof_;
+
+  /**
+   * @brief deleted_nodes_threshold_ When the number of (nodes for which deleted == true) > deleted_nodes_threshold_
+   * the arena is built from scratch
+   */
+  unsigned int deleted_nodes_threshold_;
+
+  /**
+   * @brief balance_factor_ The alpha parameter of the scapegoat rule.
+   */
+  double balance_factor_;
+
+  /**
+   * @brief partial_rebuilds_ Number of subtrees rebuilt by the scapegoat rule.
+   */
+  size_t partial_rebuilds_;
+
+  /**
+   * @brief rebuilt_nodes_ Number of kd-nodes relinked by the partial rebuilds.
+   */
+  size_t rebuilt_nodes_;
+
+  /**
+   * @brief path_ Buffer storing the kd-nodes visited by the last insertion.
+   */
+  std::vector<uint32_t> path_;
+
+  /**
+   * @brief subtree_ Buffer storing the kd-nodes of the subtree to rebuild.
+   */
+  std::vector<uint32_t> subtree_;
+
+  /**
+   * @brief Pointer to the configuration stored in the arena for the kd-node idx.
+   */
+  const double* conf(const uint32_t& idx) const
+  {
+    return configurations_.data()+static_cast<size_t>(idx)*dof_;
+  }
+
+  /**
+   * @brief Squared Euclidean distance between the configuration of the kd-node idx and configuration.
+   */
+  double squaredDistance(const uint32_t& idx, const Eigen::VectorXd& configuration) const
+  {
+    return (Eigen::Map<const Eigen::VectorXd>(conf(idx),dof_)-configuration).squaredNorm();
+  }
+
+  /**
+   * @brief Search the arena index of a node in indices_.
+   * @param node The node to search for.
+   * @param idx The index of the kd-node storing the node, if found.
+   * @return True if the node is found, false otherwise.
+   */
+  bool findNode(const NodePtr& node, uint32_t& idx) const;
+
+  /**
+   * @brief Maximum depth allowed by the scapegoat rule for a tree of n kd-nodes, i.e. log(n)/log(1/alpha).
+   */
+  unsigned int maxDepth(const size_t& n) const;
+
+  /**
+   * @brief Rebuild the subtree rooted at the kd-node idx with a median split.
+   * @param idx The root of the subtree.
+   * @param parent The parent of idx, NONE if idx is the root of the k-d tree.
+   */
+  void rebuildSubtree(const uint32_t& idx, const uint32_t& parent);
+
+  /**
+   * @brief Link the given kd-nodes below the root of the k-d tree (index 0), which is not changed.
+   * @param indices The kd-nodes to link, root excluded (the vector is reordered).
+   */
+  void buildFromRoot(std::vector<uint32_t>& indices);
+
+  /**
+   * @brief Link the kd-nodes with indices in [begin,end) into a balanced subtree, splitting them at the median along dimension.
+   * @return The index of the subtree root, NONE if the range is empty.
+   */
+  uint32_t build(const std::vector<uint32_t>::iterator& begin,
+                 const std::vector<uint32_t>::iterator& end,
+                 const uint32_t& dimension);
+
+  void nearestNeighbor(const uint32_t& idx,
+                       const Eigen::VectorXd& configuration,
+                       uint32_t& best,
+                       double& best_squared_distance) const;
+
+  bool near(const uint32_t& idx,
+            const Eigen::VectorXd& configuration,
+            const double& radius,
+            const NearVisitor& visitor) const;
+
+  void kNearestNeighbors(const uint32_t& idx,
+                         const Eigen::VectorXd& configuration,
+                         KNearestNeighborsHeap& heap) const;
+};
+
+} //end namespace core
+} // end namespace graph
@@ -0,0 +1,357 @@
+/*
+Copyright (c) 2024, Manuel Beschi and Cesare Tonola, JRL-CARI CNR-STIIMA/UNIBS, manuel.beschi@unibs.it, c.tonola001@unibs.it
+Manuel Beschi manuel.beschi@unibs.it
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of the <organization> nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL <COPYRIGHT HOLDER> BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+#pragma once
+
+#include <graph_core/datastructure/nearest_neighbors.h>
+namespace graph
+{
+namespace core
+{
+
+class BucketKdTree;
+typedef std::shared_ptr<BucketKdTree> BucketKdTreePtr;
+
+/**
+ * @class BucketKdTree
+ * @brief NearestNeighbors implementation using a k-d tree whose leaves store buckets of configurations.
+ *
+ * Internal kd-nodes only store a splitting dimension and value, while the nodes are stored in the leaves,
+ * in buckets of up to bucket_size_ elements (16-64 are suitable values). Inside a bucket, configurations are
+ * stored in structure-of-arrays layout (all the values of the first dimension, then all the values of the second one, ...),
+ * so that the squared distances between a query and a whole bucket are computed with a single vectorized loop.
+ * When a bucket is full, it is split at the median of its dimension with the largest spread.
+ * Insert, delete, restore and search functions have the same semantics of KdTree.
+ */
+class BucketKdTree: public NearestNeighbors
+{
+public:
+
+  /**
+   * @brief print_deleted_nodes_ Flag to decide whether to also consider deleted nodes when the << operator is used.
+   */
+  bool print_deleted_nodes_;
+
+  /**
+   * @brief Constructor for the BucketKdTree class.
+   * @param logger The logger.
+   * @param bucket_size The maximum number of nodes stored in a leaf before it is split.
+   */
+  BucketKdTree(const cnr_logger::TraceLoggerPtr& logger, const unsigned int& bucket_size=32);
+
+  /**
+   * @brief Implementation of the insert function for adding a node to the k-d tree.
+   *
+   * @param node The node to be inserted.
+   */
+  virtual void insert(const NodePtr& node) override;
+
+  /**
+   * @brief Implementation of the clear function to clear the nearest neighbors data structure.
+   * Additionally, it sets size_ and delted_nodes_ to zero.
+   * @return True if successful, false otherwise.
+   */
+  virtual bool clear() override;
+
+  /**
+   * @brief Build a balanced k-d tree from scratch with the given nodes.
+   *
+   * The nodes are split recursively at the median (std::nth_element) of the dimension with the largest spread
+   * until they fit in a bucket. Construction is O(n log n) and the depth is logarithmic.
+   * getNodes() returns the nodes in the given order.
+   *
+   * @param nodes The nodes to store.
+   */
+  virtual void build(const std::vector<NodePtr>& nodes) override;
+
+  /**
+   * @brief Implementation of the nearestNeighbor function for finding the nearest neighbor in the k-d tree.
+   *
+   * @param configuration The configuration for which the nearest neighbor needs to be found.
+   * @param best Reference to the pointer to the best-matching node.
+   * @param best_distance Reference to the distance to the best-matching node.
+   */
+  virtual void nearestNeighbor(const Eigen::VectorXd& configuration,
+                               NodePtr &best,
+                               double &best_distance) override;
+
+  /**
+   * @brief Implementation of the near function for visiting the nodes within a specified radius in the k-d tree.
+   *
+   * @param configuration The reference configuration.
+   * @param radius The search radius.
+   * @param visitor Function called for each node found; the search stops as soon as it returns false.
+   * @return False if the search has been stopped by the visitor, true otherwise.
+   */
+  virtual bool near(const Eigen::VectorXd& configuration,
+                    const double& radius,
+                    const NearVisitor& visitor) override;
+
+  using NearestNeighbors::near;
+  using NearestNeighbors::nearestNeighbor;
+  using NearestNeighbors::kNearestNeighbors;
+
+  /**
+   * @brief Implementation of the kNearestNeighbors function for finding k nearest neighbors in the k-d tree.
+   *
+   * @param configuration The reference configuration.
+   * @param heap The heap collecting the nearest neighbors, with their squared distances. Its capacity defines k.
+   */
+  virtual void kNearestNeighbors(const Eigen::VectorXd& configuration,
+                                 KNearestNeighborsHeap& heap) override;
+
+  /**
+   * @brief Implementation of the findNode function for checking if a node exists in the k-d tree.
+   *
+   * @param node The node to check.
+   * @return True if the node exists, false otherwise.
+   */
+  virtual bool findNode(const NodePtr& node) override;
+
+  /**
+   * @brief Implementation of the deleteNode function for deleting a node from the k-d tree.
+   *
+   * The node is only marked as deleted. If the number of deleted nodes surpasses 'deleted_nodes_threshold_',
+   * the k-d tree is built from scratch with the remaining nodes.
+   *
+   * @param node The node to delete.
+   * @param disconnect_node If true, disconnect the node from the graph.
+   * @return True if the deletion is successful, false otherwise.
+   */
+  virtual bool deleteNode(const NodePtr& node,
+                          const bool& disconnect_node=false) override;
+
+  /**
+   * @brief Implementation of the restoreNode function for restoring a previously deleted node.
+   *
+   * @param node The node to restore.
+   * @return True if the restoration is successful, false otherwise.
+   */
+  virtual bool restoreNode(const NodePtr& node) override;
+
+  /**
+   * @brief Implementation of the getNodes function for getting all nodes in the k-d tree.
+   * Nodes are returned in insertion order, so the first one is the first node inserted.
+   *
+   * @return A vector containing all nodes in the k-d tree.
+   */
+  virtual std::vector<NodePtr> getNodes() override;
+
+  /**
+   * @brief Implementation of the disconnectNodes function for disconnecting nodes in the k-d tree.
+   *
+   * @param white_list A vector of nodes to be excluded from the disconnection process.
+   */
+  virtual void disconnectNodes(const std::vector<NodePtr>& white_list) override;
+
+  /**
+   * @brief bucketSize Returns the maximum number of nodes stored in a leaf before it is split.
+   * @return bucket_size_
+   */
+  unsigned int bucketSize() const
+  {
+    return bucket_size_;
+  }
+
+  /**
+   * @brief deletedNodesThreshold Returns the deleted_nodes_threshold_,
+   * which represents the number of nodes set as deleted beyond which the k-d tree is built from scratch.
+   * @return deleted_nodes_threshold_
+   */
+  unsigned int deletedNodesThreshold();
+
+  /**
+   * @brief deletedNodesThreshold Sets the value of deleted_nodes_threshold_
+   * @param t The value of deleted_nodes_threshold_ to set.
+   */
+  void deletedNodesThreshold(const unsigned int t);
+
+  /**
+   * @brief Output stream operator for a BucketKdTree.
+   *
+   * @param os The output stream where the BucketKdTree information will be printed.
+   * @param kdtree The BucketKdTree to be printed.
+   * @return A reference to the output stream for chaining.
+   */
+  friend std::ostream& operator<<(std::ostream& os, const BucketKdTree& kdtree);
+
+protected:
+
+  /**
+   * @brief Index used to represent a missing child or bucket.
+   */
+  static constexpr uint32_t NONE = std::numeric_limits<uint32_t>::max();
+
+  /**
+   * @brief kd-node of the tree. Internal kd-nodes have bucket == NONE and two children,
+   * the left one contains values lower than split along dimension, the right one the others.
+   * Leaves store the index of their bucket.
+   */
+  struct KdEntry
+  {
+    uint32_t left;
+    uint32_t right;
+    uint32_t dimension;
+    uint32_t bucket;
+    double split;
+  };
+
+  /**
+   * @brief Nodes stored in a leaf. The value of dimension d of the i-th configuration (scaled by scale_) is coordinates[d*capacity+i].
+   */
+  struct Bucket
+  {
+    size_t capacity;
+    std::vector<double> coordinates;
+    std::vector<NodePtr> nodes;
+    std::vector<uint8_t> deleted;
+    std::vector<size_t> ids; //insertion order
+  };
+
+  /**
+   * @brief kdnodes_ The kd-nodes. The root, if any, is the first element.
+   */
+  std::vector<KdEntry> kdnodes_;
+
+  /**
+   * @brief buckets_ The buckets of the leaves.
+   */
+  std::vector<Bucket> buckets_;
+
+  /**
+   * @brief bucket_size_ The maximum number of nodes stored in a leaf before it is split.
+   */
+  unsigned int bucket_size_;
+
+  /**
+   * @brief dof_ The dimension of the configurations, set by the first insertion.
+   */
+  unsigned int dof_;
+
+  /**
+   * @brief inserted_ Counter of the insertions, used to return the nodes in insertion order.
+   */
+  size_t inserted_;
+
+  /**
+   * @brief deleted_nodes_threshold_ When the number of (nodes for which deleted == true) > deleted_nodes_threshold_
+   * the k-d tree is built from scratch
+   */
+  unsigned int deleted_nodes_threshold_;
+
+  /**
+   * @brief slots_ The bucket and the position within it of each node (including the deleted ones), to find nodes in constant time.
+   */
+  std::unordered_map<const Node*,std::pair<uint32_t,size_t>> slots_;
+
+  /**
+   * @brief scaled_configuration_ Buffer storing the configuration of the inserted node scaled by scale_.
+   */
+  Eigen::VectorXd scaled_configuration_;
+
+  /**
+   * @brief Compute the squared distances between configuration and all the configurations of a bucket.
+   * The loop runs over contiguous memory along each dimension, so that it is vectorized by Eigen.
+   * @param bucket The bucket.
+   * @param configuration The reference configuration.
+   * @param squared_distances Output buffer, resized if needed. Its first bucket.nodes.size() elements are filled.
+   */
+  void squaredDistances(const Bucket& bucket,
+                        const Eigen::VectorXd& configuration,
+                        Eigen::ArrayXd& squared_distances) const;
+
+  /**
+   * @brief Create an empty bucket with the given capacity.
+   */
+  Bucket emptyBucket(const size_t& capacity) const;
+
+  /**
+   * @brief Create a new leaf.
+   * @param bucket The index of the bucket of the leaf. If NONE, a new empty bucket is created.
+   * @return The index of the new kd-node.
+   */
+  uint32_t newLeaf(const uint32_t& bucket=NONE);
+
+  /**
+   * @brief Append a configuration to a bucket, growing its capacity if needed, and record its slot.
+   * The value of dimension d of the configuration is configuration[d*stride].
+   */
+  void append(const uint32_t& bucket_idx, const NodePtr& node, const double* configuration, const size_t& stride,
+              const bool& deleted, const size_t& id);
+
+  /**
+   * @brief Split a full leaf at the median of the dimension with the largest spread.
+   * @param idx The index of the leaf.
+   * @return False if the leaf cannot be split because all its configurations are equal.
+   */
+  bool split(const uint32_t& idx);
+
+  /**
+   * @brief Build a balanced subtree with the nodes whose indices are in [begin,end).
+   * @param nodes The nodes passed to build.
+   * @param configurations The scaled configurations of the nodes, stored contiguously.
+   * @return The index of the subtree root.
+   */
+  uint32_t build(const std::vector<NodePtr>& nodes,
+                 const std::vector<double>& configurations,
+                 const std::vector<size_t>::iterator& begin,
+                 const std::vector<size_t>::iterator& end);
+
+  /**
+   * @brief Return the leaf in which the configuration is (or would be) stored.
+   */
+  uint32_t leaf(const Eigen::VectorXd& configuration, uint32_t idx=0) const;
+
+  /**
+   * @brief Search the bucket and the position within it of a node in slots_.
+   * @param node The node to search for.
+   * @param bucket The index of the bucket storing the node, if found.
+   * @param pos The position of the node in the bucket, if found.
+   * @return True if the node is found, false otherwise.
+   */
+  bool findNode(const NodePtr& node, uint32_t& bucket, size_t& pos) const;
+
+  void nearestNeighbor(const uint32_t& idx,
+                       const Eigen::VectorXd& configuration,
+                       Eigen::ArrayXd& squared_distances,
+                       NodePtr& best,
+                       double& best_squared_distance) const;
+
+  bool near(const uint32_t& idx,
+            const Eigen::VectorXd& configuration,
+            const double& radius,
+            Eigen::ArrayXd& squared_distances,
+            const NearVisitor& visitor) const;
+
+  void kNearestNeighbors(const uint32_t& idx,
+                         const Eigen::VectorXd& configuration,
+                         Eigen::ArrayXd& squared_distances,
+                         KNearestNeighborsHeap& heap) const;
+};
+
+} //end namespace core
+} // end namespace graph
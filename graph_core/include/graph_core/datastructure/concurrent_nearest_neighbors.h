@@ -0,0 +1,284 @@
+/*
+Copyright (c) 2024, Manuel Beschi and Cesare Tonola, JRL-CARI CNR-STIIMA/UNIBS, manuel.beschi@unibs.it, c.tonola001@unibs.it
+Manuel Beschi manuel.beschi@unibs.it
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of the <organization> nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL <COPYRIGHT HOLDER> BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+#pragma once
+
+#include <graph_core/datastructure/nearest_neighbors.h>
+#include <shared_mutex>
+#include <mutex>
+namespace graph
+{
+namespace core
+{
+
+class ConcurrentNearestNeighbors;
+typedef std::shared_ptr<ConcurrentNearestNeighbors> ConcurrentNearestNeighborsPtr;
+
+/**
+ * @class ConcurrentNearestNeighbors
+ * @brief Thread-safe NearestNeighbors, wrapping any other NearestNeighbors implementation.
+ *
+ * Queries (nearestNeighbor, near, kNearestNeighbors, their batch versions, findNode, size, getNodes) acquire a shared lock, so that
+ * any number of threads can search the wrapped data structure at the same time. Functions modifying it (insert,
+ * deleteNode, restoreNode, clear, build, ...) acquire an exclusive lock. Every function is therefore atomic and
+ * the results are linearizable: a query sees all the insertions and deletions completed before it started.
+ * Insertions are serialized: only the queries run in parallel, so the speed-up grows with the ratio between
+ * queries and insertions (as in RRT, where every iteration queries and only some of them insert). Inserters should
+ * use insert(nodes) to add several nodes with a single lock.
+ * Writers have priority: once a writer is waiting, new queries wait for it, so continuous queries cannot starve
+ * the insertions (std::shared_mutex does not guarantee it, e.g. it prefers readers on glibc).
+ *
+ * The search functions of the wrapped data structure must be safe for concurrent readers, which holds for all
+ * the implementations of graph_core (their scratch buffers are thread_local). For the VpTree, also the utopia of
+ * its metrics must be thread-safe. Visitors passed to near() are called with the shared lock held: they can query
+ * this data structure again (the nested query reuses the lock of the thread instead of waiting behind a writer),
+ * but they must not modify it, and doing so throws std::logic_error.
+ */
+class ConcurrentNearestNeighbors: public NearestNeighbors
+{
+public:
+
+  /**
+   * @brief Constructor for the ConcurrentNearestNeighbors class.
+   * @param nearest_neighbors The wrapped data structure. It should not be accessed directly afterwards.
+   */
+  ConcurrentNearestNeighbors(const NearestNeighborsPtr& nearest_neighbors,
+                             const cnr_logger::TraceLoggerPtr& logger);
+
+  /**
+   * @brief Insert a node, with an exclusive lock.
+   * @param node The node to be inserted.
+   */
+  virtual void insert(const NodePtr& node) override;
+
+  /**
+   * @brief Insert several nodes acquiring the exclusive lock only once.
+   * @param nodes The nodes to be inserted.
+   */
+  void insert(const std::vector<NodePtr>& nodes);
+
+  /**
+   * @brief Clear the wrapped data structure, with an exclusive lock.
+   * @return True if successful, false otherwise.
+   */
+  virtual bool clear() override;
+
+  /**
+   * @brief Build the wrapped data structure from scratch with the given nodes, with an exclusive lock.
+   * @param nodes The nodes to store.
+   */
+  virtual void build(const std::vector<NodePtr>& nodes) override;
+
+  /**
+   * @brief Set the weights of the distance of the wrapped data structure, with an exclusive lock.
+   * @param scale The positive weight of each dimension, empty for the Euclidean distance.
+   */
+  virtual void setScale(const Eigen::VectorXd& scale) override;
+
+  /**
+   * @brief Set the approximation of the queries of the wrapped data structure, with an exclusive lock.
+   * @param epsilon The approximation, 0.0 for exact queries.
+   */
+  virtual void setEpsilon(const double& epsilon) override;
+
+  /**
+   * @brief Find the nearest neighbor to a given configuration, with a shared lock.
+   *
+   * @param configuration The configuration for which the nearest neighbor needs to be found.
+   * @param best Reference to the pointer to the best-matching node.
+   * @param best_distance Reference to the distance to the best-matching node.
+   */
+  virtual void nearestNeighbor(const Eigen::VectorXd& configuration,
+                               NodePtr &best,
+                               double &best_distance) override;
+
+  /**
+   * @brief Visit the nodes within a specified radius of a given configuration, with a shared lock.
+   *
+   * @param configuration The reference configuration.
+   * @param radius The search radius.
+   * @param visitor Function called for each node found; the search stops as soon as it returns false.
+   * It can query this data structure, but it must not modify it.
+   * @return False if the search has been stopped by the visitor, true otherwise.
+   */
+  virtual bool near(const Eigen::VectorXd& configuration,
+                    const double& radius,
+                    const NearVisitor& visitor) override;
+
+  using NearestNeighbors::near;
+  using NearestNeighbors::nearestNeighbor;
+  using NearestNeighbors::kNearestNeighbors;
+
+  /**
+   * @brief Find k nearest neighbors to a given configuration, with a shared lock.
+   *
+   * @param configuration The reference configuration.
+   * @param heap The heap collecting the nearest neighbors, with their squared distances. Its capacity defines k.
+   */
+  virtual void kNearestNeighbors(const Eigen::VectorXd& configuration,
+                                 KNearestNeighborsHeap& heap) override;
+
+  /**
+   * @brief Find the nearest neighbor of each configuration of a batch, with a single shared lock held for the whole batch.
+   *
+   * @param configurations The configurations for which the nearest neighbors need to be found.
+   * @param nodes The flat buffer of the results, see NearestNeighbors::nearestNeighbors.
+   * @param n_threads The number of threads; 1 runs the queries in the calling thread, 0 uses all the threads of the pool.
+   * @param pool The threads running the queries, nullptr for WorkerPool::shared().
+   */
+  virtual void nearestNeighbors(const std::vector<Eigen::VectorXd>& configurations,
+                                std::vector<std::pair<double,Node*>>& nodes,
+                                const unsigned int& n_threads=1,
+                                const WorkerPoolPtr& pool=nullptr) override;
+
+  /**
+   * @brief Find the k nearest neighbors of each configuration of a batch, with a single shared lock held for the whole batch.
+   *
+   * @param configurations The reference configurations.
+   * @param k The number of nearest neighbors to find for each configuration.
+   * @param nodes The flat buffer of the results, see NearestNeighbors::kNearestNeighbors.
+   * @param n_threads The number of threads; 1 runs the queries in the calling thread, 0 uses all the threads of the pool.
+   * @param pool The threads running the queries, nullptr for WorkerPool::shared().
+   */
+  virtual void kNearestNeighbors(const std::vector<Eigen::VectorXd>& configurations,
+                                 const size_t& k,
+                                 std::vector<std::pair<double,Node*>>& nodes,
+                                 const unsigned int& n_threads=1,
+                                 const WorkerPoolPtr& pool=nullptr) override;
+
+  /**
+   * @brief Check if a node exists in the wrapped data structure, with a shared lock.
+   *
+   * @param node The node to check.
+   * @return True if the node exists, false otherwise.
+   */
+  virtual bool findNode(const NodePtr& node) override;
+
+  /**
+   * @brief Delete a node from the wrapped data structure, with an exclusive lock.
+   *
+   * @param node The node to delete.
+   * @param disconnect_node If true, disconnect the node from the graph.
+   * @return True if the deletion is successful, false otherwise.
+   */
+  virtual bool deleteNode(const NodePtr& node,
+                          const bool& disconnect_node=false) override;
+
+  /**
+   * @brief Restore a previously deleted node, with an exclusive lock.
+   *
+   * @param node The node to restore.
+   * @return True if the restoration is successful, false otherwise.
+   */
+  virtual bool restoreNode(const NodePtr& node) override;
+
+  /**
+   * @brief Get the number of nodes in the wrapped data structure, with a shared lock.
+   * @return The number of nodes.
+   */
+  virtual unsigned int size() override;
+
+  /**
+   * @brief Get all the nodes of the wrapped data structure, with a shared lock.
+   * @return A vector containing all the nodes.
+   */
+  virtual std::vector<NodePtr> getNodes() override;
+
+  /**
+   * @brief Disconnect the nodes not in the white list from the graph, with an exclusive lock.
+   *
+   * @param white_list A vector of nodes to be excluded from the disconnection process.
+   */
+  virtual void disconnectNodes(const std::vector<NodePtr>& white_list) override;
+
+  /**
+   * @brief Get the wrapped data structure. Accessing it directly is not thread-safe.
+   * @return The wrapped data structure.
+   */
+  const NearestNeighborsPtr& getNearestNeighbors() const
+  {
+    return nearest_neighbors_;
+  }
+
+protected:
+
+  /**
+   * @brief nearest_neighbors_ The wrapped data structure.
+   */
+  NearestNeighborsPtr nearest_neighbors_;
+
+  /**
+   * @brief mutex_ Shared by the queries, exclusive for the functions modifying nearest_neighbors_.
+   */
+  std::shared_mutex mutex_;
+
+  /**
+   * @brief turnstile_ Held by a writer while it waits for and holds mutex_, and crossed by the readers before
+   * locking mutex_, so that new readers cannot overtake a waiting writer.
+   */
+  std::mutex turnstile_;
+
+  /**
+   * @brief Returns the wrappers whose shared lock is held by the calling thread, innermost last.
+   */
+  static std::vector<const ConcurrentNearestNeighbors*>& readLocks();
+
+  /**
+   * @brief Returns true if the calling thread holds the shared lock of this wrapper, e.g. inside a visitor of near().
+   */
+  bool readLockedByThisThread() const;
+
+  /**
+   * @brief Exclusive lock of mutex_, acquired holding the turnstile.
+   * @throws std::logic_error if the calling thread holds the shared lock, which would deadlock.
+   */
+  class WriteLock
+  {
+  public:
+    WriteLock(ConcurrentNearestNeighbors& nn);
+  private:
+    std::unique_lock<std::mutex> turnstile_;
+    std::unique_lock<std::shared_mutex> lock_;
+  };
+
+  /**
+   * @brief Shared lock of mutex_, acquired crossing the turnstile.
+   * A thread already holding the shared lock (a query nested in a visitor) does not lock again: crossing the
+   * turnstile could wait for a writer that is in turn waiting for the outer lock.
+   */
+  class ReadLock
+  {
+  public:
+    ReadLock(ConcurrentNearestNeighbors& nn);
+    ~ReadLock();
+  private:
+    std::shared_lock<std::shared_mutex> lock_;
+  };
+};
+
+} //end namespace core
+} // end namespace graph
@@ -0,0 +1,313 @@
+/*
+Copyright (c) 2024, Manuel Beschi and Cesare Tonola, JRL-CARI CNR-STIIMA/UNIBS, manuel.beschi@unibs.it, c.tonola001@unibs.it
+Manuel Beschi manuel.beschi@unibs.it
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of the <organization> nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL <COPYRIGHT HOLDER> BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+PSEUDO CODE :
+- M. Teschner et al., Optimized spatial hashing for collision detection of deformable objects, VMV 2003
+*/
+#pragma once
+
+#include <graph_core/datastructure/nearest_neighbors.h>
+#include <array>
+
+namespace graph
+{
+namespace core
+{
+
+class HashGrid;
+typedef std::shared_ptr<HashGrid> HashGridPtr;
+
+/**
+ * @class HashGrid
+ * @brief NearestNeighbors implementation using a uniform grid stored in a hash map, for low-dimensional spaces.
+ *
+ * The space is divided into hypercubic cells of side cell_size_ and each node is stored in the cell containing its
+ * (scaled) configuration. Only non-empty cells are stored, so the memory does not depend on the extent of the space.
+ * Insertions, deletions and restorations are O(1).
+ *
+ * near() visits the cells overlapping the ball of the query, so with a radius comparable to the cell size
+ * (e.g., cell_size_ = Tree::max_distance_) it takes constant time for a bounded density of nodes.
+ * nearestNeighbor() and kNearestNeighbors() visit rings of cells of increasing Chebyshev distance from the cell of the
+ * query and stop as soon as the next ring cannot contain closer nodes. If a ring has more cells than the non-empty ones,
+ * the remaining non-empty cells are scanned instead, so a query never costs more than a linear search.
+ *
+ * The number of cells of a ring grows as 3^dof, so the grid is limited to MAX_DIMENSION dimensions.
+ */
+class HashGrid: public NearestNeighbors
+{
+public:
+
+  /**
+   * @brief Maximum dimension of the configurations. Tree falls back to an ArenaKdTree for larger dimensions.
+   */
+  static constexpr unsigned int MAX_DIMENSION = 4;
+
+  /**
+   * @brief Constructor for the HashGrid class.
+   * @param cell_size The side of the cells, in the (scaled) configuration space.
+   */
+  HashGrid(const double& cell_size, const cnr_logger::TraceLoggerPtr& logger);
+
+  /**
+   * @brief Implementation of the insert function for adding a node to the grid.
+   *
+   * @param node The node to be inserted.
+   */
+  virtual void insert(const NodePtr& node) override;
+
+  /**
+   * @brief Implementation of the clear function to clear the nearest neighbors data structure.
+   * Additionally, it sets size_ and delted_nodes_ to zero.
+   * @return True if successful, false otherwise.
+   */
+  virtual bool clear() override;
+
+  /**
+   * @brief Store the given nodes from scratch. Nodes are stored in the given order, so getNodes() returns them in the same order.
+   *
+   * @param nodes The nodes to store.
+   */
+  virtual void build(const std::vector<NodePtr>& nodes) override;
+
+  /**
+   * @brief Implementation of the nearestNeighbor function for finding the nearest neighbor in the grid.
+   *
+   * @param configuration The configuration for which the nearest neighbor needs to be found.
+   * @param best Reference to the pointer to the best-matching node.
+   * @param best_distance Reference to the distance to the best-matching node.
+   */
+  virtual void nearestNeighbor(const Eigen::VectorXd& configuration,
+                               NodePtr &best,
+                               double &best_distance) override;
+
+  /**
+   * @brief Implementation of the near function for visiting the nodes within a specified radius in the grid.
+   *
+   * @param configuration The reference configuration.
+   * @param radius The search radius.
+   * @param visitor Function called for each node found; the search stops as soon as it returns false.
+   * @return False if the search has been stopped by the visitor, true otherwise.
+   */
+  virtual bool near(const Eigen::VectorXd& configuration,
+                    const double& radius,
+                    const NearVisitor& visitor) override;
+
+  using NearestNeighbors::near;
+  using NearestNeighbors::nearestNeighbor;
+  using NearestNeighbors::kNearestNeighbors;
+
+  /**
+   * @brief Implementation of the kNearestNeighbors function for finding k nearest neighbors in the grid.
+   *
+   * @param configuration The reference configuration.
+   * @param heap The heap collecting the nearest neighbors, with their squared distances. Its capacity defines k.
+   */
+  virtual void kNearestNeighbors(const Eigen::VectorXd& configuration,
+                                 KNearestNeighborsHeap& heap) override;
+
+  /**
+   * @brief Implementation of the findNode function for checking if a node exists in the grid.
+   *
+   * @param node The node to check.
+   * @return True if the node exists, false otherwise.
+   */
+  virtual bool findNode(const NodePtr& node) override;
+
+  /**
+   * @brief Implementation of the deleteNode function for deleting a node from the grid.
+   *
+   * The node is removed from its cell and marked as deleted, so that it can be restored. If the number of deleted
+   * nodes surpasses 'deleted_nodes_threshold_', the grid is built from scratch with the remaining nodes.
+   *
+   * @param node The node to delete.
+   * @param disconnect_node If true, disconnect the node from the graph.
+   * @return True if the deletion is successful, false otherwise.
+   */
+  virtual bool deleteNode(const NodePtr& node,
+                          const bool& disconnect_node=false) override;
+
+  /**
+   * @brief Implementation of the restoreNode function for restoring a previously deleted node.
+   *
+   * @param node The node to restore.
+   * @return True if the restoration is successful, false otherwise.
+   */
+  virtual bool restoreNode(const NodePtr& node) override;
+
+  /**
+   * @brief Implementation of the getNodes function for getting all nodes in the grid.
+   * Nodes are returned in insertion order, so the first one is the first node inserted.
+   *
+   * @return A vector containing all nodes in the grid.
+   */
+  virtual std::vector<NodePtr> getNodes() override;
+
+  /**
+   * @brief Implementation of the disconnectNodes function for disconnecting nodes in the grid.
+   *
+   * @param white_list A vector of nodes to be excluded from the disconnection process.
+   */
+  virtual void disconnectNodes(const std::vector<NodePtr>& white_list) override;
+
+  /**
+   * @brief cellSize Returns the side of the cells.
+   * @return cell_size_
+   */
+  double cellSize();
+
+  /**
+   * @brief numberOfCells Returns the number of non-empty cells.
+   * @return The size of cells_.
+   */
+  size_t numberOfCells();
+
+  /**
+   * @brief deletedNodesThreshold Returns the deleted_nodes_threshold_,
+   * which represents the number of nodes set as deleted beyond which the grid is built from scratch.
+   * @return deleted_nodes_threshold_
+   */
+  unsigned int deletedNodesThreshold();
+
+  /**
+   * @brief deletedNodesThreshold Sets the value of deleted_nodes_threshold_
+   * @param t The value of deleted_nodes_threshold_ to set.
+   */
+  void deletedNodesThreshold(const unsigned int t);
+
+protected:
+
+  /**
+   * @brief Index used to represent a missing node.
+   */
+  static constexpr uint32_t NONE = std::numeric_limits<uint32_t>::max();
+
+  /**
+   * @brief Integer coordinates of a cell. The components beyond dof_ are zero.
+   */
+  typedef std::array<int64_t,MAX_DIMENSION> CellKey;
+
+  struct CellKeyHash
+  {
+    size_t operator()(const CellKey& key) const
+    {
+      size_t hash = 0;
+      for(const int64_t& k: key)
+        hash ^= std::hash<int64_t>()(k)+0x9e3779b97f4a7c15+(hash<<6)+(hash>>2);
+      return hash;
+    }
+  };
+
+  /**
+   * @brief A node stored in the grid, identified by its index in items_.
+   */
+  struct Item
+  {
+    NodePtr node;
+    bool deleted;
+  };
+
+  /**
+   * @brief items_ The stored nodes, in insertion order.
+   */
+  std::vector<Item> items_;
+
+  /**
+   * @brief configurations_ The configurations of the items scaled by scale_, stored contiguously (dof_ values per item).
+   */
+  std::vector<double> configurations_;
+
+  /**
+   * @brief cells_ The indices of the (not deleted) items of each non-empty cell.
+   */
+  std::unordered_map<CellKey,std::vector<uint32_t>,CellKeyHash> cells_;
+
+  /**
+   * @brief indices_ The index in items_ of each node (including the deleted ones), to find nodes in constant time.
+   */
+  std::unordered_map<const Node*,uint32_t> indices_;
+
+  /**
+   * @brief dof_ The dimension of the configurations, set by the first insertion.
+   */
+  unsigned int dof_;
+
+  /**
+   * @brief cell_size_ The side of the cells.
+   */
+  double cell_size_;
+
+  /**
+   * @brief deleted_nodes_threshold_ When the number of (nodes for which deleted == true) > deleted_nodes_threshold_
+   * the grid is built from scratch
+   */
+  unsigned int deleted_nodes_threshold_;
+
+  /**
+   * @brief scaled_configuration_ Buffer storing the configuration of the inserted node scaled by scale_.
+   */
+  Eigen::VectorXd scaled_configuration_;
+
+  /**
+   * @brief Return the cell containing a (scaled) configuration of dof_ values.
+   */
+  CellKey cellOf(const double* configuration) const;
+
+  /**
+   * @brief Squared distance between a scaled configuration and the item idx.
+   */
+  double squaredDistance(const Eigen::VectorXd& configuration, const uint32_t& idx) const
+  {
+    return (configuration-Eigen::Map<const Eigen::VectorXd>(configurations_.data()+static_cast<size_t>(idx)*dof_,dof_)).squaredNorm();
+  }
+
+  /**
+   * @brief Add the item idx to its cell.
+   */
+  void addToCell(const uint32_t& idx);
+
+  /**
+   * @brief Remove the item idx from its cell, erasing the cell if it becomes empty.
+   */
+  void removeFromCell(const uint32_t& idx);
+
+  /**
+   * @brief Call visitor on the items of each non-empty cell at Chebyshev distance ring from the cell center.
+   * @return False if the visit has been stopped by the visitor, true otherwise.
+   */
+  template<typename Visitor>
+  bool visitRing(const CellKey& center, const int64_t& ring, Visitor& visitor) const;
+
+  /**
+   * @brief Visit the cells around the cell of a scaled configuration by increasing rings, as long as a cell of the next ring
+   * can be closer than sqrt(bound()), and call visitor on the items of each of them.
+   */
+  template<typename Visitor, typename Bound>
+  void visitByRings(const Eigen::VectorXd& configuration, Visitor& visitor, const Bound& bound) const;
+};
+
+} //end namespace core
+} // end namespace graph
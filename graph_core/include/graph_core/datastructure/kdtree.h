@@ -76,7 +76,7 @@ public:
 
   /**
    * @brief Get the stored node.
-   * @return The stored node.
+   * @return The stored node, nullptr if the kdnode is deleted.
    */
   NodePtr node();
 
@@ -132,26 +132,29 @@ public:
   void parent(const KdNodeWeakPtr &kdnode);
 
   /**
-   * @brief Delete the node from the tree.
+   * @brief Delete the node from the tree. The kdnode releases the node, keeping only a weak reference to it,
+   * so that its memory is freed as soon as it is not used elsewhere.
    * @param disconnect_node Flag indicating whether to disconnect the node from the graph/tree.
    */
   void deleteNode(const bool& disconnect_node=false);
 
   /**
    * @brief Restore the node in the tree setting deleted_ flag false.
+   * @param node The node stored by the kdnode before the deletion.
    */
-  void restoreNode();
+  void restoreNode(const NodePtr& node);
 
   /**
    * @brief Insert a node into the tree.
    * @param node The node to insert.
+   * @return The KdNode storing the inserted node.
    */
-  void insert(const NodePtr& node);
+  KdNodePtr insert(const NodePtr& node);
 
   /**
-   * @brief Find the node with the minimum value in the given dimension.
+   * @brief Find the node with the minimum value in the given dimension, among the not deleted ones.
    * @param dim The dimension along which to find the minimum.
-   * @return The KdNode with the minimum value in the specified dimension.
+   * @return The KdNode with the minimum value in the specified dimension, nullptr if all the kdnodes of the subtree are deleted.
    */
   KdNodePtr findMin(const int& dim);
 
@@ -159,31 +162,40 @@ public:
    * @brief Find the nearest neighbor to a given configuration.
    * @param configuration The target configuration for finding the nearest neighbor.
    * @param best The node that is the nearest neighbor.
-   * @param best_distance The distance to the nearest neighbor.
+   * @param best_squared_distance The squared distance to the nearest neighbor.
+   * @param scale The weight of each dimension in the distance, empty for the Euclidean distance.
+   * @param pruning_factor The other side of a splitting plane is visited only if its squared distance is lower than pruning_factor*best_squared_distance.
    */
   void nearestNeighbor(const Eigen::VectorXd& configuration,
                        NodePtr &best,
-                       double &best_distance);
+                       double &best_squared_distance,
+                       const Eigen::VectorXd& scale,
+                       const double& pruning_factor);
 
   /**
-   * @brief Find nodes within a certain radius of a given configuration.
+   * @brief Visit the nodes within a certain radius of a given configuration.
    * @param configuration The target configuration.
    * @param radius The search radius.
-   * @param nodes Multimap to store nodes within the specified radius.
+   * @param visitor Function called for each node within the specified radius; returning false stops the search.
+   * @param scale The weight of each dimension in the distance, empty for the Euclidean distance.
+   * @return False if the search has been stopped by the visitor, true otherwise.
    */
-  void near(const Eigen::VectorXd& configuration,
+  bool near(const Eigen::VectorXd& configuration,
             const double& radius,
-            std::multimap<double, NodePtr> &nodes);
+            const NearVisitor& visitor,
+            const Eigen::VectorXd& scale);
 
   /**
    * @brief Find k-nearest neighbors to a given configuration.
    * @param configuration The target configuration.
-   * @param k The number of nearest neighbors to find.
-   * @param nodes Multimap to store k-nearest neighbors.
+   * @param heap The heap collecting the k-nearest neighbors, with their squared distances.
+   * @param scale The weight of each dimension in the distance, empty for the Euclidean distance.
+   * @param pruning_factor The other side of a splitting plane is visited only if its squared distance is lower than pruning_factor*heap.worst().
    */
   void kNearestNeighbors(const Eigen::VectorXd& configuration,
-                         const size_t& k,
-                         std::multimap<double,NodePtr>& nodes);
+                         KNearestNeighborsHeap& heap,
+                         const Eigen::VectorXd& scale,
+                         const double& pruning_factor);
 
   /**
    * @brief Find a specific node in the tree.
@@ -221,10 +233,21 @@ public:
 protected:
 
   /**
-   * @brief node_ Shared pointer to the associated Node.
+   * @brief node_ Shared pointer to the associated Node, nullptr if the kdnode is deleted.
    */
   NodePtr node_;
 
+  /**
+   * @brief released_node_ Weak pointer to the associated Node when the kdnode is deleted, used to restore it.
+   */
+  std::weak_ptr<Node> released_node_;
+
+  /**
+   * @brief value_ The value of the configuration of the node along dimension_, which is kept after the deletion
+   * to route insertions and queries.
+   */
+  double value_;
+
   /**
    * @brief parent_ Weak pointer to the parent KdNode.
    */
@@ -247,8 +270,8 @@ protected:
 
   /**
    * @brief deleted_ Flag indicating whether the node is deleted.
-   * Deleted nodes are not actually removed from the tree but excluded in functions
-   * like getNodes or nearestNeighbor based on this flag.
+   * Deleted kdnodes are not actually removed from the tree (until it is compacted) but excluded in functions
+   * like getNodes or nearestNeighbor based on this flag. Their node is released.
    */
   bool deleted_;
 
@@ -301,6 +324,17 @@ public:
    */
   virtual bool clear();
 
+  /**
+   * @brief Build a balanced k-d tree from scratch with the given nodes.
+   *
+   * The first node becomes the root of the k-d tree (so getNodes() still returns it first), while its
+   * two subtrees are built recursively splitting the remaining nodes at the median (std::nth_element)
+   * along the cycling dimension. Construction is O(n log n) and the depth is logarithmic.
+   *
+   * @param nodes The nodes to store.
+   */
+  virtual void build(const std::vector<NodePtr>& nodes) override;
+
   /**
    * @brief Find the node with the minimum value in the specified dimension.
    *
@@ -325,24 +359,29 @@ public:
                                double &best_distance) override;
 
   /**
-   * @brief Implementation of the near function for finding nodes within a specified radius in the k-d tree.
+   * @brief Implementation of the near function for visiting the nodes within a specified radius in the k-d tree.
    *
    * @param configuration The reference configuration.
    * @param radius The search radius.
-   * @return A multimap containing nodes and their distances within the specified radius.
+   * @param visitor Function called for each node found; the search stops as soon as it returns false.
+   * @return False if the search has been stopped by the visitor, true otherwise.
    */
-  virtual std::multimap<double, NodePtr> near(const Eigen::VectorXd& configuration,
-                                              const double& radius) override;
+  virtual bool near(const Eigen::VectorXd& configuration,
+                    const double& radius,
+                    const NearVisitor& visitor) override;
+
+  using NearestNeighbors::near;
+  using NearestNeighbors::nearestNeighbor;
+  using NearestNeighbors::kNearestNeighbors;
 
   /**
    * @brief Implementation of the kNearestNeighbors function for finding k nearest neighbors in the k-d tree.
    *
    * @param configuration The reference configuration.
-   * @param k The number of nearest neighbors to find.
-   * @return A multimap containing k nodes and their distances.
+   * @param heap The heap collecting the nearest neighbors, with their squared distances. Its capacity defines k.
    */
-  virtual std::multimap<double,NodePtr> kNearestNeighbors(const Eigen::VectorXd& configuration,
-                                                          const size_t& k) override;
+  virtual void kNearestNeighbors(const Eigen::VectorXd& configuration,
+                                 KNearestNeighborsHeap& heap) override;
 
   /**
    * @brief Implementation of the findNode function for checking if a node exists in the k-d tree.
@@ -359,18 +398,19 @@ public:
    *
    * @param node The node to search for.
    * @param kdnode A reference to a pointer that will store the found KdNode.
+   * The KdNode is looked up in a hash map, so the search is O(1). The search does not modify the KdTree, so it can run concurrently with other searches.
    * @return True if the node is found, false otherwise. If found, kdnode will point to the corresponding KdNode.
    */
   bool findNode(const NodePtr& node,
-                KdNodePtr& kdnode);
+                KdNodePtr& kdnode) const;
 
   /**
    * @brief Implementation of the deleteNode function for deleting a node from the k-d tree.
    *
    * This function removes the specified node from the KdTree. Optionally, it can disconnect the associate NodePtr.
-   * If the number of deleted nodes surpasses the threshold defined by 'deleted_nodes_threshold_',
-   * the KdTree is entirely reconstructed. During the reconstruction, all nodes marked with the 'deleted_'
-   * flag set to true are excluded, except for the root node, which is retained as is regardless of its 'deleted_' status.
+   * The kdnode releases the node immediately, but it stays in the tree to route the searches.
+   * If the number of deleted nodes surpasses the threshold defined by 'deleted_nodes_threshold_' or the fraction
+   * 'deleted_nodes_fraction_' of the kdnodes, the KdTree is compacted (see compact()).
    *
    * @param node The node to delete.
    * @param disconnect_node If true, disconnect the node from the graph.
@@ -401,6 +441,13 @@ public:
    */
   virtual void disconnectNodes(const std::vector<NodePtr>& white_list) override;
 
+  /**
+   * @brief Rebuild the KdTree from scratch without the deleted kdnodes, so that memory and query time depend only on the stored nodes.
+   * The root node is retained as first node regardless of its 'deleted_' status, as long as it is still alive.
+   * It is called automatically by deleteNode, it can be called explicitly when convenient (e.g., outside a time-critical loop).
+   */
+  void compact();
+
   /**
    * @brief deletedNodesThreshold Returns the deleted_nodes_threshold_,
    * which represents the number of nodes set as deleted beyond which the kdtree is built from scratch.
@@ -414,6 +461,20 @@ public:
    */
   void deletedNodesThreshold(const unsigned int t);
 
+  /**
+   * @brief deletedNodesFraction Returns the deleted_nodes_fraction_,
+   * which represents the fraction of deleted kdnodes beyond which the kdtree is built from scratch.
+   * @return deleted_nodes_fraction_
+   */
+  double deletedNodesFraction();
+
+  /**
+   * @brief deletedNodesFraction Sets the value of deleted_nodes_fraction_. Since a rebuild costs O(n log n) and it is
+   * performed after at least fraction*n deletions, the amortized cost of a deletion is O(log n/fraction).
+   * @param fraction The value of deleted_nodes_fraction_ to set, in (0,1]. 1.0 disables the rebuilds triggered by the fraction.
+   */
+  void deletedNodesFraction(const double& fraction);
+
   /**
    * @brief Output stream operator for a KdTree.
    *
@@ -426,6 +487,13 @@ public:
   friend std::ostream& operator<<(std::ostream& os, const KdTree& kdtree);
 
 protected:
+  /**
+   * @brief Erase the entry of node from kdnodes_ if it belongs to a deleted kdnode whose node has been destroyed, i.e. node has been allocated at the same address.
+   * Stale entries are also dropped by insert (overwritten) and compact (rebuilt).
+   * @param node The node.
+   */
+  void eraseStaleNode(const NodePtr& node);
+
   /**
    * @brief root_ Root node of the k-d tree.
    */
@@ -436,6 +504,31 @@ protected:
    * the KdTree is built from scratch
    */
   unsigned int deleted_nodes_threshold_;
+
+  /**
+   * @brief deleted_nodes_fraction_ When the number of (nodes for which deleted_ == true) > deleted_nodes_fraction_
+   * times the number of kdnodes, the KdTree is built from scratch
+   */
+  double deleted_nodes_fraction_;
+
+  /**
+   * @brief kdnodes_ The KdNode storing each node (including the deleted ones), to find nodes in constant time.
+   */
+  std::unordered_map<const Node*,KdNodePtr> kdnodes_;
+
+  /**
+   * @brief Build a balanced subtree with the nodes in [begin,end), splitting them at the median along dimension.
+   * Nodes at the left of the splitting node have a lower value along dimension, the others are at its right.
+   * @param begin Iterator to the first node (the range is reordered).
+   * @param end Iterator past the last node.
+   * @param dimension The splitting dimension of the subtree root.
+   * @param parent The parent of the subtree root.
+   * @return The root of the subtree, nullptr if the range is empty.
+   */
+  KdNodePtr build(const std::vector<NodePtr>::iterator& begin,
+                  const std::vector<NodePtr>::iterator& end,
+                  const int& dimension,
+                  const KdNodeWeakPtr& parent);
 };
 
 } //end namespace core
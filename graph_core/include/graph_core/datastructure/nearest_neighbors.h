@@ -31,10 +31,210 @@ PSEUDO CODE :
 */
 #pragma once
 #include <graph_core/graph/node.h>
+#include <graph_core/datastructure/worker_pool.h>
+#include <functional>
+#include <unordered_map>
 namespace graph
 {
 namespace core
 {
+/**
+ * @brief Enumeration of the available NearestNeighbors implementations.
+ * It is used by Tree to select the data structure storing its nodes.
+ */
+enum class NearestNeighborsType {Vector, KdTree, ArenaKdTree, BucketKdTree, VpTree, HashGrid};
+
+/**
+ * @brief Convert a NearestNeighborsType into the string used in parameters and YAML files.
+ * @param type The type to convert.
+ * @return The corresponding string ("vector", "kdtree", "arena_kdtree", "bucket_kdtree", "vp_tree", "hash_grid").
+ */
+inline std::string toString(const NearestNeighborsType& type)
+{
+  switch(type)
+  {
+  case NearestNeighborsType::Vector:
+    return "vector";
+  case NearestNeighborsType::KdTree:
+    return "kdtree";
+  case NearestNeighborsType::ArenaKdTree:
+    return "arena_kdtree";
+  case NearestNeighborsType::BucketKdTree:
+    return "bucket_kdtree";
+  case NearestNeighborsType::VpTree:
+    return "vp_tree";
+  case NearestNeighborsType::HashGrid:
+    return "hash_grid";
+  }
+  return "";
+}
+
+/**
+ * @brief Convert a string into a NearestNeighborsType.
+ * @param name The string to convert (see toString).
+ * @param type The corresponding type.
+ * @return True if name is a valid type, false otherwise.
+ */
+inline bool fromString(const std::string& name, NearestNeighborsType& type)
+{
+  for(const NearestNeighborsType& t: {NearestNeighborsType::Vector,
+      NearestNeighborsType::KdTree,
+      NearestNeighborsType::ArenaKdTree,
+      NearestNeighborsType::BucketKdTree,
+      NearestNeighborsType::VpTree,
+      NearestNeighborsType::HashGrid})
+  {
+    if(name == toString(t))
+    {
+      type = t;
+      return true;
+    }
+  }
+  return false;
+}
+
+/**
+ * @class KNearestNeighborsHeap
+ * @brief Fixed-capacity max-heap collecting the k nearest nodes found by a query.
+ *
+ * The heap stores squared distances and raw pointers to the nodes owned by the data structure, so that
+ * candidates are pushed without allocating memory or touching reference counters. Its memory is
+ * allocated once, when k is set, and can be reused by several queries calling reset() or swapping
+ * the storage with a caller-owned vector (see swap()).
+ * Results are sorted only at the end of the query (sort() or toMultimap()).
+ */
+class KNearestNeighborsHeap
+{
+public:
+  typedef std::pair<double,Node*> Entry;
+
+  /**
+   * @brief Constructor for the KNearestNeighborsHeap class.
+   * @param k The maximum number of nodes stored.
+   */
+  KNearestNeighborsHeap(const size_t& k=0)
+  {
+    reset(k);
+  }
+
+  /**
+   * @brief Empty the heap and set its capacity.
+   * @param k The maximum number of nodes stored.
+   */
+  void reset(const size_t& k)
+  {
+    k_ = k;
+    entries_.clear();
+    entries_.reserve(k_);
+  }
+
+  /**
+   * @brief Return the maximum number of nodes stored.
+   */
+  size_t k() const
+  {
+    return k_;
+  }
+
+  /**
+   * @brief Return the number of nodes currently stored.
+   */
+  size_t size() const
+  {
+    return entries_.size();
+  }
+
+  /**
+   * @brief Squared distance a candidate must beat to enter the heap: infinity until k nodes have been found,
+   * then the squared distance of the worst stored node.
+   */
+  double worst() const
+  {
+    if(k_ == 0)
+      return -std::numeric_limits<double>::infinity();
+    return (entries_.size()<k_)? std::numeric_limits<double>::infinity(): entries_.front().first;
+  }
+
+  /**
+   * @brief Offer a candidate to the heap. It is stored if the heap is not full or if it is closer than the worst stored node.
+   * @param squared_distance The squared distance of the candidate from the query.
+   * @param node The candidate node, which must outlive the heap content.
+   */
+  void push(const double& squared_distance, const NodePtr& node)
+  {
+    if(entries_.size()<k_)
+    {
+      entries_.push_back(Entry(squared_distance,node.get()));
+      std::push_heap(entries_.begin(),entries_.end(),compare);
+    }
+    else if(k_>0 && squared_distance<entries_.front().first)
+    {
+      std::pop_heap(entries_.begin(),entries_.end(),compare);
+      entries_.back() = Entry(squared_distance,node.get());
+      std::push_heap(entries_.begin(),entries_.end(),compare);
+    }
+  }
+
+  /**
+   * @brief Sort the stored nodes by increasing distance. After this call, push cannot be used until reset is called.
+   * @return The sorted entries (squared distance, pointer to the node).
+   */
+  const std::vector<Entry>& sort()
+  {
+    std::sort_heap(entries_.begin(),entries_.end(),compare);
+    return entries_;
+  }
+
+  /**
+   * @brief Sort the stored nodes and return them in a multimap, with (not squared) distances as keys.
+   */
+  std::multimap<double,NodePtr> toMultimap()
+  {
+    std::multimap<double,NodePtr> nodes;
+    for(const Entry& e:sort())
+      nodes.emplace_hint(nodes.end(),std::sqrt(e.first),e.second->pointer());
+    return nodes;
+  }
+
+  /**
+   * @brief Exchange the heap storage with a caller-owned vector, so that its capacity is reused across queries.
+   * The heap content is undefined after the swap: call reset() before pushing new candidates.
+   * @param entries The vector to exchange with the heap storage.
+   */
+  void swap(std::vector<Entry>& entries)
+  {
+    entries_.swap(entries);
+  }
+
+protected:
+  static bool compare(const Entry& e1, const Entry& e2)
+  {
+    return e1.first<e2.first;
+  }
+
+  size_t k_;
+  std::vector<Entry> entries_;
+};
+
+/**
+ * @brief Squared weighted Euclidean distance between two configurations, sum_i (scale(i)*(configuration1(i)-configuration2(i)))^2.
+ * @param scale The weight of each dimension. If empty, the Euclidean distance is computed.
+ */
+inline double squaredDistance(const Eigen::VectorXd& configuration1,
+                              const Eigen::VectorXd& configuration2,
+                              const Eigen::VectorXd& scale)
+{
+  if(scale.size() == 0)
+    return (configuration1-configuration2).squaredNorm();
+  return (scale.cwiseProduct(configuration1-configuration2)).squaredNorm();
+}
+
+/**
+ * @brief Function called for each node found by a radius query, with its (not squared) distance from the query.
+ * Returning false stops the search.
+ */
+typedef std::function<bool(const double& distance, const NodePtr& node)> NearVisitor;
+
 /**
  * @class NearestNeighbors
  * @brief Abstract base class for handling nearest neighbor search in a graph.
@@ -50,6 +250,75 @@ public:
   {
     deleted_nodes_=0;
     size_=0;
+    epsilon_=0.0;
+    pruning_factor_=1.0;
+  }
+
+  /**
+   * @brief Set the approximation of nearestNeighbor and kNearestNeighbors.
+   * With epsilon>0, a subtree is skipped when it cannot contain nodes closer than best/(1+epsilon), where best is the
+   * distance of the (k-th) nearest node found so far. The (k-th) distance returned is at most (1+epsilon) times the exact one,
+   * while much fewer nodes are visited in high dimension. near() is always exact, as well as the Vector implementation.
+   *
+   * @param epsilon The approximation, 0.0 (default) for exact queries.
+   */
+  virtual void setEpsilon(const double& epsilon)
+  {
+    if(not (epsilon>=0.0))
+    {
+      CNR_FATAL(logger_,"the nearest neighbors epsilon should be non-negative: "<<epsilon);
+      throw std::invalid_argument("the nearest neighbors epsilon should be non-negative");
+    }
+    epsilon_ = epsilon;
+    pruning_factor_ = 1.0/((1.0+epsilon_)*(1.0+epsilon_));
+  }
+
+  /**
+   * @brief Get the approximation of nearestNeighbor and kNearestNeighbors.
+   * @return epsilon, 0.0 if the queries are exact.
+   */
+  const double& getEpsilon() const
+  {
+    return epsilon_;
+  }
+
+  /**
+   * @brief Set the weights of the distance used by the queries, ||scale.*(configuration1-configuration2)||, and rebuild the data structure.
+   * The weighted distance keeps the kd-tree pruning valid, so it should match the scaling of the planning metric
+   * (e.g., the scale of the InformedSampler). Distances returned by the queries are weighted distances.
+   *
+   * @param scale The positive weight of each dimension. An empty vector (or a vector of ones) restores the Euclidean distance.
+   */
+  virtual void setScale(const Eigen::VectorXd& scale)
+  {
+    if((scale.array()<=0.0).any())
+    {
+      CNR_FATAL(logger_,"the scale of the nearest neighbors distance should be positive: "<<scale.transpose());
+      throw std::invalid_argument("the scale of the nearest neighbors distance should be positive");
+    }
+
+    std::vector<NodePtr> nodes = getNodes();
+    if(scale.size()>0 && not nodes.empty() && scale.size() != nodes.front()->getConfiguration().size())
+    {
+      CNR_FATAL(logger_,"the scale size ("<<scale.size()<<") is different from the nodes dimension ("<<nodes.front()->getConfiguration().size()<<")");
+      throw std::invalid_argument("the scale size is different from the nodes dimension");
+    }
+
+    if((scale.array()==1.0).all())
+      scale_.resize(0);
+    else
+      scale_ = scale;
+
+    build(nodes);
+  }
+
+  /**
+   * @brief Get the weights of the distance used by the queries.
+   * @return The weight of each dimension, empty if the Euclidean distance is used.
+   */
+  const Eigen::VectorXd& getScale() const
+  {
+    return scale_;
   }
 
   /**
@@ -65,6 +334,20 @@ public:
    */
   virtual bool clear()=0;
 
+  /**
+   * @brief Clear the data structure and fill it with the given nodes.
+   * The default implementation inserts the nodes one by one; tree-based implementations override it
+   * to build a balanced structure. The first node of the vector is always the first one returned by getNodes().
+   *
+   * @param nodes The nodes to store.
+   */
+  virtual void build(const std::vector<NodePtr>& nodes)
+  {
+    clear();
+    for(const NodePtr& n:nodes)
+      insert(n);
+  }
+
   /**
    * @brief Pure virtual function to find the nearest neighbor to a given configuration.
    *
@@ -93,24 +376,144 @@ public:
   }
 
   /**
-   * @brief Pure virtual function to find nodes within a specified radius of a given configuration.
+   * @brief Pure virtual function to visit the nodes within a specified radius of a given configuration.
+   * Nodes are visited in traversal order, not sorted by distance.
+   *
+   * @param configuration The reference configuration.
+   * @param radius The search radius.
+   * @param visitor Function called for each node found; the search stops as soon as it returns false.
+   * @return False if the search has been stopped by the visitor, true otherwise.
+   */
+  virtual bool near(const Eigen::VectorXd& configuration,
+                    const double& radius,
+                    const NearVisitor& visitor)=0;
+
+  /**
+   * @brief Function to find nodes within a specified radius of a given configuration.
    *
    * @param configuration The reference configuration.
    * @param radius The search radius.
    * @return A multimap containing nodes and their distances within the specified radius.
    */
   virtual std::multimap<double, NodePtr> near(const Eigen::VectorXd& configuration,
-                            const double& radius)=0;
+                            const double& radius)
+  {
+    std::multimap<double, NodePtr> nodes;
+    near(configuration,radius,[&nodes](const double& distance, const NodePtr& node){
+      nodes.emplace(distance,node);
+      return true;
+    });
+    return nodes;
+  }
+
+  /**
+   * @brief Function to find nodes within a specified radius of a given configuration, writing them into a caller-owned vector.
+   * Reusing the same vector across queries avoids any memory allocation once its capacity is large enough.
+   *
+   * @param configuration The reference configuration.
+   * @param radius The search radius.
+   * @param nodes The nodes found and their distances, sorted by increasing distance. Its previous content is discarded.
+   * The pointers are valid as long as the nodes are stored in the data structure.
+   */
+  void near(const Eigen::VectorXd& configuration,
+            const double& radius,
+            std::vector<std::pair<double,Node*>>& nodes)
+  {
+    nodes.clear();
+    near(configuration,radius,[&nodes](const double& distance, const NodePtr& node){
+      nodes.emplace_back(distance,node.get());
+      return true;
+    });
+    std::sort(nodes.begin(),nodes.end(),[](const std::pair<double,Node*>& n1, const std::pair<double,Node*>& n2){
+      return n1.first<n2.first;
+    });
+  }
 
   /**
    * @brief Pure virtual function to find k nearest neighbors to a given configuration.
    *
    * @param configuration The reference configuration.
+   * @param heap The heap collecting the nearest neighbors, with their squared distances. Its capacity defines k.
+   * It should be empty when the function is called.
+   */
+  virtual void kNearestNeighbors(const Eigen::VectorXd& configuration,
+                                 KNearestNeighborsHeap& heap)=0;
+
+  /**
+   * @brief Function to find k nearest neighbors to a given configuration.
+   *
+   * @param configuration The reference configuration.
    * @param k The number of nearest neighbors to find.
    * @return A multimap containing k nodes and their distances.
    */
   virtual std::multimap<double,NodePtr> kNearestNeighbors(const Eigen::VectorXd& configuration,
-                                 const size_t& k)=0;
+                                 const size_t& k)
+  {
+    KNearestNeighborsHeap heap(k);
+    kNearestNeighbors(configuration,heap);
+    return heap.toMultimap();
+  }
+
+  /**
+   * @brief Function to find k nearest neighbors to a given configuration, writing them into a caller-owned vector.
+   * The vector is used as storage of the search heap, so reusing it across queries avoids any memory allocation
+   * once its capacity is at least k.
+   *
+   * @param configuration The reference configuration.
+   * @param k The number of nearest neighbors to find.
+   * @param nodes The nodes found and their distances, sorted by increasing distance. Its previous content is discarded.
+   * The pointers are valid as long as the nodes are stored in the data structure.
+   */
+  void kNearestNeighbors(const Eigen::VectorXd& configuration,
+                         const size_t& k,
+                         std::vector<std::pair<double,Node*>>& nodes)
+  {
+    KNearestNeighborsHeap heap;
+    heap.swap(nodes);
+    heap.reset(k);
+    kNearestNeighbors(configuration,heap);
+    heap.sort();
+    heap.swap(nodes);
+
+    for(std::pair<double,Node*>& n:nodes)
+      n.first = std::sqrt(n.first);
+  }
+
+  /**
+   * @brief Find the nearest neighbor of each configuration of a batch.
+   * The queries are split into n_threads contiguous ranges run by the threads of a WorkerPool, so the search functions of the
+   * data structure must be safe for concurrent readers (see ConcurrentNearestNeighbors) and the data structure must
+   * not be modified during the call.
+   *
+   * @param configurations The configurations for which the nearest neighbors need to be found.
+   * @param nodes The flat buffer of the results: nodes[i] is the nearest node of configurations[i] and its distance,
+   * (infinity, nullptr) if the data structure is empty. Its previous content is discarded.
+   * The pointers are valid as long as the nodes are stored in the data structure.
+   * @param n_threads The number of threads; 1 runs the queries in the calling thread, 0 uses all the threads of the pool.
+   * @param pool The threads running the queries, nullptr for WorkerPool::shared(). At most pool->size() ranges run concurrently.
+   */
+  virtual void nearestNeighbors(const std::vector<Eigen::VectorXd>& configurations,
+                                std::vector<std::pair<double,Node*>>& nodes,
+                                const unsigned int& n_threads=1,
+                                const WorkerPoolPtr& pool=nullptr);
+
+  /**
+   * @brief Find the k nearest neighbors of each configuration of a batch.
+   * The queries are split as in nearestNeighbors(configurations,nodes,n_threads), and each thread reuses a single
+   * search heap for all its queries.
+   *
+   * @param configurations The reference configurations.
+   * @param k The number of nearest neighbors to find for each configuration.
+   * @param nodes The flat buffer of the results: nodes[i*k+j] is the j-th nearest node of configurations[i] and its distance,
+   * sorted by increasing distance and padded with (infinity, nullptr) if fewer than k nodes are stored. Its previous content is discarded.
+   * @param n_threads The number of threads; 1 runs the queries in the calling thread, 0 uses all the threads of the pool.
+   * @param pool The threads running the queries, nullptr for WorkerPool::shared().
+   */
+  virtual void kNearestNeighbors(const std::vector<Eigen::VectorXd>& configurations,
+                                 const size_t& k,
+                                 std::vector<std::pair<double,Node*>>& nodes,
+                                 const unsigned int& n_threads=1,
+                                 const WorkerPoolPtr& pool=nullptr);
 
   /**
    * @brief Pure virtual function to check if a node exists in the nearest neighbors data structure.
@@ -170,6 +573,34 @@ protected:
    */
   unsigned int deleted_nodes_;
 
+  /**
+   * @brief scale_ Weight of each dimension in the distance used by the queries. Empty if the Euclidean distance is used.
+   */
+  Eigen::VectorXd scale_;
+
+  /**
+   * @brief epsilon_ Approximation of nearestNeighbor and kNearestNeighbors, 0.0 for exact queries.
+   */
+  double epsilon_;
+
+  /**
+   * @brief pruning_factor_ 1/(1+epsilon_)^2. A subtree is visited only if its squared distance from the query
+   * is lower than pruning_factor_ times the squared distance of the (k-th) nearest node found so far.
+   */
+  double pruning_factor_;
+
+  /**
+   * @brief Return configuration if scale_ is empty, otherwise its component-wise product with scale_, stored in buffer.
+   */
+  const Eigen::VectorXd& scaled(const Eigen::VectorXd& configuration, Eigen::VectorXd& buffer) const
+  {
+    if(scale_.size() == 0)
+      return configuration;
+
+    buffer = scale_.cwiseProduct(configuration);
+    return buffer;
+  }
+
   /**
    * @brief Pointer to a TraceLogger instance for logging.
    *
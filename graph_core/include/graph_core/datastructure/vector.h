@@ -74,24 +74,29 @@ public:
                           double &best_distance) override;
 
   /**
-   * @brief Implementation of the near function for finding nodes within a specified radius in the vector.
+   * @brief Implementation of the near function for visiting the nodes within a specified radius in the vector.
    *
    * @param configuration The reference configuration.
    * @param radius The search radius.
-   * @return A multimap containing nodes and their distances within the specified radius.
+   * @param visitor Function called for each node found; the search stops as soon as it returns false.
+   * @return False if the search has been stopped by the visitor, true otherwise.
    */
-  virtual std::multimap<double, NodePtr> near(const Eigen::VectorXd& configuration,
-                            const double& radius) override;
+  virtual bool near(const Eigen::VectorXd& configuration,
+                    const double& radius,
+                    const NearVisitor& visitor) override;
+
+  using NearestNeighbors::near;
+  using NearestNeighbors::nearestNeighbor;
+  using NearestNeighbors::kNearestNeighbors;
 
   /**
    * @brief Implementation of the kNearestNeighbors function for finding k nearest neighbors in the vector.
    *
    * @param configuration The reference configuration.
-   * @param k The number of nearest neighbors to find.
-   * @return A multimap containing k nodes and their distances.
+   * @param heap The heap collecting the nearest neighbors, with their squared distances. Its capacity defines k.
    */
-  virtual std::multimap<double,NodePtr> kNearestNeighbors(const Eigen::VectorXd& configuration,
-                                 const size_t& k) override;
+  virtual void kNearestNeighbors(const Eigen::VectorXd& configuration,
+                                 KNearestNeighborsHeap& heap) override;
 
   /**
    * @brief Implementation of the findNode function for checking if a node exists in the vector.
@@ -103,6 +108,8 @@ public:
 
   /**
    * @brief Implementation of the deleteNode function for deleting a node from the vector.
+   * The last node takes the place of the deleted one, so the deletion is O(1) but it does not preserve the insertion order
+   * (the first node stays first unless it is the deleted one).
    *
    * @param node The node to delete.
    * @param disconnect_node If true, disconnect the node from the graph.
@@ -134,6 +141,11 @@ public:
   virtual void disconnectNodes(const std::vector<NodePtr>& white_list) override;
 protected:
   std::vector<NodePtr> nodes_;
+
+  /**
+   * @brief slots_ Position of each node in nodes_, to find and delete nodes in constant time.
+   */
+  std::unordered_map<const Node*,size_t> slots_;
 };
 
 } //end namespace core
@@ -0,0 +1,410 @@
+/*
+Copyright (c) 2024, Manuel Beschi and Cesare Tonola, JRL-CARI CNR-STIIMA/UNIBS, manuel.beschi@unibs.it, c.tonola001@unibs.it
+Manuel Beschi manuel.beschi@unibs.it
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of the <organization> nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL <COPYRIGHT HOLDER> BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+PSEUDO CODE :
+- P. N. Yianilos, Data structures and algorithms for nearest neighbor search in general metric spaces, SODA 1993
+*/
+#pragma once
+
+#include <graph_core/datastructure/nearest_neighbors.h>
+#include <graph_core/metrics/metrics_base.h>
+namespace graph
+{
+namespace core
+{
+
+class VpTree;
+typedef std::shared_ptr<VpTree> VpTreePtr;
+
+/**
+ * @class VpTree
+ * @brief NearestNeighbors implementation using a vantage-point tree, for metrics that are not Euclidean.
+ *
+ * The distance between two configurations is metrics->utopia(). Differently from the k-d trees, the pruning
+ * of the searches does not rely on the coordinates of the configurations but only on the triangle inequality,
+ * so any utopia satisfying it (e.g., the one of custom MetricsBase plugins) can be used.
+ *
+ * Each internal vp-node stores a vantage point and the median radius of the distances from it: the nodes closer
+ * than the radius are in the inside subtree, the other ones in the outside subtree. Each subtree also records
+ * the range of the distances of its nodes from the parent vantage point, which bounds the distance from a query.
+ * Leaves store buckets of up to bucket_size_ nodes together with their distance from the parent vantage point,
+ * so that most of the bucket entries are discarded without evaluating the metrics.
+ *
+ * A full leaf is split choosing as vantage point the node farthest from the parent one. Insertions are kept
+ * balanced with a scapegoat rule: a subtree whose size has at least doubled since it was built and whose
+ * larger child holds more than alpha times its nodes is rebuilt with median splits. Rebuilds reuse the
+ * vp-nodes of the arena, nodes are not moved.
+ */
+class VpTree: public NearestNeighbors
+{
+public:
+
+  /**
+   * @brief Constructor for the VpTree class.
+   * @param metrics The metrics whose utopia is the distance of the queries.
+   */
+  VpTree(const MetricsPtr& metrics, const cnr_logger::TraceLoggerPtr& logger);
+
+  /**
+   * @brief Implementation of the insert function for adding a node to the vp-tree.
+   *
+   * @param node The node to be inserted.
+   */
+  virtual void insert(const NodePtr& node) override;
+
+  /**
+   * @brief Implementation of the clear function to clear the nearest neighbors data structure.
+   * Additionally, it sets size_ and delted_nodes_ to zero.
+   * @return True if successful, false otherwise.
+   */
+  virtual bool clear() override;
+
+  /**
+   * @brief Build a balanced vp-tree from scratch with the given nodes, splitting them recursively at the median distance.
+   * Nodes are stored in the given order, so getNodes() returns them in the same order.
+   *
+   * @param nodes The nodes to store.
+   */
+  virtual void build(const std::vector<NodePtr>& nodes) override;
+
+  /**
+   * @brief The distance of the vp-tree is defined by its metrics, so only an empty scale is accepted.
+   * @param scale The scale of the distance, it should be empty.
+   */
+  virtual void setScale(const Eigen::VectorXd& scale) override;
+
+  /**
+   * @brief Implementation of the nearestNeighbor function for finding the nearest neighbor in the vp-tree.
+   *
+   * @param configuration The configuration for which the nearest neighbor needs to be found.
+   * @param best Reference to the pointer to the best-matching node.
+   * @param best_distance Reference to the distance to the best-matching node.
+   */
+  virtual void nearestNeighbor(const Eigen::VectorXd& configuration,
+                               NodePtr &best,
+                               double &best_distance) override;
+
+  /**
+   * @brief Implementation of the near function for visiting the nodes within a specified radius in the vp-tree.
+   *
+   * @param configuration The reference configuration.
+   * @param radius The search radius.
+   * @param visitor Function called for each node found; the search stops as soon as it returns false.
+   * @return False if the search has been stopped by the visitor, true otherwise.
+   */
+  virtual bool near(const Eigen::VectorXd& configuration,
+                    const double& radius,
+                    const NearVisitor& visitor) override;
+
+  using NearestNeighbors::near;
+  using NearestNeighbors::nearestNeighbor;
+  using NearestNeighbors::kNearestNeighbors;
+
+  /**
+   * @brief Implementation of the kNearestNeighbors function for finding k nearest neighbors in the vp-tree.
+   *
+   * @param configuration The reference configuration.
+   * @param heap The heap collecting the nearest neighbors, with their squared distances. Its capacity defines k.
+   */
+  virtual void kNearestNeighbors(const Eigen::VectorXd& configuration,
+                                 KNearestNeighborsHeap& heap) override;
+
+  /**
+   * @brief Implementation of the findNode function for checking if a node exists in the vp-tree.
+   *
+   * @param node The node to check.
+   * @return True if the node exists, false otherwise.
+   */
+  virtual bool findNode(const NodePtr& node) override;
+
+  /**
+   * @brief Implementation of the deleteNode function for deleting a node from the vp-tree.
+   *
+   * The node is only marked as deleted. If the number of deleted nodes surpasses 'deleted_nodes_threshold_',
+   * the vp-tree is rebuilt from scratch with the remaining nodes.
+   *
+   * @param node The node to delete.
+   * @param disconnect_node If true, disconnect the node from the graph.
+   * @return True if the deletion is successful, false otherwise.
+   */
+  virtual bool deleteNode(const NodePtr& node,
+                          const bool& disconnect_node=false) override;
+
+  /**
+   * @brief Implementation of the restoreNode function for restoring a previously deleted node.
+   *
+   * @param node The node to restore.
+   * @return True if the restoration is successful, false otherwise.
+   */
+  virtual bool restoreNode(const NodePtr& node) override;
+
+  /**
+   * @brief Implementation of the getNodes function for getting all nodes in the vp-tree.
+   * Nodes are returned in insertion order, so the first one is the first node inserted.
+   *
+   * @return A vector containing all nodes in the vp-tree.
+   */
+  virtual std::vector<NodePtr> getNodes() override;
+
+  /**
+   * @brief Implementation of the disconnectNodes function for disconnecting nodes in the vp-tree.
+   *
+   * @param white_list A vector of nodes to be excluded from the disconnection process.
+   */
+  virtual void disconnectNodes(const std::vector<NodePtr>& white_list) override;
+
+  /**
+   * @brief Statistics about the shape of the vp-tree.
+   */
+  struct Statistics
+  {
+    unsigned int max_depth;   //depth of the deepest leaf (the root has depth 0)
+    double average_depth;     //average depth of the nodes, deleted ones included
+    size_t partial_rebuilds;  //number of subtrees rebuilt by the scapegoat rule or split because full
+    size_t rebuilt_nodes;     //total number of nodes moved by the partial rebuilds
+  };
+
+  /**
+   * @brief Compute the depth statistics of the vp-tree. It visits the whole tree, so it is meant for diagnostics.
+   * @return The statistics.
+   */
+  Statistics statistics() const;
+
+  /**
+   * @brief bucketSize Returns the maximum number of nodes stored in a leaf before it is split.
+   * @return bucket_size_
+   */
+  unsigned int bucketSize();
+
+  /**
+   * @brief bucketSize Sets the maximum number of nodes stored in a leaf. It is applied to the leaves created afterwards.
+   * @param bucket_size The bucket size, at least 1.
+   */
+  void bucketSize(const unsigned int& bucket_size);
+
+  /**
+   * @brief balanceFactor Returns the balance factor alpha used by the scapegoat rule.
+   * @return balance_factor_
+   */
+  double balanceFactor();
+
+  /**
+   * @brief balanceFactor Sets the balance factor alpha used by the scapegoat rule.
+   * Lower values give a better balanced tree with more frequent rebuilds, 1.0 disables the rebuilds.
+   * @param alpha The balance factor, in (0.5,1].
+   */
+  void balanceFactor(const double& alpha);
+
+  /**
+   * @brief deletedNodesThreshold Returns the deleted_nodes_threshold_,
+   * which represents the number of nodes set as deleted beyond which the vp-tree is built from scratch.
+   * @return deleted_nodes_threshold_
+   */
+  unsigned int deletedNodesThreshold();
+
+  /**
+   * @brief deletedNodesThreshold Sets the value of deleted_nodes_threshold_
+   * @param t The value of deleted_nodes_threshold_ to set.
+   */
+  void deletedNodesThreshold(const unsigned int t);
+
+protected:
+
+  /**
+   * @brief Index used to represent a missing vantage point or vp-node.
+   */
+  static constexpr uint32_t NONE = std::numeric_limits<uint32_t>::max();
+
+  /**
+   * @brief A node stored in the vp-tree, identified by its index in items_.
+   */
+  struct Item
+  {
+    NodePtr node;
+    bool deleted;
+  };
+
+  /**
+   * @brief An item of a subtree, with its distance from the vantage point of the parent vp-node.
+   */
+  typedef std::pair<uint32_t,double> Entry;
+
+  /**
+   * @brief Element of the arena. It is a leaf if vantage_point == NONE.
+   * lower and upper bound the distances from the parent vantage point of the items in the subtree.
+   */
+  struct VpEntry
+  {
+    uint32_t vantage_point;
+    double radius;
+    uint32_t inside;   //items whose distance from the vantage point is < radius
+    uint32_t outside;  //items whose distance from the vantage point is >= radius
+    double lower;
+    double upper;
+    uint32_t size;        //number of items in the subtree, deleted ones included
+    uint32_t built_size;  //size when the subtree was built
+    std::vector<Entry> bucket;
+  };
+
+  /**
+   * @brief metrics_ The metrics whose utopia is the distance of the queries.
+   */
+  MetricsPtr metrics_;
+
+  /**
+   * @brief items_ The stored nodes, in insertion order.
+   */
+  std::vector<Item> items_;
+
+  /**
+   * @brief vpnodes_ The arena of vp-nodes. The root, if any, is the first element.
+   */
+  std::vector<VpEntry> vpnodes_;
+
+  /**
+   * @brief free_vpnodes_ The vp-nodes of the arena released by the rebuilds, reused by the next ones.
+   */
+  std::vector<uint32_t> free_vpnodes_;
+
+  /**
+   * @brief indices_ The index in items_ of each node (including the deleted ones), to find nodes in constant time.
+   */
+  std::unordered_map<const Node*,uint32_t> indices_;
+
+  /**
+   * @brief dof_ The dimension of the configurations, set by the first insertion.
+   */
+  unsigned int dof_;
+
+  /**
+   * @brief bucket_size_ The maximum number of nodes stored in a leaf before it is split.
+   */
+  unsigned int bucket_size_;
+
+  /**
+   * @brief deleted_nodes_threshold_ When the number of (nodes for which deleted == true) > deleted_nodes_threshold_
+   * the vp-tree is built from scratch
+   */
+  unsigned int deleted_nodes_threshold_;
+
+  /**
+   * @brief balance_factor_ The alpha parameter of the scapegoat rule.
+   */
+  double balance_factor_;
+
+  /**
+   * @brief partial_rebuilds_ Number of subtrees rebuilt by the scapegoat rule or split because full.
+   */
+  size_t partial_rebuilds_;
+
+  /**
+   * @brief rebuilt_nodes_ Number of items moved by the partial rebuilds.
+   */
+  size_t rebuilt_nodes_;
+
+  /**
+   * @brief path_ Buffer storing the vp-nodes visited by the last insertion.
+   */
+  std::vector<uint32_t> path_;
+
+  /**
+   * @brief entries_ Buffer storing the items of the subtree to rebuild.
+   */
+  std::vector<Entry> entries_;
+
+  /**
+   * @brief distances_ Buffer storing the distances from the vantage point of the vp-node being built.
+   */
+  std::vector<double> distances_;
+
+  /**
+   * @brief Distance between a configuration and the configuration of the item idx.
+   */
+  double distance(const Eigen::VectorXd& configuration, const uint32_t& idx) const
+  {
+    return metrics_->utopia(configuration,items_[idx].node->getConfiguration());
+  }
+
+  /**
+   * @brief Lower bound of the distance between a configuration and the items of the subtree idx,
+   * given the distance between the configuration and the parent vantage point.
+   */
+  double lowerBound(const uint32_t& idx, const double& parent_distance) const
+  {
+    const VpEntry& vpnode = vpnodes_[idx];
+    return std::max(0.0,std::max(vpnode.lower-parent_distance,parent_distance-vpnode.upper));
+  }
+
+  /**
+   * @brief Get a vp-node from free_vpnodes_, or append a new one to the arena.
+   */
+  uint32_t newVpNode();
+
+  /**
+   * @brief Build a balanced subtree in the vp-node idx with the items in [begin,end).
+   * @param has_parent True if the subtree has a parent vantage point, so that the second element of the entries is meaningful.
+   */
+  void build(const uint32_t& idx,
+             const std::vector<Entry>::iterator& begin,
+             const std::vector<Entry>::iterator& end,
+             const bool& has_parent);
+
+  /**
+   * @brief Rebuild the subtree of the vp-node idx, whose parent vantage point is parent_vantage_point (NONE for the root).
+   */
+  void rebuildSubtree(const uint32_t& idx, const uint32_t& parent_vantage_point);
+
+  /**
+   * @brief Recursive implementation of the nearestNeighbor function.
+   * @param parent_distance The distance between the configuration and the parent vantage point, negative for the root.
+   */
+  void nearestNeighbor(const uint32_t& idx,
+                       const Eigen::VectorXd& configuration,
+                       const double& parent_distance,
+                       uint32_t& best,
+                       double& best_distance) const;
+
+  /**
+   * @brief Recursive implementation of the near function.
+   */
+  bool near(const uint32_t& idx,
+            const Eigen::VectorXd& configuration,
+            const double& parent_distance,
+            const double& radius,
+            const NearVisitor& visitor) const;
+
+  /**
+   * @brief Recursive implementation of the kNearestNeighbors function.
+   */
+  void kNearestNeighbors(const uint32_t& idx,
+                         const Eigen::VectorXd& configuration,
+                         const double& parent_distance,
+                         KNearestNeighborsHeap& heap) const;
+};
+
+} //end namespace core
+} // end namespace graph
@@ -0,0 +1,154 @@
+#pragma once
+/*
+Copyright (c) 2024, Manuel Beschi and Cesare Tonola, JRL-CARI CNR-STIIMA/UNIBS, manuel.beschi@unibs.it, c.tonola001@unibs.it
+Manuel Beschi manuel.beschi@unibs.it
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of the <organization> nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL <COPYRIGHT HOLDER> BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <memory>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <functional>
+#include <condition_variable>
+
+namespace graph
+{
+namespace core
+{
+class WorkerPool;
+typedef std::shared_ptr<WorkerPool> WorkerPoolPtr;
+
+/**
+ * @class WorkerPool
+ * @brief Persistent threads running batches of independent tasks.
+ *
+ * The threads are created once and wait for the next batch, so running a batch does not create threads.
+ * The calling thread takes part in the batch and run returns when all the tasks are done.
+ * One batch runs at a time: a batch requested while the pool is busy, or from inside a task, runs in the calling thread.
+ * Tasks must not throw.
+ */
+class WorkerPool
+{
+protected:
+  /**
+   * @brief The threads of the pool, the calling thread excluded.
+   */
+  std::vector<std::thread> threads_;
+
+  /**
+   * @brief Held while a batch runs.
+   */
+  std::mutex run_mtx_;
+
+  /**
+   * @brief Protects the batch state and the counters below.
+   */
+  std::mutex mtx_;
+  std::condition_variable start_cv_;
+  std::condition_variable done_cv_;
+
+  /**
+   * @brief Task of the current batch, called with the index of each task.
+   */
+  const std::function<void(const size_t& task)>* task_ = nullptr;
+
+  /**
+   * @brief Number of tasks of the current batch.
+   */
+  size_t n_tasks_ = 0;
+
+  /**
+   * @brief Index of the next task to run.
+   */
+  std::atomic<size_t> next_task_{0};
+
+  /**
+   * @brief Number of threads still working on the current batch.
+   */
+  size_t busy_threads_ = 0;
+
+  /**
+   * @brief Incremented at every batch, so that the threads recognize a new one.
+   */
+  uint64_t batch_ = 0;
+
+  bool stop_ = false;
+
+  /**
+   * @brief Loop of the threads of the pool.
+   */
+  void work();
+
+  /**
+   * @brief Run the tasks of the current batch until none is left.
+   */
+  void runTasks();
+
+public:
+  /**
+   * @brief Constructor.
+   * @param n_threads The number of threads running a batch, the calling thread included; 0 uses the hardware concurrency.
+   */
+  WorkerPool(const unsigned int& n_threads);
+  ~WorkerPool();
+
+  WorkerPool(const WorkerPool&) = delete;
+  WorkerPool& operator=(const WorkerPool&) = delete;
+
+  /**
+   * @brief Retrieves the number of threads running a batch, the calling thread included.
+   */
+  unsigned int size() const
+  {
+    return threads_.size()+1;
+  }
+
+  /**
+   * @brief Run task(0), ..., task(n_tasks-1) and wait for them. Tasks are taken in increasing order by the free threads.
+   * @param n_tasks The number of tasks.
+   * @param task The function called with the index of each task.
+   */
+  void run(const size_t& n_tasks, const std::function<void(const size_t& task)>& task);
+
+  /**
+   * @brief Split [0,n) into n_ranges contiguous ranges of similar size and run body on each of them.
+   * @param n The number of elements.
+   * @param n_ranges The number of ranges; 0 uses size().
+   * @param body The function called with the bounds [begin,end) of each range.
+   */
+  void parallelFor(const size_t& n,
+                   const unsigned int& n_ranges,
+                   const std::function<void(const size_t& begin, const size_t& end)>& body);
+
+  /**
+   * @brief Pool shared by the whole process, with one thread per hardware thread. It is created at its first use.
+   */
+  static WorkerPool& shared();
+};
+
+} //end namespace core
+} //end namespace graph
@@ -27,6 +27,8 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 */
 
 #include <graph_core/graph/node.h>
+#include <graph_core/graph/flag_set.h>
+#include <graph_core/graph/property_set.h>
 
 namespace graph
 {
@@ -52,6 +54,12 @@ protected:
    */
   NodeWeakPtr parent_;
 
+  /**
+   * @brief Raw pointer to the parent node, kept in sync with parent_.
+   * It is used by the non-allocating views of Node, which must not lock parent_.
+   */
+  Node* parent_ptr_;
+
   /**
    * @brief Shared pointer to the child node.
    */
@@ -87,15 +95,16 @@ protected:
   cnr_logger::TraceLoggerPtr logger_;
 
   /**
-   * @brief Vector of boolean flags.
+   * @brief Set of boolean flags.
    *
-   * This member variable represents a vector of boolean flags associated with the connection.
+   * This member variable represents a set of boolean flags associated with the connection.
+   * The first FlagSet::INLINE_FLAGS flags are stored inline, so they do not require memory allocations.
    * By default, the first three positions are reserved for valid flag, net flag and recently checked flag.
    * You can add new flags specific to your algorithm using function setFlag and passing the vector-index to store the flag.
    * getReservedFlagsNumber allows you to know how many positions are reserved for the defaults.
    * setFlag doesn't allow you to overwrite these positions. To overwrite them, use the flag-specific functions.
    */
-  std::vector<bool> flags_;
+  FlagSet flags_;
 
 public:
   EIGEN_MAKE_ALIGNED_OPERATOR_NEW
@@ -134,13 +143,13 @@ public:
   static constexpr unsigned int number_reserved_flags_ = 4;
 
   /**
-   * @brief Map of properties associated with the connection.
+   * @brief Properties associated with the connection.
    *
-   * This member variable represents a map of properties associated with the connection.
-   * The map uses strings as keys and std::any as values to store heterogeneous data types.
-   * Store in properties_ any object you need to customize the connection.
+   * This member variable stores the properties associated with the connection as std::any values to store heterogeneous data types.
+   * Store in properties_ any object you need to customize the connection. Access them through a PropertyKey to avoid hashing the name.
+   * Connections without properties do not allocate memory.
    */
-  std::unordered_map<std::string, std::any> properties_;
+  PropertySet properties_;
 
   /**
    * @brief Constructor for the Connection class.
@@ -195,7 +204,7 @@ public:
    */
   void setRecentlyChecked(bool checked)
   {
-    flags_[idx_recently_checked_] = checked;
+    flags_.set(idx_recently_checked_,checked);
   }
 
   /**
@@ -213,10 +222,7 @@ public:
    *
    * @param cost The cost value to be set for the Connection.
    */
-  void setCost(const double& cost)
-  {
-    cost_ = cost;
-  }
+  void setCost(const double& cost);
 
   /**
    * @brief Gets the cost of the Connection.
@@ -318,6 +324,16 @@ public:
    */
   bool getFlag(const size_t& idx, const bool default_value);
 
+  /**
+   * @brief Retrieves the number of flags, reserved flags included.
+   *
+   * @return The number of flags.
+   */
+  size_t getFlagsSize() const
+  {
+    return flags_.size();
+  }
+
   /**
    * @brief Adds the Connection to the corresponding nodes' connection vectors.
    *
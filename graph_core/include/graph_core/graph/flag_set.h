@@ -0,0 +1,169 @@
+#pragma once
+/*
+Copyright (c) 2024, Manuel Beschi and Cesare Tonola, JRL-CARI CNR-STIIMA/UNIBS, manuel.beschi@unibs.it, c.tonola001@unibs.it
+Manuel Beschi manuel.beschi@unibs.it
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of the <organization> nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL <COPYRIGHT HOLDER> BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <cstdint>
+#include <memory>
+#include <algorithm>
+#include <initializer_list>
+
+namespace graph
+{
+namespace core
+{
+/**
+ * @class FlagSet
+ * @brief Growable set of boolean flags stored inline.
+ *
+ * The first INLINE_FLAGS flags are the bits of a single word, so reading or writing them is a shift and a mask and
+ * creating the set does not allocate memory. Further flags, added with push_back, are stored in an overflow array of words
+ * allocated on the heap only when needed.
+ */
+class FlagSet
+{
+protected:
+  /**
+   * @brief Bits of the first INLINE_FLAGS flags.
+   */
+  uint64_t bits_;
+
+  /**
+   * @brief Number of flags.
+   */
+  unsigned int size_;
+
+  /**
+   * @brief Bits of the flags beyond the first INLINE_FLAGS, nullptr until needed.
+   */
+  std::unique_ptr<uint64_t[]> overflow_;
+
+  /**
+   * @brief Number of words of overflow_ needed to store n flags.
+   */
+  static size_t overflowWords(const size_t& n)
+  {
+    return n>INLINE_FLAGS? (n-INLINE_FLAGS+63)/64: 0;
+  }
+
+public:
+  /**
+   * @brief Number of flags stored inline.
+   */
+  static constexpr unsigned int INLINE_FLAGS = 64;
+
+  FlagSet(): bits_(0), size_(0){}
+
+  FlagSet(const std::initializer_list<bool>& flags): FlagSet()
+  {
+    for(const bool& flag: flags)
+      push_back(flag);
+  }
+
+  FlagSet(const FlagSet& other): bits_(other.bits_), size_(other.size_)
+  {
+    const size_t words = overflowWords(size_);
+    if(words>0)
+    {
+      overflow_ = std::make_unique<uint64_t[]>(words);
+      std::copy(other.overflow_.get(),other.overflow_.get()+words,overflow_.get());
+    }
+  }
+
+  FlagSet(FlagSet&& other) = default;
+  FlagSet& operator=(FlagSet&& other) = default;
+
+  FlagSet& operator=(const FlagSet& other)
+  {
+    if(this != &other)
+      *this = FlagSet(other);
+    return *this;
+  }
+
+  /**
+   * @brief Returns the number of flags.
+   */
+  size_t size() const
+  {
+    return size_;
+  }
+
+  /**
+   * @brief Returns the value of the flag at index idx, which must be less than size().
+   */
+  bool operator[](const size_t& idx) const
+  {
+    if(idx<INLINE_FLAGS)
+      return (bits_>>idx) & 1;
+
+    const size_t i = idx-INLINE_FLAGS;
+    return (overflow_[i/64]>>(i%64)) & 1;
+  }
+
+  /**
+   * @brief Sets the value of the flag at index idx, which must be less than size().
+   */
+  void set(const size_t& idx, const bool flag)
+  {
+    uint64_t* word;
+    uint64_t mask;
+    if(idx<INLINE_FLAGS)
+    {
+      word = &bits_;
+      mask = uint64_t(1)<<idx;
+    }
+    else
+    {
+      const size_t i = idx-INLINE_FLAGS;
+      word = &overflow_[i/64];
+      mask = uint64_t(1)<<(i%64);
+    }
+
+    flag? (*word |= mask): (*word &= ~mask);
+  }
+
+  /**
+   * @brief Appends a flag. The overflow array is reallocated every 64 flags beyond the first INLINE_FLAGS.
+   */
+  void push_back(const bool flag)
+  {
+    const size_t words = overflowWords(size_);
+    if(overflowWords(size_+1)>words)
+    {
+      std::unique_ptr<uint64_t[]> overflow = std::make_unique<uint64_t[]>(words+1); //zero-initialized
+      if(words>0)
+        std::copy(overflow_.get(),overflow_.get()+words,overflow.get());
+      overflow_ = std::move(overflow);
+    }
+
+    size_++;
+    set(size_-1,flag);
+  }
+};
+
+} //end namespace core
+} //end namespace graph
@@ -0,0 +1,305 @@
+#pragma once
+/*
+Copyright (c) 2024, Manuel Beschi and Cesare Tonola, JRL-CARI CNR-STIIMA/UNIBS, manuel.beschi@unibs.it, c.tonola001@unibs.it
+Manuel Beschi manuel.beschi@unibs.it
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of the <organization> nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL <COPYRIGHT HOLDER> BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <span>
+#include <functional>
+#include <graph_core/graph/node_side_table.h>
+
+namespace graph
+{
+namespace core
+{
+class FrozenTree;
+typedef std::shared_ptr<const FrozenTree> FrozenTreePtr;
+
+/**
+ * @class FrozenTree
+ * @brief Immutable snapshot of a Tree, stored in compressed sparse row (CSR) format.
+ *
+ * Nodes are identified by their index in the snapshot, assigned in breadth-first order from the root (index 0),
+ * so the parent of a node always has a lower index. The snapshot stores contiguously the configurations, the index
+ * and the cost of the parent connection of each node, the children of each node (offsets into a single array) and the cost to come.
+ * Queries walk these arrays instead of the shared pointers of the tree, and no member is modified after construction,
+ * so a snapshot can be shared among threads without locks. Nearest neighbor and radius queries use a static kd-tree
+ * built once over the configurations.
+ *
+ * The snapshot keeps the nodes and the parent connections of the tree alive, to map indices back to them,
+ * but it does not follow later changes of the tree: call Tree::freeze again to refresh it.
+ */
+class FrozenTree
+{
+  friend class Tree;
+
+protected:
+  /**
+   * @brief Configurations of the nodes, one per column.
+   */
+  Eigen::MatrixXd configurations_;
+
+  /**
+   * @brief Index of the parent of each node, NO_PARENT for the root.
+   */
+  std::vector<unsigned int> parents_;
+
+  /**
+   * @brief Cost of the parent connection of each node, 0.0 for the root.
+   */
+  std::vector<double> parent_costs_;
+
+  /**
+   * @brief Cost to come of each node, i.e. the sum of the connection costs from the root.
+   */
+  std::vector<double> costs_to_come_;
+
+  /**
+   * @brief The children of node i are children_[children_offsets_[i]] ... children_[children_offsets_[i+1]-1].
+   */
+  std::vector<unsigned int> children_offsets_;
+
+  /**
+   * @brief Children indices of all the nodes, grouped by parent.
+   */
+  std::vector<unsigned int> children_;
+
+  /**
+   * @brief Nodes of the tree, in the order of the snapshot.
+   */
+  std::vector<NodePtr> nodes_;
+
+  /**
+   * @brief Parent connection of each node, nullptr for the root.
+   */
+  std::vector<ConnectionPtr> parent_connections_;
+
+  /**
+   * @brief Index of each node in the snapshot, NO_PARENT for the nodes not in the snapshot.
+   * It is never written after construction, so reading it is thread-safe.
+   */
+  NodeSideTable<unsigned int> indices_;
+
+  /**
+   * @brief Weights of the distance used by near and nearestNeighbor, empty for the Euclidean distance.
+   */
+  Eigen::VectorXd scale_;
+
+  /**
+   * @brief Static kd-tree over the nodes, stored implicitly: the node kd_indices_[m] splits the range [begin,end),
+   * with m = (begin+end)/2, along dimension kd_dimensions_[m]. The nodes in [begin,m) have a lower or equal value
+   * along that dimension, the nodes in (m,end) a greater or equal one.
+   */
+  std::vector<unsigned int> kd_indices_;
+
+  /**
+   * @brief Split dimension of each position of kd_indices_.
+   */
+  std::vector<unsigned int> kd_dimensions_;
+
+  /**
+   * @brief Constructor, used by Tree::freeze.
+   * @param root The root of the tree.
+   * @param in_tree Function returning true if a node belongs to the tree.
+   * @param scale The weights of the distance used by the nearest neighbors of the tree.
+   */
+  FrozenTree(const NodePtr& root, const std::function<bool (const NodePtr&)>& in_tree, const Eigen::VectorXd& scale);
+
+  /**
+   * @brief Squared (weighted) distance between a configuration and the configuration of a node.
+   */
+  double squaredDistance(const Eigen::VectorXd& configuration, const unsigned int& idx) const
+  {
+    if(scale_.size() == 0)
+      return (configurations_.col(idx)-configuration).squaredNorm();
+    return (scale_.cwiseProduct(configurations_.col(idx)-configuration)).squaredNorm();
+  }
+
+  /**
+   * @brief Weight of a dimension in the distance.
+   */
+  double weight(const unsigned int& dimension) const
+  {
+    return scale_.size() == 0? 1.0: scale_(dimension);
+  }
+
+  /**
+   * @brief Build the kd-tree over the positions [begin,end) of kd_indices_.
+   */
+  void buildIndex(const unsigned int& begin, const unsigned int& end);
+
+  void near(const unsigned int& begin,
+            const unsigned int& end,
+            const Eigen::VectorXd& configuration,
+            const double& radius,
+            std::vector<std::pair<double,unsigned int>>& nodes) const;
+
+  void nearestNeighbor(const unsigned int& begin,
+                       const unsigned int& end,
+                       const Eigen::VectorXd& configuration,
+                       unsigned int& best,
+                       double& best_squared_distance) const;
+
+public:
+  /**
+   * @brief Parent index of the root.
+   */
+  static constexpr unsigned int NO_PARENT = std::numeric_limits<unsigned int>::max();
+
+  /**
+   * @brief Retrieves the number of nodes in the snapshot.
+   */
+  unsigned int size() const
+  {
+    return parents_.size();
+  }
+
+  /**
+   * @brief Retrieves the dimension of the configurations.
+   */
+  unsigned int getDimension() const
+  {
+    return configurations_.rows();
+  }
+
+  /**
+   * @brief Retrieves the configuration of a node.
+   * @param idx The index of the node.
+   */
+  auto getConfiguration(const unsigned int& idx) const
+  {
+    return configurations_.col(idx);
+  }
+
+  /**
+   * @brief Retrieves the configurations of all the nodes, one per column, in the order of the snapshot.
+   */
+  const Eigen::MatrixXd& getConfigurations() const
+  {
+    return configurations_;
+  }
+
+  /**
+   * @brief Retrieves the index of the parent of a node, NO_PARENT for the root.
+   * @param idx The index of the node.
+   */
+  unsigned int getParent(const unsigned int& idx) const
+  {
+    return parents_[idx];
+  }
+
+  /**
+   * @brief Retrieves the cost of the parent connection of a node, 0.0 for the root.
+   * @param idx The index of the node.
+   */
+  double getParentCost(const unsigned int& idx) const
+  {
+    return parent_costs_[idx];
+  }
+
+  /**
+   * @brief Retrieves the indices of the children of a node.
+   * @param idx The index of the node.
+   */
+  std::span<const unsigned int> getChildren(const unsigned int& idx) const
+  {
+    return std::span<const unsigned int>(children_.data()+children_offsets_[idx],children_offsets_[idx+1]-children_offsets_[idx]);
+  }
+
+  /**
+   * @brief Retrieves the node of the tree at an index.
+   * @param idx The index of the node.
+   */
+  const NodePtr& getNode(const unsigned int& idx) const
+  {
+    return nodes_[idx];
+  }
+
+  /**
+   * @brief Retrieves the index of a node of the tree.
+   * @param node The node.
+   * @return The index of the node, NO_PARENT if the node was not in the tree when the snapshot was taken.
+   */
+  unsigned int getIndex(const NodePtr& node) const
+  {
+    return indices_.get(node);
+  }
+
+  /**
+   * @brief Equivalent of Tree::costToNode: cost to reach a node from the root, computed when the snapshot was taken.
+   * @param idx The index of the node.
+   */
+  double costToNode(const unsigned int& idx) const
+  {
+    return costs_to_come_[idx];
+  }
+
+  /**
+   * @brief Retrieves the indices of the nodes from the root to a node (both included).
+   * @param idx The index of the node.
+   * @param branch The indices, from the root. Its previous content is discarded.
+   */
+  void getBranchToNode(const unsigned int& idx, std::vector<unsigned int>& branch) const;
+
+  /**
+   * @brief Equivalent of Tree::getConnectionToNode: connections from the root to a node.
+   * @param idx The index of the node.
+   * @return The connections, from the root.
+   */
+  std::vector<ConnectionPtr> getConnectionToNode(const unsigned int& idx) const;
+
+  /**
+   * @brief Retrieves the indices of the nodes of the subtree rooted at a node (the node included), in breadth-first order.
+   * @param idx The index of the root of the subtree.
+   * @param nodes The indices. Its previous content is discarded.
+   */
+  void getSubtree(const unsigned int& idx, std::vector<unsigned int>& nodes) const;
+
+  /**
+   * @brief Equivalent of Tree::getLeaves: indices of the nodes without children, the root excluded.
+   * @param leaves The vector where the indices are appended.
+   */
+  void getLeaves(std::vector<unsigned int>& leaves) const;
+
+  /**
+   * @brief Equivalent of Tree::near: nodes within a radius from a configuration.
+   * @param configuration The configuration.
+   * @param radius The radius.
+   * @param nodes The distances and the indices of the nodes, sorted by increasing distance. Its previous content is discarded.
+   */
+  void near(const Eigen::VectorXd& configuration, const double& radius, std::vector<std::pair<double,unsigned int>>& nodes) const;
+
+  /**
+   * @brief Finds the node closest to a configuration.
+   * @param configuration The configuration.
+   * @param distance The distance of the closest node.
+   * @return The index of the closest node.
+   */
+  unsigned int nearestNeighbor(const Eigen::VectorXd& configuration, double& distance) const;
+};
+
+} //end namespace core
+} //end namespace graph
@@ -0,0 +1,286 @@
+#pragma once
+/*
+Copyright (c) 2024, Manuel Beschi and Cesare Tonola, JRL-CARI CNR-STIIMA/UNIBS, manuel.beschi@unibs.it, c.tonola001@unibs.it
+Manuel Beschi manuel.beschi@unibs.it
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of the <organization> nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL <COPYRIGHT HOLDER> BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <cstdint>
+#include <string>
+#include <graph_core/graph/node.h>
+
+namespace graph
+{
+namespace core
+{
+/**
+ * @brief Header of a binary graph file, see GraphFile.
+ */
+struct GraphFileHeader
+{
+  /**
+   * @brief GraphFile::MAGIC.
+   */
+  char magic[8];
+
+  /**
+   * @brief Version of the format, GraphFile::VERSION when written.
+   */
+  uint32_t version;
+
+  /**
+   * @brief Content of the file, GraphFile::Kind.
+   */
+  uint32_t kind;
+
+  /**
+   * @brief Dimension of the configurations.
+   */
+  uint32_t dof;
+
+  /**
+   * @brief NearestNeighborsType of the tree, 0 for paths.
+   */
+  uint32_t nearest_neighbors;
+
+  /**
+   * @brief Number of nodes.
+   */
+  uint64_t nodes;
+
+  /**
+   * @brief Maximum distance of the tree, 0.0 for paths.
+   */
+  double max_distance;
+
+  /**
+   * @brief Approximation of the nearest neighbors search of the tree, 0.0 for paths.
+   */
+  double nearest_neighbors_epsilon;
+
+  /**
+   * @brief 1 if the file stores the nearest neighbors scale of the tree, 0 otherwise.
+   */
+  uint32_t has_scale;
+
+  uint32_t reserved;
+};
+static_assert(sizeof(GraphFileHeader) == 56, "unexpected padding in GraphFileHeader");
+
+/**
+ * @class GraphFile
+ * @brief Versioned binary file storing a tree or a path, which can be memory-mapped and read without any parsing.
+ *
+ * Nodes are stored so that the parent of a node has a lower index (the root, or the start of a path, is node 0).
+ * After the header, the file contains the following arrays, in native byte order:
+ *  - scale: dof doubles, only if header.has_scale is 1;
+ *  - configurations: nodes*dof doubles, the configuration of node i starts at i*dof;
+ *  - costs: nodes doubles, the cost of the parent connection of each node (0.0 for node 0);
+ *  - node flags: nodes uint64_t, bit k is the flag k of the node;
+ *  - connection flags: nodes uint64_t, bit k is the flag number_reserved_flags_+k of the parent connection;
+ *  - parents: nodes uint32_t, the parent index of each node (NO_PARENT for node 0);
+ *  - node flags sizes and connection flags sizes: nodes uint32_t each, the number of flags stored in the words above.
+ * Only the first 64 non-reserved flags of nodes and connections are stored.
+ *
+ * Write a file by filling a GraphFile::Buffer, read it with open, which maps the file and returns pointers into it.
+ */
+class GraphFile
+{
+public:
+  /**
+   * @brief Content of a file.
+   */
+  enum Kind: uint32_t
+  {
+    TREE = 0,
+    PATH = 1
+  };
+
+  /**
+   * @brief First bytes of every file.
+   */
+  static constexpr char MAGIC[8] = {'G','R','A','P','H','C','R','\0'};
+
+  /**
+   * @brief Version of the format written by Buffer::write.
+   */
+  static constexpr uint32_t VERSION = 1;
+
+  /**
+   * @brief Parent index of node 0.
+   */
+  static constexpr uint32_t NO_PARENT = std::numeric_limits<uint32_t>::max();
+
+  /**
+   * @brief Maximum number of flags stored for each node and connection.
+   */
+  static constexpr unsigned int MAX_FLAGS = 64;
+
+  /**
+   * @class Buffer
+   * @brief Content of a file, filled node by node and written at once.
+   */
+  class Buffer
+  {
+  public:
+    GraphFileHeader header;
+    std::vector<double> scale;
+    std::vector<double> configurations;
+    std::vector<double> costs;
+    std::vector<uint64_t> node_flags;
+    std::vector<uint64_t> connection_flags;
+    std::vector<uint32_t> parents;
+    std::vector<uint32_t> node_flags_sizes;
+    std::vector<uint32_t> connection_flags_sizes;
+
+    /**
+     * @brief Constructor, initializes the header.
+     * @param kind The content of the file.
+     * @param dof The dimension of the configurations.
+     * @param expected_nodes The number of nodes to reserve memory for.
+     */
+    Buffer(const Kind& kind, const unsigned int& dof, const size_t& expected_nodes = 0);
+
+    /**
+     * @brief Appends a node.
+     * @param node The node.
+     * @param parent The index of the parent node, NO_PARENT for node 0.
+     * @param connection The connection from the parent node, nullptr for node 0.
+     * @return The index of the node.
+     */
+    uint32_t addNode(const NodePtr& node, const uint32_t& parent, const ConnectionPtr& connection);
+
+    /**
+     * @brief Writes the file.
+     * @param file_name The name of the file.
+     * @param what The error description, if any.
+     * @return True if the file has been written.
+     */
+    bool write(const std::string& file_name, std::string& what);
+  };
+
+protected:
+  /**
+   * @brief Mapped file, nullptr if not open.
+   */
+  void* data_;
+
+  /**
+   * @brief Size of the mapped file, in bytes.
+   */
+  size_t size_;
+
+  const GraphFileHeader* header_;
+  const double* scale_;
+  const double* configurations_;
+  const double* costs_;
+  const uint64_t* node_flags_;
+  const uint64_t* connection_flags_;
+  const uint32_t* parents_;
+  const uint32_t* node_flags_sizes_;
+  const uint32_t* connection_flags_sizes_;
+
+public:
+  GraphFile();
+  ~GraphFile();
+
+  GraphFile(const GraphFile&) = delete;
+  GraphFile& operator=(const GraphFile&) = delete;
+
+  /**
+   * @brief Maps a file in memory and checks its header and size. An already open file is closed.
+   * @param file_name The name of the file.
+   * @param what The error description, if any.
+   * @return True if the file has been mapped.
+   */
+  bool open(const std::string& file_name, std::string& what);
+
+  /**
+   * @brief Unmaps the file. Pointers returned by the getters are no longer valid.
+   */
+  void close();
+
+  bool isOpen() const
+  {
+    return data_ != nullptr;
+  }
+
+  const GraphFileHeader& getHeader() const
+  {
+    return *header_;
+  }
+
+  /**
+   * @brief Retrieves the number of nodes.
+   */
+  size_t size() const
+  {
+    return header_->nodes;
+  }
+
+  /**
+   * @brief Retrieves the configuration of a node, without copying it.
+   * @param idx The index of the node.
+   */
+  Eigen::Map<const Eigen::VectorXd> getConfiguration(const size_t& idx) const
+  {
+    return Eigen::Map<const Eigen::VectorXd>(configurations_+idx*header_->dof,header_->dof);
+  }
+
+  /**
+   * @brief Retrieves the nearest neighbors scale, empty if not stored.
+   */
+  Eigen::Map<const Eigen::VectorXd> getScale() const
+  {
+    return Eigen::Map<const Eigen::VectorXd>(scale_,header_->has_scale? header_->dof: 0);
+  }
+
+  uint32_t getParent(const size_t& idx) const
+  {
+    return parents_[idx];
+  }
+
+  double getCost(const size_t& idx) const
+  {
+    return costs_[idx];
+  }
+
+  /**
+   * @brief Restores the stored flags of a node and of its parent connection.
+   * @param idx The index of the node.
+   * @param node The node, without non-reserved flags.
+   * @param connection The parent connection, without non-reserved flags. nullptr for node 0.
+   */
+  void restoreFlags(const size_t& idx, const NodePtr& node, const ConnectionPtr& connection) const;
+
+  /**
+   * @brief Writes the nodes and the connections in the YAML format of Tree::toYAML (for trees) or Path::toYAML (for paths).
+   * @return The YAML::Node.
+   */
+  YAML::Node toYAML() const;
+};
+
+} //end namespace core
+} //end namespace graph
@@ -0,0 +1,152 @@
+#pragma once
+/*
+Copyright (c) 2024, Manuel Beschi and Cesare Tonola, JRL-CARI CNR-STIIMA/UNIBS, manuel.beschi@unibs.it, c.tonola001@unibs.it
+Manuel Beschi manuel.beschi@unibs.it
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of the <organization> nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL <COPYRIGHT HOLDER> BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <memory_resource>
+#include <graph_core/graph/node.h>
+
+namespace graph
+{
+namespace core
+{
+class GraphPool;
+typedef std::shared_ptr<GraphPool> GraphPoolPtr;
+
+/**
+ * @class GraphPool
+ * @brief Memory pool for the nodes and connections of a graph.
+ *
+ * Nodes and connections are allocated, together with their shared pointer control blocks, from fixed-size
+ * blocks carved out of large chunks, so creating an object does not go through the general-purpose heap allocator.
+ * The blocks of released objects are reused by the next allocations and all the chunks are given back at once when
+ * the pool is destroyed. Every object keeps the pool alive, so nodes and connections can safely outlive the tree or
+ * the solver which created them.
+ *
+ * Only the Node and Connection objects come from the pool: the vectors and maps they own use the default allocator.
+ * The pool is not thread-safe, like Tree: objects of the same pool must not be created or released concurrently.
+ */
+class GraphPool: public std::enable_shared_from_this<GraphPool>
+{
+protected:
+  /**
+   * @brief Resource which manages the chunks and the free lists of blocks.
+   */
+  std::pmr::unsynchronized_pool_resource resource_;
+
+  /**
+   * @brief Number of objects currently allocated from the pool.
+   */
+  size_t allocated_objects_;
+
+public:
+  /**
+   * @class Allocator
+   * @brief Allocator used with std::allocate_shared to create objects in the pool.
+   *
+   * The allocator holds a shared pointer to the pool, which is stored in the control block of every object.
+   */
+  template<typename T>
+  class Allocator
+  {
+  public:
+    typedef T value_type;
+
+    GraphPoolPtr pool_;
+
+    Allocator(const GraphPoolPtr& pool) noexcept: pool_(pool){}
+
+    template<typename U>
+    Allocator(const Allocator<U>& other) noexcept: pool_(other.pool_){}
+
+    T* allocate(const size_t& n)
+    {
+      return static_cast<T*>(pool_->allocate(n*sizeof(T),alignof(T)));
+    }
+
+    void deallocate(T* p, const size_t& n) noexcept
+    {
+      pool_->deallocate(p,n*sizeof(T),alignof(T));
+    }
+
+    template<typename U>
+    bool operator==(const Allocator<U>& other) const noexcept
+    {
+      return pool_ == other.pool_;
+    }
+  };
+
+  /**
+   * @brief Constructor for the GraphPool class.
+   */
+  GraphPool();
+
+  /**
+   * @brief Allocates raw memory from the pool.
+   * @param bytes The size of the memory block.
+   * @param alignment The alignment of the memory block.
+   * @return A pointer to the memory block.
+   */
+  void* allocate(const size_t& bytes, const size_t& alignment);
+
+  /**
+   * @brief Gives a memory block back to the pool.
+   * @param p The pointer returned by allocate.
+   * @param bytes The size passed to allocate.
+   * @param alignment The alignment passed to allocate.
+   */
+  void deallocate(void* p, const size_t& bytes, const size_t& alignment) noexcept;
+
+  /**
+   * @brief Creates a node in the pool.
+   * @param configuration The configuration of the node.
+   * @param logger The logger of the node.
+   * @return The new node.
+   */
+  NodePtr makeNode(const Eigen::VectorXd& configuration, const cnr_logger::TraceLoggerPtr& logger);
+
+  /**
+   * @brief Creates a connection in the pool. The connection is not added to the nodes, call Connection::add.
+   * @param parent The parent node.
+   * @param child The child node.
+   * @param logger The logger of the connection.
+   * @param is_net True if the connection is a net connection.
+   * @return The new connection.
+   */
+  ConnectionPtr makeConnection(const NodePtr& parent, const NodePtr& child, const cnr_logger::TraceLoggerPtr& logger, const bool is_net = false);
+
+  /**
+   * @brief Returns the number of objects currently allocated from the pool.
+   */
+  size_t allocatedObjects() const
+  {
+    return allocated_objects_;
+  }
+};
+
+} //end namespace core
+} //end namespace graph
@@ -69,14 +69,14 @@ protected:
   std::vector<double> time_vector_;
 
   /**
-   * @brief Vector to store nodes that should be excluded from the search.
+   * @brief Marks of the nodes that should be excluded from the search. All the marks are cleared at the end of each search.
    */
-  std::vector<NodePtr> black_list_;
+  NodeSideTable<uint8_t> black_list_;
 
   /**
-   * @brief Vector to store nodes that have been visited during the search.
+   * @brief Marks of the nodes along the branch currently visited by the search, used to avoid cycles. Each mark is cleared when its node is left.
    */
-  std::vector<NodePtr> visited_nodes_;
+  NodeSideTable<uint8_t> visited_nodes_;
 
   /**
    * @brief Vector to store connections leading to parent nodes during the search.
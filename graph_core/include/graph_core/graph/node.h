@@ -26,8 +26,12 @@ ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
 SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 */
 
+#include <span>
+#include <ranges>
 #include <Eigen/Core>
 #include <graph_core/util.h>
+#include <graph_core/graph/flag_set.h>
+#include <graph_core/graph/property_set.h>
 #include <graph_core/graph/connection.h>
 
 namespace graph
@@ -72,6 +76,18 @@ protected:
    */
   std::vector<ConnectionWeakPtr> net_parent_connections_; //Weak ptr to avoid pointers cycles
 
+  /**
+   * @brief Raw pointers to the parent connections, in the same order as parent_connections_.
+   *
+   * They are used by parentConnectionsView and parentsView to iterate the parent connections without locking the weak pointers.
+   */
+  std::vector<Connection*> parent_connections_ptr_;
+
+  /**
+   * @brief Raw pointers to the net parent connections, in the same order as net_parent_connections_.
+   */
+  std::vector<Connection*> net_parent_connections_ptr_;
+
   /**
    * @brief Vector of pointers to child connections.
    *
@@ -87,14 +103,15 @@ protected:
   std::vector<ConnectionPtr> net_child_connections_;
 
   /**
-   * @brief Vector of boolean flags.
+   * @brief Set of boolean flags.
    *
-   * This member variable represents a vector of boolean flags associated with the node.
+   * This member variable represents a set of boolean flags associated with the node.
+   * The first FlagSet::INLINE_FLAGS flags are stored inline, so they do not require memory allocations.
    * You can add new flags specific to your algorithm using function setFlag and passing the vector-index to store the flag.
    * getReservedFlagsNumber allows you to know how many positions are reserved for the defaults.
    * setFlag doesn't allow you to overwrite these positions. To overwrite them, use the flag-specific functions.
    */
-  std::vector<bool> flags_;
+  FlagSet flags_;
 
   /**
    * @brief Pointer to a TraceLogger instance for logging.
@@ -105,6 +122,36 @@ protected:
    */
   cnr_logger::TraceLoggerPtr logger_;
 
+  /**
+   * @brief Cached cost to come, i.e. the sum of the costs of the parent connections up to the root of the tree containing the node.
+   * It is meaningful only if cost_to_come_valid_ is true.
+   */
+  double cost_to_come_;
+
+  /**
+   * @brief Root of the tree containing the node when cost_to_come_ was computed, nullptr if a node along the way has more than one parent.
+   */
+  Node* cost_to_come_root_;
+
+  /**
+   * @brief Flag indicating whether cost_to_come_ is up to date.
+   * If a node is not valid, none of its successors is valid, so invalidateCostToCome can stop at invalid nodes.
+   */
+  bool cost_to_come_valid_;
+
+  /**
+   * @brief Dense integer identifier of the node, see getId.
+   */
+  unsigned int id_;
+
+  /**
+   * @brief Invalidates the cached cost to come of the node and of its successors.
+   *
+   * It is called when a parent connection of the node is added or removed, or when the cost of its parent connection changes.
+   * The costs are computed again by getCostToCome when needed.
+   */
+  void invalidateCostToCome();
+
   /**
    * @brief Adds a parent connection to the node.
    *
@@ -192,20 +239,20 @@ public:
   EIGEN_MAKE_ALIGNED_OPERATOR_NEW
 
   /**
-   * @brief Map of properties associated with the node.
+   * @brief Properties associated with the node.
    *
-   * This member variable represents a map of propeFties associated with the node.
-   * The map uses strings as keys and std::any as values to store heterogeneous data types.
-   * Store in properties_ any object you need to customize the node.
+   * This member variable stores the properties associated with the node as std::any values to store heterogeneous data types.
+   * Store in properties_ any object you need to customize the node. Access them through a PropertyKey to avoid hashing the name.
+   * Nodes without properties do not allocate memory.
    */
-  std::unordered_map<std::string, std::any> properties_;
+  PropertySet properties_;
 
   /**
    * @brief Constructor for the Node class.
    *
    * This constructor initializes a Node object with the provided configuration vector.
    * It sets the configuration and calculates the number of degrees of freedom (ndof).
-   * Default flags are inserted into the 'flags_' vector at this point.
+   * Default flags are inserted into 'flags_' at this point.
    *
    * @param configuration The Eigen::VectorXd representing the configuration of the node.
    */
@@ -225,6 +272,28 @@ public:
     return shared_from_this();
   }
 
+  /**
+   * @brief Retrieves the identifier of the node.
+   *
+   * Every node gets an identifier when it is created: the identifier of a destroyed node, if any, otherwise a new one.
+   * Each thread keeps a small block of identifiers, so creating and destroying nodes rarely locks.
+   * Identifiers of living nodes are unique and dense, so they can index arrays of per-node data (see NodeSideTable).
+   *
+   * @return The identifier of the node, lower than getIdBound().
+   */
+  unsigned int getId() const
+  {
+    return id_;
+  }
+
+  /**
+   * @brief Retrieves an upper bound of the identifiers of the living nodes.
+   *
+   * @return The number of identifiers allocated so far, i.e. the size of an array indexed by any node identifier.
+   * It includes the identifiers kept by each thread, up to 128 per thread.
+   */
+  static unsigned int getIdBound();
+
   /**
    * Add here your reserved flags.
    * Example:
@@ -283,6 +352,16 @@ public:
    */
   bool getFlag(const size_t& idx, const bool default_value);
 
+  /**
+   * @brief Retrieves the number of flags, reserved flags included.
+   *
+   * @return The number of flags.
+   */
+  size_t getFlagsSize() const
+  {
+    return flags_.size();
+  }
+
   /**
    * @brief Retrieves a pointer to the TraceLogger associated with the node.
    *
@@ -456,6 +535,92 @@ public:
    */
   std::vector<ConnectionPtr> getNetChildConnections() const;
 
+  /**
+   * @brief Non-allocating view of the parent connections of the node.
+   *
+   * Unlike getParentConnections, the view refers to the storage of the node: no vector is built and no weak pointer is locked.
+   * It is invalidated when a parent connection is added or removed, so do not modify the connections of the node while iterating.
+   *
+   * @return A span of raw pointers to the parent connections.
+   */
+  std::span<Connection* const> parentConnectionsView() const
+  {
+    return parent_connections_ptr_;
+  }
+
+  /**
+   * @brief Non-allocating view of the net parent connections of the node. See parentConnectionsView.
+   *
+   * @return A span of raw pointers to the net parent connections.
+   */
+  std::span<Connection* const> netParentConnectionsView() const
+  {
+    return net_parent_connections_ptr_;
+  }
+
+  /**
+   * @brief Non-allocating view of the child connections of the node.
+   *
+   * Unlike getChildConnections, the vector of connections is not copied.
+   * It is invalidated when a child connection is added or removed, so do not modify the connections of the node while iterating.
+   *
+   * @return A span of shared pointers to the child connections.
+   */
+  std::span<const ConnectionPtr> childConnectionsView() const
+  {
+    return child_connections_;
+  }
+
+  /**
+   * @brief Non-allocating view of the net child connections of the node. See childConnectionsView.
+   *
+   * @return A span of shared pointers to the net child connections.
+   */
+  std::span<const ConnectionPtr> netChildConnectionsView() const
+  {
+    return net_child_connections_;
+  }
+
+  /**
+   * @brief Non-allocating view of the child nodes, i.e. the children of the child connections (see childConnectionsView).
+   *
+   * @return A range of references to the shared pointers of the child nodes.
+   */
+  auto childrenView() const
+  {
+    return std::views::transform(childConnectionsView(),[](const auto& conn) -> const NodePtr& {return conn->child_;});
+  }
+
+  /**
+   * @brief Non-allocating view of the net child nodes (see netChildConnectionsView).
+   *
+   * @return A range of references to the shared pointers of the net child nodes.
+   */
+  auto netChildrenView() const
+  {
+    return std::views::transform(netChildConnectionsView(),[](const auto& conn) -> const NodePtr& {return conn->child_;});
+  }
+
+  /**
+   * @brief Non-allocating view of the parent nodes, i.e. the parents of the parent connections (see parentConnectionsView).
+   *
+   * @return A range of raw pointers to the parent nodes.
+   */
+  auto parentsView() const
+  {
+    return std::views::transform(parentConnectionsView(),[](auto* conn) -> Node* {return conn->parent_ptr_;});
+  }
+
+  /**
+   * @brief Non-allocating view of the net parent nodes (see netParentConnectionsView).
+   *
+   * @return A range of raw pointers to the net parent nodes.
+   */
+  auto netParentsView() const
+  {
+    return std::views::transform(netParentConnectionsView(),[](auto* conn) -> Node* {return conn->parent_ptr_;});
+  }
+
   /**
    * @brief Disconnects all child connections of the node.
    *
@@ -521,6 +686,19 @@ public:
     return configuration_;
   }
 
+  /**
+   * @brief Retrieves the cost to come of the node, i.e. the sum of the costs of the parent connections up to the node without parents (the root).
+   *
+   * The cost is cached and it is updated only when a parent connection along the way changes, so the function is O(1) on
+   * repeated calls. The nodes from the node to the root must have exactly one parent connection (net connections are ignored).
+   * The cache of the nodes along the way is written by this function, so it must not be called concurrently on nodes of the same tree,
+   * even if the tree is not modified (see Tree::costToNodeWithoutCache).
+   *
+   * @param root Set to the root reached, or to nullptr if a node along the way has more than one parent connection.
+   * @return The cost to come, infinity if root is nullptr.
+   */
+  double getCostToCome(Node*& root);
+
   /**
    * @brief Retrieves the number of reserved flags for the node.
    *
@@ -0,0 +1,142 @@
+#pragma once
+/*
+Copyright (c) 2024, Manuel Beschi and Cesare Tonola, JRL-CARI CNR-STIIMA/UNIBS, manuel.beschi@unibs.it, c.tonola001@unibs.it
+Manuel Beschi manuel.beschi@unibs.it
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of the <organization> nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL <COPYRIGHT HOLDER> BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <vector>
+#include <algorithm>
+#include <type_traits>
+#include <graph_core/graph/node.h>
+
+namespace graph
+{
+namespace core
+{
+/**
+ * @class NodeSideTable
+ * @brief Per-node data stored in an array indexed by the node identifiers (see Node::getId).
+ *
+ * It replaces maps keyed by node pointers and linear searches in vectors of nodes (e.g., visited sets, black lists) with a
+ * constant-time array access. The array grows on write up to Node::getIdBound(); nodes without a stored value read the default value.
+ * The identifier of a destroyed node is reused, so reset the table (or restore the default values written) between independent uses.
+ *
+ * Use uint8_t instead of bool for flags, std::vector<bool> does not give references to its elements.
+ */
+template<typename T>
+class NodeSideTable
+{
+  static_assert(not std::is_same_v<T,bool>, "use uint8_t instead of bool");
+
+protected:
+  /**
+   * @brief Values of the nodes, indexed by node identifier.
+   */
+  std::vector<T> values_;
+
+  /**
+   * @brief Value of the nodes not written yet.
+   */
+  T default_value_;
+
+public:
+  NodeSideTable(const T& default_value = T()):
+    default_value_(default_value)
+  {
+  }
+
+  /**
+   * @brief Retrieves a reference to the value of a node, growing the table if needed.
+   * @param node The node.
+   * @return The reference to the value, invalidated when the table grows.
+   */
+  T& operator[](const Node* node)
+  {
+    const unsigned int& id = node->getId();
+    if(id>=values_.size())
+      values_.resize(std::max<size_t>(Node::getIdBound(),id+1),default_value_);
+    return values_[id];
+  }
+
+  T& operator[](const NodePtr& node)
+  {
+    return operator[](node.get());
+  }
+
+  /**
+   * @brief Retrieves the value of a node without growing the table.
+   * @param node The node.
+   * @return The value of the node, or the default value if it has never been written.
+   */
+  const T& get(const Node* node) const
+  {
+    const unsigned int& id = node->getId();
+    return id<values_.size()? values_[id]: default_value_;
+  }
+
+  const T& get(const NodePtr& node) const
+  {
+    return get(node.get());
+  }
+
+  /**
+   * @brief Sets the value of every node to the default value, keeping the memory of the table.
+   */
+  void reset()
+  {
+    std::fill(values_.begin(),values_.end(),default_value_);
+  }
+
+  /**
+   * @brief Sets the value of every node to the default value, changing it.
+   * @param default_value The new default value.
+   */
+  void reset(const T& default_value)
+  {
+    default_value_ = default_value;
+    reset();
+  }
+
+  /**
+   * @brief Grows the table to store the values of all the living nodes without further allocations.
+   */
+  void reserve()
+  {
+    if(values_.size()<Node::getIdBound())
+      values_.resize(Node::getIdBound(),default_value_);
+  }
+
+  /**
+   * @brief Retrieves the number of values stored.
+   */
+  size_t size() const
+  {
+    return values_.size();
+  }
+};
+
+} //end namespace core
+} //end namespace graph
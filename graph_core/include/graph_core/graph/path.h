@@ -736,6 +736,45 @@ public:
   static PathPtr fromYAML(const YAML::Node& yaml, const MetricsPtr& metrics,
                           const CollisionCheckerPtr& checker, const cnr_logger::TraceLoggerPtr& logger);
 
+  /**
+   * @brief Write the Path to a binary file (see GraphFile).
+   *
+   * Nodes are written from start to goal (from goal to start if reverse is true), together with the connection costs and the flags.
+   *
+   * @param file_name The name of the file.
+   * @param reverse If true, the path connections will be listed in reverse order.
+   * @return True if the file has been written.
+   */
+  bool toBinary(const std::string& file_name, const bool reverse=false) const;
+
+  /**
+   * @brief Create a Path from a binary file written by toBinary.
+   *
+   * The file is memory-mapped and the connections are created directly from its content. Connection costs are read from the file, not recomputed.
+   *
+   * @param file_name The name of the file.
+   * @param metrics The MetricsPtr of the path.
+   * @param checker The CollisionCheckerPtr of the path.
+   * @param logger The TraceLoggerPtr for logging error messages.
+   * @return The path, nullptr if the file cannot be read or does not contain a path.
+   */
+  static PathPtr fromBinary(const std::string& file_name, const MetricsPtr& metrics,
+                            const CollisionCheckerPtr& checker, const cnr_logger::TraceLoggerPtr& logger);
+
+  /**
+   * @brief Convert a YAML file written by toYAML into a binary file. Connection costs are computed with metrics.
+   * @return True if the conversion succeeded.
+   */
+  static bool yamlToBinary(const std::string& yaml_file_name, const std::string& binary_file_name,
+                           const MetricsPtr& metrics, const cnr_logger::TraceLoggerPtr& logger);
+
+  /**
+   * @brief Convert a binary file written by toBinary into a YAML file, without creating the path.
+   * @return True if the conversion succeeded.
+   */
+  static bool binaryToYAML(const std::string& binary_file_name, const std::string& yaml_file_name,
+                           const cnr_logger::TraceLoggerPtr& logger);
+
   friend std::ostream& operator<<(std::ostream& os, const Path& path);
 };
 
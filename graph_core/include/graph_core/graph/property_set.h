@@ -0,0 +1,314 @@
+#pragma once
+/*
+Copyright (c) 2024, Manuel Beschi and Cesare Tonola, JRL-CARI CNR-STIIMA/UNIBS, manuel.beschi@unibs.it, c.tonola001@unibs.it
+Manuel Beschi manuel.beschi@unibs.it
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of the <organization> nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL <COPYRIGHT HOLDER> BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <any>
+#include <memory>
+#include <string>
+#include <vector>
+#include <utility>
+#include <stdexcept>
+
+namespace graph
+{
+namespace core
+{
+/**
+ * @class PropertyRegistry
+ * @brief Global registry which interns the names of the properties of nodes and connections into small integer ids.
+ *
+ * Names are interned once, typically when a PropertyKey is created, so that the following accesses to the
+ * properties do not hash strings. The registry is thread-safe: lookups take a shared lock, so concurrent readers
+ * do not block each other, and only the registration of a new name takes an exclusive lock.
+ */
+class PropertyRegistry
+{
+public:
+  /**
+   * @brief Returns the id of a property name, registering the name if needed.
+   * @param name The name of the property.
+   * @return The id of the property.
+   */
+  static unsigned int intern(const std::string& name);
+
+  /**
+   * @brief Looks for the id of a property name without registering it.
+   * @param name The name of the property.
+   * @param id The id of the property, if registered.
+   * @return True if the name is registered.
+   */
+  static bool find(const std::string& name, unsigned int& id);
+
+  /**
+   * @brief Returns the name of a registered id.
+   * @throws std::out_of_range if the id is not registered.
+   */
+  static std::string name(const unsigned int& id);
+
+  /**
+   * @brief Returns the number of registered names.
+   */
+  static size_t size();
+};
+
+/**
+ * @class PropertyKey
+ * @brief Typed key of a property, interned once at construction.
+ *
+ * Create the keys once (e.g., as static members of your plugin) and use them to access the properties:
+ * @code
+ * static const graph::core::PropertyKey<double> clearance_key("clearance");
+ * node->properties_.set(clearance_key,0.1);
+ * const double* clearance = node->properties_.get(clearance_key); //nullptr if not set
+ * @endcode
+ */
+template<typename T>
+class PropertyKey
+{
+protected:
+  unsigned int id_;
+
+public:
+  typedef T value_type;
+
+  PropertyKey(const std::string& name): id_(PropertyRegistry::intern(name)){}
+
+  const unsigned int& id() const
+  {
+    return id_;
+  }
+
+  std::string name() const
+  {
+    return PropertyRegistry::name(id_);
+  }
+};
+
+/**
+ * @class PropertySet
+ * @brief Properties of a node or of a connection, identified by the ids of PropertyRegistry.
+ *
+ * Values are stored as std::any in a compact table of (id, value) pairs, allocated when the first property is set:
+ * objects without properties only store a null pointer, and the memory of a set depends on its own properties only,
+ * not on the number of names registered in the process. Objects usually have few properties, so the table is
+ * scanned linearly and accesses through a PropertyKey do not hash strings.
+ *
+ * The string-based functions (operator[], at, count, erase) keep the interface of the std::unordered_map previously
+ * used, but they look up the name in the registry at every call.
+ */
+class PropertySet
+{
+protected:
+  typedef std::vector<std::pair<unsigned int,std::any>> Table;
+
+  /**
+   * @brief The properties, in order of insertion, nullptr until the first property is set.
+   */
+  std::unique_ptr<Table> values_;
+
+  /**
+   * @brief Returns the value of a property id, adding an empty value if needed.
+   */
+  std::any& slot(const unsigned int& id)
+  {
+    if(std::any* value = find(id))
+      return *value;
+
+    if(not values_)
+      values_ = std::make_unique<Table>();
+    values_->emplace_back(id,std::any());
+    return values_->back().second;
+  }
+
+  /**
+   * @brief Returns the value of a property id, nullptr if the property does not exist.
+   */
+  std::any* find(const unsigned int& id)
+  {
+    return const_cast<std::any*>(static_cast<const PropertySet*>(this)->find(id));
+  }
+
+  const std::any* find(const unsigned int& id) const
+  {
+    if(values_)
+    {
+      for(const std::pair<unsigned int,std::any>& value: *values_)
+        if(value.first == id)
+          return &value.second;
+    }
+    return nullptr;
+  }
+
+  /**
+   * @brief Removes a property id.
+   * @return The number of properties removed.
+   */
+  size_t remove(const unsigned int& id)
+  {
+    if(values_)
+    {
+      for(Table::iterator it=values_->begin();it!=values_->end();it++)
+      {
+        if(it->first == id)
+        {
+          values_->erase(it);
+          return 1;
+        }
+      }
+    }
+    return 0;
+  }
+
+public:
+  PropertySet() = default;
+  PropertySet(PropertySet&& other) = default;
+  PropertySet& operator=(PropertySet&& other) = default;
+
+  PropertySet(const PropertySet& other)
+  {
+    if(other.values_ && not other.values_->empty())
+      values_ = std::make_unique<Table>(*other.values_);
+  }
+
+  PropertySet& operator=(const PropertySet& other)
+  {
+    if(this != &other)
+      *this = PropertySet(other);
+    return *this;
+  }
+
+  /**
+   * @brief Sets the value of a property.
+   */
+  template<typename T>
+  void set(const PropertyKey<T>& key, T value)
+  {
+    slot(key.id()) = std::move(value);
+  }
+
+  /**
+   * @brief Returns a pointer to the value of a property, nullptr if the property does not exist or it has a different type.
+   */
+  template<typename T>
+  T* get(const PropertyKey<T>& key)
+  {
+    return const_cast<T*>(static_cast<const PropertySet*>(this)->get(key));
+  }
+
+  template<typename T>
+  const T* get(const PropertyKey<T>& key) const
+  {
+    const std::any* value = find(key.id());
+    return value? std::any_cast<T>(value): nullptr;
+  }
+
+  /**
+   * @brief Returns true if the property exists.
+   */
+  template<typename T>
+  bool has(const PropertyKey<T>& key) const
+  {
+    return find(key.id()) != nullptr;
+  }
+
+  /**
+   * @brief Removes a property.
+   */
+  template<typename T>
+  void erase(const PropertyKey<T>& key)
+  {
+    remove(key.id());
+  }
+
+  /**
+   * @brief Returns the value of a property given its name, creating an empty value if the property does not exist.
+   */
+  std::any& operator[](const std::string& name)
+  {
+    return slot(PropertyRegistry::intern(name));
+  }
+
+  /**
+   * @brief Returns the value of a property given its name.
+   * @throws std::out_of_range if the property does not exist.
+   */
+  std::any& at(const std::string& name)
+  {
+    unsigned int id;
+    std::any* value = PropertyRegistry::find(name,id)? find(id): nullptr;
+    if(not value)
+      throw std::out_of_range("property "+name+" does not exist");
+    return *value;
+  }
+
+  /**
+   * @brief Returns 1 if the property exists, 0 otherwise.
+   */
+  size_t count(const std::string& name) const
+  {
+    unsigned int id;
+    return (PropertyRegistry::find(name,id) && find(id))? 1: 0;
+  }
+
+  /**
+   * @brief Removes a property given its name.
+   * @return The number of properties removed.
+   */
+  size_t erase(const std::string& name)
+  {
+    unsigned int id;
+    return PropertyRegistry::find(name,id)? remove(id): 0;
+  }
+
+  /**
+   * @brief Returns the number of properties.
+   */
+  size_t size() const
+  {
+    return values_? values_->size(): 0;
+  }
+
+  /**
+   * @brief Returns true if there are no properties.
+   */
+  bool empty() const
+  {
+    return size() == 0;
+  }
+
+  /**
+   * @brief Removes all the properties and releases their memory.
+   */
+  void clear()
+  {
+    values_.reset();
+  }
+};
+
+} //end namespace core
+} //end namespace graph
@@ -230,6 +230,14 @@ public:
    */
   virtual void addNode(const NodePtr& node, const bool& check_if_present = true);
 
+  /**
+   * @brief Add many nodes to the subtree and its parent tree.
+   *
+   * @param nodes The nodes to be added.
+   * @param check_if_present If true, check if the nodes are already present in the trees before adding.
+   */
+  virtual void addNodes(const std::vector<NodePtr>& nodes, const bool& check_if_present = true) override;
+
   /**
    * @brief Create a subtree instance.
    *
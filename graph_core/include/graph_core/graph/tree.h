@@ -27,12 +27,20 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 */
 
 #include <graph_core/util.h>
+#include <graph_core/graph/graph_pool.h>
+#include <graph_core/graph/node_side_table.h>
+#include <graph_core/graph/frozen_tree.h>
+#include <graph_core/graph/graph_file.h>
 #include <graph_core/collision_checkers/collision_checker_base.h>
 #include <graph_core/samplers/informed_sampler.h>
 #include <graph_core/metrics/metrics_base.h>
 #include <graph_core/datastructure/nearest_neighbors.h>
 #include <graph_core/datastructure/kdtree.h>
 #include <graph_core/datastructure/vector.h>
+#include <graph_core/datastructure/arena_kdtree.h>
+#include <graph_core/datastructure/bucket_kdtree.h>
+#include <graph_core/datastructure/vp_tree.h>
+#include <graph_core/datastructure/hash_grid.h>
 #include <fstream>
 
 namespace graph
@@ -70,6 +78,11 @@ protected:
    */
   bool use_kdtree_;
 
+  /**
+   * @brief Type of the data structure used for nearest neighbors search.
+   */
+  NearestNeighborsType nn_type_;
+
   /**
    * @brief Maximum distance for connection attempts in the tree.
    */
@@ -104,6 +117,59 @@ protected:
    */
   CollisionCheckerPtr checker_;
 
+  /**
+   * @brief Buffer reused by rewireOnly and informedExtend to store the neighbors of a node, so that neighbor searches do not allocate memory.
+   */
+  std::vector<std::pair<double,Node*>> near_nodes_;
+
+  /**
+   * @brief Number of threads used by rewireOnly to check the candidate connections for collision; 1 checks them in the calling thread, 0 uses the hardware concurrency.
+   */
+  unsigned int rewire_threads_ = 1;
+
+  /**
+   * @brief Clones of checker_ used by the additional threads of rewireOnly, created when needed and released by setChecker.
+   */
+  std::vector<CollisionCheckerPtr> rewire_checkers_;
+
+  /**
+   * @brief Threads used by rewireOnly and by the batch neighbor searches, created with rewire_threads_ threads at the first parallel rewire
+   * and kept until the number of threads changes. If nullptr, the batch searches use WorkerPool::shared().
+   */
+  WorkerPoolPtr rewire_pool_;
+
+  /**
+   * @brief Below this number of candidates, rewireOnly checks them in the calling thread, since waking the pool would cost more than the checks.
+   */
+  static constexpr size_t MIN_PARALLEL_REWIRE_CANDIDATES = 4;
+
+  /**
+   * @brief Memory pool used by createNode and createConnection. If nullptr, nodes and connections are created with std::make_shared.
+   */
+  GraphPoolPtr pool_;
+
+  /**
+   * @brief Marks of the nodes in the white list (or black list) of the purge (or populate) operation in progress.
+   * Every mark is false outside these operations.
+   */
+  NodeSideTable<uint8_t> listed_nodes_;
+
+  /**
+   * @brief Sets the marks of the nodes of a white list or black list in listed_nodes_.
+   * @param nodes The nodes of the list.
+   * @param listed True to mark the nodes when the operation begins, false to clear the marks when it ends.
+   */
+  void markListedNodes(const std::vector<NodePtr>& nodes, const bool& listed)
+  {
+    for(const NodePtr& n: nodes)
+      listed_nodes_[n] = listed;
+  }
+
+  /**
+   * @brief Recursively purges nodes starting from the specified node, skipping the nodes marked in listed_nodes_. See purgeFromHere.
+   */
+  bool purgeUnlistedFromHere(NodePtr& node, unsigned int& removed_nodes);
+
   /**
    * @brief Recursively purges nodes outside an ellipsoid region based on an informed sampler.
    *
@@ -115,12 +181,11 @@ protected:
    *
    * @param node The node from which the recursive purge operation begins.
    * @param sampler An InformedSamplerPtr representing the sampler defining the admissible set.
-   * @param white_list A vector of NodePtr representing nodes that should not be removed.
    * @param removed_nodes A reference to an unsigned int, counting the number of nodes removed.
+   * The nodes of the white list must be marked in listed_nodes_.
    */
   void purgeNodeOutsideEllipsoid(NodePtr& node,
                                  const SamplerPtr& sampler,
-                                 const std::vector<NodePtr>& white_list,
                                  unsigned int& removed_nodes);
   /**
    * @brief Recursively purges nodes outside multiple ellipsoid regions based on informed samplers.
@@ -134,12 +199,11 @@ protected:
    *
    * @param node The node from which the recursive purge operation begins.
    * @param samplers A vector of InformedSamplerPtr representing the informed samplers defining the admissible sets.
-   * @param white_list A vector of NodePtr representing nodes that should not be removed.
    * @param removed_nodes A reference to an unsigned int, counting the number of nodes removed.
+   * The nodes of the white list must be marked in listed_nodes_.
    */
   void purgeNodeOutsideEllipsoids(NodePtr& node,
                                   const std::vector<SamplerPtr>& samplers,
-                                  const std::vector<NodePtr>& white_list,
                                   unsigned int& removed_nodes);
 
 
@@ -187,6 +251,51 @@ protected:
    */
   void populateTreeFromNodeConsideringCost(const NodePtr& node, const Eigen::VectorXd& goal, const double& cost, const std::vector<NodePtr> &black_list, const bool node_check = false);
 
+  /**
+   * @brief Collects the successors of a node satisfying the conditions described in populateTreeFromNode.
+   * The nodes of the black list must be marked in listed_nodes_.
+   * @param nodes The vector where the successors are appended.
+   */
+  void collectNodesInsideEllipsoid(const NodePtr& node, const Eigen::VectorXd& focus1, const Eigen::VectorXd& focus2, const double& cost, const bool node_check, std::vector<NodePtr>& nodes);
+
+  /**
+   * @brief Collects the successors of a node satisfying the conditions described in populateTreeFromNodeConsideringCost.
+   * The nodes of the black list must be marked in listed_nodes_.
+   * @param cost_to_node The cost to reach node from the root.
+   * @param nodes The vector where the successors are appended.
+   */
+  void collectNodesConsideringCost(const NodePtr& node, const double& cost_to_node, const Eigen::VectorXd& goal, const double& cost, const bool node_check, std::vector<NodePtr>& nodes);
+
+  /**
+   * @brief Inserts many nodes into nodes_.
+   *
+   * If the new nodes are at least as many as the ones already stored, nodes_ is built from scratch with
+   * NearestNeighbors::build (balanced construction), otherwise the nodes are inserted one by one.
+   *
+   * @param nodes The nodes to insert.
+   */
+  void insertNodes(const std::vector<NodePtr>& nodes);
+
+  /**
+   * @brief Checks for collision the connections between node and the candidates of a rewire, using the threads of rewire_pool_.
+   *
+   * Task t checks the candidates t, t+n_threads, t+2*n_threads, ... with its own checker (checker_ for task 0, a clone for the others).
+   * With fewer than MIN_PARALLEL_REWIRE_CANDIDATES candidates, they are checked in the calling thread.
+   *
+   * @param node The node being rewired.
+   * @param candidates The candidates.
+   * @param from_node If true, the connections go from node to the candidates, otherwise from the candidates to node.
+   * @param first_only If true, only the first collision-free candidate is needed: the candidates after it may not be checked.
+   * @param free Output: free[i] is 1 if the connection with candidates[i] has been checked and is collision-free, 0 otherwise.
+   * @return The index of the first collision-free candidate, candidates.size() if there are none.
+   */
+  size_t checkRewireCandidates(const NodePtr& node, const std::vector<Node*>& candidates, const bool& from_node, const bool& first_only, std::vector<uint8_t>& free);
+
+  /**
+   * @brief Implementation of rewireOnly with more than one thread (see setRewireThreads). The neighbors of node must be stored in near_nodes_.
+   */
+  bool rewireOnlyParallel(NodePtr& node, const std::vector<NodePtr>& white_list, const bool& rewire_parent, const bool& rewire_children);
+
 public:
   EIGEN_MAKE_ALIGNED_OPERATOR_NEW
 
@@ -215,6 +324,26 @@ public:
        const cnr_logger::TraceLoggerPtr& logger,
        const bool& use_kdtree=true);
 
+  /**
+   * @brief Constructor for the Tree class.
+   *
+   * Initializes a tree as the constructor above, but the data structure used for nearest neighbor queries
+   * is selected among the available NearestNeighbors implementations.
+   *
+   * @param root A constant reference to a NodePtr representing the root node of the tree.
+   * @param max_distance A constant reference to a double representing the maximum distance for extending the tree.
+   * @param checker A constant reference to a CollisionCheckerPtr representing the collision checker used by the tree.
+   * @param metrics A constant reference to a MetricsPtr representing the metrics used by the tree.
+   * @param logger A constant reference to a cnr_logger::TraceLoggerPtr representing the logger used by the tree.
+   * @param nn_type The type of the data structure used for nearest neighbor queries.
+   */
+  Tree(const NodePtr& root,
+       const double& max_distance,
+       const CollisionCheckerPtr& checker,
+       const MetricsPtr& metrics,
+       const cnr_logger::TraceLoggerPtr& logger,
+       const NearestNeighborsType& nn_type);
+
   /**
    * @brief Checks if the tree is considered a subtree.
    *
@@ -255,6 +384,16 @@ public:
    */
   void getLeaves(std::vector<NodePtr>& leaves);
 
+  /**
+   * @brief Takes an immutable snapshot of the tree for read-heavy queries.
+   *
+   * The snapshot stores the tree in compressed sparse row format (see FrozenTree) and can be shared among threads without locks.
+   * It does not follow later changes of the tree.
+   *
+   * @return The snapshot.
+   */
+  FrozenTreePtr freeze() const;
+
   /**
    * @brief Changes the root of the tree to the specified node.
    *
@@ -280,6 +419,17 @@ public:
    */
   virtual void addNode(const NodePtr& node, const bool& check_if_present = true);
 
+  /**
+   * @brief Adds many nodes to the tree, optionally checking for their presence.
+   *
+   * Equivalent to calling addNode for each node, but the nearest neighbors data structure is
+   * built from scratch when many nodes are added, so that it remains balanced.
+   *
+   * @param nodes The nodes to be added to the tree.
+   * @param check_if_present A boolean flag indicating whether to check if the nodes are already present in the tree.
+   */
+  virtual void addNodes(const std::vector<NodePtr>& nodes, const bool& check_if_present = true);
+
   /**
    * @brief Removes a node from the tree.
    *
@@ -644,17 +794,46 @@ public:
    */
   NodePtr findClosestNode(const Eigen::VectorXd& configuration);
 
+  /**
+   * @brief Finds the closest existing node in the tree to each configuration of a batch.
+   *
+   * The queries can be split among several threads, see NearestNeighbors::nearestNeighbors. The tree must not be modified during the call.
+   *
+   * @param configurations The configurations for which the closest nodes are sought.
+   * @param nodes The flat buffer of the results: nodes[i] is the closest node to configurations[i] and its distance.
+   * @param n_threads The number of threads; 1 runs the queries in the calling thread, 0 uses the hardware concurrency.
+   * The threads of the parallel rewire are used if available (see setRewireThreads).
+   */
+  void findClosestNodes(const std::vector<Eigen::VectorXd>& configurations,
+                        std::vector<std::pair<double,Node*>>& nodes,
+                        const unsigned int& n_threads=1);
+
   /**
    * @brief Calculates the cost to reach a specific node from the tree's root.
    *
    * This function calculates the cost to reach a specific node from the tree's root by traversing the tree along its parent connections.
    * The cost is the sum of the costs of all connections along the path to the root.
+   * If the root has no parents (i.e., the tree is not a subtree), the cost cached in the nodes is used (see Node::getCostToCome),
+   * so the cost is computed again only after a parent connection along the path has been changed.
+   * Since the cache of the nodes is updated, the function is not safe for concurrent callers, even if the tree is not modified:
+   * use costToNodeWithoutCache or a snapshot of the tree (see freeze()) to query costs from several threads.
    *
    * @param node A pointer to a Node object representing the target node for which the cost is calculated.
    * @return Returns the cost to reach the specified node from the tree's root.
    */
   double costToNode(NodePtr node);
 
+  /**
+   * @brief Calculates the cost to reach a specific node from the tree's root, without using or updating the cost cached in the nodes.
+   *
+   * The function walks the parent connections up to the root every time, so it is O(depth of the node), but it only reads the tree:
+   * it can be called concurrently by several threads as long as the tree is not modified.
+   *
+   * @param node The target node.
+   * @return Returns the cost to reach the specified node from the tree's root.
+   */
+  double costToNodeWithoutCache(NodePtr node) const;
+
   /**
    * @brief Retrieves the connections along the path to a specific node from the tree's root.
    *
@@ -758,6 +937,44 @@ public:
   std::multimap<double, NodePtr> nearK(const NodePtr& node);
   std::multimap<double, NodePtr> nearK(const Eigen::VectorXd& conf);
 
+  /**
+   * @brief Finds nodes near a given node within a specified radius, writing them into a caller-owned vector.
+   *
+   * Reusing the same vector across calls avoids any memory allocation during the search.
+   *
+   * @param node The target node for which nearby nodes are to be found.
+   * @param radius The radius within which nodes are considered.
+   * @param nodes The nodes found and their distances, sorted by increasing distance. Its previous content is discarded.
+   */
+  void near(const NodePtr& node, const double& radius, std::vector<std::pair<double,Node*>>& nodes);
+
+  /**
+   * @brief Finds the K nearest neighbors of a given node (or configuration), writing them into a caller-owned vector.
+   *
+   * Reusing the same vector across calls avoids any memory allocation during the search.
+   *
+   * @param node The target node for which the K nearest neighbors are to be found.
+   * @param nodes The nodes found and their distances, sorted by increasing distance. Its previous content is discarded.
+   */
+  void nearK(const NodePtr& node, std::vector<std::pair<double,Node*>>& nodes);
+  void nearK(const Eigen::VectorXd& conf, std::vector<std::pair<double,Node*>>& nodes);
+
+  /**
+   * @brief Finds the K nearest neighbors of each configuration of a batch, with the same K used by nearK().
+   *
+   * The queries can be split among several threads, see NearestNeighbors::kNearestNeighbors. The tree must not be modified during the call.
+   *
+   * @param confs The target configurations.
+   * @param nodes The flat buffer of the results: nodes[i*K+j] is the j-th nearest node of confs[i] and its distance,
+   * padded with (infinity, nullptr) if the tree has fewer than K nodes.
+   * @param n_threads The number of threads; 1 runs the queries in the calling thread, 0 uses the hardware concurrency.
+   * The threads of the parallel rewire are used if available (see setRewireThreads).
+   * @return K, the number of entries of each configuration in nodes.
+   */
+  size_t nearK(const std::vector<Eigen::VectorXd>& confs,
+               std::vector<std::pair<double,Node*>>& nodes,
+               const unsigned int& n_threads=1);
+
   /**
    * @brief Checks if a given node is present in the tree.
    *
@@ -920,8 +1137,29 @@ public:
   void setChecker(const CollisionCheckerPtr& checker)
   {
     checker_ = checker;
+    rewire_checkers_.clear();
+  }
+
+  /**
+   * @brief Sets the number of threads used by rewireOnly to check the candidate connections for collision.
+   *
+   * With more than one thread, the candidates are first filtered by cost, then checked concurrently, each thread with its own clone of the checker
+   * (see CollisionCheckerBase::clone()), and finally the tree is modified in the calling thread. The result is the same as with a single thread.
+   *
+   * @param n_threads The number of threads; 1 (default) checks the candidates in the calling thread, 0 uses the hardware concurrency.
+   */
+  void setRewireThreads(const unsigned int& n_threads)
+  {
+    if(n_threads != rewire_threads_)
+      rewire_pool_.reset();
+    rewire_threads_ = n_threads;
   }
 
+  /**
+   * @brief Gets the number of threads used by rewireOnly to check the candidate connections for collision, see setRewireThreads.
+   */
+  const unsigned int& getRewireThreads() const {return rewire_threads_;}
+
   /**
    * @brief Sets the MetricsPtr for the tree.
    *
@@ -961,6 +1199,96 @@ public:
    */
   bool getUseKdTree(){return use_kdtree_;}
 
+  /**
+   * @brief Retrieves the type of the data structure used for nearest neighbors search.
+   *
+   * @return Returns the NearestNeighborsType of the tree.
+   */
+  const NearestNeighborsType& getNearestNeighborsType() const {return nn_type_;}
+
+  /**
+   * @brief Sets the weights of the distance used for nearest neighbors search, ||scale.*(q1-q2)||.
+   *
+   * The nearest neighbors data structure is rebuilt. Radii and distances of near(), nearK() and findClosestNode()
+   * become weighted distances, so the scale should match the one of the metrics used by the solver.
+   *
+   * @param scale The positive weight of each dimension. An empty vector restores the Euclidean distance.
+   */
+  void setNearestNeighborsScale(const Eigen::VectorXd& scale)
+  {
+    nodes_->setScale(scale);
+  }
+
+  /**
+   * @brief Retrieves the weights of the distance used for nearest neighbors search.
+   *
+   * @return The weight of each dimension, empty if the Euclidean distance is used.
+   */
+  const Eigen::VectorXd& getNearestNeighborsScale() const {return nodes_->getScale();}
+
+  /**
+   * @brief Sets the approximation of the nearest neighbors search used by findClosestNode() and nearK().
+   *
+   * The closest node returned is within (1+epsilon) times the distance of the exact one, which is enough for the
+   * exploration of RRT-like planners and saves most of the backtracking in high dimension. near() is always exact.
+   *
+   * @param epsilon The approximation, 0.0 for exact queries.
+   */
+  void setNearestNeighborsEpsilon(const double& epsilon)
+  {
+    nodes_->setEpsilon(epsilon);
+  }
+
+  /**
+   * @brief Retrieves the approximation of the nearest neighbors search.
+   *
+   * @return epsilon, 0.0 if the search is exact.
+   */
+  const double& getNearestNeighborsEpsilon() const {return nodes_->getEpsilon();}
+
+  /**
+   * @brief Sets the memory pool used to create the nodes and connections of the tree.
+   *
+   * Nodes and connections already in the tree are not moved. Pools can be shared among trees (e.g., the trees of a bidirectional solver).
+   *
+   * @param pool The memory pool, nullptr to create nodes and connections with std::make_shared.
+   */
+  void setPool(const GraphPoolPtr& pool)
+  {
+    pool_ = pool;
+  }
+
+  /**
+   * @brief Retrieves the memory pool used to create the nodes and connections of the tree.
+   *
+   * @return The memory pool, nullptr if not used.
+   */
+  const GraphPoolPtr& getPool() const {return pool_;}
+
+  /**
+   * @brief Creates a node in the memory pool of the tree, if any. The node is not added to the tree.
+   *
+   * @param configuration The configuration of the node.
+   * @return The new node.
+   */
+  NodePtr createNode(const Eigen::VectorXd& configuration)
+  {
+    return pool_? pool_->makeNode(configuration,logger_): std::make_shared<Node>(configuration,logger_);
+  }
+
+  /**
+   * @brief Creates a connection in the memory pool of the tree, if any. The connection is not added to the nodes, call Connection::add.
+   *
+   * @param parent The parent node.
+   * @param child The child node.
+   * @param is_net True if the connection is a net connection.
+   * @return The new connection.
+   */
+  ConnectionPtr createConnection(const NodePtr& parent, const NodePtr& child, const bool is_net = false)
+  {
+    return pool_? pool_->makeConnection(parent,child,logger_,is_net): std::make_shared<Connection>(parent,child,logger_,is_net);
+  }
+
   /**
    * @brief Convert the Tree to a YAML::Node.
    *
@@ -1013,6 +1341,46 @@ public:
                           const CollisionCheckerPtr& checker,
                           const cnr_logger::TraceLoggerPtr& logger);
 
+  /**
+   * @brief Write the Tree to a binary file (see GraphFile).
+   *
+   * Nodes are written in breadth-first order from the root, in a single pass, together with the connection costs and the flags.
+   *
+   * @param file_name The name of the file.
+   * @return True if the file has been written.
+   */
+  bool toBinary(const std::string& file_name) const;
+
+  /**
+   * @brief Create a Tree from a binary file written by toBinary.
+   *
+   * The file is memory-mapped and the nodes are created directly from its content. Connection costs are read from the file, not recomputed.
+   *
+   * @param file_name The name of the file.
+   * @param metrics The MetricsPtr of the tree.
+   * @param checker The CollisionCheckerPtr of the tree.
+   * @param logger The TraceLoggerPtr for logging error messages.
+   * @return The tree, nullptr if the file cannot be read or does not contain a tree.
+   */
+  static TreePtr fromBinary(const std::string& file_name,
+                            const MetricsPtr& metrics,
+                            const CollisionCheckerPtr& checker,
+                            const cnr_logger::TraceLoggerPtr& logger);
+
+  /**
+   * @brief Convert a YAML file written by toYAML into a binary file. Connection costs are computed with metrics.
+   * @return True if the conversion succeeded.
+   */
+  static bool yamlToBinary(const std::string& yaml_file_name, const std::string& binary_file_name,
+                           const MetricsPtr& metrics, const cnr_logger::TraceLoggerPtr& logger);
+
+  /**
+   * @brief Convert a binary file written by toBinary into a YAML file, without creating the tree.
+   * @return True if the conversion succeeded.
+   */
+  static bool binaryToYAML(const std::string& binary_file_name, const std::string& yaml_file_name,
+                           const cnr_logger::TraceLoggerPtr& logger);
+
 };
 
 /**
@@ -0,0 +1,124 @@
+#pragma once
+/*
+Copyright (c) 2024, Manuel Beschi and Cesare Tonola, JRL-CARI CNR-STIIMA/UNIBS, manuel.beschi@unibs.it, c.tonola001@unibs.it
+Manuel Beschi manuel.beschi@unibs.it
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of the <organization> nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL <COPYRIGHT HOLDER> BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <graph_core/graph/tree.h>
+
+namespace graph
+{
+namespace core
+{
+
+class RoadmapCache;
+typedef std::shared_ptr<RoadmapCache> RoadmapCachePtr;
+
+/**
+ * @class RoadmapCache
+ * @brief Directory of pre-computed trees, stored as binary files (see GraphFile) and keyed by environment id and collision checker identity.
+ *
+ * A tree stored for an environment is valid only for the same environment and collision checker (see CollisionCheckerBase::getIdentity()),
+ * so both are part of the key. Trees are memory-mapped when loaded, so loading a cached tree is much faster than growing it again.
+ * Files are written to a temporary file and then renamed, so other processes never read a partially written tree.
+ */
+class RoadmapCache
+{
+protected:
+  /**
+   * @brief Directory where the trees are stored.
+   */
+  std::string directory_;
+
+  /**
+   * @brief Pointer to a TraceLogger instance for logging.
+   */
+  cnr_logger::TraceLoggerPtr logger_;
+
+public:
+  /**
+   * @brief Constructor for RoadmapCache.
+   * @param directory The directory where the trees are stored. It must exist.
+   * @param logger Pointer to a TraceLogger for logging.
+   */
+  RoadmapCache(const std::string& directory, const cnr_logger::TraceLoggerPtr& logger);
+
+  /**
+   * @brief Get the directory where the trees are stored.
+   * @return The directory.
+   */
+  const std::string& getDirectory() const
+  {
+    return directory_;
+  }
+
+  /**
+   * @brief Get the name of the file storing the tree of an environment.
+   * The name is made of the environment id (non alphanumeric characters replaced by '_') and of a hash of the checker identity.
+   * @param environment_id The id of the environment.
+   * @param checker The collision checker used to grow the tree.
+   * @return The full path of the file.
+   */
+  std::string getFileName(const std::string& environment_id, const CollisionCheckerPtr& checker) const;
+
+  /**
+   * @brief Check if a tree is stored for an environment.
+   * @param environment_id The id of the environment.
+   * @param checker The collision checker used to grow the tree.
+   * @return True if the file of the tree exists.
+   */
+  bool has(const std::string& environment_id, const CollisionCheckerPtr& checker) const;
+
+  /**
+   * @brief Store a tree for an environment, replacing the previous one.
+   * @param environment_id The id of the environment.
+   * @param checker The collision checker used to grow the tree.
+   * @param tree The tree to store.
+   * @return True if the tree has been stored.
+   */
+  bool store(const std::string& environment_id, const CollisionCheckerPtr& checker, const TreePtr& tree) const;
+
+  /**
+   * @brief Load the tree stored for an environment.
+   * @param environment_id The id of the environment.
+   * @param metrics The metrics of the tree.
+   * @param checker The collision checker of the tree, it is also part of the key.
+   * @param recheck If true, the connections of the tree are checked again for collision and the branches in collision are removed.
+   * @return The tree, nullptr if no tree is stored for the environment or it cannot be loaded.
+   */
+  TreePtr load(const std::string& environment_id, const MetricsPtr& metrics, const CollisionCheckerPtr& checker, const bool& recheck = false) const;
+
+  /**
+   * @brief Remove the tree stored for an environment, e.g. because the environment has changed.
+   * @param environment_id The id of the environment.
+   * @param checker The collision checker used to grow the tree.
+   * @return True if the tree has been removed.
+   */
+  bool remove(const std::string& environment_id, const CollisionCheckerPtr& checker) const;
+};
+
+} //end namespace core
+} //end namespace graph
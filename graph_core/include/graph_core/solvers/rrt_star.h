@@ -42,6 +42,12 @@ class RRTStar: public RRT
 protected:
   double r_rewire_;
 
+  /**
+   * @brief Number of threads used by the tree to check the rewire candidates for collision, see Tree::setRewireThreads.
+   * Read from the 'rewire_threads' parameter; if not available, it is 1.
+   */
+  unsigned int rewire_threads_ = 1;
+
   void updateRewireRadius();
 
 public:
@@ -63,6 +69,7 @@ public:
     RRT(metrics, checker, sampler, logger) {}  //set initialized_ true
 
   virtual bool config(const std::string& param_ns) override;
+  virtual bool addStart(const NodePtr& start_node, const double &max_time = std::numeric_limits<double>::infinity()) override;
   virtual bool addStartTree(const TreePtr& start_tree, const double &max_time = std::numeric_limits<double>::infinity()) override;
   virtual bool update(PathPtr& solution) override;
   virtual bool solve(PathPtr &solution, const unsigned int& max_iter=100, const double &max_time = std::numeric_limits<double>::infinity()) override;
@@ -28,6 +28,7 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include <graph_core/graph/tree.h>
 #include <graph_core/graph/path.h>
+#include <graph_core/solvers/roadmap_cache.h>
 #include <graph_core/samplers/sampler_base.h>
 #include <graph_core/metrics/goal_cost_function_base.h>
 
@@ -126,6 +127,49 @@ protected:
    */
   bool use_kdtree_;
 
+  /**
+   * @brief Type of the data structure used by the trees for nearest neighbor search.
+   * Read from the 'nearest_neighbors' parameter ("vector", "kdtree", "arena_kdtree", "bucket_kdtree", "vp_tree", "hash_grid"); if not available, it is derived from use_kdtree_.
+   * The cells of "hash_grid" are as large as max_distance_; above HashGrid::MAX_DIMENSION dof, the trees use "arena_kdtree" instead.
+   */
+  NearestNeighborsType nn_type_;
+
+  /**
+   * @brief Weights of the distance used by the trees for nearest neighbor search, ||nn_scale_.*(q1-q2)||.
+   * Read from the 'nearest_neighbors_scale' parameter; if not available, it is empty and the Euclidean distance is used.
+   */
+  Eigen::VectorXd nn_scale_;
+
+  /**
+   * @brief Approximation of the nearest neighbor search of the trees: the closest node found is within (1+nn_epsilon_) times the exact distance.
+   * Read from the 'nearest_neighbors_epsilon' parameter; if not available, it is 0.0 and the search is exact.
+   */
+  double nn_epsilon_ = 0.0;
+
+  /**
+   * @brief Flag indicating whether the nodes and connections of the trees are created in a memory pool.
+   * Read from the 'use_graph_pool' parameter; if not available, it is false.
+   */
+  bool use_graph_pool_ = false;
+
+  /**
+   * @brief Memory pool shared by the trees of the current problem, nullptr if use_graph_pool_ is false.
+   * A new pool is created by resetProblem, the previous one is released together with the last of its nodes.
+   */
+  GraphPoolPtr pool_;
+
+  /**
+   * @brief Cache of pre-computed trees used by addStartFromRoadmapCache, nullptr if not used.
+   * It is created from the 'roadmap_cache_directory' parameter if available, otherwise it is set with setRoadmapCache().
+   */
+  RoadmapCachePtr roadmap_cache_;
+
+  /**
+   * @brief Id of the environment, used as key of roadmap_cache_.
+   * Read from the 'environment_id' parameter if 'roadmap_cache_directory' is available, otherwise it is set with setRoadmapCache().
+   */
+  std::string environment_id_;
+
   /**
    * @brief initialized_ Flag to indicate whether the object is initialised, i.e. whether its members have been defined correctly.
    * It is false when the object is created with an empty constructor. In this case, call the 'init' function to initialise it.
@@ -368,6 +412,28 @@ public:
    */
   virtual bool addStartTree(const TreePtr& start_tree, const double &max_time = std::numeric_limits<double>::infinity())=0;
 
+  /**
+   * @brief Set the start node of the path planning problem, using the tree stored in roadmap_cache_ for environment_id_ as start tree.
+   *
+   * The start node is connected to the closest node of the cached tree which can be reached without collisions (within max_distance_)
+   * and becomes the root of the tree, which is then added with addStartTree(). The solver must be configured before using this function,
+   * and the goal must be added before if addStartTree() needs it (e.g., RRTStar). If addStartTree() fails, start_node is disconnected from the cached tree.
+   * As in addStart(), the start must be within the bounds of the sampler, and the cached tree uses nn_scale_, nn_epsilon_ and pool_ instead of
+   * the settings stored in the cache.
+   *
+   * @param start_node The start node to be added.
+   * @param max_time The maximum allowed time for adding the start tree.
+   * @return true if the cached tree is used, false if no cache or tree is available, the start is out of bounds or it cannot be connected to the tree.
+   * In this case, use addStart().
+   */
+  virtual bool addStartFromRoadmapCache(const NodePtr& start_node, const double &max_time = std::numeric_limits<double>::infinity());
+
+  /**
+   * @brief Store the current start tree in roadmap_cache_ for environment_id_, so that the next queries can use it (see addStartFromRoadmapCache()).
+   * @return true if the tree is stored, false if no cache or tree is available or the tree cannot be written.
+   */
+  virtual bool storeToRoadmapCache() const;
+
   /**
    * @brief Compute a path planning path between given configurations.
    *
@@ -564,6 +630,35 @@ public:
     return sampler_;
   }
 
+  /**
+   * @brief Set the cache of pre-computed trees and the id of the current environment.
+   * @param roadmap_cache The cache, nullptr to not use any cache.
+   * @param environment_id The id of the environment, used as key of the cache.
+   */
+  void setRoadmapCache(const RoadmapCachePtr& roadmap_cache, const std::string& environment_id)
+  {
+    roadmap_cache_ = roadmap_cache;
+    environment_id_ = environment_id;
+  }
+
+  /**
+   * @brief Get the cache of pre-computed trees.
+   * @return A pointer to the cache, nullptr if not used.
+   */
+  RoadmapCachePtr getRoadmapCache() const
+  {
+    return roadmap_cache_;
+  }
+
+  /**
+   * @brief Get the id of the environment used as key of the cache of pre-computed trees.
+   * @return The id of the environment.
+   */
+  const std::string& getEnvironmentId() const
+  {
+    return environment_id_;
+  }
+
   /**
    * @brief Get the cost of the path.
    *
@@ -0,0 +1,638 @@
+/*
+Copyright (c) 2024, Manuel Beschi and Cesare Tonola, JRL-CARI CNR-STIIMA/UNIBS, manuel.beschi@unibs.it, c.tonola001@unibs.it
+Manuel Beschi manuel.beschi@unibs.it
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of the <organization> nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL <COPYRIGHT HOLDER> BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+#include <graph_core/datastructure/arena_kdtree.h>
+#include <numeric>
+
+namespace graph
+{
+namespace core
+{
+
+namespace
+{
+/**
+ * @brief Number of queries below which sortQueries leaves a range unsorted.
+ */
+constexpr long QUERY_LEAF_SIZE = 8;
+
+// Sort the queries [begin,end) along a kd-tree: median split along the dimension of largest spread, recursively
+void sortQueries(const std::vector<Eigen::VectorXd>& configurations,
+                 const std::vector<size_t>::iterator& begin,
+                 const std::vector<size_t>::iterator& end)
+{
+  if(end-begin<=QUERY_LEAF_SIZE)
+    return;
+
+  Eigen::VectorXd min_values = configurations[*begin];
+  Eigen::VectorXd max_values = configurations[*begin];
+  for(std::vector<size_t>::iterator it=begin;it!=end;it++)
+  {
+    min_values = min_values.cwiseMin(configurations[*it]);
+    max_values = max_values.cwiseMax(configurations[*it]);
+  }
+
+  Eigen::Index dimension;
+  (max_values-min_values).maxCoeff(&dimension);
+
+  std::vector<size_t>::iterator middle = begin+(end-begin)/2;
+  std::nth_element(begin,middle,end,[&configurations,&dimension](const size_t& i1, const size_t& i2){
+    return configurations[i1](dimension)<configurations[i2](dimension);
+  });
+
+  sortQueries(configurations,begin,middle);
+  sortQueries(configurations,middle,end);
+}
+}
+
+ArenaKdTree::ArenaKdTree(const cnr_logger::TraceLoggerPtr &logger):
+  NearestNeighbors(logger)
+{
+  dof_ = 0;
+  print_deleted_nodes_ = false;
+  deleted_nodes_threshold_ = std::numeric_limits<unsigned int>::max();
+  balance_factor_ = 0.75;
+  partial_rebuilds_ = 0;
+  rebuilt_nodes_ = 0;
+}
+
+void ArenaKdTree::insert(const NodePtr& node)
+{
+  const Eigen::VectorXd& configuration = scaled(node->getConfiguration(),scaled_configuration_);
+
+  if(kdnodes_.empty())
+    dof_ = configuration.size();
+  else if(configuration.size() != dof_)
+  {
+    CNR_FATAL(logger_,"node dimension ("<<configuration.size()<<") is different from the kdtree dimension ("<<dof_<<")");
+    throw std::invalid_argument("node dimension is different from the kdtree dimension");
+  }
+
+  if(kdnodes_.size() >= NONE)
+  {
+    CNR_FATAL(logger_,"the arena kdtree cannot store more than "<<NONE<<" nodes");
+    throw std::runtime_error("the arena kdtree is full");
+  }
+
+  uint32_t new_idx = kdnodes_.size();
+  uint32_t dimension = 0;
+
+  path_.clear();
+  if(not kdnodes_.empty())
+  {
+    uint32_t idx = 0;
+    while(true)
+    {
+      path_.push_back(idx);
+
+      KdEntry& kdnode = kdnodes_[idx];
+      kdnode.size++;
+
+      uint32_t& child = (configuration(kdnode.dimension)>=conf(idx)[kdnode.dimension])? kdnode.right: kdnode.left;
+      if(child == NONE)
+      {
+        child = new_idx;
+        dimension = (kdnode.dimension == dof_-1)? 0: kdnode.dimension+1;
+        break;
+      }
+      idx = child;
+    }
+  }
+
+  kdnodes_.push_back(KdEntry{node,NONE,NONE,dimension,1,false});
+  indices_[node.get()] = new_idx;
+  configurations_.insert(configurations_.end(),configuration.data(),configuration.data()+dof_);
+  size_++;
+
+  // Scapegoat rule: if the new node is too deep, rebuild the subtree of its lowest alpha-unbalanced ancestor
+  if(balance_factor_<1.0 && path_.size()>maxDepth(kdnodes_.size()))
+  {
+    uint32_t child = new_idx;
+    for(size_t i=path_.size();i-->0;)
+    {
+      uint32_t idx = path_[i];
+      if(kdnodes_[child].size>balance_factor_*kdnodes_[idx].size)
+      {
+        rebuildSubtree(idx,(i>0)? path_[i-1]: NONE);
+        break;
+      }
+      child = idx;
+    }
+  }
+}
+
+unsigned int ArenaKdTree::maxDepth(const size_t& n) const
+{
+  return std::floor(std::log(static_cast<double>(n))/std::log(1.0/balance_factor_));
+}
+
+void ArenaKdTree::rebuildSubtree(const uint32_t& idx, const uint32_t& parent)
+{
+  // Collect the kd-nodes of the subtree (deleted ones included, so that they can still be restored)
+  subtree_.clear();
+  subtree_.push_back(idx);
+  for(size_t i=0;i<subtree_.size();i++)
+  {
+    const KdEntry& kdnode = kdnodes_[subtree_[i]];
+    if(kdnode.left != NONE)
+      subtree_.push_back(kdnode.left);
+    if(kdnode.right != NONE)
+      subtree_.push_back(kdnode.right);
+  }
+
+  partial_rebuilds_++;
+  rebuilt_nodes_ += subtree_.size();
+
+  CNR_DEBUG(logger_,"subtree of kdnode "<<idx<<" is unbalanced, its "<<subtree_.size()<<" kdnodes are rebuilt");
+
+  if(idx == 0) //the root of the kdtree does not change
+  {
+    subtree_.erase(subtree_.begin());
+    buildFromRoot(subtree_);
+    return;
+  }
+
+  uint32_t new_idx = build(subtree_.begin(),subtree_.end(),kdnodes_[idx].dimension);
+
+  KdEntry& parent_kdnode = kdnodes_[parent];
+  if(parent_kdnode.left == idx)
+    parent_kdnode.left = new_idx;
+  else
+    parent_kdnode.right = new_idx;
+}
+
+void ArenaKdTree::buildFromRoot(std::vector<uint32_t>& indices)
+{
+  // The other nodes are split according to the value of the root along its dimension
+  KdEntry& root = kdnodes_[0];
+  double root_value = conf(0)[root.dimension];
+  std::vector<uint32_t>::iterator middle = std::partition(indices.begin(),indices.end(),[&](const uint32_t& idx){
+    return conf(idx)[root.dimension]<root_value;
+  });
+
+  uint32_t next_dim = (root.dimension == dof_-1)? 0: root.dimension+1;
+  root.left  = build(indices.begin(),middle,next_dim);
+  root.right = build(middle,indices.end(),next_dim);
+  root.size  = indices.size()+1;
+}
+
+bool ArenaKdTree::clear()
+{
+  size_=0;
+  deleted_nodes_=0;
+
+  kdnodes_.clear();
+  configurations_.clear();
+  indices_.clear();
+
+  return true;
+}
+
+void ArenaKdTree::build(const std::vector<NodePtr>& nodes)
+{
+  clear();
+  if(nodes.empty())
+    return;
+
+  if(nodes.size() >= NONE)
+  {
+    CNR_FATAL(logger_,"the arena kdtree cannot store more than "<<NONE<<" nodes");
+    throw std::runtime_error("the arena kdtree is full");
+  }
+
+  dof_ = nodes.front()->getConfiguration().size();
+  reserve(nodes.size());
+
+  for(const NodePtr& n:nodes)
+  {
+    const Eigen::VectorXd& configuration = scaled(n->getConfiguration(),scaled_configuration_);
+    if(configuration.size() != dof_)
+    {
+      CNR_FATAL(logger_,"node dimension ("<<configuration.size()<<") is different from the kdtree dimension ("<<dof_<<")");
+      throw std::invalid_argument("node dimension is different from the kdtree dimension");
+    }
+
+    indices_[n.get()] = kdnodes_.size();
+    kdnodes_.push_back(KdEntry{n,NONE,NONE,0,1,false});
+    configurations_.insert(configurations_.end(),configuration.data(),configuration.data()+dof_);
+  }
+  size_ = nodes.size();
+
+  // The first node is kept as root
+  std::vector<uint32_t> indices(nodes.size()-1);
+  std::iota(indices.begin(),indices.end(),1);
+  buildFromRoot(indices);
+}
+
+uint32_t ArenaKdTree::build(const std::vector<uint32_t>::iterator& begin,
+                            const std::vector<uint32_t>::iterator& end,
+                            const uint32_t& dimension)
+{
+  if(begin == end)
+    return NONE;
+
+  std::vector<uint32_t>::iterator median = begin+(end-begin)/2;
+  std::nth_element(begin,median,end,[&](const uint32_t& i1, const uint32_t& i2){
+    return conf(i1)[dimension]<conf(i2)[dimension];
+  });
+
+  // Nodes equal to the median along dimension must go to the right (see insert),
+  // so the first of them is chosen as splitting node
+  double value = conf(*median)[dimension];
+  std::vector<uint32_t>::iterator split = std::partition(begin,median,[&](const uint32_t& idx){
+    return conf(idx)[dimension]<value;
+  });
+  std::iter_swap(split,median);
+
+  uint32_t next_dim = (dimension == dof_-1)? 0: dimension+1;
+
+  KdEntry& kdnode = kdnodes_[*split];
+  kdnode.dimension = dimension;
+  kdnode.size  = end-begin;
+  kdnode.left  = build(begin,split,next_dim);
+  kdnode.right = build(split+1,end,next_dim);
+
+  return *split;
+}
+
+void ArenaKdTree::reserve(const size_t& n)
+{
+  kdnodes_.reserve(n);
+  indices_.reserve(n);
+  if(dof_>0)
+    configurations_.reserve(n*dof_);
+}
+
+void ArenaKdTree::nearestNeighbor(const Eigen::VectorXd& configuration,
+                                  NodePtr &best,
+                                  double &best_distance)
+{
+  best_distance=std::numeric_limits<double>::infinity();
+  if(kdnodes_.empty())
+    return;
+
+  thread_local Eigen::VectorXd scaled_query;
+  const Eigen::VectorXd& query = scaled(configuration,scaled_query);
+
+  uint32_t best_idx = NONE;
+  double best_squared_distance = std::numeric_limits<double>::infinity();
+  nearestNeighbor(0,query,best_idx,best_squared_distance);
+
+  if(best_idx != NONE)
+  {
+    best = kdnodes_[best_idx].node;
+    best_distance = std::sqrt(best_squared_distance);
+  }
+}
+
+void ArenaKdTree::nearestNeighbor(const uint32_t& idx,
+                                  const Eigen::VectorXd& configuration,
+                                  uint32_t& best,
+                                  double& best_squared_distance) const
+{
+  const KdEntry& kdnode = kdnodes_[idx];
+
+  if(not kdnode.deleted)
+  {
+    double squared_dist = squaredDistance(idx,configuration);
+    if(squared_dist<best_squared_distance)
+    {
+      best_squared_distance = squared_dist;
+      best = idx;
+    }
+  }
+
+  double delta = configuration(kdnode.dimension)-conf(idx)[kdnode.dimension];
+
+  if(delta>0.0) //search right first
+  {
+    if(kdnode.right != NONE)
+      nearestNeighbor(kdnode.right,configuration,best,best_squared_distance);
+    if(kdnode.left != NONE && delta*delta<=pruning_factor_*best_squared_distance)
+      nearestNeighbor(kdnode.left,configuration,best,best_squared_distance);
+  }
+  else //search left first
+  {
+    if(kdnode.left != NONE)
+      nearestNeighbor(kdnode.left,configuration,best,best_squared_distance);
+    if(kdnode.right != NONE && delta*delta<=pruning_factor_*best_squared_distance)
+      nearestNeighbor(kdnode.right,configuration,best,best_squared_distance);
+  }
+}
+
+bool ArenaKdTree::near(const Eigen::VectorXd& configuration,
+                       const double& radius,
+                       const NearVisitor& visitor)
+{
+  if(kdnodes_.empty())
+    return true;
+
+  thread_local Eigen::VectorXd scaled_query;
+  const Eigen::VectorXd& query = scaled(configuration,scaled_query);
+
+  return near(0,query,radius,visitor);
+}
+
+bool ArenaKdTree::near(const uint32_t& idx,
+                       const Eigen::VectorXd& configuration,
+                       const double& radius,
+                       const NearVisitor& visitor) const
+{
+  const KdEntry& kdnode = kdnodes_[idx];
+
+  if(not kdnode.deleted)
+  {
+    double squared_dist = squaredDistance(idx,configuration);
+    if(squared_dist<radius*radius && not visitor(std::sqrt(squared_dist),kdnode.node))
+      return false;
+  }
+
+  double split = conf(idx)[kdnode.dimension];
+  double value = configuration(kdnode.dimension);
+
+  if(kdnode.left != NONE && (value-radius)<=split && not near(kdnode.left,configuration,radius,visitor))
+    return false;
+  if(kdnode.right != NONE && (value+radius)>=split && not near(kdnode.right,configuration,radius,visitor))
+    return false;
+  return true;
+}
+
+void ArenaKdTree::kNearestNeighbors(const Eigen::VectorXd& configuration,
+                                    KNearestNeighborsHeap& heap)
+{
+  if(kdnodes_.empty() || heap.k() == 0)
+    return;
+
+  thread_local Eigen::VectorXd scaled_query;
+  const Eigen::VectorXd& query = scaled(configuration,scaled_query);
+
+  kNearestNeighbors(0,query,heap);
+}
+
+void ArenaKdTree::nearestNeighbors(const std::vector<Eigen::VectorXd>& configurations,
+                                   std::vector<std::pair<double,Node*>>& nodes,
+                                   const unsigned int& n_threads,
+                                   const WorkerPoolPtr& pool)
+{
+  nodes.assign(configurations.size(),std::make_pair(std::numeric_limits<double>::infinity(),nullptr));
+  if(kdnodes_.empty())
+    return;
+
+  std::vector<size_t> order(configurations.size());
+  std::iota(order.begin(),order.end(),0);
+  sortQueries(configurations,order.begin(),order.end());
+
+  auto search = [this,&configurations,&nodes,&order](const size_t& begin, const size_t& end){
+    Eigen::VectorXd scaled_query;
+    uint32_t best_idx = NONE;
+    for(size_t i=begin;i<end;i++)
+    {
+      const Eigen::VectorXd& query = scaled(configurations[order[i]],scaled_query);
+
+      // The nearest node of the previous query bounds the search from the start
+      double best_squared_distance = (best_idx == NONE)? std::numeric_limits<double>::infinity(): squaredDistance(best_idx,query);
+      nearestNeighbor(0,query,best_idx,best_squared_distance);
+
+      if(best_idx != NONE)
+        nodes[order[i]] = std::make_pair(std::sqrt(best_squared_distance),kdnodes_[best_idx].node.get());
+    }
+  };
+
+  // The shared pool is not created for serial batches
+  if(n_threads == 1)
+    search(0,order.size());
+  else
+    (pool? *pool: WorkerPool::shared()).parallelFor(order.size(),n_threads,search);
+}
+
+void ArenaKdTree::kNearestNeighbors(const uint32_t& idx,
+                                    const Eigen::VectorXd& configuration,
+                                    KNearestNeighborsHeap& heap) const
+{
+  const KdEntry& kdnode = kdnodes_[idx];
+
+  if(not kdnode.deleted)
+    heap.push(squaredDistance(idx,configuration),kdnode.node);
+
+  double delta = configuration(kdnode.dimension)-conf(idx)[kdnode.dimension];
+
+  // the worst distance is read again after the first recursion, since it can improve it
+  if(delta>0.0) //search right first
+  {
+    if(kdnode.right != NONE)
+      kNearestNeighbors(kdnode.right,configuration,heap);
+    if(kdnode.left != NONE && delta*delta<=pruning_factor_*heap.worst())
+      kNearestNeighbors(kdnode.left,configuration,heap);
+  }
+  else //search left first
+  {
+    if(kdnode.left != NONE)
+      kNearestNeighbors(kdnode.left,configuration,heap);
+    if(kdnode.right != NONE && delta*delta<=pruning_factor_*heap.worst())
+      kNearestNeighbors(kdnode.right,configuration,heap);
+  }
+}
+
+bool ArenaKdTree::findNode(const NodePtr& node, uint32_t& idx) const
+{
+  std::unordered_map<const Node*,uint32_t>::const_iterator it = indices_.find(node.get());
+  if(it == indices_.end())
+    return false;
+
+  idx = it->second;
+  return true;
+}
+
+bool ArenaKdTree::findNode(const NodePtr& node)
+{
+  uint32_t idx;
+  return findNode(node,idx);
+}
+
+bool ArenaKdTree::deleteNode(const NodePtr& node,
+                             const bool& disconnect_node)
+{
+  uint32_t idx;
+  if(not findNode(node,idx))
+    return false;
+
+  if(kdnodes_[idx].deleted)
+    return false;
+
+  size_--;
+  deleted_nodes_++;
+  kdnodes_[idx].deleted = true;
+
+  if(disconnect_node)
+    node->disconnect();
+
+  if(deleted_nodes_>deleted_nodes_threshold_ && size_>0)
+  {
+    CNR_DEBUG(logger_,"number of deleted nodes ("<<deleted_nodes_<<") is greater than the threshold ("
+              <<deleted_nodes_threshold_<<"), kdtree is built from scratch");
+
+    std::vector<NodePtr> nodes = getNodes(); //insertion order is preserved
+    build(nodes);
+  }
+
+  return true;
+}
+
+bool ArenaKdTree::restoreNode(const NodePtr& node)
+{
+  uint32_t idx;
+  if(not findNode(node,idx))
+    return false;
+
+  if(not kdnodes_[idx].deleted)
+    return true;
+
+  size_++;
+  deleted_nodes_--;
+  kdnodes_[idx].deleted = false;
+  return true;
+}
+
+double ArenaKdTree::balanceFactor()
+{
+  return balance_factor_;
+}
+
+void ArenaKdTree::balanceFactor(const double& alpha)
+{
+  if(alpha<=0.5 || alpha>1.0)
+  {
+    CNR_WARN(logger_, "balance_factor_ cannot be set because it should be in (0.5,1] and you are trying to set "<<alpha);
+    return;
+  }
+  balance_factor_ = alpha;
+}
+
+ArenaKdTree::Statistics ArenaKdTree::statistics() const
+{
+  Statistics stats;
+  stats.max_depth = 0;
+  stats.average_depth = 0.0;
+  stats.max_imbalance = 0.0;
+  stats.partial_rebuilds = partial_rebuilds_;
+  stats.rebuilt_nodes = rebuilt_nodes_;
+
+  if(kdnodes_.empty())
+    return stats;
+
+  std::vector<std::pair<uint32_t,unsigned int>> stack; //kd-node, depth
+  stack.push_back(std::make_pair(0,0));
+  while(not stack.empty())
+  {
+    uint32_t idx = stack.back().first;
+    unsigned int depth = stack.back().second;
+    stack.pop_back();
+
+    const KdEntry& kdnode = kdnodes_[idx];
+    stats.max_depth = std::max(stats.max_depth,depth);
+    stats.average_depth += depth;
+
+    uint32_t left_size  = (kdnode.left  == NONE)? 0: kdnodes_[kdnode.left ].size;
+    uint32_t right_size = (kdnode.right == NONE)? 0: kdnodes_[kdnode.right].size;
+    if(idx != 0) //the root is fixed, so it is not considered
+      stats.max_imbalance = std::max(stats.max_imbalance,static_cast<double>(std::max(left_size,right_size))/kdnode.size);
+
+    if(kdnode.left != NONE)
+      stack.push_back(std::make_pair(kdnode.left,depth+1));
+    if(kdnode.right != NONE)
+      stack.push_back(std::make_pair(kdnode.right,depth+1));
+  }
+  stats.average_depth /= kdnodes_.size();
+
+  return stats;
+}
+
+unsigned int ArenaKdTree::deletedNodesThreshold()
+{
+  return deleted_nodes_threshold_;
+}
+
+void ArenaKdTree::deletedNodesThreshold(const unsigned int t)
+{
+  if(t<=1)
+  {
+    CNR_WARN(logger_, "deleted_nodes_threshold_ cannot bet set because it should be at least 2 and you are trying to set "<<t);
+    return;
+  }
+  deleted_nodes_threshold_ = t;
+}
+
+std::vector<NodePtr> ArenaKdTree::getNodes()
+{
+  std::vector<NodePtr> nodes;
+  nodes.reserve(size_);
+
+  for(const KdEntry& kdnode: kdnodes_)
+  {
+    if(not kdnode.deleted)
+      nodes.push_back(kdnode.node);
+  }
+  return nodes;
+}
+
+void ArenaKdTree::disconnectNodes(const std::vector<NodePtr>& white_list)
+{
+  for(const KdEntry& kdnode: kdnodes_)
+  {
+    if(std::find(white_list.begin(),white_list.end(),kdnode.node)==white_list.end())
+      kdnode.node->disconnect();
+  }
+}
+
+std::ostream& operator<<(std::ostream& os, const ArenaKdTree& kdtree)
+{
+  ArenaKdTree::Statistics stats = kdtree.statistics();
+  os<<"arena size-> "<<kdtree.kdnodes_.size()<<" dof-> "<<kdtree.dof_<<std::endl;
+  os<<"max depth-> "<<stats.max_depth<<" average depth-> "<<stats.average_depth<<" max imbalance-> "<<stats.max_imbalance
+    <<" partial rebuilds-> "<<stats.partial_rebuilds<<" rebuilt nodes-> "<<stats.rebuilt_nodes<<std::endl;
+  os<<"size-> "<<kdtree.size_<<" deleted nodes-> "<<kdtree.deleted_nodes_<<" print deleted nodes-> "<<kdtree.print_deleted_nodes_<<"\n"<<std::endl;
+
+  for(size_t idx=0;idx<kdtree.kdnodes_.size();idx++)
+  {
+    const ArenaKdTree::KdEntry& kdnode = kdtree.kdnodes_[idx];
+    if(kdtree.print_deleted_nodes_ || not kdnode.deleted)
+    {
+      os << "   --- kdnode "<<idx<<" ---"<<std::endl;
+      os << "node-> "<<Eigen::Map<const Eigen::VectorXd>(kdtree.conf(idx),kdtree.dof_).transpose()<<" ("<<kdnode.node<<")"<<std::endl;
+      os << "dimension-> "<<kdnode.dimension<<" subtree size-> "<<kdnode.size<<" deleted-> "<<kdnode.deleted<<std::endl;
+      os << "left child-> "<<(kdnode.left == ArenaKdTree::NONE? -1: static_cast<long>(kdnode.left))
+         <<" right child-> "<<(kdnode.right == ArenaKdTree::NONE? -1: static_cast<long>(kdnode.right))<<std::endl<<std::endl;
+    }
+  }
+
+  return os;
+}
+
+} //end namespace core
+} // end namespace graph
@@ -0,0 +1,649 @@
+/*
+Copyright (c) 2024, Manuel Beschi and Cesare Tonola, JRL-CARI CNR-STIIMA/UNIBS, manuel.beschi@unibs.it, c.tonola001@unibs.it
+Manuel Beschi manuel.beschi@unibs.it
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of the <organization> nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL <COPYRIGHT HOLDER> BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+#include <graph_core/datastructure/bucket_kdtree.h>
+#include <numeric>
+
+namespace graph
+{
+namespace core
+{
+
+BucketKdTree::BucketKdTree(const cnr_logger::TraceLoggerPtr &logger, const unsigned int &bucket_size):
+  NearestNeighbors(logger)
+{
+  dof_ = 0;
+  inserted_ = 0;
+  print_deleted_nodes_ = false;
+  deleted_nodes_threshold_ = std::numeric_limits<unsigned int>::max();
+
+  bucket_size_ = bucket_size;
+  if(bucket_size_<2)
+  {
+    CNR_WARN(logger_,"bucket size should be at least 2 and you are trying to set "<<bucket_size<<", set equal to 2");
+    bucket_size_ = 2;
+  }
+}
+
+void BucketKdTree::squaredDistances(const Bucket& bucket,
+                                    const Eigen::VectorXd& configuration,
+                                    Eigen::ArrayXd& squared_distances) const
+{
+  const Eigen::Index n = bucket.nodes.size();
+  if(squared_distances.size()<n)
+    squared_distances.resize(bucket.capacity);
+
+  auto d2 = squared_distances.head(n);
+  d2.setZero();
+  for(unsigned int d=0;d<dof_;d++)
+    d2 += (Eigen::Map<const Eigen::ArrayXd>(bucket.coordinates.data()+d*bucket.capacity,n)-configuration(d)).square();
+}
+
+BucketKdTree::Bucket BucketKdTree::emptyBucket(const size_t& capacity) const
+{
+  Bucket bucket;
+  bucket.capacity = capacity;
+  bucket.coordinates.resize(capacity*dof_);
+  bucket.nodes.reserve(capacity);
+  bucket.deleted.reserve(capacity);
+  bucket.ids.reserve(capacity);
+  return bucket;
+}
+
+uint32_t BucketKdTree::newLeaf(const uint32_t& bucket)
+{
+  if(kdnodes_.size() >= NONE || buckets_.size() >= NONE)
+  {
+    CNR_FATAL(logger_,"the bucket kdtree cannot store more than "<<NONE<<" kd-nodes");
+    throw std::runtime_error("the bucket kdtree is full");
+  }
+
+  uint32_t bucket_idx = bucket;
+  if(bucket_idx == NONE)
+  {
+    buckets_.push_back(emptyBucket(bucket_size_));
+    bucket_idx = buckets_.size()-1;
+  }
+
+  kdnodes_.push_back(KdEntry{NONE,NONE,0,bucket_idx,0.0});
+  return kdnodes_.size()-1;
+}
+
+void BucketKdTree::append(const uint32_t& bucket_idx, const NodePtr& node, const double* configuration, const size_t& stride,
+                          const bool& deleted, const size_t& id)
+{
+  Bucket& bucket = buckets_[bucket_idx];
+  size_t n = bucket.nodes.size();
+  if(n == bucket.capacity) //can happen only when the bucket cannot be split
+  {
+    size_t capacity = 2*bucket.capacity;
+    std::vector<double> coordinates(capacity*dof_);
+    for(unsigned int d=0;d<dof_;d++)
+      std::copy(bucket.coordinates.begin()+d*bucket.capacity,
+                bucket.coordinates.begin()+d*bucket.capacity+n,
+                coordinates.begin()+d*capacity);
+
+    bucket.coordinates = std::move(coordinates);
+    bucket.capacity = capacity;
+  }
+
+  for(unsigned int d=0;d<dof_;d++)
+    bucket.coordinates[d*bucket.capacity+n] = configuration[d*stride];
+
+  bucket.nodes.push_back(node);
+  bucket.deleted.push_back(deleted);
+  bucket.ids.push_back(id);
+
+  slots_[node.get()] = std::make_pair(bucket_idx,n);
+}
+
+bool BucketKdTree::split(const uint32_t& idx)
+{
+  uint32_t bucket_idx = kdnodes_[idx].bucket;
+  const size_t n = buckets_[bucket_idx].nodes.size();
+
+  // Dimension with the largest spread
+  Eigen::Map<const Eigen::ArrayXXd> points(buckets_[bucket_idx].coordinates.data(),buckets_[bucket_idx].capacity,dof_);
+
+  unsigned int dimension = 0;
+  double max_spread = 0.0;
+  for(unsigned int d=0;d<dof_;d++)
+  {
+    double spread = points.col(d).head(n).maxCoeff()-points.col(d).head(n).minCoeff();
+    if(spread>max_spread)
+    {
+      max_spread = spread;
+      dimension = d;
+    }
+  }
+
+  if(max_spread == 0.0) //all the configurations are equal
+    return false;
+
+  // Median value, moved up if needed so that both children are not empty (left < split <= right)
+  std::vector<double> values(points.col(dimension).data(),points.col(dimension).data()+n);
+  std::nth_element(values.begin(),values.begin()+n/2,values.end());
+  double split = values[n/2];
+
+  double min_value = *std::min_element(values.begin(),values.end());
+  if(split == min_value)
+  {
+    split = std::numeric_limits<double>::infinity();
+    for(const double& v:values)
+    {
+      if(v>min_value && v<split)
+        split = v;
+    }
+  }
+
+  // Move the content of the bucket into the two new leaves. The slot of the old bucket is reused by the left leaf
+  Bucket bucket = std::move(buckets_[bucket_idx]);
+  buckets_[bucket_idx] = emptyBucket(bucket_size_);
+
+  uint32_t left = newLeaf(bucket_idx);
+  uint32_t right = newLeaf();
+
+  for(size_t i=0;i<n;i++)
+  {
+    const double* configuration = bucket.coordinates.data()+i;
+    uint32_t child = (configuration[dimension*bucket.capacity]<split)? left: right;
+    append(kdnodes_[child].bucket,bucket.nodes[i],configuration,bucket.capacity,bucket.deleted[i],bucket.ids[i]);
+  }
+
+  KdEntry& kdnode = kdnodes_[idx];
+  kdnode.bucket = NONE;
+  kdnode.dimension = dimension;
+  kdnode.split = split;
+  kdnode.left = left;
+  kdnode.right = right;
+
+  return true;
+}
+
+void BucketKdTree::build(const std::vector<NodePtr>& nodes)
+{
+  clear();
+  if(nodes.empty())
+    return;
+
+  dof_ = nodes.front()->getConfiguration().size();
+
+  // Scaled configurations, stored contiguously to be read while partitioning
+  std::vector<double> configurations;
+  configurations.reserve(nodes.size()*dof_);
+  for(const NodePtr& n:nodes)
+  {
+    if(n->getConfiguration().size() != dof_)
+    {
+      CNR_FATAL(logger_,"node dimension ("<<n->getConfiguration().size()<<") is different from the kdtree dimension ("<<dof_<<")");
+      throw std::invalid_argument("node dimension is different from the kdtree dimension");
+    }
+    const Eigen::VectorXd& configuration = scaled(n->getConfiguration(),scaled_configuration_);
+    configurations.insert(configurations.end(),configuration.data(),configuration.data()+dof_);
+  }
+
+  std::vector<size_t> indices(nodes.size());
+  std::iota(indices.begin(),indices.end(),0);
+  slots_.reserve(nodes.size());
+
+  build(nodes,configurations,indices.begin(),indices.end());
+
+  size_ = nodes.size();
+  inserted_ = nodes.size();
+}
+
+uint32_t BucketKdTree::build(const std::vector<NodePtr>& nodes,
+                             const std::vector<double>& configurations,
+                             const std::vector<size_t>::iterator& begin,
+                             const std::vector<size_t>::iterator& end)
+{
+  auto value = [&](const size_t& i, const unsigned int& d)->double{
+    return configurations[i*dof_+d];
+  };
+
+  // Dimension with the largest spread
+  unsigned int dimension = 0;
+  double max_spread = 0.0;
+  if(static_cast<size_t>(end-begin)>bucket_size_)
+  {
+    for(unsigned int d=0;d<dof_;d++)
+    {
+      auto minmax = std::minmax_element(begin,end,[&](const size_t& i1, const size_t& i2){
+        return value(i1,d)<value(i2,d);
+      });
+
+      double spread = value(*minmax.second,d)-value(*minmax.first,d);
+      if(spread>max_spread)
+      {
+        max_spread = spread;
+        dimension = d;
+      }
+    }
+  }
+
+  if(max_spread == 0.0) //the nodes fit in a bucket or they are all equal
+  {
+    uint32_t idx = newLeaf();
+    for(std::vector<size_t>::iterator it=begin;it!=end;it++)
+      append(kdnodes_[idx].bucket,nodes[*it],configurations.data()+(*it)*dof_,1,false,*it);
+
+    return idx;
+  }
+
+  // Median value, moved up if needed so that both children are not empty (left < split <= right)
+  std::vector<size_t>::iterator median = begin+(end-begin)/2;
+  std::nth_element(begin,median,end,[&](const size_t& i1, const size_t& i2){
+    return value(i1,dimension)<value(i2,dimension);
+  });
+
+  double split = value(*median,dimension);
+  std::vector<size_t>::iterator middle = std::partition(begin,end,[&](const size_t& i){
+    return value(i,dimension)<split;
+  });
+
+  if(middle == begin)
+  {
+    split = std::numeric_limits<double>::infinity();
+    for(std::vector<size_t>::iterator it=begin;it!=end;it++)
+    {
+      if(value(*it,dimension)>value(*median,dimension) && value(*it,dimension)<split)
+        split = value(*it,dimension);
+    }
+    middle = std::partition(begin,end,[&](const size_t& i){
+      return value(i,dimension)<split;
+    });
+  }
+
+  // The parent is added before its children, so that the root is the first kd-node
+  kdnodes_.push_back(KdEntry{NONE,NONE,dimension,NONE,split});
+  uint32_t idx = kdnodes_.size()-1;
+
+  uint32_t left  = build(nodes,configurations,begin,middle);
+  uint32_t right = build(nodes,configurations,middle,end);
+
+  kdnodes_[idx].left  = left;
+  kdnodes_[idx].right = right;
+
+  return idx;
+}
+
+uint32_t BucketKdTree::leaf(const Eigen::VectorXd& configuration, uint32_t idx) const
+{
+  while(kdnodes_[idx].bucket == NONE)
+  {
+    const KdEntry& kdnode = kdnodes_[idx];
+    idx = (configuration(kdnode.dimension)<kdnode.split)? kdnode.left: kdnode.right;
+  }
+  return idx;
+}
+
+void BucketKdTree::insert(const NodePtr& node)
+{
+  const Eigen::VectorXd& configuration = scaled(node->getConfiguration(),scaled_configuration_);
+
+  if(kdnodes_.empty())
+  {
+    dof_ = configuration.size();
+    newLeaf();
+  }
+  else if(configuration.size() != dof_)
+  {
+    CNR_FATAL(logger_,"node dimension ("<<configuration.size()<<") is different from the kdtree dimension ("<<dof_<<")");
+    throw std::invalid_argument("node dimension is different from the kdtree dimension");
+  }
+
+  uint32_t idx = leaf(configuration);
+  if(buckets_[kdnodes_[idx].bucket].nodes.size() >= bucket_size_)
+  {
+    if(split(idx))
+      idx = leaf(configuration,idx);
+  }
+
+  append(kdnodes_[idx].bucket,node,configuration.data(),1,false,inserted_++);
+  size_++;
+}
+
+bool BucketKdTree::clear()
+{
+  size_=0;
+  deleted_nodes_=0;
+  inserted_=0;
+
+  kdnodes_.clear();
+  buckets_.clear();
+  slots_.clear();
+
+  return true;
+}
+
+void BucketKdTree::nearestNeighbor(const Eigen::VectorXd& configuration,
+                                   NodePtr &best,
+                                   double &best_distance)
+{
+  best_distance=std::numeric_limits<double>::infinity();
+  if(kdnodes_.empty())
+    return;
+
+  // Per-thread scratch buffer, so that queries do not allocate memory
+  thread_local Eigen::ArrayXd squared_distances;
+  thread_local Eigen::VectorXd scaled_query;
+  const Eigen::VectorXd& query = scaled(configuration,scaled_query);
+  double best_squared_distance = std::numeric_limits<double>::infinity();
+  nearestNeighbor(0,query,squared_distances,best,best_squared_distance);
+
+  best_distance = std::sqrt(best_squared_distance);
+}
+
+void BucketKdTree::nearestNeighbor(const uint32_t& idx,
+                                   const Eigen::VectorXd& configuration,
+                                   Eigen::ArrayXd& squared_distances,
+                                   NodePtr& best,
+                                   double& best_squared_distance) const
+{
+  const KdEntry& kdnode = kdnodes_[idx];
+
+  if(kdnode.bucket != NONE)
+  {
+    const Bucket& bucket = buckets_[kdnode.bucket];
+    squaredDistances(bucket,configuration,squared_distances);
+
+    for(size_t i=0;i<bucket.nodes.size();i++)
+    {
+      if(squared_distances(i)<best_squared_distance && not bucket.deleted[i])
+      {
+        best_squared_distance = squared_distances(i);
+        best = bucket.nodes[i];
+      }
+    }
+    return;
+  }
+
+  double delta = configuration(kdnode.dimension)-kdnode.split;
+
+  if(delta>=0.0) //search right first
+  {
+    nearestNeighbor(kdnode.right,configuration,squared_distances,best,best_squared_distance);
+    if(delta*delta<pruning_factor_*best_squared_distance)
+      nearestNeighbor(kdnode.left,configuration,squared_distances,best,best_squared_distance);
+  }
+  else //search left first
+  {
+    nearestNeighbor(kdnode.left,configuration,squared_distances,best,best_squared_distance);
+    if(delta*delta<=pruning_factor_*best_squared_distance)
+      nearestNeighbor(kdnode.right,configuration,squared_distances,best,best_squared_distance);
+  }
+}
+
+bool BucketKdTree::near(const Eigen::VectorXd& configuration,
+                        const double& radius,
+                        const NearVisitor& visitor)
+{
+  if(kdnodes_.empty())
+    return true;
+
+  // Per-thread scratch buffer, so that queries do not allocate memory
+  thread_local Eigen::ArrayXd squared_distances;
+  thread_local Eigen::VectorXd scaled_query;
+  const Eigen::VectorXd& query = scaled(configuration,scaled_query);
+  return near(0,query,radius,squared_distances,visitor);
+}
+
+bool BucketKdTree::near(const uint32_t& idx,
+                        const Eigen::VectorXd& configuration,
+                        const double& radius,
+                        Eigen::ArrayXd& squared_distances,
+                        const NearVisitor& visitor) const
+{
+  const KdEntry& kdnode = kdnodes_[idx];
+
+  if(kdnode.bucket != NONE)
+  {
+    const Bucket& bucket = buckets_[kdnode.bucket];
+    squaredDistances(bucket,configuration,squared_distances);
+
+    double squared_radius = radius*radius;
+    for(size_t i=0;i<bucket.nodes.size();i++)
+    {
+      if(squared_distances(i)<squared_radius && not bucket.deleted[i] &&
+         not visitor(std::sqrt(squared_distances(i)),bucket.nodes[i]))
+        return false;
+    }
+    return true;
+  }
+
+  double delta = configuration(kdnode.dimension)-kdnode.split;
+
+  if(delta<radius && not near(kdnode.left,configuration,radius,squared_distances,visitor))
+    return false;
+  if(-delta<radius && not near(kdnode.right,configuration,radius,squared_distances,visitor))
+    return false;
+  return true;
+}
+
+void BucketKdTree::kNearestNeighbors(const Eigen::VectorXd& configuration,
+                                     KNearestNeighborsHeap& heap)
+{
+  if(kdnodes_.empty() || heap.k() == 0)
+    return;
+
+  // Per-thread scratch buffer, so that queries do not allocate memory
+  thread_local Eigen::ArrayXd squared_distances;
+  thread_local Eigen::VectorXd scaled_query;
+  const Eigen::VectorXd& query = scaled(configuration,scaled_query);
+  kNearestNeighbors(0,query,squared_distances,heap);
+}
+
+void BucketKdTree::kNearestNeighbors(const uint32_t& idx,
+                                     const Eigen::VectorXd& configuration,
+                                     Eigen::ArrayXd& squared_distances,
+                                     KNearestNeighborsHeap& heap) const
+{
+  const KdEntry& kdnode = kdnodes_[idx];
+
+  if(kdnode.bucket != NONE)
+  {
+    const Bucket& bucket = buckets_[kdnode.bucket];
+    squaredDistances(bucket,configuration,squared_distances);
+
+    for(size_t i=0;i<bucket.nodes.size();i++)
+    {
+      if(squared_distances(i)<heap.worst() && not bucket.deleted[i])
+        heap.push(squared_distances(i),bucket.nodes[i]);
+    }
+    return;
+  }
+
+  double delta = configuration(kdnode.dimension)-kdnode.split;
+
+  // the worst distance is read again after the first recursion, since it can improve it
+  if(delta>=0.0) //search right first
+  {
+    kNearestNeighbors(kdnode.right,configuration,squared_distances,heap);
+    if(delta*delta<pruning_factor_*heap.worst())
+      kNearestNeighbors(kdnode.left,configuration,squared_distances,heap);
+  }
+  else //search left first
+  {
+    kNearestNeighbors(kdnode.left,configuration,squared_distances,heap);
+    if(delta*delta<=pruning_factor_*heap.worst())
+      kNearestNeighbors(kdnode.right,configuration,squared_distances,heap);
+  }
+}
+
+bool BucketKdTree::findNode(const NodePtr& node, uint32_t& bucket, size_t& pos) const
+{
+  std::unordered_map<const Node*,std::pair<uint32_t,size_t>>::const_iterator it = slots_.find(node.get());
+  if(it == slots_.end())
+    return false;
+
+  bucket = it->second.first;
+  pos = it->second.second;
+  return true;
+}
+
+bool BucketKdTree::findNode(const NodePtr& node)
+{
+  uint32_t bucket;
+  size_t pos;
+  return findNode(node,bucket,pos);
+}
+
+bool BucketKdTree::deleteNode(const NodePtr& node,
+                              const bool& disconnect_node)
+{
+  uint32_t bucket;
+  size_t pos;
+  if(not findNode(node,bucket,pos))
+    return false;
+
+  if(buckets_[bucket].deleted[pos])
+    return false;
+
+  size_--;
+  deleted_nodes_++;
+  buckets_[bucket].deleted[pos] = true;
+
+  if(disconnect_node)
+    node->disconnect();
+
+  if(deleted_nodes_>deleted_nodes_threshold_ && size_>0)
+  {
+    CNR_DEBUG(logger_,"number of deleted nodes ("<<deleted_nodes_<<") is greater than the threshold ("
+              <<deleted_nodes_threshold_<<"), kdtree is built from scratch");
+
+    std::vector<NodePtr> nodes = getNodes(); //insertion order is preserved
+    build(nodes);
+  }
+
+  return true;
+}
+
+bool BucketKdTree::restoreNode(const NodePtr& node)
+{
+  uint32_t bucket;
+  size_t pos;
+  if(not findNode(node,bucket,pos))
+    return false;
+
+  if(not buckets_[bucket].deleted[pos])
+    return true;
+
+  size_++;
+  deleted_nodes_--;
+  buckets_[bucket].deleted[pos] = false;
+  return true;
+}
+
+unsigned int BucketKdTree::deletedNodesThreshold()
+{
+  return deleted_nodes_threshold_;
+}
+
+void BucketKdTree::deletedNodesThreshold(const unsigned int t)
+{
+  if(t<=1)
+  {
+    CNR_WARN(logger_, "deleted_nodes_threshold_ cannot bet set because it should be at least 2 and you are trying to set "<<t);
+    return;
+  }
+  deleted_nodes_threshold_ = t;
+}
+
+std::vector<NodePtr> BucketKdTree::getNodes()
+{
+  std::vector<std::pair<size_t,NodePtr>> ordered_nodes;
+  ordered_nodes.reserve(size_);
+
+  for(const Bucket& bucket: buckets_)
+  {
+    for(size_t i=0;i<bucket.nodes.size();i++)
+    {
+      if(not bucket.deleted[i])
+        ordered_nodes.push_back(std::make_pair(bucket.ids[i],bucket.nodes[i]));
+    }
+  }
+
+  std::sort(ordered_nodes.begin(),ordered_nodes.end(),
+            [](const std::pair<size_t,NodePtr>& a, const std::pair<size_t,NodePtr>& b){return a.first<b.first;});
+
+  std::vector<NodePtr> nodes;
+  nodes.reserve(ordered_nodes.size());
+  for(const std::pair<size_t,NodePtr>& p:ordered_nodes)
+    nodes.push_back(p.second);
+
+  return nodes;
+}
+
+void BucketKdTree::disconnectNodes(const std::vector<NodePtr>& white_list)
+{
+  for(const Bucket& bucket: buckets_)
+  {
+    for(const NodePtr& n:bucket.nodes)
+    {
+      if(std::find(white_list.begin(),white_list.end(),n)==white_list.end())
+        n->disconnect();
+    }
+  }
+}
+
+std::ostream& operator<<(std::ostream& os, const BucketKdTree& kdtree)
+{
+  os<<"kd-nodes-> "<<kdtree.kdnodes_.size()<<" buckets-> "<<kdtree.buckets_.size()<<" bucket size-> "<<kdtree.bucket_size_<<" dof-> "<<kdtree.dof_<<std::endl;
+  os<<"size-> "<<kdtree.size_<<" deleted nodes-> "<<kdtree.deleted_nodes_<<" print deleted nodes-> "<<kdtree.print_deleted_nodes_<<"\n"<<std::endl;
+
+  for(size_t idx=0;idx<kdtree.kdnodes_.size();idx++)
+  {
+    const BucketKdTree::KdEntry& kdnode = kdtree.kdnodes_[idx];
+    os << "   --- kdnode "<<idx<<" ---"<<std::endl;
+    if(kdnode.bucket == BucketKdTree::NONE)
+    {
+      os << "split dimension-> "<<kdnode.dimension<<" split value-> "<<kdnode.split<<std::endl;
+      os << "left child-> "<<kdnode.left<<" right child-> "<<kdnode.right<<std::endl<<std::endl;
+    }
+    else
+    {
+      const BucketKdTree::Bucket& bucket = kdtree.buckets_[kdnode.bucket];
+      os << "bucket-> "<<kdnode.bucket<<" nodes-> "<<bucket.nodes.size()<<std::endl;
+      for(size_t i=0;i<bucket.nodes.size();i++)
+      {
+        if(kdtree.print_deleted_nodes_ || not bucket.deleted[i])
+        {
+          Eigen::Map<const Eigen::VectorXd,0,Eigen::InnerStride<>> configuration(bucket.coordinates.data()+i,kdtree.dof_,Eigen::InnerStride<>(bucket.capacity));
+          os << "node-> "<<configuration.transpose()<<" ("<<bucket.nodes[i]<<") deleted-> "<<static_cast<bool>(bucket.deleted[i])<<std::endl;
+        }
+      }
+      os<<std::endl;
+    }
+  }
+
+  return os;
+}
+
+} //end namespace core
+} // end namespace graph
@@ -0,0 +1,213 @@
+/*
+Copyright (c) 2024, Manuel Beschi and Cesare Tonola, JRL-CARI CNR-STIIMA/UNIBS, manuel.beschi@unibs.it, c.tonola001@unibs.it
+Manuel Beschi manuel.beschi@unibs.it
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of the <organization> nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL <COPYRIGHT HOLDER> BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+#include <graph_core/datastructure/concurrent_nearest_neighbors.h>
+#include <algorithm>
+
+namespace graph
+{
+namespace core
+{
+
+ConcurrentNearestNeighbors::ConcurrentNearestNeighbors(const NearestNeighborsPtr& nearest_neighbors,
+                                                       const cnr_logger::TraceLoggerPtr& logger):
+  NearestNeighbors(logger),
+  nearest_neighbors_(nearest_neighbors)
+{
+  if(not nearest_neighbors_)
+  {
+    CNR_FATAL(logger_,"the data structure wrapped by ConcurrentNearestNeighbors is not defined");
+    throw std::invalid_argument("the data structure wrapped by ConcurrentNearestNeighbors is not defined");
+  }
+  scale_ = nearest_neighbors_->getScale();
+  NearestNeighbors::setEpsilon(nearest_neighbors_->getEpsilon());
+}
+
+std::vector<const ConcurrentNearestNeighbors*>& ConcurrentNearestNeighbors::readLocks()
+{
+  thread_local std::vector<const ConcurrentNearestNeighbors*> read_locks;
+  return read_locks;
+}
+
+bool ConcurrentNearestNeighbors::readLockedByThisThread() const
+{
+  const std::vector<const ConcurrentNearestNeighbors*>& read_locks = readLocks();
+  return std::find(read_locks.begin(),read_locks.end(),this) != read_locks.end();
+}
+
+ConcurrentNearestNeighbors::WriteLock::WriteLock(ConcurrentNearestNeighbors& nn)
+{
+  if(nn.readLockedByThisThread())
+  {
+    CNR_FATAL(nn.logger_,"ConcurrentNearestNeighbors modified while the same thread is querying it (e.g., by a visitor of near())");
+    throw std::logic_error("ConcurrentNearestNeighbors modified while the same thread is querying it (e.g., by a visitor of near())");
+  }
+  turnstile_ = std::unique_lock<std::mutex>(nn.turnstile_);
+  lock_ = std::unique_lock<std::shared_mutex>(nn.mutex_);
+}
+
+ConcurrentNearestNeighbors::ReadLock::ReadLock(ConcurrentNearestNeighbors& nn):
+  lock_(nn.mutex_,std::defer_lock)
+{
+  if(nn.readLockedByThisThread())
+    return;
+
+  {
+    std::lock_guard<std::mutex> turnstile(nn.turnstile_);
+    lock_.lock();
+  }
+  readLocks().push_back(&nn);
+}
+
+ConcurrentNearestNeighbors::ReadLock::~ReadLock()
+{
+  if(lock_.owns_lock())
+    readLocks().pop_back();
+}
+
+void ConcurrentNearestNeighbors::insert(const NodePtr& node)
+{
+  WriteLock lock(*this);
+  nearest_neighbors_->insert(node);
+}
+
+void ConcurrentNearestNeighbors::insert(const std::vector<NodePtr>& nodes)
+{
+  WriteLock lock(*this);
+  for(const NodePtr& n:nodes)
+    nearest_neighbors_->insert(n);
+}
+
+bool ConcurrentNearestNeighbors::clear()
+{
+  WriteLock lock(*this);
+  return nearest_neighbors_->clear();
+}
+
+void ConcurrentNearestNeighbors::build(const std::vector<NodePtr>& nodes)
+{
+  WriteLock lock(*this);
+  nearest_neighbors_->build(nodes);
+}
+
+void ConcurrentNearestNeighbors::setScale(const Eigen::VectorXd& scale)
+{
+  WriteLock lock(*this);
+  nearest_neighbors_->setScale(scale);
+  scale_ = nearest_neighbors_->getScale();
+}
+
+void ConcurrentNearestNeighbors::setEpsilon(const double& epsilon)
+{
+  WriteLock lock(*this);
+  nearest_neighbors_->setEpsilon(epsilon);
+  NearestNeighbors::setEpsilon(epsilon);
+}
+
+void ConcurrentNearestNeighbors::nearestNeighbor(const Eigen::VectorXd& configuration,
+                                                 NodePtr &best,
+                                                 double &best_distance)
+{
+  ReadLock lock(*this);
+  nearest_neighbors_->nearestNeighbor(configuration,best,best_distance);
+}
+
+bool ConcurrentNearestNeighbors::near(const Eigen::VectorXd& configuration,
+                                      const double& radius,
+                                      const NearVisitor& visitor)
+{
+  ReadLock lock(*this);
+  return nearest_neighbors_->near(configuration,radius,visitor);
+}
+
+void ConcurrentNearestNeighbors::kNearestNeighbors(const Eigen::VectorXd& configuration,
+                                                   KNearestNeighborsHeap& heap)
+{
+  ReadLock lock(*this);
+  nearest_neighbors_->kNearestNeighbors(configuration,heap);
+}
+
+void ConcurrentNearestNeighbors::nearestNeighbors(const std::vector<Eigen::VectorXd>& configurations,
+                                                  std::vector<std::pair<double,Node*>>& nodes,
+                                                  const unsigned int& n_threads,
+                                                  const WorkerPoolPtr& pool)
+{
+  ReadLock lock(*this);
+  nearest_neighbors_->nearestNeighbors(configurations,nodes,n_threads,pool);
+}
+
+void ConcurrentNearestNeighbors::kNearestNeighbors(const std::vector<Eigen::VectorXd>& configurations,
+                                                   const size_t& k,
+                                                   std::vector<std::pair<double,Node*>>& nodes,
+                                                   const unsigned int& n_threads,
+                                                   const WorkerPoolPtr& pool)
+{
+  ReadLock lock(*this);
+  nearest_neighbors_->kNearestNeighbors(configurations,k,nodes,n_threads,pool);
+}
+
+bool ConcurrentNearestNeighbors::findNode(const NodePtr& node)
+{
+  ReadLock lock(*this);
+  return nearest_neighbors_->findNode(node);
+}
+
+bool ConcurrentNearestNeighbors::deleteNode(const NodePtr& node,
+                                            const bool& disconnect_node)
+{
+  WriteLock lock(*this);
+  return nearest_neighbors_->deleteNode(node,disconnect_node);
+}
+
+bool ConcurrentNearestNeighbors::restoreNode(const NodePtr& node)
+{
+  WriteLock lock(*this);
+  return nearest_neighbors_->restoreNode(node);
+}
+
+unsigned int ConcurrentNearestNeighbors::size()
+{
+  ReadLock lock(*this);
+  return nearest_neighbors_->size();
+}
+
+std::vector<NodePtr> ConcurrentNearestNeighbors::getNodes()
+{
+  ReadLock lock(*this);
+  return nearest_neighbors_->getNodes();
+}
+
+void ConcurrentNearestNeighbors::disconnectNodes(const std::vector<NodePtr>& white_list)
+{
+  WriteLock lock(*this);
+  nearest_neighbors_->disconnectNodes(white_list);
+}
+
+} //end namespace core
+} // end namespace graph
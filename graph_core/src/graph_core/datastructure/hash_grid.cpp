@@ -0,0 +1,447 @@
+/*
+Copyright (c) 2024, Manuel Beschi and Cesare Tonola, JRL-CARI CNR-STIIMA/UNIBS, manuel.beschi@unibs.it, c.tonola001@unibs.it
+Manuel Beschi manuel.beschi@unibs.it
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of the <organization> nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL <COPYRIGHT HOLDER> BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+#include <graph_core/datastructure/hash_grid.h>
+
+namespace graph
+{
+namespace core
+{
+
+HashGrid::HashGrid(const double& cell_size, const cnr_logger::TraceLoggerPtr &logger):
+  NearestNeighbors(logger),
+  cell_size_(cell_size)
+{
+  if(not (cell_size_>0.0 && cell_size_<std::numeric_limits<double>::infinity()))
+  {
+    CNR_FATAL(logger_,"the cell size of the grid should be positive and finite: "<<cell_size_);
+    throw std::invalid_argument("the cell size of the grid should be positive and finite");
+  }
+
+  dof_ = 0;
+  deleted_nodes_threshold_ = std::numeric_limits<unsigned int>::max();
+}
+
+HashGrid::CellKey HashGrid::cellOf(const double* configuration) const
+{
+  CellKey key;
+  key.fill(0);
+  for(unsigned int d=0;d<dof_;d++)
+    key[d] = static_cast<int64_t>(std::floor(configuration[d]/cell_size_));
+  return key;
+}
+
+void HashGrid::addToCell(const uint32_t& idx)
+{
+  cells_[cellOf(configurations_.data()+static_cast<size_t>(idx)*dof_)].push_back(idx);
+}
+
+void HashGrid::removeFromCell(const uint32_t& idx)
+{
+  std::unordered_map<CellKey,std::vector<uint32_t>,CellKeyHash>::iterator it = cells_.find(cellOf(configurations_.data()+static_cast<size_t>(idx)*dof_));
+  assert(it != cells_.end());
+
+  std::vector<uint32_t>& cell = it->second;
+  std::vector<uint32_t>::iterator it_item = std::find(cell.begin(),cell.end(),idx);
+  assert(it_item != cell.end());
+
+  *it_item = cell.back();
+  cell.pop_back();
+  if(cell.empty())
+    cells_.erase(it);
+}
+
+void HashGrid::insert(const NodePtr& node)
+{
+  const Eigen::VectorXd& configuration = node->getConfiguration();
+
+  if(items_.empty())
+  {
+    if(configuration.size()>MAX_DIMENSION)
+    {
+      CNR_FATAL(logger_,"the grid supports up to "<<MAX_DIMENSION<<" dimensions, the node has "<<configuration.size());
+      throw std::invalid_argument("the node dimension is too large for the grid");
+    }
+    dof_ = configuration.size();
+  }
+  else if(configuration.size() != dof_)
+  {
+    CNR_FATAL(logger_,"node dimension ("<<configuration.size()<<") is different from the grid dimension ("<<dof_<<")");
+    throw std::invalid_argument("node dimension is different from the grid dimension");
+  }
+
+  if(items_.size() >= NONE)
+  {
+    CNR_FATAL(logger_,"the grid cannot store more than "<<NONE<<" nodes");
+    throw std::runtime_error("the grid is full");
+  }
+
+  uint32_t idx = items_.size();
+  items_.push_back(Item{node,false});
+  indices_[node.get()] = idx;
+
+  const Eigen::VectorXd& scaled_configuration = scaled(configuration,scaled_configuration_);
+  configurations_.insert(configurations_.end(),scaled_configuration.data(),scaled_configuration.data()+dof_);
+
+  addToCell(idx);
+  size_++;
+}
+
+bool HashGrid::clear()
+{
+  size_=0;
+  deleted_nodes_=0;
+  items_.clear();
+  configurations_.clear();
+  cells_.clear();
+  indices_.clear();
+  return true;
+}
+
+void HashGrid::build(const std::vector<NodePtr>& nodes)
+{
+  clear();
+  items_.reserve(nodes.size());
+  indices_.reserve(nodes.size());
+  if(not nodes.empty())
+    configurations_.reserve(nodes.size()*nodes.front()->getConfiguration().size());
+
+  for(const NodePtr& n:nodes)
+    insert(n);
+}
+
+template<typename Visitor>
+bool HashGrid::visitRing(const CellKey& center, const int64_t& ring, Visitor& visitor) const
+{
+  if(ring == 0)
+  {
+    std::unordered_map<CellKey,std::vector<uint32_t>,CellKeyHash>::const_iterator it = cells_.find(center);
+    return (it == cells_.end() || visitor(it->second));
+  }
+
+  // Odometer on the offsets of the first dof_-1 dimensions. The last dimension spans the whole ring only
+  // if another offset is already on the boundary of the ring, otherwise it takes only the values -ring and ring
+  unsigned int last = dof_-1;
+  CellKey offset;
+  offset.fill(0);
+  for(unsigned int d=0;d<last;d++)
+    offset[d] = -ring;
+
+  CellKey key;
+  while(true)
+  {
+    bool on_boundary = false;
+    for(unsigned int d=0;d<last;d++)
+      on_boundary = on_boundary || (std::abs(offset[d]) == ring);
+
+    int64_t step = on_boundary? 1: 2*ring;
+    for(int64_t o=-ring;o<=ring;o+=step)
+    {
+      key = center;
+      for(unsigned int d=0;d<last;d++)
+        key[d] += offset[d];
+      key[last] += o;
+
+      std::unordered_map<CellKey,std::vector<uint32_t>,CellKeyHash>::const_iterator it = cells_.find(key);
+      if(it != cells_.end() && not visitor(it->second))
+        return false;
+    }
+
+    unsigned int d=0;
+    for(;d<last;d++)
+    {
+      if(offset[d]<ring)
+      {
+        offset[d]++;
+        break;
+      }
+      offset[d] = -ring;
+    }
+    if(d == last)
+      return true;
+  }
+}
+
+template<typename Visitor, typename Bound>
+void HashGrid::visitByRings(const Eigen::VectorXd& configuration, Visitor& visitor, const Bound& bound) const
+{
+  CellKey center = cellOf(configuration.data());
+
+  // Distance between the configuration and the closest face of its cell: a cell of ring r>0 is at least
+  // (r-1)*cell_size_+margin far from the configuration
+  double margin = cell_size_;
+  for(unsigned int d=0;d<dof_;d++)
+  {
+    double offset = std::max(0.0,configuration(d)-center[d]*cell_size_);
+    margin = std::min(margin,std::min(offset,std::max(0.0,cell_size_-offset)));
+  }
+
+  for(int64_t ring=0;;ring++)
+  {
+    if(ring>0)
+    {
+      double lower_bound = (ring-1)*cell_size_+margin;
+      if(lower_bound*lower_bound>=bound())
+        return;
+    }
+
+    // (2*ring+1)^dof_ cells have been visited at the end of this ring: if they are more than the non-empty cells,
+    // the non-empty cells not visited yet are scanned instead
+    double cells_in_rings = std::pow(2.0*ring+1.0,dof_);
+    if(cells_in_rings>cells_.size())
+    {
+      for(const std::pair<const CellKey,std::vector<uint32_t>>& cell: cells_)
+      {
+        int64_t chebyshev_distance = 0;
+        for(unsigned int d=0;d<dof_;d++)
+          chebyshev_distance = std::max(chebyshev_distance,std::abs(cell.first[d]-center[d]));
+        if(chebyshev_distance>=ring)
+          visitor(cell.second);
+      }
+      return;
+    }
+
+    visitRing(center,ring,visitor);
+  }
+}
+
+void HashGrid::nearestNeighbor(const Eigen::VectorXd& configuration,
+                               NodePtr &best,
+                               double &best_distance)
+{
+  best_distance=std::numeric_limits<double>::infinity();
+  if(size_ == 0)
+    return;
+
+  thread_local Eigen::VectorXd scaled_query;
+  const Eigen::VectorXd& query = scaled(configuration,scaled_query);
+
+  uint32_t best_idx = NONE;
+  double best_squared_distance = std::numeric_limits<double>::infinity();
+  auto visitor = [this,&query,&best_idx,&best_squared_distance](const std::vector<uint32_t>& cell){
+    for(const uint32_t& idx: cell)
+    {
+      double squared_distance = squaredDistance(query,idx);
+      if(squared_distance<best_squared_distance)
+      {
+        best_squared_distance = squared_distance;
+        best_idx = idx;
+      }
+    }
+    return true;
+  };
+  visitByRings(query,visitor,[this,&best_squared_distance](){return pruning_factor_*best_squared_distance;});
+
+  best = items_[best_idx].node;
+  best_distance = std::sqrt(best_squared_distance);
+}
+
+bool HashGrid::near(const Eigen::VectorXd& configuration,
+                    const double& radius,
+                    const NearVisitor& visitor)
+{
+  if(size_ == 0)
+    return true;
+
+  thread_local Eigen::VectorXd scaled_query;
+  const Eigen::VectorXd& query = scaled(configuration,scaled_query);
+
+  double squared_radius = radius*radius;
+  auto cell_visitor = [this,&query,&squared_radius,&visitor](const std::vector<uint32_t>& cell){
+    for(const uint32_t& idx: cell)
+    {
+      double squared_distance = squaredDistance(query,idx);
+      if(squared_distance<squared_radius && not visitor(std::sqrt(squared_distance),items_[idx].node))
+        return false;
+    }
+    return true;
+  };
+
+  // Cells overlapping the bounding box of the ball. If they are more than the non-empty cells, the latter are scanned
+  CellKey lower, upper;
+  lower.fill(0);
+  upper.fill(0);
+  double cells_in_box = 1.0;
+  for(unsigned int d=0;d<dof_;d++)
+  {
+    double l = std::floor((query(d)-radius)/cell_size_);
+    double u = std::floor((query(d)+radius)/cell_size_);
+    cells_in_box *= (u-l+1.0);
+    if(not (cells_in_box<=cells_.size()))
+      break;
+    lower[d] = static_cast<int64_t>(l);
+    upper[d] = static_cast<int64_t>(u);
+  }
+
+  if(not (cells_in_box<=cells_.size()))
+  {
+    for(const std::pair<const CellKey,std::vector<uint32_t>>& cell: cells_)
+    {
+      if(not cell_visitor(cell.second))
+        return false;
+    }
+    return true;
+  }
+
+  CellKey key = lower;
+  while(true)
+  {
+    std::unordered_map<CellKey,std::vector<uint32_t>,CellKeyHash>::const_iterator it = cells_.find(key);
+    if(it != cells_.end() && not cell_visitor(it->second))
+      return false;
+
+    unsigned int d=0;
+    for(;d<dof_;d++)
+    {
+      if(key[d]<upper[d])
+      {
+        key[d]++;
+        break;
+      }
+      key[d] = lower[d];
+    }
+    if(d == dof_)
+      return true;
+  }
+}
+
+void HashGrid::kNearestNeighbors(const Eigen::VectorXd& configuration,
+                                 KNearestNeighborsHeap& heap)
+{
+  if(size_ == 0 || heap.k() == 0)
+    return;
+
+  thread_local Eigen::VectorXd scaled_query;
+  const Eigen::VectorXd& query = scaled(configuration,scaled_query);
+
+  auto visitor = [this,&query,&heap](const std::vector<uint32_t>& cell){
+    for(const uint32_t& idx: cell)
+      heap.push(squaredDistance(query,idx),items_[idx].node);
+    return true;
+  };
+  visitByRings(query,visitor,[this,&heap](){return pruning_factor_*heap.worst();});
+}
+
+bool HashGrid::findNode(const NodePtr& node)
+{
+  return indices_.find(node.get()) != indices_.end();
+}
+
+bool HashGrid::deleteNode(const NodePtr& node,
+                          const bool& disconnect_node)
+{
+  std::unordered_map<const Node*,uint32_t>::iterator it = indices_.find(node.get());
+  if(it == indices_.end() || items_[it->second].deleted)
+    return false;
+
+  size_--;
+  deleted_nodes_++;
+  items_[it->second].deleted = true;
+  removeFromCell(it->second);
+
+  if(disconnect_node)
+    node->disconnect();
+
+  if(deleted_nodes_>deleted_nodes_threshold_ && size_>0)
+  {
+    CNR_DEBUG(logger_,"number of deleted nodes ("<<deleted_nodes_<<") is greater than the threshold ("
+              <<deleted_nodes_threshold_<<"), grid is built from scratch");
+
+    std::vector<NodePtr> nodes = getNodes(); //insertion order is preserved
+    build(nodes);
+  }
+
+  return true;
+}
+
+bool HashGrid::restoreNode(const NodePtr& node)
+{
+  std::unordered_map<const Node*,uint32_t>::iterator it = indices_.find(node.get());
+  if(it == indices_.end())
+    return false;
+
+  if(not items_[it->second].deleted)
+    return true;
+
+  size_++;
+  deleted_nodes_--;
+  items_[it->second].deleted = false;
+  addToCell(it->second);
+  return true;
+}
+
+double HashGrid::cellSize()
+{
+  return cell_size_;
+}
+
+size_t HashGrid::numberOfCells()
+{
+  return cells_.size();
+}
+
+unsigned int HashGrid::deletedNodesThreshold()
+{
+  return deleted_nodes_threshold_;
+}
+
+void HashGrid::deletedNodesThreshold(const unsigned int t)
+{
+  if(t<=1)
+  {
+    CNR_WARN(logger_, "deleted_nodes_threshold_ cannot bet set because it should be at least 2 and you are trying to set "<<t);
+    return;
+  }
+  deleted_nodes_threshold_ = t;
+}
+
+std::vector<NodePtr> HashGrid::getNodes()
+{
+  std::vector<NodePtr> nodes;
+  nodes.reserve(size_);
+
+  for(const Item& item: items_)
+  {
+    if(not item.deleted)
+      nodes.push_back(item.node);
+  }
+  return nodes;
+}
+
+void HashGrid::disconnectNodes(const std::vector<NodePtr>& white_list)
+{
+  for(const Item& item: items_)
+  {
+    if(std::find(white_list.begin(),white_list.end(),item.node)==white_list.end())
+      item.node->disconnect();
+  }
+}
+
+} //end namespace core
+} // end namespace graph
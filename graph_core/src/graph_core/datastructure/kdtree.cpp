@@ -41,6 +41,7 @@ KdNode::KdNode(const NodePtr& node,
                const int &dimension,
                const cnr_logger::TraceLoggerPtr &logger):
   node_(node),
+  value_(node->getConfiguration()(dimension)),
   dimension_(dimension),
   logger_(logger)
 {
@@ -95,19 +96,20 @@ int KdNode::dimension()
   return dimension_;
 }
 
-void KdNode::insert(const NodePtr& node)
+KdNodePtr KdNode::insert(const NodePtr& node)
 {
   int size=node->getConfiguration().size();
   int next_dim=(dimension_==(size-1))?0:dimension_+1;
-  if (node->getConfiguration()(dimension_)>=node_->getConfiguration()(dimension_))  // goRight
+  if (node->getConfiguration()(dimension_)>=value_)  // goRight
   {
     if (not right_)
     {
       right_=std::make_shared<KdNode>(node,next_dim,logger_);
       right_->parent(pointer());
+      return right_;
     }
     else
-      right_->insert(node);
+      return right_->insert(node);
   }
   else //goLeft
   {
@@ -115,27 +117,34 @@ void KdNode::insert(const NodePtr& node)
     {
       left_=std::make_shared<KdNode>(node,next_dim,logger_);
       left_->parent(pointer());
+      return left_;
     }
     else
-      left_->insert(node);
+      return left_->insert(node);
   }
 }
 
 KdNodePtr KdNode::findMin(const int& dim)
 {
+  // deleted kdnodes have released their node, so they are skipped
   if (dimension_==dim)
   {
-    if (not left_)
-      return pointer();
-    else
-      return left_->findMin(dim);
+    // the left subtree is lower than this kdnode, which is not greater than the right subtree
+    KdNodePtr min_kdnode;
+    if (left_)
+      min_kdnode = left_->findMin(dim);
+    if (not min_kdnode && not deleted_)
+      min_kdnode = pointer();
+    if (not min_kdnode && right_)
+      min_kdnode = right_->findMin(dim);
+    return min_kdnode;
   }
   else
   {
-    if(not left_ and not right_)
-      return pointer();
+    KdNodePtr min_kdnode, min_left, min_right;
 
-    KdNodePtr min_left, min_right;
+    if (not deleted_)
+      min_kdnode = pointer();
 
     if(left_)
       min_left  = left_->findMin(dim);
@@ -143,11 +152,9 @@ KdNodePtr KdNode::findMin(const int& dim)
     if(right_)
       min_right = right_->findMin(dim);
 
-    KdNodePtr min_kdnode = pointer();
-
-    if(min_left && (min_left->node()->getConfiguration()(dim)<min_kdnode->node()->getConfiguration()(dim)))
+    if(min_left && (not min_kdnode || min_left->node()->getConfiguration()(dim)<min_kdnode->node()->getConfiguration()(dim)))
       min_kdnode = min_left;
-    if(min_right && (min_right->node()->getConfiguration()(dim)<min_kdnode->node()->getConfiguration()(dim)))
+    if(min_right && (not min_kdnode || min_right->node()->getConfiguration()(dim)<min_kdnode->node()->getConfiguration()(dim)))
       min_kdnode = min_right;
 
     return min_kdnode;
@@ -156,122 +163,107 @@ KdNodePtr KdNode::findMin(const int& dim)
 
 void KdNode::nearestNeighbor(const Eigen::VectorXd& configuration,
                              NodePtr& best,
-                             double& best_distance)
+                             double& best_squared_distance,
+                             const Eigen::VectorXd& scale,
+                             const double& pruning_factor)
 {
-  double distance=(configuration-node_->getConfiguration()).norm();
-  if ((not deleted_) and distance<best_distance)
+  if (not deleted_)
   {
-    best_distance=distance;
-    best=node_;
+    double squared_distance=squaredDistance(configuration,node_->getConfiguration(),scale);
+    if (squared_distance<best_squared_distance)
+    {
+      best_squared_distance=squared_distance;
+      best=node_;
+    }
   }
 
+  double delta=configuration(dimension_)-value_;
+  if (scale.size()>0)
+    delta*=scale(dimension_);
+
   SearchDirection dir=SearchDirection::Left;
-  if (configuration(dimension_)>node_->getConfiguration()(dimension_))
+  if (delta>0)
     dir=SearchDirection::Right;
 
+  // the other side is visited only if the splitting plane is closer than the best node found so far
   if (dir==SearchDirection::Left)
   {
-    if (left_ &&
-        (configuration(dimension_)-best_distance)<=node_->getConfiguration()(dimension_))
-    {
-      left_->nearestNeighbor(configuration,best,best_distance);
-    }
-    if (right_ &&
-        (configuration(dimension_)+best_distance)>=node_->getConfiguration()(dimension_))
-    {
-      right_->nearestNeighbor(configuration,best,best_distance);
-    }
+    if (left_)
+      left_->nearestNeighbor(configuration,best,best_squared_distance,scale,pruning_factor);
+    if (right_ && delta*delta<=pruning_factor*best_squared_distance)
+      right_->nearestNeighbor(configuration,best,best_squared_distance,scale,pruning_factor);
   }
   else  //  (dir==SearchDirection::Right)
   {
-    if (right_ &&
-        (configuration(dimension_)+best_distance)>=node_->getConfiguration()(dimension_))
-    {
-      right_->nearestNeighbor(configuration,best,best_distance);
-    }
-    if (left_ &&
-        (configuration(dimension_)-best_distance)<=node_->getConfiguration()(dimension_))
-    {
-      left_->nearestNeighbor(configuration,best,best_distance);
-    }
+    if (right_)
+      right_->nearestNeighbor(configuration,best,best_squared_distance,scale,pruning_factor);
+    if (left_ && delta*delta<=pruning_factor*best_squared_distance)
+      left_->nearestNeighbor(configuration,best,best_squared_distance,scale,pruning_factor);
   }
 }
 
-void KdNode::near(const Eigen::VectorXd& configuration,
+bool KdNode::near(const Eigen::VectorXd& configuration,
                   const double& radius,
-                  std::multimap<double, NodePtr> &nodes)
+                  const NearVisitor& visitor,
+                  const Eigen::VectorXd& scale)
 {
-  double distance=(configuration-node_->getConfiguration()).norm();
-
-  if ((not deleted_) and distance<radius)
+  if (not deleted_)
   {
-    nodes.insert(std::pair<double,NodePtr>(distance,node_));
+    double squared_distance=squaredDistance(configuration,node_->getConfiguration(),scale);
+    if (squared_distance<radius*radius && not visitor(std::sqrt(squared_distance),node_))
+      return false;
   }
 
+  // the radius along the splitting dimension, in configuration units
+  double dimension_radius=radius;
+  if (scale.size()>0)
+    dimension_radius/=scale(dimension_);
+
   if (left_ &&
-      (configuration(dimension_)-radius)<=node_->getConfiguration()(dimension_))
+      (configuration(dimension_)-dimension_radius)<=value_)
   {
-    left_->near(configuration,radius,nodes);
+    if(not left_->near(configuration,radius,visitor,scale))
+      return false;
   }
   if (right_ &&
-      (configuration(dimension_)+radius)>=node_->getConfiguration()(dimension_))
+      (configuration(dimension_)+dimension_radius)>=value_)
   {
-    right_->near(configuration,radius,nodes);
+    if(not right_->near(configuration,radius,visitor,scale))
+      return false;
   }
+  return true;
 }
 
 void KdNode::kNearestNeighbors(const Eigen::VectorXd& configuration,
-                               const size_t& k,
-                               std::multimap<double, NodePtr> &nodes)
+                               KNearestNeighborsHeap& heap,
+                               const Eigen::VectorXd& scale,
+                               const double& pruning_factor)
 {
-  double last_distance;
-  if (nodes.empty())
-    last_distance=std::numeric_limits<double>::infinity();
-  else
-    last_distance=std::prev(nodes.end())->first;
+  if (not deleted_)
+    heap.push(squaredDistance(configuration,node_->getConfiguration(),scale),node_);
 
-  double distance=(configuration-node_->getConfiguration()).norm();
-  if ((not deleted_) and nodes.size()<k)
-  {
-    nodes.insert(std::pair<double,NodePtr>(distance,node_));
-    last_distance=std::prev(nodes.end())->first;
-  }
-  else if ((not deleted_) and distance<last_distance)
-  {
-    nodes.erase(std::prev(nodes.end()));
-    nodes.insert(std::pair<double,NodePtr>(distance,node_));
-    last_distance=std::prev(nodes.end())->first;
-  }
+  double delta=configuration(dimension_)-value_;
+  if (scale.size()>0)
+    delta*=scale(dimension_);
 
   SearchDirection dir=SearchDirection::Left;
-  if (configuration(dimension_)>node_->getConfiguration()(dimension_))
+  if (delta>0)
     dir=SearchDirection::Right;
 
+  // the worst distance is read again after the first recursion, since it can improve it
   if (dir==SearchDirection::Left)
   {
-    if (left_ &&
-        (configuration(dimension_)-last_distance)<=node_->getConfiguration()(dimension_))
-    {
-      left_->kNearestNeighbors(configuration,k,nodes);
-    }
-    if (right_ &&
-        (configuration(dimension_)+last_distance)>=node_->getConfiguration()(dimension_))
-    {
-      right_->kNearestNeighbors(configuration,k,nodes);
-    }
+    if (left_)
+      left_->kNearestNeighbors(configuration,heap,scale,pruning_factor);
+    if (right_ && delta*delta<=pruning_factor*heap.worst())
+      right_->kNearestNeighbors(configuration,heap,scale,pruning_factor);
   }
   else  //  (dir==SearchDirection::Right)
   {
-    if (right_ &&
-        (configuration(dimension_)+last_distance)>=node_->getConfiguration()(dimension_))
-    {
-      right_->kNearestNeighbors(configuration,k,nodes);
-    }
-    if (left_ &&
-        (configuration(dimension_)-last_distance)<=node_->getConfiguration()(dimension_))
-    {
-      left_->kNearestNeighbors(configuration,k,nodes);
-    }
+    if (right_)
+      right_->kNearestNeighbors(configuration,heap,scale,pruning_factor);
+    if (left_ && delta*delta<=pruning_factor*heap.worst())
+      left_->kNearestNeighbors(configuration,heap,scale,pruning_factor);
   }
 }
 
@@ -279,13 +271,13 @@ bool KdNode::findNode(const NodePtr& node,
                       KdNodePtr& kdnode)
 {
   // is this node?
-  if (node_==node)
+  if (node_==node || (deleted_ && released_node_.lock()==node))
   {
     kdnode=pointer();
     return true;
   }
   // otherwise search the node
-  if (node->getConfiguration()(dimension_)>=node_->getConfiguration()(dimension_))  // goRight
+  if (node->getConfiguration()(dimension_)>=value_)  // goRight
   {
     if (not right_)
       return false;
@@ -304,11 +296,16 @@ void KdNode::deleteNode(const bool& disconnect_node)
   deleted_=true;
   if (disconnect_node)
     node_->disconnect();
+
+  released_node_=node_;
+  node_=nullptr;
 }
 
-void KdNode::restoreNode()
+void KdNode::restoreNode(const NodePtr& node)
 {
   deleted_=false;
+  node_=node;
+  released_node_.reset();
 }
 
 void KdNode::getNodes(std::vector<NodePtr>& nodes)
@@ -323,8 +320,9 @@ void KdNode::getNodes(std::vector<NodePtr>& nodes)
 
 void KdNode::disconnectNodes(const std::vector<NodePtr>& white_list)
 {
-  if (std::find(white_list.begin(),white_list.end(),node_)==white_list.end())
-    node_->disconnect();
+  NodePtr node=deleted_? released_node_.lock(): node_;
+  if (node && std::find(white_list.begin(),white_list.end(),node)==white_list.end())
+    node->disconnect();
   if (left_)
     left_->disconnectNodes(white_list);
   if (right_)
@@ -333,7 +331,10 @@ void KdNode::disconnectNodes(const std::vector<NodePtr>& white_list)
 
 std::ostream& operator<<(std::ostream& os, const KdNode& kdnode)
 {
-  os << "node-> "<<kdnode.node_->getConfiguration().transpose()<<" ("<<kdnode.node_<<")"<<std::endl;
+  if (kdnode.node_)
+    os << "node-> "<<kdnode.node_->getConfiguration().transpose()<<" ("<<kdnode.node_<<")"<<std::endl;
+  else
+    os << "node-> released (value "<<kdnode.value_<<")"<<std::endl;
   os << "dimension-> "<<kdnode.dimension_<<" deleted-> "<<kdnode.deleted_<<std::endl;
   os << "parent-> "<<kdnode.parent_.lock()<<" left child-> "<<kdnode.left_<<" right child-> "<<kdnode.right_<<std::endl;
   return os;
@@ -348,6 +349,7 @@ KdTree::KdTree(const cnr_logger::TraceLoggerPtr &logger):
 {
   print_deleted_nodes_ = false;
   deleted_nodes_threshold_ = std::numeric_limits<unsigned int>::max();
+  deleted_nodes_fraction_ = 0.5;
 }
 
 KdTree::~KdTree()
@@ -362,9 +364,10 @@ void KdTree::insert(const NodePtr& node)
   if (not root_)
   {
     root_=std::make_shared<KdNode>(node,0,logger_); //parent_=nullptr by default
+    kdnodes_[node.get()]=root_;
     return;
   }
-  root_->insert(node);
+  kdnodes_[node.get()]=root_->insert(node);
   return;
 }
 
@@ -374,15 +377,79 @@ bool KdTree::clear()
   deleted_nodes_=0;
 
   root_ = nullptr;
+  kdnodes_.clear();
 
   return true;
 }
 
+void KdTree::build(const std::vector<NodePtr>& nodes)
+{
+  clear();
+  if(nodes.empty())
+    return;
+
+  // The first node is kept as root, the others are split according to its value along dimension 0
+  const NodePtr& root = nodes.front();
+  int dof = root->getConfiguration().size();
+  double root_value = root->getConfiguration()(0);
+
+  std::vector<NodePtr> others(nodes.begin()+1,nodes.end());
+  std::vector<NodePtr>::iterator middle = std::partition(others.begin(),others.end(),[&](const NodePtr& n){
+    return n->getConfiguration()(0)<root_value;
+  });
+
+  kdnodes_.reserve(nodes.size());
+
+  int next_dim = (dof == 1)? 0: 1;
+  root_ = std::make_shared<KdNode>(root,0,logger_);
+  kdnodes_[root.get()] = root_;
+  root_->left_  = build(others.begin(),middle,next_dim,root_);
+  root_->right_ = build(middle,others.end(),next_dim,root_);
+
+  size_ = nodes.size();
+}
+
+KdNodePtr KdTree::build(const std::vector<NodePtr>::iterator& begin,
+                        const std::vector<NodePtr>::iterator& end,
+                        const int& dimension,
+                        const KdNodeWeakPtr& parent)
+{
+  if(begin == end)
+    return nullptr;
+
+  auto lower = [&](const NodePtr& n1, const NodePtr& n2)->bool{
+    return n1->getConfiguration()(dimension)<n2->getConfiguration()(dimension);
+  };
+
+  std::vector<NodePtr>::iterator median = begin+(end-begin)/2;
+  std::nth_element(begin,median,end,lower);
+
+  // Nodes equal to the median along dimension must go to the right (see KdNode::insert),
+  // so the first of them is chosen as splitting node
+  double value = (*median)->getConfiguration()(dimension);
+  std::vector<NodePtr>::iterator split = std::partition(begin,median,[&](const NodePtr& n){
+    return n->getConfiguration()(dimension)<value;
+  });
+  std::iter_swap(split,median);
+
+  int dof = (*split)->getConfiguration().size();
+  int next_dim = (dimension == (dof-1))? 0: dimension+1;
+
+  KdNodePtr kdnode = std::make_shared<KdNode>(*split,dimension,logger_);
+  kdnode->parent(parent);
+  kdnodes_[split->get()] = kdnode;
+  kdnode->left_  = build(begin,split,next_dim,kdnode);
+  kdnode->right_ = build(split+1,end,next_dim,kdnode);
+
+  return kdnode;
+}
+
 NodePtr KdTree::findMin(const int& dim)
 {
   if (not root_)
     return nullptr;
-  return root_->findMin(dim)->node();
+  KdNodePtr kdnode=root_->findMin(dim);
+  return kdnode? kdnode->node(): nullptr;
 }
 
 void KdTree::nearestNeighbor(const Eigen::VectorXd& configuration,
@@ -392,38 +459,46 @@ void KdTree::nearestNeighbor(const Eigen::VectorXd& configuration,
   best_distance=std::numeric_limits<double>::infinity();
   if (not root_)
     return;
-  root_->nearestNeighbor(configuration,best,best_distance);
+
+  double best_squared_distance=std::numeric_limits<double>::infinity();
+  root_->nearestNeighbor(configuration,best,best_squared_distance,scale_,pruning_factor_);
+  best_distance=std::sqrt(best_squared_distance);
 }
 
 
-std::multimap<double, NodePtr> KdTree::near(const Eigen::VectorXd& configuration,
-                                                        const double& radius)
+bool KdTree::near(const Eigen::VectorXd& configuration,
+                  const double& radius,
+                  const NearVisitor& visitor)
 {
-  std::multimap<double, NodePtr> nodes;
   if (not root_)
-    return nodes;
+    return true;
 
-  root_->near(configuration,radius,nodes);
-  return nodes;
+  return root_->near(configuration,radius,visitor,scale_);
 }
 
-std::multimap<double, NodePtr> KdTree::kNearestNeighbors(const Eigen::VectorXd& configuration,
-                                                         const size_t& k)
+void KdTree::kNearestNeighbors(const Eigen::VectorXd& configuration,
+                               KNearestNeighborsHeap& heap)
 {
-  std::multimap<double, NodePtr> nodes;
-  if (not root_)
-    return nodes;
+  if (not root_ || heap.k() == 0)
+    return;
 
-  root_->kNearestNeighbors(configuration,k,nodes);
-  return nodes;
+  root_->kNearestNeighbors(configuration,heap,scale_,pruning_factor_);
 }
 
 bool KdTree::findNode(const NodePtr& node,
-                      KdNodePtr& kdnode)
+                      KdNodePtr& kdnode) const
 {
-  if (not root_)
+  std::unordered_map<const Node*,KdNodePtr>::const_iterator it=kdnodes_.find(node.get());
+  if (it==kdnodes_.end())
     return false;
-  return root_->findNode(node,kdnode);
+
+  // a deleted kdnode whose node has been destroyed can be found with a new node allocated at the same address.
+  // The stale entry is not erased here, so that searches can run concurrently; see eraseStaleNode
+  if (it->second->deleted_ && it->second->released_node_.lock()!=node)
+    return false;
+
+  kdnode=it->second;
+  return true;
 }
 
 
@@ -434,36 +509,59 @@ bool KdTree::findNode(const NodePtr& node)
 }
 
 
+void KdTree::eraseStaleNode(const NodePtr& node)
+{
+  std::unordered_map<const Node*,KdNodePtr>::const_iterator it=kdnodes_.find(node.get());
+  if (it!=kdnodes_.end() && it->second->deleted_ && it->second->released_node_.lock()!=node)
+    kdnodes_.erase(it);
+}
+
 bool KdTree::deleteNode(const NodePtr& node,
                         const bool& disconnect_node)
 {
   KdNodePtr kdnode;
   if (not findNode(node,kdnode))
+  {
+    eraseStaleNode(node);
+    return false;
+  }
+
+  if (kdnode->deleted_)
     return false;
 
   size_--;
   deleted_nodes_++;
   kdnode->deleteNode(disconnect_node);
 
-  if(deleted_nodes_>deleted_nodes_threshold_ && size_>0)
+  if(size_>0 && (deleted_nodes_>deleted_nodes_threshold_ || deleted_nodes_>deleted_nodes_fraction_*(size_+deleted_nodes_)))
   {
     CNR_DEBUG(logger_,"number of deleted nodes ("<<deleted_nodes_<<") is greater than the threshold ("
-              <<deleted_nodes_threshold_<<"), kdtree is built from scratch");
+              <<deleted_nodes_threshold_<<") or than "<<deleted_nodes_fraction_<<" of the kdnodes, kdtree is built from scratch");
+    compact();
+  }
 
-    bool root_was_deleted = root_->deleted_;
-    root_->restoreNode(); //set deleted_ to false to have it into nodes vector below (we want the root regardless its "deleted_" flag)
-    std::vector<NodePtr> nodes = getNodes(); //contains also the root
+  return true;
+}
 
-    clear(); //clear the KdTree
+void KdTree::compact()
+{
+  if(deleted_nodes_ == 0 || not root_)
+    return;
 
-    for(const NodePtr& n:nodes)
-      insert(n);
+  // The root is kept as first node regardless its "deleted_" flag, as long as its node is still alive
+  NodePtr deleted_root = root_->deleted_? root_->released_node_.lock(): nullptr;
+  if(deleted_root)
+    root_->restoreNode(deleted_root);
 
-    if(root_was_deleted)
-      deleteNode(root_->node_,disconnect_node);
-  }
+  std::vector<NodePtr> nodes = getNodes(); //contains also the root, as first element
+  build(nodes);
 
-  return true;
+  if(deleted_root)
+  {
+    size_--;
+    deleted_nodes_++;
+    root_->deleteNode();
+  }
 }
 
 unsigned int KdTree::deletedNodesThreshold()
@@ -481,14 +579,34 @@ void KdTree::deletedNodesThreshold(const unsigned int t)
   deleted_nodes_threshold_ = t;
 }
 
+double KdTree::deletedNodesFraction()
+{
+  return deleted_nodes_fraction_;
+}
+
+void KdTree::deletedNodesFraction(const double& fraction)
+{
+  if(fraction<=0.0 || fraction>1.0)
+  {
+    CNR_WARN(logger_, "deleted_nodes_fraction_ cannot be set because it should be in (0,1] and you are trying to set "<<fraction);
+    return;
+  }
+  deleted_nodes_fraction_ = fraction;
+}
+
 bool KdTree::restoreNode(const NodePtr& node)
 {
   KdNodePtr kdnode;
   if (not findNode(node,kdnode))
+  {
+    eraseStaleNode(node);
     return false;
+  }
+  if (not kdnode->deleted_)
+    return true;
   size_++;
   deleted_nodes_--;
-  kdnode->restoreNode();
+  kdnode->restoreNode(node);
   return true;
 }
 
@@ -0,0 +1,93 @@
+/*
+Copyright (c) 2024, Manuel Beschi and Cesare Tonola, JRL-CARI CNR-STIIMA/UNIBS, manuel.beschi@unibs.it, c.tonola001@unibs.it
+Manuel Beschi manuel.beschi@unibs.it
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of the <organization> nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL <COPYRIGHT HOLDER> BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+#include <graph_core/datastructure/nearest_neighbors.h>
+
+namespace graph
+{
+namespace core
+{
+
+void NearestNeighbors::nearestNeighbors(const std::vector<Eigen::VectorXd>& configurations,
+                                        std::vector<std::pair<double,Node*>>& nodes,
+                                        const unsigned int& n_threads,
+                                        const WorkerPoolPtr& pool)
+{
+  nodes.resize(configurations.size());
+  auto search = [this,&configurations,&nodes](const size_t& begin, const size_t& end){
+    NodePtr best;
+    double best_distance;
+    for(size_t i=begin;i<end;i++)
+    {
+      best.reset();
+      best_distance=std::numeric_limits<double>::infinity();
+      nearestNeighbor(configurations[i],best,best_distance);
+      nodes[i] = std::make_pair(best? best_distance: std::numeric_limits<double>::infinity(),best.get());
+    }
+  };
+
+  // The shared pool is not created for serial batches
+  if(n_threads == 1)
+    search(0,configurations.size());
+  else
+    (pool? *pool: WorkerPool::shared()).parallelFor(configurations.size(),n_threads,search);
+}
+
+void NearestNeighbors::kNearestNeighbors(const std::vector<Eigen::VectorXd>& configurations,
+                                         const size_t& k,
+                                         std::vector<std::pair<double,Node*>>& nodes,
+                                         const unsigned int& n_threads,
+                                         const WorkerPoolPtr& pool)
+{
+  nodes.assign(configurations.size()*k,std::make_pair(std::numeric_limits<double>::infinity(),nullptr));
+  if(k == 0)
+    return;
+
+  auto search = [this,&configurations,&k,&nodes](const size_t& begin, const size_t& end){
+    KNearestNeighborsHeap heap(k);
+    for(size_t i=begin;i<end;i++)
+    {
+      heap.reset(k);
+      kNearestNeighbors(configurations[i],heap);
+
+      std::vector<std::pair<double,Node*>>::iterator it = nodes.begin()+i*k;
+      for(const KNearestNeighborsHeap::Entry& e:heap.sort())
+        *(it++) = std::make_pair(std::sqrt(e.first),e.second);
+    }
+  };
+
+  // The shared pool is not created for serial batches
+  if(n_threads == 1)
+    search(0,configurations.size());
+  else
+    (pool? *pool: WorkerPool::shared()).parallelFor(configurations.size(),n_threads,search);
+}
+
+} //end namespace core
+} // end namespace graph
@@ -40,6 +40,7 @@ Vector::Vector(const cnr_logger::TraceLoggerPtr &logger):
 
 void Vector::insert(const NodePtr& node)
 {
+  slots_[node.get()] = nodes_.size();
   nodes_.push_back(node);
   size_++;
   return;
@@ -51,6 +52,7 @@ bool Vector::clear()
   deleted_nodes_=0;
 
   nodes_.clear();
+  slots_.clear();
 
   return true;
 }
@@ -59,72 +61,74 @@ void Vector::nearestNeighbor(const Eigen::VectorXd& configuration,
                              NodePtr &best,
                              double &best_distance)
 {
-  best_distance=std::numeric_limits<double>::infinity();
+  double best_squared_distance=std::numeric_limits<double>::infinity();
   for (const NodePtr& n: nodes_)
   {
-    double dist=(n->getConfiguration()-configuration).norm();
-    if (dist<best_distance)
+    double squared_dist=squaredDistance(n->getConfiguration(),configuration,scale_);
+    if (squared_dist<best_squared_distance)
     {
       best=n;
-      best_distance=dist;
+      best_squared_distance=squared_dist;
     }
   }
+  best_distance=std::sqrt(best_squared_distance);
 }
 
-std::multimap<double, NodePtr> Vector::near(const Eigen::VectorXd& configuration,
-                                  const double& radius)
+bool Vector::near(const Eigen::VectorXd& configuration,
+                  const double& radius,
+                  const NearVisitor& visitor)
 {
-  std::multimap<double, NodePtr> nodes;
+  double squared_radius=radius*radius;
   for (const NodePtr& n: nodes_)
   {
-    double dist=(n->getConfiguration()-configuration).norm();
-    if (dist<radius)
+    double squared_dist=squaredDistance(n->getConfiguration(),configuration,scale_);
+    if (squared_dist<squared_radius)
     {
-      nodes.insert(std::pair<double, NodePtr>(dist,n));
+      if(not visitor(std::sqrt(squared_dist),n))
+        return false;
     }
   }
-  return nodes;
+  return true;
 }
 
-std::multimap<double, NodePtr> Vector::kNearestNeighbors(const Eigen::VectorXd& configuration,
-                                        const size_t& k)
+void Vector::kNearestNeighbors(const Eigen::VectorXd& configuration,
+                               KNearestNeighborsHeap& heap)
 {
-  std::multimap<double, NodePtr> nodes;
   for (const NodePtr& n: nodes_)
-  {
-    double dist=(n->getConfiguration()-configuration).norm();
-    nodes.insert(std::pair<double, NodePtr>(dist,n));
-  }
-  if (nodes.size()<k)
-    return nodes;
-
-  std::multimap<double, NodePtr> m2(nodes.begin(), std::next(nodes.begin(), k));
-  return m2;
+    heap.push(squaredDistance(n->getConfiguration(),configuration,scale_),n);
 }
 
 
 bool Vector::findNode(const NodePtr& node)
 {
-  return  (std::find(nodes_.begin(),nodes_.end(),node)!=nodes_.end());
+  return  (slots_.find(node.get())!=slots_.end());
 }
 
 
 bool Vector::deleteNode(const NodePtr& node,
                         const bool& disconnect_node)
 {
-  std::vector<NodePtr>::iterator it;
-  it=std::find(nodes_.begin(),nodes_.end(),node);
-  if (it==nodes_.end())
+  std::unordered_map<const Node*,size_t>::iterator it;
+  it=slots_.find(node.get());
+  if (it==slots_.end())
     return false;
 
   size_--;
   deleted_nodes_++;
 
-  nodes_.erase(it);
-
   if(disconnect_node)
     node->disconnect();
 
+  // Move the last node into the slot of the deleted one
+  size_t slot=it->second;
+  slots_.erase(it);
+  if (slot+1<nodes_.size())
+  {
+    nodes_[slot]=std::move(nodes_.back());
+    slots_[nodes_[slot].get()]=slot;
+  }
+  nodes_.pop_back();
+
   return true;
 }
 
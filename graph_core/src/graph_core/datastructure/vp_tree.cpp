@@ -0,0 +1,659 @@
+/*
+Copyright (c) 2024, Manuel Beschi and Cesare Tonola, JRL-CARI CNR-STIIMA/UNIBS, manuel.beschi@unibs.it, c.tonola001@unibs.it
+Manuel Beschi manuel.beschi@unibs.it
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of the <organization> nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL <COPYRIGHT HOLDER> BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+#include <graph_core/datastructure/vp_tree.h>
+
+namespace graph
+{
+namespace core
+{
+
+VpTree::VpTree(const MetricsPtr& metrics, const cnr_logger::TraceLoggerPtr &logger):
+  NearestNeighbors(logger),
+  metrics_(metrics)
+{
+  if(not metrics_)
+  {
+    CNR_FATAL(logger_,"the vp-tree needs metrics to compute the distances");
+    throw std::invalid_argument("the vp-tree needs metrics to compute the distances");
+  }
+
+  dof_ = 0;
+  bucket_size_ = 16;
+  deleted_nodes_threshold_ = std::numeric_limits<unsigned int>::max();
+  balance_factor_ = 0.75;
+  partial_rebuilds_ = 0;
+  rebuilt_nodes_ = 0;
+}
+
+uint32_t VpTree::newVpNode()
+{
+  uint32_t idx;
+  if(not free_vpnodes_.empty())
+  {
+    idx = free_vpnodes_.back();
+    free_vpnodes_.pop_back();
+  }
+  else
+  {
+    idx = vpnodes_.size();
+    vpnodes_.emplace_back();
+  }
+
+  VpEntry& vpnode = vpnodes_[idx];
+  vpnode.vantage_point = NONE;
+  vpnode.radius = 0.0;
+  vpnode.inside = NONE;
+  vpnode.outside = NONE;
+  vpnode.lower =  std::numeric_limits<double>::infinity();
+  vpnode.upper = -std::numeric_limits<double>::infinity();
+  vpnode.size = 0;
+  vpnode.built_size = 0;
+  vpnode.bucket.clear();
+
+  return idx;
+}
+
+void VpTree::insert(const NodePtr& node)
+{
+  const Eigen::VectorXd& configuration = node->getConfiguration();
+
+  if(items_.empty())
+    dof_ = configuration.size();
+  else if(configuration.size() != dof_)
+  {
+    CNR_FATAL(logger_,"node dimension ("<<configuration.size()<<") is different from the vp-tree dimension ("<<dof_<<")");
+    throw std::invalid_argument("node dimension is different from the vp-tree dimension");
+  }
+
+  if(items_.size() >= NONE)
+  {
+    CNR_FATAL(logger_,"the vp-tree cannot store more than "<<NONE<<" nodes");
+    throw std::runtime_error("the vp-tree is full");
+  }
+
+  uint32_t item = items_.size();
+  items_.push_back(Item{node,false});
+  indices_[node.get()] = item;
+  size_++;
+
+  if(vpnodes_.empty())
+    newVpNode();
+
+  // Descend to the leaf, updating sizes and distance bounds along the way
+  path_.clear();
+  uint32_t idx = 0;
+  uint32_t parent_vantage_point = NONE;
+  double parent_distance = 0.0;
+  while(vpnodes_[idx].vantage_point != NONE)
+  {
+    path_.push_back(idx);
+
+    VpEntry& vpnode = vpnodes_[idx];
+    vpnode.size++;
+
+    parent_vantage_point = vpnode.vantage_point;
+    parent_distance = distance(configuration,vpnode.vantage_point);
+    idx = (parent_distance<vpnode.radius)? vpnode.inside: vpnode.outside;
+
+    VpEntry& child = vpnodes_[idx];
+    child.lower = std::min(child.lower,parent_distance);
+    child.upper = std::max(child.upper,parent_distance);
+  }
+
+  VpEntry& leaf = vpnodes_[idx];
+  leaf.size++;
+  leaf.bucket.push_back(Entry(item,parent_distance));
+
+  // Scapegoat: the highest vp-node that has at least doubled since it was built and is unbalanced
+  for(size_t i=0;i<path_.size();i++)
+  {
+    const VpEntry& vpnode = vpnodes_[path_[i]];
+    uint32_t max_child_size = std::max(vpnodes_[vpnode.inside].size,vpnodes_[vpnode.outside].size);
+    if(vpnode.size >= 2*vpnode.built_size && max_child_size > balance_factor_*vpnode.size)
+    {
+      rebuildSubtree(path_[i],(i == 0)? NONE: vpnodes_[path_[i-1]].vantage_point);
+      return;
+    }
+  }
+
+  // A full leaf is split. If its items could not be split when it was built, it waits until it doubles
+  if(leaf.size > bucket_size_ && leaf.size > 2*leaf.built_size)
+    rebuildSubtree(idx,parent_vantage_point);
+}
+
+bool VpTree::clear()
+{
+  size_=0;
+  deleted_nodes_=0;
+  items_.clear();
+  vpnodes_.clear();
+  free_vpnodes_.clear();
+  indices_.clear();
+  return true;
+}
+
+void VpTree::build(const std::vector<NodePtr>& nodes)
+{
+  clear();
+  if(nodes.empty())
+    return;
+
+  if(nodes.size() >= NONE)
+  {
+    CNR_FATAL(logger_,"the vp-tree cannot store more than "<<NONE<<" nodes");
+    throw std::runtime_error("the vp-tree is full");
+  }
+
+  dof_ = nodes.front()->getConfiguration().size();
+  items_.reserve(nodes.size());
+  indices_.reserve(nodes.size());
+  entries_.clear();
+  entries_.reserve(nodes.size());
+
+  for(const NodePtr& n:nodes)
+  {
+    if(n->getConfiguration().size() != dof_)
+    {
+      CNR_FATAL(logger_,"node dimension ("<<n->getConfiguration().size()<<") is different from the vp-tree dimension ("<<dof_<<")");
+      throw std::invalid_argument("node dimension is different from the vp-tree dimension");
+    }
+
+    indices_[n.get()] = items_.size();
+    entries_.push_back(Entry(items_.size(),0.0));
+    items_.push_back(Item{n,false});
+  }
+  size_ = nodes.size();
+
+  build(newVpNode(),entries_.begin(),entries_.end(),false);
+}
+
+void VpTree::build(const uint32_t& idx,
+                   const std::vector<Entry>::iterator& begin,
+                   const std::vector<Entry>::iterator& end,
+                   const bool& has_parent)
+{
+  size_t n = end-begin;
+  {
+    VpEntry& vpnode = vpnodes_[idx];
+    vpnode.vantage_point = NONE;
+    vpnode.inside = NONE;
+    vpnode.outside = NONE;
+    vpnode.size = n;
+    vpnode.built_size = n;
+    vpnode.bucket.clear();
+
+    vpnode.lower =  std::numeric_limits<double>::infinity();
+    vpnode.upper = -std::numeric_limits<double>::infinity();
+    if(has_parent)
+    {
+      for(std::vector<Entry>::iterator it=begin;it!=end;it++)
+      {
+        vpnode.lower = std::min(vpnode.lower,it->second);
+        vpnode.upper = std::max(vpnode.upper,it->second);
+      }
+    }
+
+    if(n<=bucket_size_)
+    {
+      vpnode.bucket.assign(begin,end);
+      return;
+    }
+  }
+
+  // The vantage point is the item farthest from the parent one, the first item for the root
+  std::vector<Entry>::iterator vantage_point = begin;
+  if(has_parent)
+  {
+    vantage_point = std::max_element(begin,end,[](const Entry& e1, const Entry& e2){
+      return e1.second<e2.second;
+    });
+  }
+  std::iter_swap(begin,vantage_point);
+
+  const Eigen::VectorXd& vantage_configuration = items_[begin->first].node->getConfiguration();
+  double min_distance =  std::numeric_limits<double>::infinity();
+  double max_distance = -std::numeric_limits<double>::infinity();
+  distances_.resize(n-1);
+  for(size_t i=1;i<n;i++)
+  {
+    distances_[i-1] = distance(vantage_configuration,(begin+i)->first);
+    min_distance = std::min(min_distance,distances_[i-1]);
+    max_distance = std::max(max_distance,distances_[i-1]);
+  }
+
+  if(max_distance == min_distance) //all items are at the same distance from the vantage point, they cannot be split
+  {
+    vpnodes_[idx].bucket.assign(begin,end);
+    return;
+  }
+
+  // Distances from the parent vantage point are not needed anymore
+  for(size_t i=1;i<n;i++)
+    (begin+i)->second = distances_[i-1];
+
+  // Median distance, moved up if needed so that both children are not empty (inside < radius <= outside)
+  std::vector<Entry>::iterator first = begin+1;
+  std::vector<Entry>::iterator median = first+(end-first)/2;
+  std::nth_element(first,median,end,[](const Entry& e1, const Entry& e2){
+    return e1.second<e2.second;
+  });
+
+  double radius = median->second;
+  std::vector<Entry>::iterator middle = std::partition(first,end,[&radius](const Entry& e){
+    return e.second<radius;
+  });
+
+  if(middle == first)
+  {
+    radius = std::numeric_limits<double>::infinity();
+    for(std::vector<Entry>::iterator it=first;it!=end;it++)
+    {
+      if(it->second>min_distance && it->second<radius)
+        radius = it->second;
+    }
+    middle = std::partition(first,end,[&radius](const Entry& e){
+      return e.second<radius;
+    });
+  }
+
+  vpnodes_[idx].vantage_point = begin->first;
+  vpnodes_[idx].radius = radius;
+
+  uint32_t inside  = newVpNode();
+  uint32_t outside = newVpNode();
+  build(inside,first,middle,true);
+  build(outside,middle,end,true);
+
+  vpnodes_[idx].inside  = inside;
+  vpnodes_[idx].outside = outside;
+}
+
+void VpTree::rebuildSubtree(const uint32_t& idx, const uint32_t& parent_vantage_point)
+{
+  // Collect the items of the subtree and release its vp-nodes, except idx
+  entries_.clear();
+  bool leaf = (vpnodes_[idx].vantage_point == NONE);
+
+  std::vector<uint32_t> stack;
+  stack.push_back(idx);
+  while(not stack.empty())
+  {
+    uint32_t i = stack.back();
+    stack.pop_back();
+
+    VpEntry& vpnode = vpnodes_[i];
+    if(vpnode.vantage_point == NONE)
+      entries_.insert(entries_.end(),vpnode.bucket.begin(),vpnode.bucket.end());
+    else
+    {
+      entries_.push_back(Entry(vpnode.vantage_point,0.0));
+      stack.push_back(vpnode.inside);
+      stack.push_back(vpnode.outside);
+    }
+
+    if(i != idx)
+    {
+      vpnode.bucket.clear();
+      free_vpnodes_.push_back(i);
+    }
+  }
+
+  // The bucket of a leaf already stores the distances from the parent vantage point
+  if(not leaf && parent_vantage_point != NONE)
+  {
+    const Eigen::VectorXd& parent_configuration = items_[parent_vantage_point].node->getConfiguration();
+    for(Entry& e: entries_)
+      e.second = distance(parent_configuration,e.first);
+  }
+
+  partial_rebuilds_++;
+  rebuilt_nodes_ += entries_.size();
+
+  build(idx,entries_.begin(),entries_.end(),parent_vantage_point != NONE);
+}
+
+void VpTree::setScale(const Eigen::VectorXd& scale)
+{
+  if(scale.size()>0)
+  {
+    CNR_FATAL(logger_,"the distance of the vp-tree is defined by its metrics, it cannot be scaled");
+    throw std::invalid_argument("the distance of the vp-tree is defined by its metrics, it cannot be scaled");
+  }
+}
+
+void VpTree::nearestNeighbor(const Eigen::VectorXd& configuration,
+                             NodePtr &best,
+                             double &best_distance)
+{
+  best_distance=std::numeric_limits<double>::infinity();
+  if(vpnodes_.empty())
+    return;
+
+  uint32_t best_idx = NONE;
+  nearestNeighbor(0,configuration,-1.0,best_idx,best_distance);
+
+  if(best_idx != NONE)
+    best = items_[best_idx].node;
+}
+
+void VpTree::nearestNeighbor(const uint32_t& idx,
+                             const Eigen::VectorXd& configuration,
+                             const double& parent_distance,
+                             uint32_t& best,
+                             double& best_distance) const
+{
+  const VpEntry& vpnode = vpnodes_[idx];
+
+  if(vpnode.vantage_point == NONE)
+  {
+    for(const Entry& e: vpnode.bucket)
+    {
+      // triangle inequality: the distance is at least |parent_distance-e.second|
+      if(items_[e.first].deleted || (parent_distance>=0.0 && (1.0+epsilon_)*std::abs(parent_distance-e.second)>=best_distance))
+        continue;
+
+      double d = distance(configuration,e.first);
+      if(d<best_distance)
+      {
+        best_distance = d;
+        best = e.first;
+      }
+    }
+    return;
+  }
+
+  double d = distance(configuration,vpnode.vantage_point);
+  if(not items_[vpnode.vantage_point].deleted && d<best_distance)
+  {
+    best_distance = d;
+    best = vpnode.vantage_point;
+  }
+
+  uint32_t first = vpnode.inside;
+  uint32_t second = vpnode.outside;
+  if(d>=vpnode.radius)
+    std::swap(first,second);
+
+  // the bound is checked again after the first recursion, since it can improve best_distance
+  if((1.0+epsilon_)*lowerBound(first,d)<best_distance)
+    nearestNeighbor(first,configuration,d,best,best_distance);
+  if((1.0+epsilon_)*lowerBound(second,d)<best_distance)
+    nearestNeighbor(second,configuration,d,best,best_distance);
+}
+
+bool VpTree::near(const Eigen::VectorXd& configuration,
+                  const double& radius,
+                  const NearVisitor& visitor)
+{
+  if(vpnodes_.empty())
+    return true;
+
+  return near(0,configuration,-1.0,radius,visitor);
+}
+
+bool VpTree::near(const uint32_t& idx,
+                  const Eigen::VectorXd& configuration,
+                  const double& parent_distance,
+                  const double& radius,
+                  const NearVisitor& visitor) const
+{
+  const VpEntry& vpnode = vpnodes_[idx];
+
+  if(vpnode.vantage_point == NONE)
+  {
+    for(const Entry& e: vpnode.bucket)
+    {
+      if(items_[e.first].deleted || (parent_distance>=0.0 && std::abs(parent_distance-e.second)>=radius))
+        continue;
+
+      double d = distance(configuration,e.first);
+      if(d<radius && not visitor(d,items_[e.first].node))
+        return false;
+    }
+    return true;
+  }
+
+  double d = distance(configuration,vpnode.vantage_point);
+  if(not items_[vpnode.vantage_point].deleted && d<radius && not visitor(d,items_[vpnode.vantage_point].node))
+    return false;
+
+  if(lowerBound(vpnode.inside,d)<radius && not near(vpnode.inside,configuration,d,radius,visitor))
+    return false;
+  if(lowerBound(vpnode.outside,d)<radius && not near(vpnode.outside,configuration,d,radius,visitor))
+    return false;
+  return true;
+}
+
+void VpTree::kNearestNeighbors(const Eigen::VectorXd& configuration,
+                               KNearestNeighborsHeap& heap)
+{
+  if(vpnodes_.empty() || heap.k() == 0)
+    return;
+
+  kNearestNeighbors(0,configuration,-1.0,heap);
+}
+
+void VpTree::kNearestNeighbors(const uint32_t& idx,
+                               const Eigen::VectorXd& configuration,
+                               const double& parent_distance,
+                               KNearestNeighborsHeap& heap) const
+{
+  const VpEntry& vpnode = vpnodes_[idx];
+
+  if(vpnode.vantage_point == NONE)
+  {
+    for(const Entry& e: vpnode.bucket)
+    {
+      if(items_[e.first].deleted)
+        continue;
+
+      if(parent_distance>=0.0)
+      {
+        double bound = std::abs(parent_distance-e.second);
+        if(bound*bound>=pruning_factor_*heap.worst())
+          continue;
+      }
+
+      double d = distance(configuration,e.first);
+      heap.push(d*d,items_[e.first].node);
+    }
+    return;
+  }
+
+  double d = distance(configuration,vpnode.vantage_point);
+  if(not items_[vpnode.vantage_point].deleted)
+    heap.push(d*d,items_[vpnode.vantage_point].node);
+
+  uint32_t first = vpnode.inside;
+  uint32_t second = vpnode.outside;
+  if(d>=vpnode.radius)
+    std::swap(first,second);
+
+  // the worst distance is read again after the first recursion, since it can improve it
+  double bound = lowerBound(first,d);
+  if(bound*bound<pruning_factor_*heap.worst())
+    kNearestNeighbors(first,configuration,d,heap);
+  bound = lowerBound(second,d);
+  if(bound*bound<pruning_factor_*heap.worst())
+    kNearestNeighbors(second,configuration,d,heap);
+}
+
+bool VpTree::findNode(const NodePtr& node)
+{
+  return indices_.find(node.get()) != indices_.end();
+}
+
+bool VpTree::deleteNode(const NodePtr& node,
+                        const bool& disconnect_node)
+{
+  std::unordered_map<const Node*,uint32_t>::iterator it = indices_.find(node.get());
+  if(it == indices_.end() || items_[it->second].deleted)
+    return false;
+
+  size_--;
+  deleted_nodes_++;
+  items_[it->second].deleted = true;
+
+  if(disconnect_node)
+    node->disconnect();
+
+  if(deleted_nodes_>deleted_nodes_threshold_ && size_>0)
+  {
+    CNR_DEBUG(logger_,"number of deleted nodes ("<<deleted_nodes_<<") is greater than the threshold ("
+              <<deleted_nodes_threshold_<<"), vp-tree is built from scratch");
+
+    std::vector<NodePtr> nodes = getNodes(); //insertion order is preserved
+    build(nodes);
+  }
+
+  return true;
+}
+
+bool VpTree::restoreNode(const NodePtr& node)
+{
+  std::unordered_map<const Node*,uint32_t>::iterator it = indices_.find(node.get());
+  if(it == indices_.end())
+    return false;
+
+  if(not items_[it->second].deleted)
+    return true;
+
+  size_++;
+  deleted_nodes_--;
+  items_[it->second].deleted = false;
+  return true;
+}
+
+VpTree::Statistics VpTree::statistics() const
+{
+  Statistics stats;
+  stats.max_depth = 0;
+  stats.average_depth = 0.0;
+  stats.partial_rebuilds = partial_rebuilds_;
+  stats.rebuilt_nodes = rebuilt_nodes_;
+
+  if(vpnodes_.empty() || items_.empty())
+    return stats;
+
+  std::vector<std::pair<uint32_t,unsigned int>> stack; //vp-node, depth
+  stack.push_back(std::make_pair(0,0));
+  while(not stack.empty())
+  {
+    uint32_t idx = stack.back().first;
+    unsigned int depth = stack.back().second;
+    stack.pop_back();
+
+    const VpEntry& vpnode = vpnodes_[idx];
+    if(vpnode.vantage_point == NONE)
+    {
+      stats.max_depth = std::max(stats.max_depth,depth);
+      stats.average_depth += static_cast<double>(depth)*vpnode.bucket.size();
+    }
+    else
+    {
+      stats.average_depth += depth;
+      stack.push_back(std::make_pair(vpnode.inside,depth+1));
+      stack.push_back(std::make_pair(vpnode.outside,depth+1));
+    }
+  }
+  stats.average_depth /= items_.size();
+
+  return stats;
+}
+
+unsigned int VpTree::bucketSize()
+{
+  return bucket_size_;
+}
+
+void VpTree::bucketSize(const unsigned int& bucket_size)
+{
+  if(bucket_size<1)
+  {
+    CNR_WARN(logger_, "bucket_size_ cannot be set because it should be at least 1 and you are trying to set "<<bucket_size);
+    return;
+  }
+  bucket_size_ = bucket_size;
+}
+
+double VpTree::balanceFactor()
+{
+  return balance_factor_;
+}
+
+void VpTree::balanceFactor(const double& alpha)
+{
+  if(alpha<=0.5 || alpha>1.0)
+  {
+    CNR_WARN(logger_, "balance_factor_ cannot be set because it should be in (0.5,1] and you are trying to set "<<alpha);
+    return;
+  }
+  balance_factor_ = alpha;
+}
+
+unsigned int VpTree::deletedNodesThreshold()
+{
+  return deleted_nodes_threshold_;
+}
+
+void VpTree::deletedNodesThreshold(const unsigned int t)
+{
+  if(t<=1)
+  {
+    CNR_WARN(logger_, "deleted_nodes_threshold_ cannot bet set because it should be at least 2 and you are trying to set "<<t);
+    return;
+  }
+  deleted_nodes_threshold_ = t;
+}
+
+std::vector<NodePtr> VpTree::getNodes()
+{
+  std::vector<NodePtr> nodes;
+  nodes.reserve(size_);
+
+  for(const Item& item: items_)
+  {
+    if(not item.deleted)
+      nodes.push_back(item.node);
+  }
+  return nodes;
+}
+
+void VpTree::disconnectNodes(const std::vector<NodePtr>& white_list)
+{
+  for(const Item& item: items_)
+  {
+    if(std::find(white_list.begin(),white_list.end(),item.node)==white_list.end())
+      item.node->disconnect();
+  }
+}
+
+} //end namespace core
+} // end namespace graph
@@ -0,0 +1,152 @@
+/*
+Copyright (c) 2024, Manuel Beschi and Cesare Tonola, JRL-CARI CNR-STIIMA/UNIBS, manuel.beschi@unibs.it, c.tonola001@unibs.it
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of the <organization> nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL <COPYRIGHT HOLDER> BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+#include <graph_core/datastructure/worker_pool.h>
+#include <algorithm>
+
+namespace graph
+{
+namespace core
+{
+
+namespace
+{
+// Pool whose batch is running in this thread, to run nested batches in the calling thread
+thread_local WorkerPool* running_pool = nullptr;
+}
+
+WorkerPool::WorkerPool(const unsigned int& n_threads)
+{
+  unsigned int threads = (n_threads == 0)? std::max(1u,std::thread::hardware_concurrency()): n_threads;
+
+  threads_.reserve(threads-1);
+  for(unsigned int t=1;t<threads;t++)
+    threads_.emplace_back(&WorkerPool::work,this);
+}
+
+WorkerPool::~WorkerPool()
+{
+  {
+    std::lock_guard<std::mutex> lock(mtx_);
+    stop_ = true;
+  }
+  start_cv_.notify_all();
+
+  for(std::thread& t:threads_)
+    t.join();
+}
+
+void WorkerPool::work()
+{
+  uint64_t batch = 0;
+  while(true)
+  {
+    {
+      std::unique_lock<std::mutex> lock(mtx_);
+      start_cv_.wait(lock,[this,&batch](){return stop_ || batch_ != batch;});
+      if(stop_)
+        return;
+      batch = batch_;
+    }
+
+    runTasks();
+
+    std::lock_guard<std::mutex> lock(mtx_);
+    if(--busy_threads_ == 0)
+      done_cv_.notify_one();
+  }
+}
+
+void WorkerPool::runTasks()
+{
+  WorkerPool* previous_pool = running_pool;
+  running_pool = this;
+
+  for(size_t i=next_task_++;i<n_tasks_;i=next_task_++)
+    (*task_)(i);
+
+  running_pool = previous_pool;
+}
+
+void WorkerPool::run(const size_t& n_tasks, const std::function<void(const size_t& task)>& task)
+{
+  if(n_tasks == 0)
+    return;
+
+  if(threads_.empty() || n_tasks == 1 || running_pool == this || not run_mtx_.try_lock())
+  {
+    for(size_t i=0;i<n_tasks;i++)
+      task(i);
+    return;
+  }
+  std::lock_guard<std::mutex> run_lock(run_mtx_,std::adopt_lock);
+
+  {
+    std::lock_guard<std::mutex> lock(mtx_);
+    task_ = &task;
+    n_tasks_ = n_tasks;
+    next_task_ = 0;
+    busy_threads_ = threads_.size();
+    batch_++;
+  }
+  start_cv_.notify_all();
+
+  runTasks();
+
+  std::unique_lock<std::mutex> lock(mtx_);
+  done_cv_.wait(lock,[this](){return busy_threads_ == 0;});
+  task_ = nullptr;
+}
+
+void WorkerPool::parallelFor(const size_t& n,
+                             const unsigned int& n_ranges,
+                             const std::function<void(const size_t& begin, const size_t& end)>& body)
+{
+  size_t ranges = (n_ranges == 0)? size(): n_ranges;
+  ranges = std::min(ranges,n);
+
+  if(ranges<=1)
+  {
+    body(0,n);
+    return;
+  }
+
+  run(ranges,[&n,&ranges,&body](const size_t& r){
+    body(n*r/ranges,n*(r+1)/ranges);
+  });
+}
+
+WorkerPool& WorkerPool::shared()
+{
+  // Never destroyed, so that it can be used until the end of the process
+  static WorkerPool* pool = new WorkerPool(0);
+  return *pool;
+}
+
+} //end namespace core
+} //end namespace graph
@@ -33,7 +33,9 @@ namespace core
 {
 Connection::Connection(const NodePtr& parent, const NodePtr& child, const cnr_logger::TraceLoggerPtr &logger, const bool is_net):
   parent_(parent),
+  parent_ptr_(parent.get()),
   child_(child),
+  cost_(0.0),
   logger_(logger)
 {
   assert(getParent());
@@ -46,10 +48,22 @@ Connection::Connection(const NodePtr& parent, const NodePtr& child, const cnr_lo
   assert(number_reserved_flags_ == flags_.size());
 }
 
+void Connection::setCost(const double& cost)
+{
+  if(cost == cost_)
+    return;
+
+  cost_ = cost;
+
+  // The cost to come of the child and of its successors changes
+  if(flags_[idx_child_valid_] && not flags_[idx_net_])
+    child_->invalidateCostToCome();
+}
+
 unsigned int Connection::setFlag(const bool flag)
 {
   unsigned int idx = flags_.size();
-  setFlag(flag,idx);
+  setFlag(idx,flag);
 
   return idx;
 }
@@ -67,7 +81,7 @@ bool Connection::setFlag(const size_t& idx, const bool flag)
       return false;
     }
     else
-      flags_[idx] = flag;
+      flags_.set(idx,flag);
   }
   else  //the flag should already exist or you should ask to create a flag at idx = flags_.size()
   {
@@ -88,7 +102,7 @@ bool Connection::getFlag(const size_t &idx, const bool default_value)
 
 void Connection::add(const bool is_net)
 {
-  flags_[idx_net_] = is_net;
+  flags_.set(idx_net_,is_net);
   add();
 }
 
@@ -221,6 +235,7 @@ void Connection::flip()
   NodePtr tmp = child_;
   child_ = parent_.lock();
   parent_ = tmp;
+  parent_ptr_ = tmp.get();
   add();   // add new connection from new parent and child
 }
 
@@ -265,7 +280,7 @@ bool Connection::convertToConnection()
   if(flags_[idx_net_])
   {
     remove();
-    flags_[idx_net_] = false;
+    flags_.set(idx_net_,false);
     add();
     return true;
   }
@@ -277,7 +292,7 @@ bool Connection::convertToNetConnection()
   if(not flags_[idx_net_])
   {
     remove();
-    flags_[idx_net_] = true;
+    flags_.set(idx_net_,true);
     add();
     return true;
   }
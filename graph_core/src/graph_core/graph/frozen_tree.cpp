@@ -0,0 +1,241 @@
+/*
+Copyright (c) 2024, Manuel Beschi and Cesare Tonola, JRL-CARI CNR-STIIMA/UNIBS, manuel.beschi@unibs.it, c.tonola001@unibs.it
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of the <organization> nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL <COPYRIGHT HOLDER> BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+#include <graph_core/graph/frozen_tree.h>
+#include <numeric>
+
+namespace graph
+{
+namespace core
+{
+FrozenTree::FrozenTree(const NodePtr& root, const std::function<bool (const NodePtr&)>& in_tree, const Eigen::VectorXd& scale):
+  indices_(NO_PARENT),
+  scale_(scale)
+{
+  nodes_.push_back(root);
+  parents_.push_back(NO_PARENT);
+  parent_costs_.push_back(0.0);
+  costs_to_come_.push_back(0.0);
+  parent_connections_.push_back(nullptr);
+
+  // Breadth-first visit: the children of a node get consecutive indices
+  children_offsets_.push_back(0);
+  for(unsigned int i=0; i<nodes_.size(); i++)
+  {
+    Node* node = nodes_[i].get();
+    for(const ConnectionPtr& conn: node->childConnectionsView())
+    {
+      const NodePtr& child = conn->getChild();
+      if(not in_tree(child))
+        continue;
+
+      children_.push_back(nodes_.size());
+      nodes_.push_back(child);
+      parents_.push_back(i);
+      parent_costs_.push_back(conn->getCost());
+      costs_to_come_.push_back(costs_to_come_[i]+conn->getCost());
+      parent_connections_.push_back(conn);
+    }
+    children_offsets_.push_back(children_.size());
+  }
+
+  configurations_.resize(root->getConfiguration().size(),nodes_.size());
+  indices_.reserve();
+  for(unsigned int i=0; i<nodes_.size(); i++)
+  {
+    configurations_.col(i) = nodes_[i]->getConfiguration();
+    indices_[nodes_[i]] = i;
+  }
+
+  kd_indices_.resize(nodes_.size());
+  std::iota(kd_indices_.begin(),kd_indices_.end(),0);
+  kd_dimensions_.resize(nodes_.size(),0);
+  buildIndex(0,nodes_.size());
+}
+
+void FrozenTree::buildIndex(const unsigned int& begin, const unsigned int& end)
+{
+  if(end-begin<2)
+    return;
+
+  // Dimension with the largest (weighted) spread
+  unsigned int dimension = 0;
+  double max_spread = -1.0;
+  for(unsigned int d=0; d<getDimension(); d++)
+  {
+    double min_value = std::numeric_limits<double>::infinity();
+    double max_value = -std::numeric_limits<double>::infinity();
+    for(unsigned int i=begin; i<end; i++)
+    {
+      double value = configurations_(d,kd_indices_[i]);
+      min_value = std::min(min_value,value);
+      max_value = std::max(max_value,value);
+    }
+
+    double spread = weight(d)*(max_value-min_value);
+    if(spread>max_spread)
+    {
+      max_spread = spread;
+      dimension = d;
+    }
+  }
+
+  unsigned int middle = begin+(end-begin)/2;
+  std::nth_element(kd_indices_.begin()+begin,kd_indices_.begin()+middle,kd_indices_.begin()+end,
+                   [this,&dimension](const unsigned int& i1, const unsigned int& i2){
+    return configurations_(dimension,i1)<configurations_(dimension,i2);
+  });
+  kd_dimensions_[middle] = dimension;
+
+  buildIndex(begin,middle);
+  buildIndex(middle+1,end);
+}
+
+void FrozenTree::getBranchToNode(const unsigned int& idx, std::vector<unsigned int>& branch) const
+{
+  branch.clear();
+  for(unsigned int i=idx; i != NO_PARENT; i=parents_[i])
+    branch.push_back(i);
+
+  std::reverse(branch.begin(),branch.end());
+}
+
+std::vector<ConnectionPtr> FrozenTree::getConnectionToNode(const unsigned int& idx) const
+{
+  std::vector<ConnectionPtr> connections;
+  for(unsigned int i=idx; parents_[i] != NO_PARENT; i=parents_[i])
+    connections.push_back(parent_connections_[i]);
+
+  std::reverse(connections.begin(),connections.end());
+  return connections;
+}
+
+void FrozenTree::getSubtree(const unsigned int& idx, std::vector<unsigned int>& nodes) const
+{
+  nodes.clear();
+  nodes.push_back(idx);
+  for(size_t i=0; i<nodes.size(); i++)
+  {
+    std::span<const unsigned int> children = getChildren(nodes[i]);
+    nodes.insert(nodes.end(),children.begin(),children.end());
+  }
+}
+
+void FrozenTree::getLeaves(std::vector<unsigned int>& leaves) const
+{
+  for(unsigned int i=1; i<size(); i++)
+  {
+    if(children_offsets_[i] == children_offsets_[i+1])
+      leaves.push_back(i);
+  }
+}
+
+void FrozenTree::near(const Eigen::VectorXd& configuration, const double& radius, std::vector<std::pair<double,unsigned int>>& nodes) const
+{
+  nodes.clear();
+  near(0,size(),configuration,radius,nodes);
+
+  std::sort(nodes.begin(),nodes.end());
+  for(std::pair<double,unsigned int>& p: nodes)
+    p.first = std::sqrt(p.first);
+}
+
+void FrozenTree::near(const unsigned int& begin,
+                      const unsigned int& end,
+                      const Eigen::VectorXd& configuration,
+                      const double& radius,
+                      std::vector<std::pair<double,unsigned int>>& nodes) const
+{
+  if(begin>=end)
+    return;
+
+  unsigned int middle = begin+(end-begin)/2;
+  unsigned int idx = kd_indices_[middle];
+
+  double squared_distance = squaredDistance(configuration,idx);
+  if(squared_distance<radius*radius)
+    nodes.push_back(std::make_pair(squared_distance,idx));
+
+  unsigned int dimension = kd_dimensions_[middle];
+  double delta = weight(dimension)*(configuration(dimension)-configurations_(dimension,idx));
+
+  if(delta<radius)
+    near(begin,middle,configuration,radius,nodes);
+  if(-delta<radius)
+    near(middle+1,end,configuration,radius,nodes);
+}
+
+unsigned int FrozenTree::nearestNeighbor(const Eigen::VectorXd& configuration, double& distance) const
+{
+  unsigned int nearest = 0;
+  double best = std::numeric_limits<double>::infinity();
+  nearestNeighbor(0,size(),configuration,nearest,best);
+
+  distance = std::sqrt(best);
+  return nearest;
+}
+
+void FrozenTree::nearestNeighbor(const unsigned int& begin,
+                                 const unsigned int& end,
+                                 const Eigen::VectorXd& configuration,
+                                 unsigned int& best,
+                                 double& best_squared_distance) const
+{
+  if(begin>=end)
+    return;
+
+  unsigned int middle = begin+(end-begin)/2;
+  unsigned int idx = kd_indices_[middle];
+
+  double squared_distance = squaredDistance(configuration,idx);
+  if(squared_distance<best_squared_distance)
+  {
+    best_squared_distance = squared_distance;
+    best = idx;
+  }
+
+  unsigned int dimension = kd_dimensions_[middle];
+  double delta = weight(dimension)*(configuration(dimension)-configurations_(dimension,idx));
+
+  // the best distance is read again after the first recursion, since it can improve it
+  if(delta>=0.0) //search right first
+  {
+    nearestNeighbor(middle+1,end,configuration,best,best_squared_distance);
+    if(delta*delta<best_squared_distance)
+      nearestNeighbor(begin,middle,configuration,best,best_squared_distance);
+  }
+  else //search left first
+  {
+    nearestNeighbor(begin,middle,configuration,best,best_squared_distance);
+    if(delta*delta<best_squared_distance)
+      nearestNeighbor(middle+1,end,configuration,best,best_squared_distance);
+  }
+}
+
+} //end namespace core
+} //end namespace graph
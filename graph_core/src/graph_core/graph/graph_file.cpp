@@ -0,0 +1,339 @@
+/*
+Copyright (c) 2024, Manuel Beschi and Cesare Tonola, JRL-CARI CNR-STIIMA/UNIBS, manuel.beschi@unibs.it, c.tonola001@unibs.it
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of the <organization> nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL <COPYRIGHT HOLDER> BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+#include <graph_core/graph/graph_file.h>
+#include <graph_core/datastructure/nearest_neighbors.h>
+#include <cstring>
+#include <cstdio>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+namespace graph
+{
+namespace core
+{
+GraphFile::Buffer::Buffer(const Kind& kind, const unsigned int& dof, const size_t& expected_nodes)
+{
+  std::memset(&header,0,sizeof(header));
+  std::memcpy(header.magic,MAGIC,sizeof(header.magic));
+  header.version = VERSION;
+  header.kind = kind;
+  header.dof = dof;
+
+  configurations.reserve(expected_nodes*dof);
+  costs.reserve(expected_nodes);
+  node_flags.reserve(expected_nodes);
+  connection_flags.reserve(expected_nodes);
+  parents.reserve(expected_nodes);
+  node_flags_sizes.reserve(expected_nodes);
+  connection_flags_sizes.reserve(expected_nodes);
+}
+
+uint32_t GraphFile::Buffer::addNode(const NodePtr& node, const uint32_t& parent, const ConnectionPtr& connection)
+{
+  const Eigen::VectorXd& configuration = node->getConfiguration();
+  assert(configuration.size() == header.dof);
+  configurations.insert(configurations.end(),configuration.data(),configuration.data()+configuration.size());
+
+  parents.push_back(parent);
+  costs.push_back(connection? connection->getCost(): 0.0);
+
+  uint64_t flags = 0;
+  uint32_t flags_size = std::min<size_t>(node->getFlagsSize()-Node::getReservedFlagsNumber(),MAX_FLAGS);
+  for(uint32_t k=0; k<flags_size; k++)
+  {
+    if(node->getFlag(Node::getReservedFlagsNumber()+k,false))
+      flags |= uint64_t(1)<<k;
+  }
+  node_flags.push_back(flags);
+  node_flags_sizes.push_back(flags_size);
+
+  flags = 0;
+  flags_size = 0;
+  if(connection)
+  {
+    flags_size = std::min<size_t>(connection->getFlagsSize()-Connection::getReservedFlagsNumber(),MAX_FLAGS);
+    for(uint32_t k=0; k<flags_size; k++)
+    {
+      if(connection->getFlag(Connection::getReservedFlagsNumber()+k,false))
+        flags |= uint64_t(1)<<k;
+    }
+  }
+  connection_flags.push_back(flags);
+  connection_flags_sizes.push_back(flags_size);
+
+  return header.nodes++;
+}
+
+bool GraphFile::Buffer::write(const std::string& file_name, std::string& what)
+{
+  header.has_scale = scale.empty()? 0: 1;
+  if(header.has_scale && scale.size() != header.dof)
+  {
+    what = "the scale size is different from the nodes dimension";
+    return false;
+  }
+
+  std::FILE* file = std::fopen(file_name.c_str(),"wb");
+  if(not file)
+  {
+    what = "cannot open file "+file_name;
+    return false;
+  }
+
+  auto write_vector = [&](const auto& v) -> bool{
+    return v.empty() || std::fwrite(v.data(),sizeof(v[0]),v.size(),file) == v.size();
+  };
+
+  bool ok = std::fwrite(&header,sizeof(header),1,file) == 1 &&
+      write_vector(scale) &&
+      write_vector(configurations) &&
+      write_vector(costs) &&
+      write_vector(node_flags) &&
+      write_vector(connection_flags) &&
+      write_vector(parents) &&
+      write_vector(node_flags_sizes) &&
+      write_vector(connection_flags_sizes);
+
+  ok = (std::fclose(file) == 0) && ok;
+  if(not ok)
+    what = "error writing file "+file_name;
+
+  return ok;
+}
+
+GraphFile::GraphFile():
+  data_(nullptr),
+  size_(0)
+{
+}
+
+GraphFile::~GraphFile()
+{
+  close();
+}
+
+bool GraphFile::open(const std::string& file_name, std::string& what)
+{
+  close();
+
+  int fd = ::open(file_name.c_str(),O_RDONLY);
+  if(fd<0)
+  {
+    what = "cannot open file "+file_name;
+    return false;
+  }
+
+  struct stat st;
+  if(fstat(fd,&st) != 0 || static_cast<size_t>(st.st_size)<sizeof(GraphFileHeader))
+  {
+    ::close(fd);
+    what = "file "+file_name+" is too small to be a graph file";
+    return false;
+  }
+
+  void* data = mmap(nullptr,st.st_size,PROT_READ,MAP_PRIVATE,fd,0);
+  ::close(fd); //the mapping stays valid
+  if(data == MAP_FAILED)
+  {
+    what = "cannot map file "+file_name;
+    return false;
+  }
+
+  data_ = data;
+  size_ = st.st_size;
+  header_ = static_cast<const GraphFileHeader*>(data_);
+
+  if(std::memcmp(header_->magic,MAGIC,sizeof(MAGIC)) != 0)
+  {
+    close();
+    what = "file "+file_name+" is not a graph file";
+    return false;
+  }
+  if(header_->version != VERSION)
+  {
+    std::string version = std::to_string(header_->version);
+    close();
+    what = "file "+file_name+" has version "+version+", expected "+std::to_string(VERSION);
+    return false;
+  }
+  if(header_->kind != TREE && header_->kind != PATH)
+  {
+    std::string kind = std::to_string(header_->kind);
+    close();
+    what = "file "+file_name+" has unknown kind "+kind;
+    return false;
+  }
+  if(header_->nearest_neighbors>static_cast<uint32_t>(NearestNeighborsType::HashGrid))
+  {
+    std::string nn_type = std::to_string(header_->nearest_neighbors);
+    close();
+    what = "file "+file_name+" has unknown nearest neighbors type "+nn_type;
+    return false;
+  }
+
+  if(header_->dof == 0)
+  {
+    close();
+    what = "file "+file_name+" is corrupted: the configurations have dimension 0";
+    return false;
+  }
+
+  // The number of nodes is checked against the file size before computing the expected size, which could overflow
+  const size_t dof = header_->dof;
+  const size_t scale_size = sizeof(double)*(header_->has_scale? dof: 0);
+  const size_t bytes_per_node = sizeof(double)*(dof+1)+sizeof(uint64_t)*2+sizeof(uint32_t)*3;
+  if(size_<sizeof(GraphFileHeader)+scale_size || header_->nodes>(size_-sizeof(GraphFileHeader)-scale_size)/bytes_per_node)
+  {
+    std::string nodes = std::to_string(header_->nodes);
+    close();
+    what = "file "+file_name+" has size "+std::to_string(st.st_size)+", too small for "+nodes+" nodes";
+    return false;
+  }
+
+  const size_t n = header_->nodes;
+  const size_t expected_size = sizeof(GraphFileHeader)+scale_size+bytes_per_node*n;
+  if(size_ != expected_size)
+  {
+    close();
+    what = "file "+file_name+" has size "+std::to_string(st.st_size)+", expected "+std::to_string(expected_size);
+    return false;
+  }
+
+  const char* p = static_cast<const char*>(data_)+sizeof(GraphFileHeader);
+  auto section = [&p](auto*& ptr, const size_t& count){
+    ptr = reinterpret_cast<std::remove_reference_t<decltype(ptr)>>(p);
+    p += count*sizeof(*ptr);
+  };
+  section(scale_,header_->has_scale? dof: 0);
+  section(configurations_,n*dof);
+  section(costs_,n);
+  section(node_flags_,n);
+  section(connection_flags_,n);
+  section(parents_,n);
+  section(node_flags_sizes_,n);
+  section(connection_flags_sizes_,n);
+
+  for(size_t i=1; i<n; i++)
+  {
+    if(parents_[i]>=i)
+    {
+      std::string parent = std::to_string(parents_[i]);
+      close();
+      what = "file "+file_name+" is corrupted: node "+std::to_string(i)+" has parent "+parent;
+      return false;
+    }
+  }
+
+  // Flags are read by shifting a 64 bit word, larger sizes would shift out of range
+  for(size_t i=0; i<n; i++)
+  {
+    if(node_flags_sizes_[i]>MAX_FLAGS || connection_flags_sizes_[i]>MAX_FLAGS)
+    {
+      std::string sizes = std::to_string(node_flags_sizes_[i])+" and "+std::to_string(connection_flags_sizes_[i]);
+      close();
+      what = "file "+file_name+" is corrupted: node "+std::to_string(i)+" has flag sizes "+sizes+", at most "+std::to_string(MAX_FLAGS)+" are allowed";
+      return false;
+    }
+  }
+
+  return true;
+}
+
+void GraphFile::close()
+{
+  if(data_)
+    munmap(data_,size_);
+
+  data_ = nullptr;
+  size_ = 0;
+}
+
+void GraphFile::restoreFlags(const size_t& idx, const NodePtr& node, const ConnectionPtr& connection) const
+{
+  for(uint32_t k=0; k<node_flags_sizes_[idx]; k++)
+    node->setFlag(Node::getReservedFlagsNumber()+k,(node_flags_[idx]>>k) & 1);
+
+  if(connection)
+  {
+    for(uint32_t k=0; k<connection_flags_sizes_[idx]; k++)
+      connection->setFlag(Connection::getReservedFlagsNumber()+k,(connection_flags_[idx]>>k) & 1);
+  }
+}
+
+YAML::Node GraphFile::toYAML() const
+{
+  auto configuration_to_yaml = [this](const size_t& idx) -> YAML::Node{
+    YAML::Node yaml;
+    yaml.SetStyle(YAML::EmitterStyle::Flow);
+    for(uint32_t j=0; j<header_->dof; j++)
+      yaml.push_back(configurations_[idx*header_->dof+j]);
+    return yaml;
+  };
+
+  YAML::Node yaml;
+  if(header_->kind == PATH)
+  {
+    for(size_t i=0; i<size(); i++)
+      yaml.push_back(configuration_to_yaml(i));
+    return yaml;
+  }
+
+  YAML::Node nodes;
+  YAML::Node connections;
+  for(size_t i=0; i<size(); i++)
+  {
+    nodes.push_back(configuration_to_yaml(i));
+    if(i>0)
+    {
+      YAML::Node connection;
+      connection.SetStyle(YAML::EmitterStyle::Flow);
+      connection.push_back(static_cast<int>(parents_[i]));
+      connection.push_back(static_cast<int>(i));
+      connections.push_back(connection);
+    }
+  }
+
+  NearestNeighborsType nn_type = static_cast<NearestNeighborsType>(header_->nearest_neighbors);
+  yaml["max_distance"] = header_->max_distance;
+  yaml["use_kdtree"] = (nn_type != NearestNeighborsType::Vector);
+  yaml["nearest_neighbors"] = toString(nn_type);
+  if(header_->has_scale)
+    yaml["nearest_neighbors_scale"] = std::vector<double>(scale_,scale_+header_->dof);
+  if(header_->nearest_neighbors_epsilon>0.0)
+    yaml["nearest_neighbors_epsilon"] = header_->nearest_neighbors_epsilon;
+  yaml["nodes"] = nodes;
+  yaml["connections"] = connections;
+
+  return yaml;
+}
+
+} //end namespace core
+} //end namespace graph
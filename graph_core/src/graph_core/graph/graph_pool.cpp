@@ -0,0 +1,64 @@
+/*
+Copyright (c) 2024, Manuel Beschi and Cesare Tonola, JRL-CARI CNR-STIIMA/UNIBS, manuel.beschi@unibs.it, c.tonola001@unibs.it
+Manuel Beschi manuel.beschi@unibs.it
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of the <organization> nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL <COPYRIGHT HOLDER> BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <graph_core/graph/graph_pool.h>
+
+namespace graph
+{
+namespace core
+{
+GraphPool::GraphPool():
+  allocated_objects_(0)
+{
+}
+
+void* GraphPool::allocate(const size_t& bytes, const size_t& alignment)
+{
+  void* p = resource_.allocate(bytes,alignment);
+  allocated_objects_++;
+  return p;
+}
+
+void GraphPool::deallocate(void* p, const size_t& bytes, const size_t& alignment) noexcept
+{
+  resource_.deallocate(p,bytes,alignment);
+  allocated_objects_--;
+}
+
+NodePtr GraphPool::makeNode(const Eigen::VectorXd& configuration, const cnr_logger::TraceLoggerPtr& logger)
+{
+  return std::allocate_shared<Node>(Allocator<Node>(shared_from_this()),configuration,logger);
+}
+
+ConnectionPtr GraphPool::makeConnection(const NodePtr& parent, const NodePtr& child, const cnr_logger::TraceLoggerPtr& logger, const bool is_net)
+{
+  return std::allocate_shared<Connection>(Allocator<Connection>(shared_from_this()),parent,child,logger,is_net);
+}
+
+} //end namespace core
+} //end namespace graph
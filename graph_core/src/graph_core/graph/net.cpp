@@ -53,12 +53,6 @@ std::multimap<double,std::vector<ConnectionPtr>>& Net::getConnectionBetweenNodes
 {
   double cost2here = 0.0;
 
-  black_list_.clear();
-  black_list_ = black_list;
-
-  visited_nodes_.clear();
-  visited_nodes_.push_back(goal_node);
-
   map_.clear();
   connections2parent_.clear();
 
@@ -71,9 +65,18 @@ std::multimap<double,std::vector<ConnectionPtr>>& Net::getConnectionBetweenNodes
   if(max_time_<=0.0)
     return map_;
 
+  // Only the marked entries are cleared at the end, the tables span all the nodes of the process
+  for(const NodePtr& n: black_list)
+    black_list_[n] = true;
+  visited_nodes_[goal_node] = true;
+
   tic_search_ = graph_time::now();
   computeConnectionFromNodeToNode(start_node,goal_node,cost2here,cost2beat);
 
+  for(const NodePtr& n: black_list)
+    black_list_[n] = false;
+  visited_nodes_[goal_node] = false;
+
   return map_;
 }
 
@@ -87,12 +90,6 @@ std::multimap<double,std::vector<ConnectionPtr>>& Net::getConnectionToNode(const
 {
   double cost2here = 0.0;
 
-  black_list_.clear();
-  black_list_ = black_list;
-
-  visited_nodes_.clear();
-  visited_nodes_.push_back(node);
-
   map_.clear();
   connections2parent_.clear();
 
@@ -104,9 +101,18 @@ std::multimap<double,std::vector<ConnectionPtr>>& Net::getConnectionToNode(const
   if(max_time_<=0.0)
     return map_;
 
+  // Only the marked entries are cleared at the end, the tables span all the nodes of the process
+  for(const NodePtr& n: black_list)
+    black_list_[n] = true;
+  visited_nodes_[node] = true;
+
   tic_search_ = graph_time::now();
   computeConnectionFromNodeToNode(linked_tree_->getRoot(),node,cost2here,cost2beat);
 
+  for(const NodePtr& n: black_list)
+    black_list_[n] = false;
+  visited_nodes_[node] = false;
+
   return map_;
 }
 
@@ -151,10 +157,6 @@ void Net::computeConnectionFromNodeToNode(const NodePtr& start_node, const NodeP
   }
   else
   {
-    std::vector<ConnectionPtr> all_parent_connections = goal_node->getParentConnections();
-    std::vector<ConnectionPtr> net_parent_connections = goal_node->getNetParentConnections();
-    all_parent_connections.insert(all_parent_connections.end(),net_parent_connections.begin(),net_parent_connections.end());
-
     std::chrono::time_point<graph_time> tic_cycle;
 
     now = graph_time::now();
@@ -162,8 +164,13 @@ void Net::computeConnectionFromNodeToNode(const NodePtr& start_node, const NodeP
 
     double time2now;
     double cost2parent;
-    for(const ConnectionPtr& conn2parent:all_parent_connections)
+    std::span<Connection* const> parent_connections = goal_node->parentConnectionsView();
+    std::span<Connection* const> net_parent_connections = goal_node->netParentConnectionsView();
+    for(size_t k=0;k<parent_connections.size()+net_parent_connections.size();k++)
     {
+      Connection* conn = k<parent_connections.size()? parent_connections[k]: net_parent_connections[k-parent_connections.size()];
+      const ConnectionPtr conn2parent = conn->pointer();
+
       tic_cycle = graph_time::now();
       time2now =  toSeconds(tic_cycle,tic_search_);
 
@@ -269,7 +276,7 @@ void Net::computeConnectionFromNodeToNode(const NodePtr& start_node, const NodeP
       else
       {
         time_black_list_check = graph_time::now();
-        if(std::find(black_list_.begin(),black_list_.end(),parent)<black_list_.end())
+        if(black_list_.get(parent))
         {
           now = graph_time::now();
           time_tot = time_tot + (now-tic_cycle);
@@ -288,7 +295,7 @@ void Net::computeConnectionFromNodeToNode(const NodePtr& start_node, const NodeP
           CNR_INFO(logger_,"time black list check: "<<toSeconds(now,time_black_list_check));
 
         time_visited_list_check = graph_time::now();
-        if(std::find(visited_nodes_.begin(),visited_nodes_.end(),parent)<visited_nodes_.end())
+        if(visited_nodes_.get(parent))
         {
           now = graph_time::now();
           time_tot = time_tot+(now-tic_cycle);
@@ -302,7 +309,7 @@ void Net::computeConnectionFromNodeToNode(const NodePtr& start_node, const NodeP
           continue;
         }
         else
-          visited_nodes_.push_back(parent);
+          visited_nodes_[parent] = true;
 
         now = graph_time::now();
         if(verbose_)
@@ -322,7 +329,7 @@ void Net::computeConnectionFromNodeToNode(const NodePtr& start_node, const NodeP
         computeConnectionFromNodeToNode(start_node,parent,cost2parent);
 
         auto tic_cycle2 = graph_time::now();
-        visited_nodes_.pop_back();
+        visited_nodes_[parent] = false;
         connections2parent_.pop_back();
 
         now = graph_time::now();
@@ -26,12 +26,141 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 */
 
 #include <graph_core/graph/node.h>
+#include <algorithm>
+#include <mutex>
+#include <atomic>
 
 namespace graph
 {
 namespace core
 {
-Node::Node(const Eigen::VectorXd& configuration):logger_(nullptr)
+namespace
+{
+/**
+ * @brief Identifiers are moved between the threads and the shared registry in blocks of ID_BLOCK,
+ * so that creating and destroying nodes locks the registry once every ID_BLOCK operations.
+ */
+constexpr size_t ID_BLOCK = 64;
+
+struct IdRegistry
+{
+  std::mutex mtx;
+  std::atomic<unsigned int> bound{0};
+  std::vector<unsigned int> free_ids;
+
+  // Moves up to ID_BLOCK identifiers into ids, taking new ones if there are no free identifiers
+  void take(std::vector<unsigned int>& ids)
+  {
+    std::lock_guard<std::mutex> lock(mtx);
+    if(free_ids.empty())
+    {
+      unsigned int first = bound.fetch_add(ID_BLOCK);
+      for(size_t i=ID_BLOCK;i>0;i--)
+        ids.push_back(first+i-1);
+      return;
+    }
+
+    size_t n = std::min(ID_BLOCK,free_ids.size());
+    ids.insert(ids.end(),free_ids.end()-n,free_ids.end());
+    free_ids.resize(free_ids.size()-n);
+  }
+
+  // Moves the last n identifiers of ids into the registry
+  void give(std::vector<unsigned int>& ids, const size_t& n)
+  {
+    std::lock_guard<std::mutex> lock(mtx);
+    free_ids.insert(free_ids.end(),ids.end()-n,ids.end());
+    ids.resize(ids.size()-n);
+  }
+};
+
+IdRegistry& idRegistry()
+{
+  // Never destroyed, static objects holding nodes may be destroyed after it
+  static IdRegistry* registry = new IdRegistry();
+  return *registry;
+}
+
+// Set when the identifiers of the thread have been returned to the registry, at thread exit.
+// Nodes destroyed afterwards (e.g. by static objects) use the registry directly
+thread_local bool local_ids_released = false;
+
+/**
+ * @brief Identifiers owned by a thread, used without locks. They are returned to the registry at thread exit.
+ */
+struct LocalIds
+{
+  std::vector<unsigned int> ids;
+
+  LocalIds()
+  {
+    ids.reserve(2*ID_BLOCK+1);
+  }
+
+  ~LocalIds()
+  {
+    idRegistry().give(ids,ids.size());
+    local_ids_released = true;
+  }
+};
+
+LocalIds* localIds()
+{
+  if(local_ids_released)
+    return nullptr;
+
+  thread_local LocalIds local_ids;
+  return &local_ids;
+}
+
+unsigned int allocateId()
+{
+  LocalIds* local = localIds();
+  if(not local)
+  {
+    std::vector<unsigned int> ids;
+    idRegistry().take(ids);
+    unsigned int id = ids.back();
+    ids.pop_back();
+    idRegistry().give(ids,ids.size());
+    return id;
+  }
+
+  if(local->ids.empty())
+    idRegistry().take(local->ids);
+
+  unsigned int id = local->ids.back();
+  local->ids.pop_back();
+  return id;
+}
+
+void releaseId(const unsigned int& id)
+{
+  LocalIds* local = localIds();
+  if(not local)
+  {
+    std::vector<unsigned int> ids(1,id);
+    idRegistry().give(ids,1);
+    return;
+  }
+
+  local->ids.push_back(id);
+  if(local->ids.size()>2*ID_BLOCK)
+    idRegistry().give(local->ids,ID_BLOCK);
+}
+}
+
+unsigned int Node::getIdBound()
+{
+  return idRegistry().bound.load(std::memory_order_relaxed);
+}
+
+Node::Node(const Eigen::VectorXd& configuration):
+  logger_(nullptr),
+  cost_to_come_(0.0),
+  cost_to_come_root_(nullptr),
+  cost_to_come_valid_(false),
+  id_(allocateId())
 {
   configuration_ = configuration;
   ndof_ = configuration_.size();
@@ -40,7 +169,11 @@ Node::Node(const Eigen::VectorXd& configuration):logger_(nullptr)
 }
 
 Node::Node(const Eigen::VectorXd &configuration, const cnr_logger::TraceLoggerPtr &logger):
-  logger_(logger)
+  logger_(logger),
+  cost_to_come_(0.0),
+  cost_to_come_root_(nullptr),
+  cost_to_come_valid_(false),
+  id_(allocateId())
 {
   configuration_ = configuration;
   ndof_ = configuration_.size();
@@ -51,7 +184,7 @@ Node::Node(const Eigen::VectorXd &configuration, const cnr_logger::TraceLoggerPt
 unsigned int Node::setFlag(const bool flag)
 {
   unsigned int idx = flags_.size();
-  setFlag(flag,idx);
+  setFlag(idx,flag);
 
   return idx;
 }
@@ -68,7 +201,7 @@ bool Node::setFlag(const size_t& idx, const bool flag)
       return false;
     }
     else
-      flags_[idx] = flag;
+      flags_.set(idx,flag);
   }
   else  //the flag should already exist or you should ask to create a flag at idx = flags_.size()
   {
@@ -96,9 +229,11 @@ void Node::addParentConnection(const ConnectionPtr &connection)
   }
 
   parent_connections_.push_back(connection);
+  parent_connections_ptr_.push_back(connection.get());
+  invalidateCostToCome();
 
   //Set connection's child as valid
-  connection->flags_[Connection::idx_child_valid_] = true;
+  connection->flags_.set(Connection::idx_child_valid_,true);
   return;
 }
 
@@ -113,7 +248,7 @@ void Node::addChildConnection(const ConnectionPtr &connection)
   child_connections_.push_back(connection);
 
   //Set connection's parent as valid
-  connection->flags_[Connection::idx_parent_valid_] = true;
+  connection->flags_.set(Connection::idx_parent_valid_,true);
   return;
 }
 
@@ -126,9 +261,10 @@ void Node::addNetParentConnection(const ConnectionPtr &connection)
   }
 
   net_parent_connections_.push_back(connection);
+  net_parent_connections_ptr_.push_back(connection.get());
 
   //Set connection's child as valid
-  connection->flags_[Connection::idx_child_valid_] = true;
+  connection->flags_.set(Connection::idx_child_valid_,true);
   return;
 }
 
@@ -143,7 +279,7 @@ void Node::addNetChildConnection(const ConnectionPtr &connection)
   net_child_connections_.push_back(connection);
 
   //Set connection's parent as valid
-  connection->flags_[Connection::idx_parent_valid_] = true;
+  connection->flags_.set(Connection::idx_parent_valid_,true);
   return;
 }
 
@@ -166,10 +302,12 @@ void Node::removeParentConnection(const std::vector<ConnectionWeakPtr>::iterator
   else
   {
     //Set connection's child as not valid (before erasing)
-    (*it_conn).lock()->flags_[Connection::idx_child_valid_] = false;
+    (*it_conn).lock()->flags_.set(Connection::idx_child_valid_,false);
 
-    //Remove connection from this node's parent connections vector
+    //Remove connection from this node's parent connections vectors
+    parent_connections_ptr_.erase(parent_connections_ptr_.begin()+(it_conn-parent_connections_.begin()));
     parent_connections_.erase(it_conn);
+    invalidateCostToCome();
   }
 }
 
@@ -192,9 +330,10 @@ void Node::removeNetParentConnection(const std::vector<ConnectionWeakPtr>::itera
   else
   {
     //Set connection's child as not valid (before erasing)
-    (*it_conn).lock()->flags_[Connection::idx_child_valid_] = false;
+    (*it_conn).lock()->flags_.set(Connection::idx_child_valid_,false);
 
-    //Remove connection from this node's net parent connections vector
+    //Remove connection from this node's net parent connections vectors
+    net_parent_connections_ptr_.erase(net_parent_connections_ptr_.begin()+(it_conn-net_parent_connections_.begin()));
     net_parent_connections_.erase(it_conn);
   }
   return;
@@ -217,7 +356,7 @@ void Node::removeChildConnection(const std::vector<ConnectionPtr>::iterator &it_
   else
   {
     //Set connection's parent as not valid (before erasing)
-    (*it_conn)->flags_[Connection::idx_parent_valid_] = false;
+    (*it_conn)->flags_.set(Connection::idx_parent_valid_,false);
     assert(not (*it_conn)->flags_[Connection::idx_parent_valid_]);
 
     //Remove connection from this node's child connections vector
@@ -243,7 +382,7 @@ void Node::removeNetChildConnection(const std::vector<ConnectionPtr>::iterator&
   else
   {
     //Set connection's parent as not valid (before erasing)
-    (*it_conn)->flags_[Connection::idx_parent_valid_] = false;
+    (*it_conn)->flags_.set(Connection::idx_parent_valid_,false);
     assert(not (*it_conn)->flags_[Connection::idx_parent_valid_]);
 
     //Remove connection from this node's child connections vector
@@ -251,6 +390,83 @@ void Node::removeNetChildConnection(const std::vector<ConnectionPtr>::iterator&
   }
 }
 
+void Node::invalidateCostToCome()
+{
+  if(not cost_to_come_valid_)
+    return;  //the successors are not valid either
+
+  static thread_local std::vector<Node*> stack;
+  stack.clear();
+
+  cost_to_come_valid_ = false;
+  stack.push_back(this);
+  while(not stack.empty())
+  {
+    Node* node = stack.back();
+    stack.pop_back();
+
+    for(const ConnectionPtr& conn: node->child_connections_)
+    {
+      Node* child = conn->child_.get();
+      if(child->cost_to_come_valid_)
+      {
+        child->cost_to_come_valid_ = false;
+        stack.push_back(child);
+      }
+    }
+  }
+}
+
+double Node::getCostToCome(Node*& root)
+{
+  if(cost_to_come_valid_)
+  {
+    root = cost_to_come_root_;
+    return cost_to_come_;
+  }
+
+  // Go up to the first node with a valid cost, storing the nodes met and the cost of their parent connection
+  static thread_local std::vector<std::pair<Node*,double>> chain;
+  chain.clear();
+
+  Node* node = this;
+  while(not node->cost_to_come_valid_)
+  {
+    if(node->parent_connections_.size() != 1)
+    {
+      node->cost_to_come_root_ = node->parent_connections_.empty()? node: nullptr;
+      node->cost_to_come_ = node->parent_connections_.empty()? 0.0: std::numeric_limits<double>::infinity();
+      node->cost_to_come_valid_ = true;
+      break;
+    }
+
+    Connection* conn = node->parent_connections_ptr_.front();
+    chain.push_back(std::make_pair(node,conn->cost_));
+    node = conn->parent_ptr_;
+
+    if(node == chain.back().first)
+    {
+      CNR_FATAL(logger_,"node "<< node <<"=\n" << *node);
+      CNR_FATAL(logger_,"to parent\n" << *conn);
+      CNR_FATAL(logger_,"connection between the same node!");
+      throw std::runtime_error("connection between the same node!");
+    }
+  }
+
+  // Go down updating the costs
+  double cost = node->cost_to_come_;
+  root = node->cost_to_come_root_;
+  for(std::vector<std::pair<Node*,double>>::reverse_iterator it = chain.rbegin(); it != chain.rend(); ++it)
+  {
+    cost += it->second;
+    it->first->cost_to_come_ = cost;
+    it->first->cost_to_come_root_ = root;
+    it->first->cost_to_come_valid_ = true;
+  }
+
+  return cost;
+}
+
 void Node::disconnect()
 {
   disconnectParentConnections();
@@ -393,6 +609,8 @@ Node::~Node()
 
   assert(parent_connections_.empty() && net_parent_connections_.empty() &&
          child_connections_ .empty() && net_child_connections_ .empty());
+
+  releaseId(id_);
 }
 
 const size_t Node::getParentConnectionsSize() const
@@ -472,6 +690,8 @@ std::vector<NodePtr> Node::getChildren() const
   if (child_connections_.size()==0)
     return children;
 
+  children.reserve(child_connections_.size());
+
   for(const ConnectionPtr& conn:child_connections_)
   {
     assert(conn);
@@ -486,6 +706,8 @@ std::vector<NodePtr> Node::getNetChildren() const
   if (net_child_connections_.size()==0)
     return children;
 
+  children.reserve(net_child_connections_.size());
+
   for(const ConnectionPtr& conn:net_child_connections_)
   {
     assert(conn);
@@ -500,10 +722,9 @@ std::vector<NodePtr> Node::getParents() const
   if (parent_connections_.size()==0)
     return parents;
 
-  ConnectionPtr conn;
-  for(unsigned int i=0; i<parent_connections_.size();i++)
+  parents.reserve(parent_connections_.size());
+  for(const Connection* conn: parent_connections_ptr_)
   {
-    conn = parent_connections_[i].lock();
     assert(conn);
     parents.push_back(conn->getParent());
   }
@@ -516,10 +737,9 @@ std::vector<NodePtr> Node::getNetParents() const
   if (net_parent_connections_.size()==0)
     return parents;
 
-  ConnectionPtr conn;
-  for(unsigned int i=0; i<net_parent_connections_.size();i++)
+  parents.reserve(net_parent_connections_.size());
+  for(const Connection* conn: net_parent_connections_ptr_)
   {
-    conn = net_parent_connections_[i].lock();
     assert(conn);
     parents.push_back(conn->getParent());
   }
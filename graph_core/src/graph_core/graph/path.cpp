@@ -1452,6 +1452,133 @@ PathPtr Path::fromYAML(const YAML::Node& yaml, const MetricsPtr& metrics,
   return std::make_shared<Path>(nodes,metrics,checker,logger);
 }
 
+bool Path::toBinary(const std::string& file_name, const bool reverse) const
+{
+  if(connections_.empty())
+  {
+    CNR_ERROR(logger_,"Cannot write an empty path");
+    return false;
+  }
+
+  GraphFile::Buffer buffer(GraphFile::PATH,start_node_->getConfiguration().size(),connections_.size()+1);
+
+  buffer.addNode(reverse? goal_node_: start_node_,GraphFile::NO_PARENT,nullptr);
+  for(size_t idx=0; idx<connections_.size(); idx++)
+  {
+    if(reverse)
+    {
+      const ConnectionPtr& conn = connections_[connections_.size()-idx-1];
+      buffer.addNode(conn->getParent(),idx,conn);
+    }
+    else
+      buffer.addNode(connections_[idx]->getChild(),idx,connections_[idx]);
+  }
+
+  std::string what;
+  if(not buffer.write(file_name,what))
+  {
+    CNR_ERROR(logger_,what);
+    return false;
+  }
+  return true;
+}
+
+PathPtr Path::fromBinary(const std::string& file_name, const MetricsPtr& metrics,
+                         const CollisionCheckerPtr& checker, const cnr_logger::TraceLoggerPtr& logger)
+{
+  GraphFile file;
+  std::string what;
+  if(not file.open(file_name,what))
+  {
+    CNR_ERROR(logger,what);
+    return nullptr;
+  }
+
+  if(file.getHeader().kind != GraphFile::PATH || file.size()<2)
+  {
+    CNR_ERROR(logger,"file "<<file_name<<" does not contain a path");
+    return nullptr;
+  }
+
+  std::vector<ConnectionPtr> connections;
+  connections.reserve(file.size()-1);
+
+  NodePtr start = std::make_shared<Node>(file.getConfiguration(0),logger);
+  file.restoreFlags(0,start,nullptr);
+
+  NodePtr parent = start;
+  for(size_t i=1; i<file.size(); i++)
+  {
+    if(file.getParent(i) != i-1)
+    {
+      CNR_ERROR(logger,"file "<<file_name<<" does not contain a path");
+      return nullptr;
+    }
+
+    NodePtr child = std::make_shared<Node>(file.getConfiguration(i),logger);
+    ConnectionPtr conn = std::make_shared<Connection>(parent,child,logger);
+    conn->setCost(file.getCost(i));
+    conn->add();
+
+    file.restoreFlags(i,child,conn);
+    connections.push_back(conn);
+    parent = child;
+  }
+
+  CNR_WARN(logger,"Path created from binary file but no tree is available, remember to add it!");
+
+  return std::make_shared<Path>(connections,metrics,checker,logger);
+}
+
+bool Path::yamlToBinary(const std::string& yaml_file_name, const std::string& binary_file_name,
+                        const MetricsPtr& metrics, const cnr_logger::TraceLoggerPtr& logger)
+{
+  YAML::Node yaml;
+  try
+  {
+    yaml = YAML::LoadFile(yaml_file_name);
+  }
+  catch(const YAML::Exception& e)
+  {
+    CNR_ERROR(logger,"Cannot load file "<<yaml_file_name<<": "<<e.what());
+    return false;
+  }
+
+  PathPtr path = fromYAML(yaml,metrics,nullptr,logger);
+  if(not path)
+    return false;
+
+  return path->toBinary(binary_file_name);
+}
+
+bool Path::binaryToYAML(const std::string& binary_file_name, const std::string& yaml_file_name,
+                        const cnr_logger::TraceLoggerPtr& logger)
+{
+  GraphFile file;
+  std::string what;
+  if(not file.open(binary_file_name,what))
+  {
+    CNR_ERROR(logger,what);
+    return false;
+  }
+
+  if(file.getHeader().kind != GraphFile::PATH)
+  {
+    CNR_ERROR(logger,"file "<<binary_file_name<<" does not contain a path");
+    return false;
+  }
+
+  std::ofstream out(yaml_file_name);
+  if(not out.is_open())
+  {
+    CNR_ERROR(logger,"Error opening file: "<<yaml_file_name);
+    return false;
+  }
+  out << file.toYAML();
+
+  return true;
+}
+
 void Path::flip()
 {
   std::reverse(connections_.begin(),connections_.end()); //must be before connections flip
@@ -0,0 +1,106 @@
+/*
+Copyright (c) 2024, Manuel Beschi and Cesare Tonola, JRL-CARI CNR-STIIMA/UNIBS, manuel.beschi@unibs.it, c.tonola001@unibs.it
+Manuel Beschi manuel.beschi@unibs.it
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of the <organization> nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL <COPYRIGHT HOLDER> BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <graph_core/graph/property_set.h>
+#include <mutex>
+#include <shared_mutex>
+#include <unordered_map>
+#include <stdexcept>
+
+namespace graph
+{
+namespace core
+{
+namespace
+{
+struct Registry
+{
+  std::shared_mutex mtx;
+  std::unordered_map<std::string,unsigned int> ids;
+  std::vector<std::string> names;
+};
+
+Registry& registry()
+{
+  static Registry registry;
+  return registry;
+}
+}
+
+unsigned int PropertyRegistry::intern(const std::string& name)
+{
+  unsigned int id;
+  if(find(name,id))
+    return id;
+
+  Registry& r = registry();
+  std::unique_lock<std::shared_mutex> lock(r.mtx);
+
+  // Registered by another thread in the meantime
+  auto it = r.ids.find(name);
+  if(it != r.ids.end())
+    return it->second;
+
+  id = r.names.size();
+  r.ids.emplace(name,id);
+  r.names.push_back(name);
+  return id;
+}
+
+bool PropertyRegistry::find(const std::string& name, unsigned int& id)
+{
+  Registry& r = registry();
+  std::shared_lock<std::shared_mutex> lock(r.mtx);
+
+  auto it = r.ids.find(name);
+  if(it == r.ids.end())
+    return false;
+
+  id = it->second;
+  return true;
+}
+
+std::string PropertyRegistry::name(const unsigned int& id)
+{
+  Registry& r = registry();
+  std::shared_lock<std::shared_mutex> lock(r.mtx);
+
+  if(id>=r.names.size())
+    throw std::out_of_range("property id "+std::to_string(id)+" is not registered");
+  return r.names[id];
+}
+
+size_t PropertyRegistry::size()
+{
+  Registry& r = registry();
+  std::shared_lock<std::shared_mutex> lock(r.mtx);
+  return r.names.size();
+}
+
+} //end namespace core
+} //end namespace graph
@@ -34,9 +34,12 @@ namespace core
 Subtree::Subtree(const TreePtr& parent_tree,
                  const NodePtr& root):
   Tree(root,parent_tree->getMaximumDistance(),
-       parent_tree->getChecker(),parent_tree->getMetrics(),parent_tree->getLogger(),parent_tree->getUseKdTree()),
+       parent_tree->getChecker(),parent_tree->getMetrics(),parent_tree->getLogger(),parent_tree->getNearestNeighborsType()),
   parent_tree_(parent_tree)
 {
+  setNearestNeighborsScale(parent_tree->getNearestNeighborsScale());
+  setNearestNeighborsEpsilon(parent_tree->getNearestNeighborsEpsilon());
+  setPool(parent_tree->getPool());
   populateTreeFromNode(root);
 }
 
@@ -44,9 +47,12 @@ Subtree::Subtree(const TreePtr& parent_tree,
                  const NodePtr& root,
                  const std::vector<NodePtr>& black_list):
   Tree(root,parent_tree->getMaximumDistance(),
-       parent_tree->getChecker(),parent_tree->getMetrics(),parent_tree->getLogger(),parent_tree->getUseKdTree()),
+       parent_tree->getChecker(),parent_tree->getMetrics(),parent_tree->getLogger(),parent_tree->getNearestNeighborsType()),
   parent_tree_(parent_tree)
 {
+  setNearestNeighborsScale(parent_tree->getNearestNeighborsScale());
+  setNearestNeighborsEpsilon(parent_tree->getNearestNeighborsEpsilon());
+  setPool(parent_tree->getPool());
   double cost = std::numeric_limits<double>::infinity();
   Eigen::VectorXd focus1,focus2;
   focus1 = root->getConfiguration();
@@ -61,9 +67,12 @@ Subtree::Subtree(const TreePtr& parent_tree,
                  const Eigen::VectorXd& focus2,
                  const double& cost):
   Tree(root,parent_tree->getMaximumDistance(),
-       parent_tree->getChecker(),parent_tree->getMetrics(),parent_tree->getLogger(),parent_tree->getUseKdTree()),
+       parent_tree->getChecker(),parent_tree->getMetrics(),parent_tree->getLogger(),parent_tree->getNearestNeighborsType()),
   parent_tree_(parent_tree)
 {
+  setNearestNeighborsScale(parent_tree->getNearestNeighborsScale());
+  setNearestNeighborsEpsilon(parent_tree->getNearestNeighborsEpsilon());
+  setPool(parent_tree->getPool());
   std::vector<NodePtr> black_list;
   populateSubtreeInsideEllipsoid(root,focus1,focus2,cost,black_list);
 }
@@ -76,9 +85,12 @@ Subtree::Subtree(const TreePtr& parent_tree,
                  const std::vector<NodePtr>& black_list,
                  const bool node_check):
   Tree(root,parent_tree->getMaximumDistance(),
-       parent_tree->getChecker(),parent_tree->getMetrics(),parent_tree->getLogger(),parent_tree->getUseKdTree()),
+       parent_tree->getChecker(),parent_tree->getMetrics(),parent_tree->getLogger(),parent_tree->getNearestNeighborsType()),
   parent_tree_(parent_tree)
 {
+  setNearestNeighborsScale(parent_tree->getNearestNeighborsScale());
+  setNearestNeighborsEpsilon(parent_tree->getNearestNeighborsEpsilon());
+  setPool(parent_tree->getPool());
   populateSubtreeInsideEllipsoid(root,focus1,focus2,cost,black_list,node_check);
 }
 
@@ -89,9 +101,12 @@ Subtree::Subtree(const TreePtr& parent_tree,
                  const std::vector<NodePtr>& black_list,
                  const bool node_check):
   Tree(root,parent_tree->getMaximumDistance(),
-       parent_tree->getChecker(),parent_tree->getMetrics(),parent_tree->getLogger(),parent_tree->getUseKdTree()),
+       parent_tree->getChecker(),parent_tree->getMetrics(),parent_tree->getLogger(),parent_tree->getNearestNeighborsType()),
   parent_tree_(parent_tree)
 {
+  setNearestNeighborsScale(parent_tree->getNearestNeighborsScale());
+  setNearestNeighborsEpsilon(parent_tree->getNearestNeighborsEpsilon());
+  setPool(parent_tree->getPool());
   populateTreeFromNodeConsideringCost(root,goal,cost,black_list,node_check);
 }
 
@@ -114,13 +129,18 @@ void Subtree::addNode(const NodePtr& node, const bool& check_if_present)
   parent_tree_->addNode(node,check_if_present);
 }
 
+void Subtree::addNodes(const std::vector<NodePtr>& nodes, const bool& check_if_present)
+{
+  Tree::addNodes(nodes,check_if_present);
+  parent_tree_->addNodes(nodes,check_if_present);
+}
+
 void Subtree::hideFromSubtree(const NodePtr& node)
 {
   assert(node);
   if(nodes_->findNode(node))
   {
-    std::vector<NodePtr> successors = node->getChildren();
-    for(NodePtr& n : successors)
+    for(const NodePtr& n : node->childrenView())
     {
       assert(n.get()!=node.get());
       hideFromSubtree(n);
@@ -136,7 +156,7 @@ void Subtree::hideInvalidBranches(const NodePtr& node)
   assert(node);
   if(nodes_->findNode(node))
   {
-    for(ConnectionPtr& c : node->getChildConnections())
+    for(const ConnectionPtr& c : node->childConnectionsView())
     {
       assert(c->getChild().get()!=node.get());
       if(c->getCost() == std::numeric_limits<double>::infinity())
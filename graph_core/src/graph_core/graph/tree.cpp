@@ -26,6 +26,8 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 */
 
 #include <graph_core/graph/tree.h>
+#include <atomic>
+#include <tuple>
 
 namespace graph
 {
@@ -37,20 +39,52 @@ Tree::Tree(const NodePtr& root,
            const MetricsPtr &metrics,
            const cnr_logger::TraceLoggerPtr& logger,
            const bool &use_kdtree):
+  Tree(root,max_distance,checker,metrics,logger,
+       use_kdtree? NearestNeighborsType::KdTree: NearestNeighborsType::Vector)
+{
+}
+
+Tree::Tree(const NodePtr& root,
+           const double &max_distance,
+           const CollisionCheckerPtr &checker,
+           const MetricsPtr &metrics,
+           const cnr_logger::TraceLoggerPtr& logger,
+           const NearestNeighborsType &nn_type):
   root_(root),
-  use_kdtree_(use_kdtree),
+  use_kdtree_(nn_type != NearestNeighborsType::Vector),
+  nn_type_(nn_type),
   max_distance_(max_distance),
   metrics_(metrics),
   logger_(logger),
   checker_(checker)
 {
-  if (use_kdtree)
+  if(nn_type_ == NearestNeighborsType::HashGrid && root->getConfiguration().size()>HashGrid::MAX_DIMENSION)
   {
-    nodes_=std::make_shared<KdTree>(logger_);
+    CNR_WARN(logger_,"the hash grid supports up to "<<HashGrid::MAX_DIMENSION<<" dimensions, the tree has "
+             <<root->getConfiguration().size()<<": an arena kd-tree is used instead");
+    nn_type_ = NearestNeighborsType::ArenaKdTree;
   }
-  else
+
+  switch(nn_type_)
   {
+  case NearestNeighborsType::Vector:
     nodes_=std::make_shared<Vector>(logger_);
+    break;
+  case NearestNeighborsType::KdTree:
+    nodes_=std::make_shared<KdTree>(logger_);
+    break;
+  case NearestNeighborsType::ArenaKdTree:
+    nodes_=std::make_shared<ArenaKdTree>(logger_);
+    break;
+  case NearestNeighborsType::BucketKdTree:
+    nodes_=std::make_shared<BucketKdTree>(logger_);
+    break;
+  case NearestNeighborsType::VpTree:
+    nodes_=std::make_shared<VpTree>(metrics_,logger_);
+    break;
+  case NearestNeighborsType::HashGrid:
+    nodes_=std::make_shared<HashGrid>(max_distance_,logger_);
+    break;
   }
   nodes_->insert(root);
   double dimension=root->getConfiguration().size();
@@ -62,6 +96,13 @@ NodePtr Tree::findClosestNode(const Eigen::VectorXd &configuration)
   return nodes_->nearestNeighbor(configuration);
 }
 
+void Tree::findClosestNodes(const std::vector<Eigen::VectorXd>& configurations,
+                            std::vector<std::pair<double,Node*>>& nodes,
+                            const unsigned int& n_threads)
+{
+  nodes_->nearestNeighbors(configurations,nodes,n_threads,rewire_pool_);
+}
+
 bool Tree::tryExtend(const Eigen::VectorXd &configuration,
                      Eigen::VectorXd &next_configuration,
                      NodePtr &closest_node)
@@ -147,7 +188,7 @@ double Tree::selectNextConfiguration(const Eigen::VectorXd& configuration,
 bool Tree::extendOnly(NodePtr& closest_node, NodePtr &new_node, ConnectionPtr &connection)
 {
   double cost = metrics_->cost(closest_node, new_node);
-  connection = std::make_shared<Connection>(closest_node, new_node,logger_);
+  connection = createConnection(closest_node, new_node);
   connection->add();
   connection->setCost(cost);
 
@@ -175,7 +216,7 @@ bool Tree::extend(const Eigen::VectorXd &configuration, NodePtr &new_node, Conne
     return false;
   }
 
-  new_node = std::make_shared<Node>(next_configuration,logger_);
+  new_node = createNode(next_configuration);
   return extendOnly(closest_node,new_node,connection);
 }
 
@@ -199,7 +240,7 @@ bool Tree::extendWithPathCheck(const Eigen::VectorXd &configuration, NodePtr &ne
     return false;
   }
 
-  new_node = std::make_shared<Node>(next_configuration, logger_);
+  new_node = createNode(next_configuration);
   if(not extendOnly(closest_node,new_node,connection))
     return false;
 
@@ -231,12 +272,12 @@ bool Tree::extendToNode(const NodePtr& node,
   }
   else
   {
-    new_node = std::make_shared<Node>(next_configuration,logger_);
+    new_node = createNode(next_configuration);
     addNode(new_node,false);
   }
 
   double cost = metrics_->cost(closest_node, new_node);
-  ConnectionPtr conn = std::make_shared<Connection>(closest_node, new_node,logger_);
+  ConnectionPtr conn = createConnection(closest_node, new_node);
   conn->add();
   conn->setCost(cost);
 
@@ -270,8 +311,8 @@ bool Tree::informedExtend(const Eigen::VectorXd &configuration, NodePtr &new_nod
     double distance;
   };
 
-  std::multimap<double,NodePtr> closest_nodes_map = nearK(configuration);
-  if(closest_nodes_map.size()==0)
+  nearK(configuration,near_nodes_);
+  if(near_nodes_.size()==0)
   {
     CNR_FATAL(logger_,"closest nodes map is empty");
     throw std::runtime_error("closest nodes map is empty");
@@ -281,14 +322,15 @@ bool Tree::informedExtend(const Eigen::VectorXd &configuration, NodePtr &new_nod
   Eigen::VectorXd new_configuration;
   std::multimap<double,extension> best_nodes_map;
 
-  for(const std::pair<const double,NodePtr>& n: closest_nodes_map)
+  for(const std::pair<double,Node*>& n: near_nodes_)
   {
-    distance = selectNextConfiguration(configuration,new_configuration,n.second);
-    cost2node = costToNode(n.second);
+    NodePtr tree_node = n.second->pointer();
+    distance = selectNextConfiguration(configuration,new_configuration,tree_node);
+    cost2node = costToNode(tree_node);
     heuristic = bias*distance+(1-bias)*cost2node;
 
     extension ext;
-    ext.tree_node = n.second;
+    ext.tree_node = tree_node;
     ext.new_conf = new_configuration;
     ext.distance = distance;
 
@@ -319,7 +361,7 @@ bool Tree::informedExtend(const Eigen::VectorXd &configuration, NodePtr &new_nod
   if(extend_ok)
   {
     ConnectionPtr connection;
-    new_node = std::make_shared<Node>(ext.new_conf,logger_);
+    new_node = createNode(ext.new_conf);
     return extendOnly(ext.tree_node,new_node,connection);
   }
   else
@@ -439,27 +481,28 @@ bool Tree::rewireOnly(NodePtr& node, double r_rewire, const std::vector<NodePtr>
       rewire_parent = false;
   }
 
-  std::multimap<double,NodePtr> near_nodes;
   if(r_rewire<=0)
-    near_nodes = nearK(node);
+    nearK(node,near_nodes_);
   else
-    near_nodes = near(node, r_rewire);
+    near(node,r_rewire,near_nodes_);
+
+  if(rewire_threads_ != 1)
+    return rewireOnlyParallel(node,white_list,rewire_parent,rewire_children);
 
   double cost_to_node = costToNode(node);
   bool improved = false;
 
   if(rewire_parent)
   {
-    NodePtr nearest_node = node->getParents()[0];
-    for(const std::pair<const double,NodePtr>& p : near_nodes)
+    NodePtr nearest_node = node->parentConnectionsView().front()->getParent();
+    for(const std::pair<double,Node*>& p : near_nodes_)
     {
-      const NodePtr& n = p.second;
-
-      if (n == nearest_node)
+      if (p.second == nearest_node.get())
         continue;
-      if (n == node)
+      if (p.second == node.get())
         continue;
 
+      NodePtr n = p.second->pointer();
       double cost_to_near = costToNode(n);
 
       if (cost_to_near >= cost_to_node)
@@ -476,7 +519,7 @@ bool Tree::rewireOnly(NodePtr& node, double r_rewire, const std::vector<NodePtr>
       assert(node->parentConnection(0)->isValid());
       node->parentConnection(0)->remove();
 
-      ConnectionPtr conn = std::make_shared<Connection>(n, node,logger_);
+      ConnectionPtr conn = createConnection(n, node);
       conn->setCost(cost_near_to_node);
       conn->add();
 
@@ -489,21 +532,20 @@ bool Tree::rewireOnly(NodePtr& node, double r_rewire, const std::vector<NodePtr>
   if(node == root_)
     parent = nullptr;
   else
-   parent = node->getParents()[0];
+   parent = node->parentConnectionsView().front()->getParent();
 
   if(rewire_children)
   {
-    for (const std::pair<const double,NodePtr>& p : near_nodes)
+    for (const std::pair<double,Node*>& p : near_nodes_)
     {
-      const NodePtr& n = p.second;
-
-      if(n == parent)
+      if(p.second == parent.get())
         continue;
-      if(n == node)
+      if(p.second == node.get())
         continue;
-      if(n == root_)
+      if(p.second == root_.get())
         continue;
 
+      NodePtr n = p.second->pointer();
       it = std::find(white_list.begin(),white_list.end(),n); //if the near node is a white node its parent should not be changed
       if(it<white_list.end())
         continue;
@@ -522,7 +564,7 @@ bool Tree::rewireOnly(NodePtr& node, double r_rewire, const std::vector<NodePtr>
       assert(n->parentConnection(0)->isValid());
       n->parentConnection(0)->remove();
 
-      ConnectionPtr conn = std::make_shared<Connection>(node, n,logger_);
+      ConnectionPtr conn = createConnection(node, n);
       conn->setCost(cost_node_to_near);
       conn->add();
 
@@ -533,6 +575,152 @@ bool Tree::rewireOnly(NodePtr& node, double r_rewire, const std::vector<NodePtr>
   return improved;
 }
 
+size_t Tree::checkRewireCandidates(const NodePtr& node, const std::vector<Node*>& candidates, const bool& from_node, const bool& first_only, std::vector<uint8_t>& free)
+{
+  free.assign(candidates.size(),0);
+
+  if(not rewire_pool_)
+    rewire_pool_ = std::make_shared<WorkerPool>(rewire_threads_);
+
+  size_t n_threads = (candidates.size()<MIN_PARALLEL_REWIRE_CANDIDATES)? 1: std::min<size_t>(rewire_pool_->size(),candidates.size());
+
+  while(rewire_checkers_.size()+1<n_threads)
+    rewire_checkers_.push_back(checker_->clone());
+
+  std::atomic<size_t> first(candidates.size());
+  auto body = [&](const size_t& t){
+    const CollisionCheckerPtr& checker = (t == 0)? checker_: rewire_checkers_[t-1];
+    for(size_t i=t;i<candidates.size();i+=n_threads)
+    {
+      // Candidates are checked in increasing order, so all the ones before first have been checked
+      if(first_only && i>first.load())
+        break;
+
+      const Eigen::VectorXd& q_node = node->getConfiguration();
+      const Eigen::VectorXd& q_candidate = candidates[i]->getConfiguration();
+      if(from_node? checker->checkConnection(q_node,q_candidate): checker->checkConnection(q_candidate,q_node))
+      {
+        free[i] = 1;
+
+        size_t current = first.load();
+        while(i<current && not first.compare_exchange_weak(current,i))
+          ;
+      }
+    }
+  };
+
+  rewire_pool_->run(n_threads,body);
+
+  return first.load();
+}
+
+bool Tree::rewireOnlyParallel(NodePtr& node, const std::vector<NodePtr>& white_list, const bool& rewire_parent, const bool& rewire_children)
+{
+  double cost_to_node = costToNode(node);
+  bool improved = false;
+
+  std::vector<Node*> candidates;
+  std::vector<uint8_t> free;
+
+  if(rewire_parent)
+  {
+    // The serial loop ends up with the collision-free candidate of lowest cost, the first in near_nodes_ order in case of ties.
+    // The candidates are sorted accordingly and only the first collision-free one is needed.
+    Node* nearest_node = node->parentConnectionsView().front()->getParent().get();
+    std::vector<std::tuple<double,size_t,double>> costs; // cost to node through the candidate, index in near_nodes_, cost from the candidate to node
+    for(size_t i=0;i<near_nodes_.size();i++)
+    {
+      Node* n = near_nodes_[i].second;
+      if (n == nearest_node || n == node.get())
+        continue;
+
+      double cost_to_near = costToNode(n->pointer());
+      if (cost_to_near >= cost_to_node)
+        continue;
+
+      double cost_near_to_node = metrics_->cost(n->pointer(), node);
+      if ((cost_to_near + cost_near_to_node) >= cost_to_node)
+        continue;
+
+      costs.emplace_back(cost_to_near + cost_near_to_node,i,cost_near_to_node);
+    }
+    std::sort(costs.begin(),costs.end());
+
+    candidates.clear();
+    for(const std::tuple<double,size_t,double>& c: costs)
+      candidates.push_back(near_nodes_[std::get<1>(c)].second);
+
+    size_t first = checkRewireCandidates(node,candidates,false,true,free);
+    if(first<candidates.size())
+    {
+      assert(node->parentConnection(0)->isValid());
+      node->parentConnection(0)->remove();
+
+      ConnectionPtr conn = createConnection(candidates[first]->pointer(), node);
+      conn->setCost(std::get<2>(costs[first]));
+      conn->add();
+
+      cost_to_node = std::get<0>(costs[first]);
+      improved = true;
+    }
+  }
+
+  if(rewire_children)
+  {
+    Node* parent = (node == root_)? nullptr: node->parentConnectionsView().front()->getParent().get();
+
+    // Rewiring a child only lowers the costs to reach the nodes, so a candidate discarded now would be discarded by the serial loop as well
+    std::vector<double> costs_node_to_near;
+    candidates.clear();
+    for (const std::pair<double,Node*>& p : near_nodes_)
+    {
+      Node* n = p.second;
+      if(n == parent || n == node.get() || n == root_.get())
+        continue;
+
+      NodePtr n_ptr = n->pointer();
+      if(std::find(white_list.begin(),white_list.end(),n_ptr)<white_list.end()) //if the near node is a white node its parent should not be changed
+        continue;
+
+      double cost_to_near = costToNode(n_ptr);
+      if (cost_to_node >= cost_to_near)
+        continue;
+
+      double cost_node_to_near = metrics_->cost(node->getConfiguration(), n->getConfiguration());
+      if ((cost_to_node + cost_node_to_near) >= cost_to_near)
+        continue;
+
+      candidates.push_back(n);
+      costs_node_to_near.push_back(cost_node_to_near);
+    }
+
+    checkRewireCandidates(node,candidates,true,false,free);
+
+    // Same order and conditions of the serial loop, the costs are evaluated again because previous rewires may have lowered them
+    for(size_t i=0;i<candidates.size();i++)
+    {
+      if(not free[i])
+        continue;
+
+      NodePtr n = candidates[i]->pointer();
+      double cost_to_near = costToNode(n);
+      if (cost_to_node >= cost_to_near || (cost_to_node + costs_node_to_near[i]) >= cost_to_near)
+        continue;
+
+      assert(n->parentConnection(0)->isValid());
+      n->parentConnection(0)->remove();
+
+      ConnectionPtr conn = createConnection(node, n);
+      conn->setCost(costs_node_to_near[i]);
+      conn->add();
+
+      improved = true;
+    }
+  }
+
+  return improved;
+}
+
 bool Tree::rewireOnlyWithPathCheck(NodePtr& node, std::vector<ConnectionPtr> &checked_connections, double r_rewire, const int& what_rewire)
 {
   std::vector<NodePtr> white_list;
@@ -594,7 +782,7 @@ bool Tree::rewireOnlyWithPathCheck(NodePtr& node, std::vector<ConnectionPtr>& ch
 
   if(rewire_parent)
   {
-    NodePtr nearest_node = node->getParents()[0];
+    NodePtr nearest_node = node->parentConnectionsView().front()->getParent();
     for (const std::pair<const double,NodePtr>& p : near_nodes)
     {
       const NodePtr& n = p.second;
@@ -622,7 +810,7 @@ bool Tree::rewireOnlyWithPathCheck(NodePtr& node, std::vector<ConnectionPtr>& ch
       assert(node->parentConnection(0)->isValid());
       node->parentConnection(0)->remove();
 
-      ConnectionPtr conn = std::make_shared<Connection>(n, node,logger_);
+      ConnectionPtr conn = createConnection(n, node);
       conn->setCost(cost_near_to_node);
       conn->add();
 
@@ -641,7 +829,7 @@ bool Tree::rewireOnlyWithPathCheck(NodePtr& node, std::vector<ConnectionPtr>& ch
   if(node == root_)
     parent = nullptr;
   else
-   parent = node->getParents()[0];
+   parent = node->parentConnectionsView().front()->getParent();
 
   if(rewire_children)
   {
@@ -688,7 +876,7 @@ bool Tree::rewireOnlyWithPathCheck(NodePtr& node, std::vector<ConnectionPtr>& ch
 
       n->parentConnection(0)->remove();
 
-      ConnectionPtr conn = std::make_shared<Connection>(node, n,logger_);
+      ConnectionPtr conn = createConnection(node, n);
       conn->setCost(cost_node_to_near);
       conn->add();
 
@@ -777,7 +965,50 @@ std::multimap<double,NodePtr> Tree::nearK(const Eigen::VectorXd &conf)
   return nodes_->kNearestNeighbors(conf,k);
 }
 
+void Tree::near(const NodePtr &node, const double &radius, std::vector<std::pair<double,Node*>>& nodes)
+{
+  nodes_->near(node->getConfiguration(),radius,nodes);
+}
+
+void Tree::nearK(const NodePtr &node, std::vector<std::pair<double,Node*>>& nodes)
+{
+  nearK(node->getConfiguration(),nodes);
+}
+
+void Tree::nearK(const Eigen::VectorXd &conf, std::vector<std::pair<double,Node*>>& nodes)
+{
+  size_t k=std::ceil(k_rrt_*std::log(nodes_->size()+1));
+  nodes_->kNearestNeighbors(conf,k,nodes);
+}
+
+size_t Tree::nearK(const std::vector<Eigen::VectorXd>& confs,
+                   std::vector<std::pair<double,Node*>>& nodes,
+                   const unsigned int& n_threads)
+{
+  size_t k=std::ceil(k_rrt_*std::log(nodes_->size()+1));
+  nodes_->kNearestNeighbors(confs,k,nodes,n_threads,rewire_pool_);
+  return k;
+}
+
 double Tree::costToNode(NodePtr node)
+{
+  if(root_->getParentConnectionsSize() == 0)
+  {
+    // root_ is the root of the whole tree: use the cost to come cached in the node
+    Node* root;
+    double cost = node->getCostToCome(root);
+    if(root != root_.get())
+    {
+      CNR_ERROR(logger_,"a tree node should have exactly a parent!\n "<<*node);
+      return std::numeric_limits<double>::infinity();
+    }
+    return cost;
+  }
+
+  return costToNodeWithoutCache(node);
+}
+
+double Tree::costToNodeWithoutCache(NodePtr node) const
 {
   double cost = 0;
   while (node != root_)
@@ -831,6 +1062,36 @@ void Tree::addNode(const NodePtr& node, const bool& check_if_present)
     nodes_->insert(node);
 }
 
+void Tree::addNodes(const std::vector<NodePtr>& nodes, const bool& check_if_present)
+{
+  if(not check_if_present)
+    return insertNodes(nodes);
+
+  std::vector<NodePtr> new_nodes;
+  new_nodes.reserve(nodes.size());
+  for(const NodePtr& n:nodes)
+  {
+    if(not isInTree(n))
+      new_nodes.push_back(n);
+  }
+  insertNodes(new_nodes);
+}
+
+void Tree::insertNodes(const std::vector<NodePtr>& nodes)
+{
+  if(nodes.size()<nodes_->size())
+  {
+    for(const NodePtr& n:nodes)
+      nodes_->insert(n);
+  }
+  else
+  {
+    std::vector<NodePtr> all_nodes = nodes_->getNodes(); //the root is the first element
+    all_nodes.insert(all_nodes.end(),nodes.begin(),nodes.end());
+    nodes_->build(all_nodes);
+  }
+}
+
 void Tree::removeNode(const NodePtr& node)
 {
   node->disconnect();
@@ -856,9 +1117,7 @@ bool Tree::keepOnlyThisBranch(const std::vector<ConnectionPtr>& connections)
   }
 
   nodes_->disconnectNodes(branch_nodes);
-  nodes_->clear();
-  for (const NodePtr& n : branch_nodes)
-    nodes_->insert(n);
+  nodes_->build(branch_nodes);
 
   assert(nodes_->size() == branch_nodes.size());
 
@@ -899,10 +1158,10 @@ bool Tree::addTree(TreePtr &additional_tree, const double &max_time)
   }
 
   std::vector<NodePtr> additional_nodes=additional_tree->getNodes();
-  for (size_t inode=1;inode<additional_nodes.size();inode++)
-  {
-    addNode(additional_nodes.at(inode),false);
-  }
+  if(not additional_nodes.empty())
+    additional_nodes.erase(additional_nodes.begin()); //the root
+
+  addNodes(additional_nodes,false);
   return true;
 }
 
@@ -919,7 +1178,9 @@ unsigned int Tree::purgeNodesOutsideEllipsoid(const SamplerPtr& sampler, const s
     return 0;
   unsigned int removed_nodes = 0;
 
-  purgeNodeOutsideEllipsoid(root_,sampler,white_list,removed_nodes);
+  markListedNodes(white_list,true);
+  purgeNodeOutsideEllipsoid(root_,sampler,removed_nodes);
+  markListedNodes(white_list,false);
   return removed_nodes;
 }
 
@@ -929,13 +1190,14 @@ unsigned int Tree::purgeNodesOutsideEllipsoids(const std::vector<SamplerPtr>& sa
     return 0;
   unsigned int removed_nodes = 0;
 
-  purgeNodeOutsideEllipsoids(root_,samplers,white_list,removed_nodes);
+  markListedNodes(white_list,true);
+  purgeNodeOutsideEllipsoids(root_,samplers,removed_nodes);
+  markListedNodes(white_list,false);
   return removed_nodes;
 }
 
 void Tree::purgeNodeOutsideEllipsoid(NodePtr& node,
                                      const SamplerPtr& sampler,
-                                     const std::vector<NodePtr>& white_list,
                                      unsigned int& removed_nodes)
 {
   assert(node);
@@ -943,29 +1205,27 @@ void Tree::purgeNodeOutsideEllipsoid(NodePtr& node,
   // check if it is in the admissible informed set
   if(sampler->inBounds(node->getConfiguration()))
   {
-    // if node is inside the admissible set, check its successors
-    std::vector<NodePtr> successors;
-    successors = node->getChildren();
-
-    for(NodePtr& n : successors)
+    // if node is inside the admissible set, check its successors.
+    // Iterate backward because a purged successor is removed from the child connections of node
+    for(size_t i=node->getChildConnectionsSize(); i-->0;)
     {
+      NodePtr n = node->childConnectionsView()[i]->getChild();
       assert(n.get()!=node.get());
-      purgeNodeOutsideEllipsoid(n,sampler,white_list,removed_nodes);
+      purgeNodeOutsideEllipsoid(n,sampler,removed_nodes);
     }
   }
   else
   {
     // if node is outside the admissible set, remove it and its successors if they are not in the white list.
-    if (std::find(white_list.begin(), white_list.end(), node) != white_list.end())
+    if (listed_nodes_.get(node))
       return;
-    purgeFromHere(node, white_list, removed_nodes);
+    purgeUnlistedFromHere(node, removed_nodes);
   }
   return;
 }
 
 void Tree::purgeNodeOutsideEllipsoids(NodePtr& node,
                                       const std::vector<SamplerPtr>& samplers,
-                                      const std::vector<NodePtr>& white_list,
                                       unsigned int& removed_nodes)
 {
   if (nodes_->size() < 0.5*maximum_nodes_)
@@ -973,25 +1233,24 @@ void Tree::purgeNodeOutsideEllipsoids(NodePtr& node,
   assert(node);
 
   // check if it belongs to a admissible informed set or the white list
-  bool inbound=std::find(white_list.begin(), white_list.end(), node) != white_list.end();
+  bool inbound=listed_nodes_.get(node);
   for (const SamplerPtr& sampler: samplers)
     inbound = inbound || sampler->inBounds(node->getConfiguration());
 
   if (inbound)
   {
-    // if node is inside the admissible set, check its successors
-    std::vector<NodePtr> successors;
-    successors = node->getChildren();
-
-    for (NodePtr& n : successors)
+    // if node is inside the admissible set, check its successors.
+    // Iterate backward because a purged successor is removed from the child connections of node
+    for(size_t i=node->getChildConnectionsSize(); i-->0;)
     {
+      NodePtr n = node->childConnectionsView()[i]->getChild();
       assert(n.get()!=node.get());
-      purgeNodeOutsideEllipsoids(n,samplers,white_list,removed_nodes);
+      purgeNodeOutsideEllipsoids(n,samplers,removed_nodes);
     }
   }
   else
   {
-    purgeFromHere(node, white_list, removed_nodes);
+    purgeUnlistedFromHere(node, removed_nodes);
   }
   return;
 }
@@ -1005,16 +1264,17 @@ unsigned int Tree::purgeNodes(const SamplerPtr& sampler, const std::vector<NodeP
   unsigned int removed_nodes = 0;
   unsigned int idx = 0;
   std::vector<NodePtr> nodes = nodes_->getNodes();
+  markListedNodes(white_list,true);
   while (idx < nodes_->size())
   {
-    if (std::find(white_list.begin(), white_list.end(), nodes.at(idx)) != white_list.end())
+    if (listed_nodes_.get(nodes.at(idx)))
     {
       idx++;
       continue;
     }
     if(check_bounds && !sampler->inBounds(nodes.at(idx)->getConfiguration()))
     {
-      purgeFromHere(nodes.at(idx), white_list, removed_nodes);
+      purgeUnlistedFromHere(nodes.at(idx), removed_nodes);
       continue;
     }
 
@@ -1030,6 +1290,7 @@ unsigned int Tree::purgeNodes(const SamplerPtr& sampler, const std::vector<NodeP
 
     idx++;
   }
+  markListedNodes(white_list,false);
   return removed_nodes;
 }
 
@@ -1043,21 +1304,29 @@ bool Tree::purgeFromHere(NodePtr& node)
 
 bool Tree::purgeFromHere(NodePtr& node, const std::vector<NodePtr>& white_list, unsigned int& removed_nodes)
 {
-  if (std::find(white_list.begin(), white_list.end(), node) != white_list.end())
+  markListedNodes(white_list,true);
+  bool disconnect = purgeUnlistedFromHere(node,removed_nodes);
+  markListedNodes(white_list,false);
+
+  return disconnect;
+}
+
+bool Tree::purgeUnlistedFromHere(NodePtr& node, unsigned int& removed_nodes)
+{
+  if (listed_nodes_.get(node))
   {
     CNR_INFO(logger_,"Node in white list: "<<*node);
     return false;
   }
   assert(node);
-  std::vector<NodePtr> successors;
-
-  successors = node->getChildren();
 
+  // Iterate backward because a purged successor is removed from the child connections of node
   bool disconnect = true;
-  for (NodePtr& n : successors)
+  for(size_t i=node->getChildConnectionsSize(); i-->0;)
   {
+    NodePtr n = node->childConnectionsView()[i]->getChild();
     assert(n.get()!=node.get());
-    if (!purgeFromHere(n,white_list,removed_nodes))
+    if (!purgeUnlistedFromHere(n,removed_nodes))
       disconnect = false;
   }
 
@@ -1079,14 +1348,12 @@ void Tree::purgeThisNode(NodePtr& node, unsigned int& removed_nodes)
 
 void Tree::cleanTree()
 {
-  std::vector<NodePtr> successors;
-  std::vector<NodePtr> white_list;
   unsigned int removed_nodes;
-  successors=root_->getChildren();
-  for (NodePtr& n: successors)
+  for(size_t i=root_->getChildConnectionsSize(); i-->0;)
   {
+    NodePtr n = root_->childConnectionsView()[i]->getChild();
     if (isInTree(n))
-      purgeFromHere(n,white_list,removed_nodes);
+      purgeUnlistedFromHere(n,removed_nodes);
   }
 }
 
@@ -1118,10 +1385,18 @@ void Tree::populateTreeFromNode(const NodePtr& node, const Eigen::VectorXd& focu
     throw std::invalid_argument("node is not member of tree");
   }
 
-  for (const NodePtr& n: node->getChildren())
+  std::vector<NodePtr> nodes;
+  markListedNodes(black_list,true);
+  collectNodesInsideEllipsoid(node,focus1,focus2,cost,node_check,nodes);
+  markListedNodes(black_list,false);
+  insertNodes(nodes);
+}
+
+void Tree::collectNodesInsideEllipsoid(const NodePtr& node, const Eigen::VectorXd& focus1, const Eigen::VectorXd& focus2, const double& cost, const bool node_check, std::vector<NodePtr>& nodes)
+{
+  for (const NodePtr& n: node->childrenView())
   {
-    std::vector<NodePtr>::const_iterator it = std::find(black_list.begin(), black_list.end(), n);
-    if(it != black_list.end())
+    if(listed_nodes_.get(n))
     {
       continue;
     }
@@ -1137,8 +1412,8 @@ void Tree::populateTreeFromNode(const NodePtr& node, const Eigen::VectorXd& focu
             continue;
           }
         }
-        nodes_->insert(n);
-        populateTreeFromNode(n,focus1,focus2,cost,black_list);
+        nodes.push_back(n);
+        collectNodesInsideEllipsoid(n,focus1,focus2,cost,node_check,nodes);
       }
     }
   }
@@ -1156,6 +1431,15 @@ void Tree::populateTreeFromNodeConsideringCost(const NodePtr& node, const Eigen:
   for(const ConnectionPtr& conn:getConnectionToNode(node))
     cost_to_node += conn->getCost();
 
+  std::vector<NodePtr> nodes;
+  markListedNodes(black_list,true);
+  collectNodesConsideringCost(node,cost_to_node,goal,cost,node_check,nodes);
+  markListedNodes(black_list,false);
+  insertNodes(nodes);
+}
+
+void Tree::collectNodesConsideringCost(const NodePtr& node, const double& cost_to_node, const Eigen::VectorXd& goal, const double& cost, const bool node_check, std::vector<NodePtr>& nodes)
+{
   NodePtr child;
   ConnectionPtr conn;
   double cost_to_child;
@@ -1164,8 +1448,7 @@ void Tree::populateTreeFromNodeConsideringCost(const NodePtr& node, const Eigen:
     conn = node->childConnection(i);
     child = conn->getChild();
 
-    std::vector<NodePtr>::const_iterator it = std::find(black_list.begin(), black_list.end(), child);
-    if(it != black_list.end())
+    if(listed_nodes_.get(child))
     {
       continue;
     }
@@ -1180,8 +1463,8 @@ void Tree::populateTreeFromNodeConsideringCost(const NodePtr& node, const Eigen:
           if(not checker_->check(child->getConfiguration()))
             continue;
         }
-        nodes_->insert(child);
-        populateTreeFromNodeConsideringCost(child,goal,cost,black_list,node_check);
+        nodes.push_back(child);
+        collectNodesConsideringCost(child,cost_to_child,goal,cost,node_check,nodes);
       }
     }
   }
@@ -1198,6 +1481,11 @@ void Tree::getLeaves(std::vector<NodePtr>& leaves)
   });
 }
 
+FrozenTreePtr Tree::freeze() const
+{
+  return FrozenTreePtr(new FrozenTree(root_,[this](const NodePtr& n){return nodes_->findNode(n);},nodes_->getScale()));
+}
+
 YAML::Node Tree::toYAML() const
 {
   YAML::Node tree;
@@ -1205,33 +1493,43 @@ YAML::Node Tree::toYAML() const
   YAML::Node connections;
 
   std::vector<NodePtr> nodes_vector = nodes_->getNodes();
+
+  // Index of each node in nodes_vector, -1 for the nodes not in the tree
+  NodeSideTable<int> indices(-1);
+  indices.reserve();
+  for (std::size_t inode = 0; inode < nodes_vector.size(); ++inode)
+    indices[nodes_vector[inode]] = static_cast<int>(inode);
+
   for (std::size_t inode = 0; inode < nodes_vector.size(); ++inode)
   {
     const NodePtr& n = nodes_vector.at(inode);
     nodes.push_back(n->toYAML());
 
-    std::vector<NodePtr> children = n->getChildren();
-
-    for (std::size_t ichild = 0; ichild < children.size(); ++ichild)
+    for (const NodePtr& child: n->childrenView())
     {
-      for (std::size_t inodes = 0; inodes < nodes_vector.size(); ++inodes)
+      int ichild = indices.get(child);
+      if (ichild>=0)
       {
-        if (nodes_vector.at(inodes) == children.at(ichild))
-        {
-          YAML::Node connection;
-          connection.SetStyle(YAML::EmitterStyle::Flow); // Set the style to flow style for a more compact representation
+        YAML::Node connection;
+        connection.SetStyle(YAML::EmitterStyle::Flow); // Set the style to flow style for a more compact representation
 
-          connection.push_back(static_cast<int>(inode));
-          connection.push_back(static_cast<int>(inodes));
-          connections.push_back(connection);
-          break;
-        }
+        connection.push_back(static_cast<int>(inode));
+        connection.push_back(ichild);
+        connections.push_back(connection);
       }
     }
   }
 
   tree["max_distance"] = max_distance_;
   tree["use_kdtree"] = use_kdtree_;
+  tree["nearest_neighbors"] = toString(nn_type_);
+  if(nodes_->getScale().size()>0)
+  {
+    const Eigen::VectorXd& scale = nodes_->getScale();
+    tree["nearest_neighbors_scale"] = std::vector<double>(scale.data(),scale.data()+scale.size());
+  }
+  if(nodes_->getEpsilon()>0.0)
+    tree["nearest_neighbors_epsilon"] = nodes_->getEpsilon();
   tree["nodes"] = nodes;
   tree["connections"] = connections;
 
@@ -1264,7 +1562,7 @@ std::ostream& operator<<(std::ostream& os, const Tree& tree)
 
     std::function<void(const NodePtr&)> fcn;
     fcn = [&](const NodePtr& n) ->void{
-      for(const ConnectionPtr& c:n->getChildConnections())
+      for(const ConnectionPtr& c:n->childConnectionsView())
       {
         os<<"\n"<<c<<" "<<c->getParent()->getConfiguration().transpose()<<" ("<<c->getParent()<<") --> "<<
             c->getChild()->getConfiguration().transpose()<<" ("<<c->getChild()<<")";
@@ -1303,6 +1601,13 @@ TreePtr Tree::fromYAML(const YAML::Node& yaml,
   else
     use_kdtree = yaml["use_kdtree"].as<bool>();
 
+  NearestNeighborsType nn_type = use_kdtree? NearestNeighborsType::KdTree: NearestNeighborsType::Vector;
+  if (yaml["nearest_neighbors"])
+  {
+    if (!fromString(yaml["nearest_neighbors"].as<std::string>(), nn_type))
+      CNR_WARN(logger, "Unknown 'nearest_neighbors' field in YAML, "<<toString(nn_type)<<" is used");
+  }
+
   double max_distance = -1.0;
   bool compute_max_distance = false;
   if (!yaml["max_distance"])
@@ -1387,16 +1692,164 @@ TreePtr Tree::fromYAML(const YAML::Node& yaml,
     }
   }
 
-  TreePtr tree = std::make_shared<Tree>(root, max_distance, checker, metrics, logger, use_kdtree);
+  TreePtr tree = std::make_shared<Tree>(root, max_distance, checker, metrics, logger, nn_type);
+
+  if (yaml["nearest_neighbors_scale"])
+  {
+    std::vector<double> scale = yaml["nearest_neighbors_scale"].as<std::vector<double>>();
+    tree->setNearestNeighborsScale(Eigen::Map<Eigen::VectorXd>(scale.data(),scale.size()));
+  }
+  if (yaml["nearest_neighbors_epsilon"])
+    tree->setNearestNeighborsEpsilon(yaml["nearest_neighbors_epsilon"].as<double>());
 
-  for (size_t inode = 1; inode < nodes_vector.size(); inode++)
+  std::vector<NodePtr> other_nodes;
+  other_nodes.reserve(nodes_vector.size());
+  for(const NodePtr& n: nodes_vector)
   {
-    tree->addNode(nodes_vector[inode], false);
+    if(n != root)
+      other_nodes.push_back(n);
   }
+  tree->addNodes(other_nodes, false);
 
   return tree;
 }
 
+bool Tree::toBinary(const std::string& file_name) const
+{
+  GraphFile::Buffer buffer(GraphFile::TREE,root_->getConfiguration().size(),nodes_->size());
+  buffer.header.nearest_neighbors = static_cast<uint32_t>(nn_type_);
+  buffer.header.max_distance = max_distance_;
+  buffer.header.nearest_neighbors_epsilon = nodes_->getEpsilon();
+
+  const Eigen::VectorXd& scale = nodes_->getScale();
+  buffer.scale.assign(scale.data(),scale.data()+scale.size());
+
+  // Breadth-first visit, so that every node is written after its parent
+  std::vector<Node*> queue;
+  queue.reserve(nodes_->size());
+  queue.push_back(root_.get());
+  buffer.addNode(root_,GraphFile::NO_PARENT,nullptr);
+  for(size_t i=0; i<queue.size(); i++)
+  {
+    for(const ConnectionPtr& conn: queue[i]->childConnectionsView())
+    {
+      const NodePtr& child = conn->getChild();
+      if(not nodes_->findNode(child))
+        continue;
+
+      buffer.addNode(child,i,conn);
+      queue.push_back(child.get());
+    }
+  }
+
+  std::string what;
+  if(not buffer.write(file_name,what))
+  {
+    CNR_ERROR(logger_,what);
+    return false;
+  }
+  return true;
+}
+
+TreePtr Tree::fromBinary(const std::string& file_name,
+                         const MetricsPtr& metrics,
+                         const CollisionCheckerPtr& checker,
+                         const cnr_logger::TraceLoggerPtr& logger)
+{
+  GraphFile file;
+  std::string what;
+  if(not file.open(file_name,what))
+  {
+    CNR_ERROR(logger,what);
+    return nullptr;
+  }
+
+  const GraphFileHeader& header = file.getHeader();
+  if(header.kind != GraphFile::TREE || file.size() == 0)
+  {
+    CNR_ERROR(logger,"file "<<file_name<<" does not contain a tree");
+    return nullptr;
+  }
+
+  // GraphFile::open rejects unknown types
+  NearestNeighborsType nn_type = static_cast<NearestNeighborsType>(header.nearest_neighbors);
+
+  std::vector<NodePtr> nodes(file.size());
+  nodes[0] = std::make_shared<Node>(file.getConfiguration(0),logger);
+  file.restoreFlags(0,nodes[0],nullptr);
+
+  ConnectionPtr conn;
+  for(size_t i=1; i<file.size(); i++)
+  {
+    nodes[i] = std::make_shared<Node>(file.getConfiguration(i),logger);
+
+    conn = std::make_shared<Connection>(nodes[file.getParent(i)],nodes[i],logger);
+    conn->setCost(file.getCost(i));
+    conn->add();
+
+    file.restoreFlags(i,nodes[i],conn);
+  }
+
+  TreePtr tree = std::make_shared<Tree>(nodes[0],header.max_distance,checker,metrics,logger,nn_type);
+  if(header.has_scale)
+    tree->setNearestNeighborsScale(file.getScale());
+  if(header.nearest_neighbors_epsilon>0.0)
+    tree->setNearestNeighborsEpsilon(header.nearest_neighbors_epsilon);
+
+  tree->addNodes(std::vector<NodePtr>(nodes.begin()+1,nodes.end()),false);
+
+  return tree;
+}
+
+bool Tree::yamlToBinary(const std::string& yaml_file_name, const std::string& binary_file_name,
+                        const MetricsPtr& metrics, const cnr_logger::TraceLoggerPtr& logger)
+{
+  YAML::Node yaml;
+  try
+  {
+    yaml = YAML::LoadFile(yaml_file_name);
+  }
+  catch(const YAML::Exception& e)
+  {
+    CNR_ERROR(logger,"Cannot load file "<<yaml_file_name<<": "<<e.what());
+    return false;
+  }
+
+  TreePtr tree = fromYAML(yaml,metrics,nullptr,logger);
+  if(not tree)
+    return false;
+
+  return tree->toBinary(binary_file_name);
+}
+
+bool Tree::binaryToYAML(const std::string& binary_file_name, const std::string& yaml_file_name,
+                        const cnr_logger::TraceLoggerPtr& logger)
+{
+  GraphFile file;
+  std::string what;
+  if(not file.open(binary_file_name,what))
+  {
+    CNR_ERROR(logger,what);
+    return false;
+  }
+
+  if(file.getHeader().kind != GraphFile::TREE)
+  {
+    CNR_ERROR(logger,"file "<<binary_file_name<<" does not contain a tree");
+    return false;
+  }
+
+  std::ofstream out(yaml_file_name);
+  if(not out.is_open())
+  {
+    CNR_ERROR(logger,"Error opening file: "<<yaml_file_name);
+    return false;
+  }
+  out << file.toYAML();
+
+  return true;
+}
+
 bool Tree::changeRoot(const NodePtr& node)
 {
   if (not isInTree(node))
@@ -1421,8 +1874,8 @@ bool Tree::recheckCollisionFromNode(NodePtr& n)
   unsigned int removed_nodes;
   std::vector<NodePtr> white_list;
 
-  std::vector<ConnectionPtr> n_conns = n->getChildConnections();
-  for(ConnectionPtr& conn:n_conns)
+  // A purged child is removed from the child connections of n, but the loop ends right after
+  for(const ConnectionPtr& conn:n->childConnectionsView())
   {
     child=conn->getChild();
 
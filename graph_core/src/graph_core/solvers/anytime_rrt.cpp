@@ -284,7 +284,10 @@ bool AnytimeRRT::improve(NodePtr& start_node, NodePtr& goal_node, PathPtr& solut
     return false;
   }
 
-  new_tree_ = std::make_shared<Tree>(start_node, max_distance_, checker_, metrics_, logger_, use_kdtree_);
+  new_tree_ = std::make_shared<Tree>(start_node, max_distance_, checker_, metrics_, logger_, nn_type_);
+  new_tree_->setNearestNeighborsScale(nn_scale_);
+  new_tree_->setNearestNeighborsEpsilon(nn_epsilon_);
+  new_tree_->setPool(pool_);
 
   tmp_goal_node_ = goal_node;
   cost2beat_ = cost2beat;
@@ -66,7 +66,10 @@ bool BiRRT::importFromSolver(const TreeSolverPtr& solver)
 
 bool BiRRT::addGoal(const NodePtr &goal_node, const double &max_time)
 {
-  goal_tree_ = std::make_shared<Tree>(goal_node, max_distance_, checker_, metrics_, logger_, use_kdtree_);
+  goal_tree_ = std::make_shared<Tree>(goal_node, max_distance_, checker_, metrics_, logger_, nn_type_);
+  goal_tree_->setNearestNeighborsScale(nn_scale_);
+  goal_tree_->setNearestNeighborsEpsilon(nn_epsilon_);
+  goal_tree_->setPool(pool_);
 
   return RRT::addGoal(goal_node, max_time);
 }
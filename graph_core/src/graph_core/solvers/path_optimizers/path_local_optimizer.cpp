@@ -114,11 +114,11 @@ bool PathLocalOptimizer::bisection(const size_t &connection_idx,
     bool is_net = conn23->isNet();
     conn23->remove();
 
-    NodePtr n = std::make_shared<Node>(p,logger_);
-    conn12 = std::make_shared<Connection>(parent, n,logger_);
-
-    is_net? (conn23 = std::make_shared<Connection>(n, child, logger_, true)):
-            (conn23 = std::make_shared<Connection>(n, child, logger_, false));
+    // Use the memory pool of the tree, if any
+    TreePtr tree = path_->getTree();
+    NodePtr n = tree? tree->createNode(p): std::make_shared<Node>(p,logger_);
+    conn12 = tree? tree->createConnection(parent, n): std::make_shared<Connection>(parent, n,logger_);
+    conn23 = tree? tree->createConnection(n, child, is_net): std::make_shared<Connection>(n, child, logger_, is_net);
 
     conn12->setCost(cost_pn);
     conn23->setCost(cost_nc);
@@ -128,8 +128,8 @@ bool PathLocalOptimizer::bisection(const size_t &connection_idx,
     assert(child->getParentConnectionsSize() == 1);
     assert(conn23->getChild()->getParentConnectionsSize() == 1);
 
-    if (path_->getTree())
-      path_->getTree()->addNode(n, false);
+    if (tree)
+      tree->addNode(n, false);
   }
 
   if (improved)
@@ -0,0 +1,151 @@
+/*
+Copyright (c) 2024, Manuel Beschi and Cesare Tonola, JRL-CARI CNR-STIIMA/UNIBS, manuel.beschi@unibs.it, c.tonola001@unibs.it
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of the <organization> nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL <COPYRIGHT HOLDER> BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+#include <graph_core/solvers/roadmap_cache.h>
+#include <cctype>
+#include <cstdio>
+#include <sstream>
+#include <iomanip>
+#include <sys/stat.h>
+
+namespace graph
+{
+namespace core
+{
+
+namespace
+{
+/**
+ * @brief 64-bit FNV-1a hash. Unlike std::hash, it does not change between builds, so it can be used in file names.
+ */
+uint64_t fnv1a(const std::string& str)
+{
+  uint64_t hash = 14695981039346656037ULL;
+  for(const char& c: str)
+  {
+    hash ^= static_cast<unsigned char>(c);
+    hash *= 1099511628211ULL;
+  }
+  return hash;
+}
+}
+
+RoadmapCache::RoadmapCache(const std::string& directory, const cnr_logger::TraceLoggerPtr& logger):
+  directory_(directory),
+  logger_(logger)
+{
+  while(directory_.size()>1 && directory_.back() == '/')
+    directory_.pop_back();
+}
+
+std::string RoadmapCache::getFileName(const std::string& environment_id, const CollisionCheckerPtr& checker) const
+{
+  std::string name = environment_id;
+  for(char& c: name)
+  {
+    if(not std::isalnum(static_cast<unsigned char>(c)) && c != '-')
+      c = '_';
+  }
+
+  std::stringstream ss;
+  ss << directory_ << "/" << name << "_" << std::hex << std::setw(16) << std::setfill('0')
+     << fnv1a(checker? checker->getIdentity(): std::string()) << ".graph";
+
+  return ss.str();
+}
+
+bool RoadmapCache::has(const std::string& environment_id, const CollisionCheckerPtr& checker) const
+{
+  struct stat st;
+  return ::stat(getFileName(environment_id,checker).c_str(),&st) == 0;
+}
+
+bool RoadmapCache::store(const std::string& environment_id, const CollisionCheckerPtr& checker, const TreePtr& tree) const
+{
+  if(not tree)
+  {
+    CNR_ERROR(logger_,"Cannot store an empty tree for environment "<<environment_id);
+    return false;
+  }
+
+  std::string file_name = getFileName(environment_id,checker);
+  std::string tmp_file_name = file_name+".tmp";
+  if(not tree->toBinary(tmp_file_name))
+  {
+    std::remove(tmp_file_name.c_str());
+    return false;
+  }
+
+  // Processes which have already mapped the previous file keep reading it
+  if(std::rename(tmp_file_name.c_str(),file_name.c_str()) != 0)
+  {
+    CNR_ERROR(logger_,"Cannot rename "<<tmp_file_name<<" to "<<file_name);
+    std::remove(tmp_file_name.c_str());
+    return false;
+  }
+
+  CNR_DEBUG(logger_,"Tree with "<<tree->getNumberOfNodes()<<" nodes stored for environment "<<environment_id<<" in "<<file_name);
+  return true;
+}
+
+TreePtr RoadmapCache::load(const std::string& environment_id, const MetricsPtr& metrics, const CollisionCheckerPtr& checker, const bool& recheck) const
+{
+  if(not has(environment_id,checker))
+  {
+    CNR_DEBUG(logger_,"No tree stored for environment "<<environment_id);
+    return nullptr;
+  }
+
+  TreePtr tree = Tree::fromBinary(getFileName(environment_id,checker),metrics,checker,logger_);
+  if(not tree)
+    return nullptr;
+
+  if(recheck)
+  {
+    if(not checker->check(tree->getRoot()->getConfiguration()))
+    {
+      CNR_WARN(logger_,"The root of the tree stored for environment "<<environment_id<<" is in collision");
+      return nullptr;
+    }
+
+    // recheckCollision removes one branch in collision per call
+    while(not tree->recheckCollision())
+      ;
+  }
+
+  CNR_DEBUG(logger_,"Tree with "<<tree->getNumberOfNodes()<<" nodes loaded for environment "<<environment_id);
+  return tree;
+}
+
+bool RoadmapCache::remove(const std::string& environment_id, const CollisionCheckerPtr& checker) const
+{
+  return std::remove(getFileName(environment_id,checker).c_str()) == 0;
+}
+
+} //end namespace core
+} //end namespace graph
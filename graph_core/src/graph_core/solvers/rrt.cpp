@@ -71,7 +71,10 @@ bool RRT::addStart(const NodePtr &start_node, const double &max_time)
   }
 
   solved_ = false;
-  start_tree_ = std::make_shared<Tree>(start_node, max_distance_, checker_, metrics_, logger_, use_kdtree_);
+  start_tree_ = std::make_shared<Tree>(start_node, max_distance_, checker_, metrics_, logger_, nn_type_);
+  start_tree_->setNearestNeighborsScale(nn_scale_);
+  start_tree_->setNearestNeighborsEpsilon(nn_epsilon_);
+  start_tree_->setPool(pool_);
 
   setProblem(max_time);
 
@@ -91,6 +94,8 @@ void RRT::resetProblem()
 {
   goal_node_.reset();
   start_tree_.reset();
+  if(use_graph_pool_)
+    pool_ = std::make_shared<GraphPool>();
   problem_set_ = false;
   solved_=false;
   can_improve_ = true;
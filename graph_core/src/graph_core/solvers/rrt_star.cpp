@@ -32,10 +32,20 @@ namespace graph
 namespace core
 {
 
+bool RRTStar::addStart(const NodePtr &start_node, const double &max_time)
+{
+  if(not RRT::addStart(start_node,max_time))
+    return false;
+
+  start_tree_->setRewireThreads(rewire_threads_);
+  return true;
+}
+
 bool RRTStar::addStartTree(const TreePtr &start_tree, const double &max_time)
 {
   assert(start_tree);
   start_tree_ = start_tree;
+  start_tree_->setRewireThreads(rewire_threads_);
   return setProblem(max_time);
 }
 
@@ -45,6 +55,15 @@ bool RRTStar::config(const std::string &param_ns)
 
   solved_ = false;
   get_param(logger_,param_ns_,"rewire_radius",r_rewire_,2.0*max_distance_);
+
+  int rewire_threads;
+  get_param(logger_,param_ns_,"rewire_threads",rewire_threads,1);
+  if(rewire_threads < 0)
+  {
+    CNR_WARN(logger_,"rewire_threads cannot be negative, set equal to 1");
+    rewire_threads = 1;
+  }
+  rewire_threads_ = rewire_threads;
   return true;
 }
 
@@ -58,6 +77,7 @@ bool RRTStar::importFromSolver(const RRTStarPtr& solver)
   if(RRT::importFromSolver(std::static_pointer_cast<RRT>(solver)))
   {
     r_rewire_ = solver->r_rewire_;
+    rewire_threads_ = solver->rewire_threads_;
     return true;
   }
   else
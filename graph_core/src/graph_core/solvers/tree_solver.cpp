@@ -37,6 +37,19 @@ bool TreeSolver::config(const std::string &param_ns)
   param_ns_ = param_ns;
   get_param(logger_,param_ns_,"max_distance",max_distance_,1.0);
   get_param(logger_,param_ns_,"use_kdtree",use_kdtree_, true);
+
+  std::string nn_type;
+  nn_type_ = use_kdtree_? NearestNeighborsType::KdTree: NearestNeighborsType::Vector;
+  get_param(logger_,param_ns_,"nearest_neighbors",nn_type, toString(nn_type_));
+  if(not fromString(nn_type,nn_type_))
+  {
+    CNR_ERROR(logger_,"Unknown nearest_neighbors type: "<<nn_type);
+    throw std::invalid_argument("Unknown nearest_neighbors type: "+nn_type);
+  }
+  use_kdtree_ = (nn_type_ != NearestNeighborsType::Vector);
+  get_param(logger_,param_ns_,"nearest_neighbors_scale",nn_scale_,Eigen::VectorXd());
+  get_param(logger_,param_ns_,"nearest_neighbors_epsilon",nn_epsilon_,0.0);
+  get_param(logger_,param_ns_,"use_graph_pool",use_graph_pool_,false);
   get_param(logger_,param_ns_,"extend",extend_, false);
   get_param(logger_,param_ns_,"utopia_tolerance",utopia_tolerance_, 0.01);
 
@@ -47,7 +60,32 @@ bool TreeSolver::config(const std::string &param_ns)
   }
   utopia_tolerance_ += 1.0;
 
+  if(nn_epsilon_ < 0.0)
+  {
+    CNR_WARN(logger_,"nearest_neighbors_epsilon cannot be negative, set equal to 0.0");
+    nn_epsilon_ = 0.0;
+  }
+
+  std::string roadmap_cache_directory;
+  get_param(logger_,param_ns_,"roadmap_cache_directory",roadmap_cache_directory,std::string());
+  if(not roadmap_cache_directory.empty())
+  {
+    get_param(logger_,param_ns_,"environment_id",environment_id_,std::string("default"));
+    if(not roadmap_cache_ || roadmap_cache_->getDirectory() != roadmap_cache_directory)
+      roadmap_cache_ = std::make_shared<RoadmapCache>(roadmap_cache_directory,logger_);
+  }
+
+  if(use_graph_pool_ && not pool_)
+    pool_ = std::make_shared<GraphPool>();
+  else if(not use_graph_pool_)
+    pool_ = nullptr;
+
   dof_ = sampler_->getDimension();
+  if(nn_scale_.size()>0 && nn_scale_.size() != dof_)
+  {
+    CNR_ERROR(logger_,"nearest_neighbors_scale size ("<<nn_scale_.size()<<") is different from the number of dof ("<<dof_<<")");
+    throw std::invalid_argument("nearest_neighbors_scale size is different from the number of dof");
+  }
   configured_ = true;
   can_improve_=true;
   return true;
@@ -139,10 +177,21 @@ bool TreeSolver::computePath(const NodePtr &start_node, const NodePtr &goal_node
 {
   resetProblem();
   this->config(param_ns);
-  if(not addStart(start_node))
-    return false;
-  if(not addGoal(goal_node))
-    return false;
+  if(roadmap_cache_)
+  {
+    // The goal is added first because addStartTree may need it (e.g., RRTStar)
+    if(not addGoal(goal_node))
+      return false;
+    if(not addStartFromRoadmapCache(start_node) && not addStart(start_node))
+      return false;
+  }
+  else
+  {
+    if(not addStart(start_node))
+      return false;
+    if(not addGoal(goal_node))
+      return false;
+  }
 
   finalizeProblem();
 
@@ -155,6 +204,77 @@ bool TreeSolver::computePath(const NodePtr &start_node, const NodePtr &goal_node
   return true;
 }
 
+bool TreeSolver::addStartFromRoadmapCache(const NodePtr& start_node, const double& max_time)
+{
+  if(not roadmap_cache_)
+    return false;
+
+  if(not configured_)
+  {
+    CNR_ERROR(logger_,"Solver is not configured!");
+    return false;
+  }
+
+  const Eigen::VectorXd& start_conf = start_node->getConfiguration();
+  if(not sampler_->inBounds(start_conf))
+  {
+    CNR_WARN(logger_,"Start not in bounds");
+    return false;
+  }
+
+  TreePtr tree = roadmap_cache_->load(environment_id_,metrics_,checker_);
+  if(not tree)
+    return false;
+
+  if(tree->getRoot()->getConfiguration().size() != start_conf.size())
+  {
+    CNR_ERROR(logger_,"The tree cached for environment "<<environment_id_<<" has a different number of dof");
+    return false;
+  }
+
+  // The settings of the solver replace the ones stored in the file, as for the trees created by addStart
+  tree->setNearestNeighborsScale(nn_scale_);
+  tree->setNearestNeighborsEpsilon(nn_epsilon_);
+  tree->setPool(pool_);
+
+  // The start node is connected to the closest node which can be reached without collisions
+  std::multimap<double,NodePtr> near_nodes = tree->near(start_node,max_distance_);
+  for(const std::pair<const double,NodePtr>& p: near_nodes)
+  {
+    const NodePtr& node = p.second;
+    if(not checker_->checkConnection(node->getConfiguration(),start_conf))
+      continue;
+
+    ConnectionPtr conn = std::make_shared<Connection>(node,start_node,logger_);
+    conn->setCost(metrics_->cost(node,start_node));
+    conn->add();
+
+    tree->addNode(start_node,false);
+    tree->changeRoot(start_node);
+
+    CNR_DEBUG(logger_,"Start node connected to the tree cached for environment "<<environment_id_<<" ("<<tree->getNumberOfNodes()<<" nodes)");
+    if(addStartTree(tree,max_time))
+      return true;
+
+    // The cached tree is discarded, start_node must be left as it was so that it can be used by addStart
+    CNR_DEBUG(logger_,"The tree cached for environment "<<environment_id_<<" cannot be used as start tree");
+    conn->remove();
+    start_tree_.reset();
+    return false;
+  }
+
+  CNR_DEBUG(logger_,"Start node cannot be connected to the tree cached for environment "<<environment_id_);
+  return false;
+}
+
+bool TreeSolver::storeToRoadmapCache() const
+{
+  if(not roadmap_cache_ || not start_tree_)
+    return false;
+
+  return roadmap_cache_->store(environment_id_,checker_,start_tree_);
+}
+
 bool TreeSolver::setSolution(const PathPtr &solution)
 {
   if (not solution)
@@ -248,6 +368,13 @@ bool TreeSolver::importFromSolver(const TreeSolverPtr& solver)
   extend_ = solver->extend_;
   utopia_tolerance_ = solver->utopia_tolerance_;
   use_kdtree_ = solver->use_kdtree_;
+  nn_type_ = solver->nn_type_;
+  nn_scale_ = solver->nn_scale_;
+  nn_epsilon_ = solver->nn_epsilon_;
+  use_graph_pool_ = solver->use_graph_pool_;
+  pool_ = solver->pool_;
+  roadmap_cache_ = solver->roadmap_cache_;
+  environment_id_ = solver->environment_id_;
   goal_node_ = solver->goal_node_;
   path_cost_ = solver->path_cost_;
   goal_cost_ = solver->goal_cost_;
@@ -0,0 +1,87 @@
+#include <graph_core/datastructure/concurrent_nearest_neighbors.h>
+#include <graph_core/datastructure/kdtree.h>
+#include <graph_core/util.h>
+#include <cnr_logger/cnr_logger.h>
+#include <thread>
+#include <random>
+
+using namespace graph::core;
+
+// Each iteration is a nearest neighbor query followed, every insert_period iterations, by an insertion (as in RRT)
+void work(const NearestNeighborsPtr& nn, const unsigned int& dof, const int& iterations, const int& insert_period,
+          const unsigned int& seed, const cnr_logger::TraceLoggerPtr& logger)
+{
+  std::mt19937 rng(seed);
+  std::uniform_real_distribution<double> uniform(-1.0,1.0);
+  Eigen::VectorXd q(dof);
+  for(int i=0;i<iterations;i++)
+  {
+    for(unsigned int d=0;d<dof;d++)
+      q(d) = uniform(rng);
+
+    NodePtr best;
+    double best_distance;
+    nn->nearestNeighbor(q,best,best_distance);
+
+    if(i%insert_period == 0)
+      nn->insert(std::make_shared<Node>(q,logger));
+  }
+}
+
+int main(int argc, char **argv)
+{
+  std::string file_path = std::string(TEST_DIR) + "/logger_param.yaml";
+  std::cout << "file_path = " << file_path << std::endl;
+  // Create the logger
+  cnr_logger::TraceLoggerPtr logger=std::make_shared<cnr_logger::TraceLogger>("concurrent_nearest_neighbors_benchmark", file_path);
+
+  int n_nodes = 50000;
+  int iterations = 200000;
+  unsigned int dof = 6;
+  int insert_period = 10;
+
+  if(argc > 1)
+    n_nodes = std::atoi(argv[1]);
+  if(argc > 2)
+    dof = std::atoi(argv[2]);
+  if(argc > 3)
+    insert_period = std::max(1,std::atoi(argv[3]));
+
+  // Insertions are serialized, so the speed-up depends on the cores and on insert_period
+  unsigned int max_threads = std::max(1u,std::thread::hardware_concurrency());
+  if(argc > 4)
+    max_threads = std::max(1,std::atoi(argv[4]));
+
+  std::vector<NodePtr> nodes;
+  for(int i=0;i<n_nodes;i++)
+    nodes.push_back(std::make_shared<Node>(Eigen::VectorXd::Random(dof),logger));
+
+  // Serial KdTree
+  NearestNeighborsPtr kdtree = std::make_shared<KdTree>(logger);
+  kdtree->build(nodes);
+
+  graph_time_point tic = graph_time::now();
+  work(kdtree,dof,iterations,insert_period,0,logger);
+  double serial_time = toSeconds(graph_time::now(),tic);
+  CNR_INFO(logger,"serial kdtree: "<<iterations/serial_time<<" iterations/s");
+
+  // The same total work split among several threads sharing a ConcurrentNearestNeighbors
+  for(unsigned int n_threads=1;n_threads<=max_threads;n_threads*=2)
+  {
+    NearestNeighborsPtr wrapped_kdtree = std::make_shared<KdTree>(logger);
+    wrapped_kdtree->build(nodes);
+    ConcurrentNearestNeighborsPtr nn = std::make_shared<ConcurrentNearestNeighbors>(wrapped_kdtree,logger);
+
+    tic = graph_time::now();
+    std::vector<std::thread> threads;
+    for(unsigned int t=0;t<n_threads;t++)
+      threads.emplace_back(work,nn,dof,iterations/n_threads,insert_period,t,logger);
+    for(std::thread& t: threads)
+      t.join();
+    double time = toSeconds(graph_time::now(),tic);
+
+    CNR_INFO(logger,"concurrent kdtree, "<<n_threads<<" threads: "<<iterations/time<<" iterations/s, speed-up "<<serial_time/time<<" w.r.t. the serial kdtree");
+  }
+
+  return 0;
+}
@@ -0,0 +1,269 @@
+#include <graph_core/datastructure/concurrent_nearest_neighbors.h>
+#include <graph_core/datastructure/vector.h>
+#include <graph_core/datastructure/kdtree.h>
+#include <graph_core/datastructure/arena_kdtree.h>
+#include <graph_core/datastructure/bucket_kdtree.h>
+#include <graph_core/datastructure/vp_tree.h>
+#include <graph_core/datastructure/hash_grid.h>
+#include <graph_core/metrics/euclidean_metrics.h>
+#include <graph_core/util.h>
+#include <cnr_logger/cnr_logger.h>
+#include <thread>
+#include <atomic>
+#include <random>
+#include <algorithm>
+#include <chrono>
+
+using namespace graph::core;
+
+int main(int argc, char **argv)
+{
+  std::string file_path = std::string(TEST_DIR) + "/logger_param.yaml";
+  std::cout << "file_path = " << file_path << std::endl;
+  // Create the logger
+  cnr_logger::TraceLoggerPtr logger=std::make_shared<cnr_logger::TraceLogger>("concurrent_nearest_neighbors_test", file_path);
+
+  int n_nodes = 2000;  //inserted by each writer
+  unsigned int dof = 4;
+  unsigned int n_writers = 4;
+  unsigned int n_readers = 4;
+
+  if(argc > 1)
+    n_nodes = std::atoi(argv[1]);
+  if(argc > 2)
+    dof = std::atoi(argv[2]);
+
+  MetricsPtr metrics = std::make_shared<EuclideanMetrics>(logger);
+
+  std::vector<std::pair<std::string,NearestNeighborsPtr>> backends;
+  backends.push_back(std::make_pair("vector",       std::make_shared<Vector>(logger)));
+  backends.push_back(std::make_pair("kdtree",       std::make_shared<KdTree>(logger)));
+  backends.push_back(std::make_pair("arena_kdtree", std::make_shared<ArenaKdTree>(logger)));
+  backends.push_back(std::make_pair("bucket_kdtree",std::make_shared<BucketKdTree>(logger)));
+  backends.push_back(std::make_pair("vp_tree",      std::make_shared<VpTree>(metrics,logger)));
+  if(dof<=HashGrid::MAX_DIMENSION)
+    backends.push_back(std::make_pair("hash_grid",  std::make_shared<HashGrid>(0.2,logger)));
+
+  bool success = true;
+  for(const auto& b:backends)
+  {
+    ConcurrentNearestNeighborsPtr nn = std::make_shared<ConcurrentNearestNeighbors>(b.second,logger);
+    nn->insert(std::make_shared<Node>(Eigen::VectorXd::Zero(dof),logger));
+
+    std::atomic<bool> done(false);
+    std::atomic<size_t> errors(0);
+    std::vector<std::vector<NodePtr>> inserted(n_writers);
+
+    // Writers insert nodes and check that their own insertions and deletions are immediately visible
+    std::vector<std::thread> writers;
+    for(unsigned int w=0;w<n_writers;w++)
+    {
+      writers.emplace_back([&,w](){
+        std::mt19937 rng(w);
+        std::uniform_real_distribution<double> uniform(-1.0,1.0);
+        std::vector<NodePtr> batch;
+
+        for(int i=0;i<n_nodes;i++)
+        {
+          Eigen::VectorXd q(dof);
+          for(unsigned int d=0;d<dof;d++)
+            q(d) = uniform(rng);
+          NodePtr node = std::make_shared<Node>(q,logger);
+
+          if(i%10 == 0) //deleted right after the insertion
+          {
+            nn->insert(node);
+            if(not nn->deleteNode(node) || nn->deleteNode(node))
+              errors++;
+
+            NodePtr best;
+            double best_distance;
+            nn->nearestNeighbor(q,best,best_distance);
+            if(best == node)
+              errors++;
+            continue;
+          }
+
+          if(i%4 == 0) //inserted in batches
+          {
+            batch.push_back(node);
+            if(batch.size() == 8)
+            {
+              nn->insert(batch);
+              inserted[w].insert(inserted[w].end(),batch.begin(),batch.end());
+              for(const NodePtr& n: batch)
+                if(not nn->findNode(n))
+                  errors++;
+              batch.clear();
+            }
+            continue;
+          }
+
+          nn->insert(node);
+          inserted[w].push_back(node);
+
+          NodePtr best;
+          double best_distance;
+          nn->nearestNeighbor(q,best,best_distance);
+          if(best_distance>0.0)
+            errors++;
+        }
+
+        nn->insert(batch);
+        inserted[w].insert(inserted[w].end(),batch.begin(),batch.end());
+      });
+    }
+
+    // Readers query concurrently and check the consistency of each result
+    std::vector<std::thread> readers;
+    std::vector<size_t> queries(n_readers,0);
+    for(unsigned int r=0;r<n_readers;r++)
+    {
+      readers.emplace_back([&,r](){
+        std::mt19937 rng(100+r);
+        std::uniform_real_distribution<double> uniform(-1.0,1.0);
+        std::vector<std::pair<double,Node*>> buffer;
+
+        while(not done)
+        {
+          Eigen::VectorXd q(dof);
+          for(unsigned int d=0;d<dof;d++)
+            q(d) = uniform(rng);
+
+          NodePtr best;
+          double best_distance;
+          nn->nearestNeighbor(q,best,best_distance);
+          if(not best || std::abs((best->getConfiguration()-q).norm()-best_distance)>1e-9)
+            errors++;
+
+          // Nodes can be inserted between two queries, so each result is checked on its own
+          nn->near(q,0.5,buffer);
+          for(const std::pair<double,Node*>& p: buffer)
+            if(p.first>=0.5 || std::abs((p.second->getConfiguration()-q).norm()-p.first)>1e-9)
+              errors++;
+
+          nn->kNearestNeighbors(q,5,buffer);
+          if(buffer.empty() || buffer.size()>5 || not std::is_sorted(buffer.begin(),buffer.end(),[](const std::pair<double,Node*>& p1, const std::pair<double,Node*>& p2){
+             return p1.first<p2.first;
+           }))
+            errors++;
+
+          // The first node is never deleted
+          if(nn->size()<1)
+            errors++;
+          queries[r]++;
+        }
+      });
+    }
+
+    for(std::thread& t: writers)
+      t.join();
+    done = true;
+    for(std::thread& t: readers)
+      t.join();
+
+    // The final content matches the nodes inserted and not deleted
+    size_t expected_size = 1;
+    for(const std::vector<NodePtr>& v: inserted)
+      expected_size += v.size();
+
+    if(nn->size() != expected_size || nn->getNodes().size() != expected_size)
+    {
+      CNR_ERROR(logger,b.first<<": wrong size "<<nn->size()<<" instead of "<<expected_size);
+      success = false;
+    }
+    for(const std::vector<NodePtr>& v: inserted)
+    {
+      for(const NodePtr& n: v)
+      {
+        if(not nn->findNode(n))
+        {
+          errors++;
+          break;
+        }
+      }
+    }
+
+    size_t total_queries = 0;
+    for(const size_t& q: queries)
+      total_queries += q;
+
+    CNR_INFO(logger,b.first<<": "<<n_writers<<" writers, "<<n_readers<<" readers, "<<total_queries<<" concurrent queries, "<<errors<<" errors");
+    if(errors>0)
+    {
+      CNR_ERROR(logger,b.first<<": "<<errors<<" inconsistent results");
+      success = false;
+    }
+  }
+
+  // A visitor of near() queries the same wrapper while a writer is waiting for the lock
+  {
+    ConcurrentNearestNeighborsPtr nn = std::make_shared<ConcurrentNearestNeighbors>(std::make_shared<KdTree>(logger),logger);
+    NodePtr origin = std::make_shared<Node>(Eigen::VectorXd::Zero(dof),logger);
+    nn->insert(origin);
+
+    std::atomic<bool> writer_started(false);
+    std::atomic<bool> reader_done(false);
+    std::atomic<bool> writer_done(false);
+    size_t nested_errors = 0;
+    bool modification_rejected = false;
+
+    std::thread reader([&](){
+      nn->near(origin->getConfiguration(),0.5,[&](const double& /*distance*/, const NodePtr& node){
+        writer_started = true;
+        std::this_thread::sleep_for(std::chrono::milliseconds(100)); //let the writer wait on the turnstile
+
+        NodePtr best;
+        double best_distance;
+        nn->nearestNeighbor(origin->getConfiguration(),best,best_distance);
+        std::vector<std::pair<double,Node*>> buffer;
+        nn->near(origin->getConfiguration(),0.5,buffer);
+        if(best != origin || buffer.size() != 1 || not nn->findNode(node) || nn->size() != 1)
+          nested_errors++;
+
+        try
+        {
+          nn->deleteNode(node);
+        }
+        catch(const std::logic_error&)
+        {
+          modification_rejected = true;
+        }
+        return true;
+      });
+      reader_done = true;
+    });
+
+    while(not writer_started)
+      std::this_thread::yield();
+    std::thread writer([&](){
+      nn->insert(std::make_shared<Node>(Eigen::VectorXd::Ones(dof),logger));
+      writer_done = true;
+    });
+
+    graph_time_point tic = graph_time::now();
+    while(not (reader_done && writer_done) && toSeconds(graph_time::now(),tic)<10.0)
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+
+    if(not (reader_done && writer_done))
+    {
+      CNR_ERROR(logger,"a query nested in a visitor of near() deadlocked with a waiting writer");
+      reader.detach();
+      writer.detach();
+      return 1;
+    }
+    reader.join();
+    writer.join();
+
+    if(nested_errors>0 || not modification_rejected || nn->size() != 2)
+    {
+      CNR_ERROR(logger,"wrong results of the queries nested in a visitor of near()");
+      success = false;
+    }
+  }
+
+  if(success)
+    CNR_INFO(logger, cnr_logger::RESET() << cnr_logger::GREEN() << "Concurrent insertions and queries are consistent");
+
+  return success? 0: 1;
+}
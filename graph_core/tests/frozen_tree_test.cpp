@@ -0,0 +1,155 @@
+#include <graph_core/graph/tree.h>
+#include <graph_core/metrics/euclidean_metrics.h>
+#include <cnr_logger/cnr_logger.h>
+#include <thread>
+#include <atomic>
+#include <random>
+
+using namespace graph::core;
+
+int main(int argc, char **argv)
+{
+  std::string file_path = std::string(TEST_DIR) + "/logger_param.yaml";
+  std::cout << "file_path = " << file_path << std::endl;
+  // Create the logger
+  cnr_logger::TraceLoggerPtr logger=std::make_shared<cnr_logger::TraceLogger>("frozen_tree_test", file_path);
+
+  int n_nodes = 5000;
+  unsigned int dof = 4;
+  unsigned int n_threads = 4;
+
+  if(argc > 1)
+    n_nodes = std::atoi(argv[1]);
+  if(argc > 2)
+    dof = std::atoi(argv[2]);
+
+  MetricsPtr metrics = std::make_shared<EuclideanMetrics>(logger);
+
+  // Random tree: each node is connected to a random node added before it
+  std::mt19937 rng(0);
+  NodePtr root = std::make_shared<Node>(Eigen::VectorXd::Zero(dof),logger);
+  std::vector<NodePtr> nodes;
+  nodes.push_back(root);
+  for(int i=0;i<n_nodes;i++)
+  {
+    NodePtr parent = nodes.at(std::uniform_int_distribution<int>(0,nodes.size()-1)(rng));
+    NodePtr node = std::make_shared<Node>(Eigen::VectorXd::Random(dof),logger);
+    ConnectionPtr conn = std::make_shared<Connection>(parent,node,logger);
+    conn->setCost(metrics->cost(parent,node));
+    conn->add();
+    nodes.push_back(node);
+  }
+
+  TreePtr tree = std::make_shared<Tree>(root,1.0,nullptr,metrics,logger,NearestNeighborsType::KdTree);
+  for(size_t i=1;i<nodes.size();i++)
+    tree->addNode(nodes.at(i),false);
+
+  // A branch outside the tree must not appear in the snapshot
+  NodePtr outside = std::make_shared<Node>(Eigen::VectorXd::Random(dof),logger);
+  ConnectionPtr outside_conn = std::make_shared<Connection>(root,outside,logger);
+  outside_conn->setCost(metrics->cost(root,outside));
+  outside_conn->add();
+
+  FrozenTreePtr frozen = tree->freeze();
+
+  bool success = true;
+  if(frozen->size() != tree->getNumberOfNodes() || frozen->getIndex(outside) != FrozenTree::NO_PARENT || frozen->getNode(0) != root)
+  {
+    CNR_ERROR(logger,"the snapshot has "<<frozen->size()<<" nodes instead of "<<tree->getNumberOfNodes());
+    success = false;
+  }
+
+  // Costs and branches
+  for(const NodePtr& n: nodes)
+  {
+    unsigned int idx = frozen->getIndex(n);
+    if(idx == FrozenTree::NO_PARENT || frozen->getNode(idx) != n || frozen->getConfiguration(idx) != n->getConfiguration())
+    {
+      CNR_ERROR(logger,"node "<<n<<" not found in the snapshot");
+      success = false;
+      continue;
+    }
+    if(std::abs(frozen->costToNode(idx)-tree->costToNode(n))>1e-9 || std::abs(tree->costToNodeWithoutCache(n)-tree->costToNode(n))>1e-9 ||
+       frozen->getConnectionToNode(idx) != tree->getConnectionToNode(n))
+    {
+      CNR_ERROR(logger,"the branch to node "<<idx<<" is different from the one of the tree");
+      success = false;
+    }
+    if(idx != 0 && frozen->getParent(idx)>=idx)
+    {
+      CNR_ERROR(logger,"the parent of node "<<idx<<" has a higher index");
+      success = false;
+    }
+  }
+
+  // Leaves
+  std::vector<NodePtr> leaves;
+  std::vector<unsigned int> frozen_leaves;
+  tree->getLeaves(leaves);
+  frozen->getLeaves(frozen_leaves);
+  if(leaves.size() != frozen_leaves.size())
+  {
+    CNR_ERROR(logger,"the snapshot has "<<frozen_leaves.size()<<" leaves instead of "<<leaves.size());
+    success = false;
+  }
+
+  // Subtree of the root
+  std::vector<unsigned int> subtree;
+  frozen->getSubtree(0,subtree);
+  if(subtree.size() != frozen->size())
+  {
+    CNR_ERROR(logger,"the subtree of the root has "<<subtree.size()<<" nodes instead of "<<frozen->size());
+    success = false;
+  }
+
+  // Concurrent near queries, compared with the tree
+  unsigned int n_queries = 200;
+  std::vector<Eigen::VectorXd> queries;
+  std::vector<std::multimap<double,NodePtr>> expected;
+  std::vector<NodePtr> expected_nearest;
+  for(unsigned int i=0;i<n_queries;i++)
+  {
+    queries.push_back(Eigen::VectorXd::Random(dof));
+    NodePtr query = std::make_shared<Node>(queries.back(),logger);
+    expected.push_back(tree->near(query,0.5));
+    expected_nearest.push_back(tree->findClosestNode(queries.back()));
+  }
+
+  std::atomic<size_t> errors(0);
+  std::vector<std::thread> threads;
+  for(unsigned int t=0;t<n_threads;t++)
+  {
+    threads.emplace_back([&,t](){
+      std::vector<std::pair<double,unsigned int>> near_nodes;
+      for(unsigned int i=t;i<n_queries;i+=n_threads)
+      {
+        frozen->near(queries[i],0.5,near_nodes);
+        if(near_nodes.size() != expected[i].size())
+        {
+          errors++;
+          continue;
+        }
+
+        double distance;
+        unsigned int nearest = frozen->nearestNeighbor(queries[i],distance);
+        if(not near_nodes.empty() && (near_nodes.front().second != nearest || std::abs(near_nodes.front().first-distance)>1e-9))
+          errors++;
+        if(frozen->getNode(nearest) != expected_nearest[i])
+          errors++;
+      }
+    });
+  }
+  for(std::thread& t: threads)
+    t.join();
+
+  if(errors>0)
+  {
+    CNR_ERROR(logger,errors<<" near queries of the snapshot differ from the ones of the tree");
+    success = false;
+  }
+
+  if(success)
+    CNR_INFO(logger, cnr_logger::RESET() << cnr_logger::BOLDGREEN() << "Done!");
+
+  return success? 0: 1;
+}
@@ -0,0 +1,220 @@
+#include <graph_core/graph/path.h>
+#include <graph_core/graph/graph_file.h>
+#include <graph_core/metrics/euclidean_metrics.h>
+#include <cnr_logger/cnr_logger.h>
+#include <random>
+#include <fstream>
+#include <cstddef>
+#include <cstring>
+
+using namespace graph::core;
+
+int main(int argc, char **argv)
+{
+  std::string file_path = std::string(TEST_DIR) + "/logger_param.yaml";
+  std::cout << "file_path = " << file_path << std::endl;
+  // Create the logger
+  cnr_logger::TraceLoggerPtr logger=std::make_shared<cnr_logger::TraceLogger>("graph_file_test", file_path);
+
+  int n_nodes = 2000;
+  unsigned int dof = 4;
+
+  if(argc > 1)
+    n_nodes = std::atoi(argv[1]);
+  if(argc > 2)
+    dof = std::atoi(argv[2]);
+
+  MetricsPtr metrics = std::make_shared<EuclideanMetrics>(logger);
+
+  // Random tree: each node is connected to a random node added before it. Some nodes and connections carry a custom flag
+  std::mt19937 rng(0);
+  NodePtr root = std::make_shared<Node>(Eigen::VectorXd::Zero(dof),logger);
+  std::vector<NodePtr> nodes;
+  nodes.push_back(root);
+  for(int i=0;i<n_nodes;i++)
+  {
+    NodePtr parent = nodes.at(std::uniform_int_distribution<int>(0,nodes.size()-1)(rng));
+    NodePtr node = std::make_shared<Node>(Eigen::VectorXd::Random(dof),logger);
+    ConnectionPtr conn = std::make_shared<Connection>(parent,node,logger);
+    conn->setCost(metrics->cost(parent,node));
+    conn->add();
+    if(i%3 == 0)
+      node->setFlag(true);
+    if(i%5 == 0)
+      conn->setFlag(true);
+    nodes.push_back(node);
+  }
+
+  TreePtr tree = std::make_shared<Tree>(root,1.0,nullptr,metrics,logger,NearestNeighborsType::KdTree);
+  for(size_t i=1;i<nodes.size();i++)
+    tree->addNode(nodes.at(i),false);
+
+  bool success = true;
+
+  // Tree: binary round trip
+  std::string tree_file = "/tmp/graph_file_test_tree.bin";
+  TreePtr loaded_tree;
+  if(not tree->toBinary(tree_file) || not (loaded_tree = Tree::fromBinary(tree_file,metrics,nullptr,logger)))
+  {
+    CNR_ERROR(logger,"cannot write or read the tree binary file");
+    return 1;
+  }
+
+  if(loaded_tree->getNumberOfNodes() != tree->getNumberOfNodes() || loaded_tree->getMaximumDistance() != tree->getMaximumDistance())
+  {
+    CNR_ERROR(logger,"the loaded tree has "<<loaded_tree->getNumberOfNodes()<<" nodes instead of "<<tree->getNumberOfNodes());
+    success = false;
+  }
+
+  std::vector<NodePtr> leaves, loaded_leaves;
+  tree->getLeaves(leaves);
+  loaded_tree->getLeaves(loaded_leaves);
+  if(leaves.size() != loaded_leaves.size())
+  {
+    CNR_ERROR(logger,"the loaded tree has "<<loaded_leaves.size()<<" leaves instead of "<<leaves.size());
+    success = false;
+  }
+
+  for(const NodePtr& n: nodes)
+  {
+    NodePtr loaded = loaded_tree->findClosestNode(n->getConfiguration());
+    if(loaded->getConfiguration() != n->getConfiguration())
+    {
+      CNR_ERROR(logger,"node "<<n<<" not found in the loaded tree");
+      success = false;
+      continue;
+    }
+    if(std::abs(loaded_tree->costToNode(loaded)-tree->costToNode(n))>1e-9)
+    {
+      CNR_ERROR(logger,"the cost to node "<<n<<" differs in the loaded tree");
+      success = false;
+    }
+    if(loaded->getFlag(Node::getReservedFlagsNumber(),false) != n->getFlag(Node::getReservedFlagsNumber(),false))
+    {
+      CNR_ERROR(logger,"the flags of node "<<n<<" differ in the loaded tree");
+      success = false;
+    }
+    if(n != root)
+    {
+      ConnectionPtr conn = n->getParentConnections().front();
+      ConnectionPtr loaded_conn = loaded->getParentConnections().front();
+      if(loaded_conn->getFlag(Connection::getReservedFlagsNumber(),false) != conn->getFlag(Connection::getReservedFlagsNumber(),false))
+      {
+        CNR_ERROR(logger,"the flags of the connection to node "<<n<<" differ in the loaded tree");
+        success = false;
+      }
+    }
+  }
+
+  // Tree: binary to YAML and back
+  std::string tree_yaml = "/tmp/graph_file_test_tree.yaml";
+  std::string tree_file_from_yaml = "/tmp/graph_file_test_tree_from_yaml.bin";
+  if(not Tree::binaryToYAML(tree_file,tree_yaml,logger) || not Tree::yamlToBinary(tree_yaml,tree_file_from_yaml,metrics,logger))
+  {
+    CNR_ERROR(logger,"cannot convert the tree between binary and YAML");
+    success = false;
+  }
+  else
+  {
+    TreePtr converted_tree = Tree::fromBinary(tree_file_from_yaml,metrics,nullptr,logger);
+    if(not converted_tree || converted_tree->getNumberOfNodes() != tree->getNumberOfNodes())
+    {
+      CNR_ERROR(logger,"the tree converted from YAML is different from the original one");
+      success = false;
+    }
+  }
+
+  // Path: binary round trip, straight and reversed
+  std::vector<NodePtr> leaves_vector;
+  tree->getLeaves(leaves_vector);
+  std::vector<ConnectionPtr> connections = tree->getConnectionToNode(leaves_vector.front());
+  PathPtr path = std::make_shared<Path>(connections,metrics,nullptr,logger);
+
+  std::string path_file = "/tmp/graph_file_test_path.bin";
+  for(bool reverse: {false,true})
+  {
+    PathPtr loaded_path;
+    if(not path->toBinary(path_file,reverse) || not (loaded_path = Path::fromBinary(path_file,metrics,nullptr,logger)))
+    {
+      CNR_ERROR(logger,"cannot write or read the path binary file");
+      success = false;
+      continue;
+    }
+
+    std::vector<NodePtr> path_nodes = path->getNodes();
+    std::vector<NodePtr> loaded_nodes = loaded_path->getNodes();
+    if(reverse)
+      std::reverse(path_nodes.begin(),path_nodes.end());
+
+    if(path_nodes.size() != loaded_nodes.size() || std::abs(path->cost()-loaded_path->cost())>1e-9)
+    {
+      CNR_ERROR(logger,"the loaded path is different from the original one");
+      success = false;
+      continue;
+    }
+    for(size_t i=0;i<path_nodes.size();i++)
+    {
+      if(path_nodes[i]->getConfiguration() != loaded_nodes[i]->getConfiguration())
+      {
+        CNR_ERROR(logger,"node "<<i<<" of the loaded path is different from the original one");
+        success = false;
+      }
+    }
+  }
+
+  // Path: binary to YAML
+  std::string path_yaml = "/tmp/graph_file_test_path.yaml";
+  if(not Path::binaryToYAML(path_file,path_yaml,logger) || not Path::fromYAML(YAML::LoadFile(path_yaml),metrics,nullptr,logger))
+  {
+    CNR_ERROR(logger,"cannot convert the path from binary to YAML");
+    success = false;
+  }
+
+  // A tree file must not be loaded as a path
+  if(Path::fromBinary(tree_file,metrics,nullptr,logger))
+  {
+    CNR_ERROR(logger,"a tree file has been loaded as a path");
+    success = false;
+  }
+
+  // Corrupted headers and flag sizes must be rejected
+  std::ifstream tree_stream(tree_file,std::ios::binary);
+  std::string tree_bytes((std::istreambuf_iterator<char>(tree_stream)),std::istreambuf_iterator<char>());
+
+  auto rejects = [&](const size_t& offset, const auto& value, const size_t& file_size){
+    std::string bytes = tree_bytes.substr(0,file_size);
+    std::memcpy(&bytes[offset],&value,sizeof(value));
+
+    std::string corrupted_file = "/tmp/graph_file_test_corrupted.bin";
+    std::ofstream(corrupted_file,std::ios::binary).write(bytes.data(),bytes.size());
+
+    GraphFile file;
+    std::string what;
+    if(file.open(corrupted_file,what))
+      return false;
+
+    CNR_INFO(logger,"rejected: "<<what);
+    return not Tree::fromBinary(corrupted_file,metrics,nullptr,logger);
+  };
+
+  const size_t last_connection_flags_size = tree_bytes.size()-sizeof(uint32_t);
+  const size_t last_node_flags_size = last_connection_flags_size-sizeof(uint32_t)*tree->getNumberOfNodes();
+  // With 2^62 nodes the expected size overflows to the size of a header-only file
+  const uint64_t huge_nodes = uint64_t(1)<<62;
+  if(not rejects(offsetof(GraphFileHeader,nearest_neighbors),uint32_t(100),tree_bytes.size()) ||
+     not rejects(offsetof(GraphFileHeader,kind),uint32_t(7),tree_bytes.size()) ||
+     not rejects(offsetof(GraphFileHeader,dof),uint32_t(0),tree_bytes.size()) ||
+     not rejects(offsetof(GraphFileHeader,nodes),huge_nodes,tree_bytes.size()) ||
+     not rejects(offsetof(GraphFileHeader,nodes),huge_nodes,sizeof(GraphFileHeader)) ||
+     not rejects(last_node_flags_size,uint32_t(GraphFile::MAX_FLAGS+1),tree_bytes.size()) ||
+     not rejects(last_connection_flags_size,uint32_t(200),tree_bytes.size()))
+  {
+    CNR_ERROR(logger,"a corrupted file has been loaded");
+    success = false;
+  }
+
+  if(success)
+    CNR_INFO(logger, cnr_logger::RESET() << cnr_logger::BOLDGREEN() << "Done!");
+
+  return success? 0: 1;
+}
@@ -2,6 +2,19 @@
 #include <cnr_logger/cnr_logger.h>
 #include <random>
 
+// KdTree exposing the number of deleted kdnodes
+class InspectableKdTree: public graph::core::KdTree
+{
+public:
+  InspectableKdTree(const cnr_logger::TraceLoggerPtr& logger):graph::core::KdTree(logger)
+  {}
+
+  unsigned int deletedNodes()
+  {
+    return deleted_nodes_;
+  }
+};
+
 int main(int argc, char **argv)
 {
   std::string file_path = std::string(TEST_DIR) + "/logger_param.yaml";
@@ -66,6 +79,75 @@ int main(int argc, char **argv)
   kdtree->print_deleted_nodes_ = true;
   CNR_INFO(logger, cnr_logger::RESET() << cnr_logger::BLUE() << " KdTree with also deleted nodes: \n"<<*kdtree);
 
+  // Deleted nodes are released immediately, and the kdtree is compacted when more than half of its kdnodes are deleted
+  bool success = true;
+  std::shared_ptr<InspectableKdTree> compacted_kdtree = std::make_shared<InspectableKdTree>(logger);
+  std::vector<std::weak_ptr<graph::core::Node>> deleted_nodes;
+  std::vector<graph::core::NodePtr> live_nodes;
+  {
+    std::vector<graph::core::NodePtr> all_nodes;
+    for(int i=0;i<1000;i++)
+    {
+      all_nodes.push_back(std::make_shared<graph::core::Node>(Eigen::VectorXd::Random(3),logger));
+      compacted_kdtree->insert(all_nodes.back());
+    }
+
+    for(size_t i=0;i<all_nodes.size();i++)
+    {
+      if(i%4 == 0)
+      {
+        live_nodes.push_back(all_nodes.at(i));
+        continue;
+      }
+
+      deleted_nodes.push_back(all_nodes.at(i));
+      compacted_kdtree->deleteNode(all_nodes.at(i));
+      if(compacted_kdtree->deletedNodes()>compacted_kdtree->deletedNodesFraction()*(compacted_kdtree->size()+compacted_kdtree->deletedNodes()))
+      {
+        CNR_ERROR(logger,"the kdtree has not been compacted: "<<compacted_kdtree->deletedNodes()<<" deleted kdnodes out of "
+                  <<compacted_kdtree->size()+compacted_kdtree->deletedNodes());
+        success = false;
+        break;
+      }
+    }
+  }
+
+  for(const std::weak_ptr<graph::core::Node>& n:deleted_nodes)
+  {
+    if(not n.expired())
+    {
+      CNR_ERROR(logger,"a deleted node is still kept alive by the kdtree");
+      success = false;
+      break;
+    }
+  }
+
+  if(compacted_kdtree->getNodes().size() != live_nodes.size())
+  {
+    CNR_ERROR(logger,"the compacted kdtree has "<<compacted_kdtree->getNodes().size()<<" nodes instead of "<<live_nodes.size());
+    success = false;
+  }
+
+  for(int i=0;i<100;i++)
+  {
+    Eigen::VectorXd q = Eigen::VectorXd::Random(3);
+    double best_distance = std::numeric_limits<double>::infinity();
+    for(const graph::core::NodePtr& n:live_nodes)
+      best_distance = std::min(best_distance,(n->getConfiguration()-q).norm());
+
+    graph::core::NodePtr nn;
+    double d;
+    compacted_kdtree->nearestNeighbor(q,nn,d);
+    if(std::abs(d-best_distance)>1e-9)
+    {
+      CNR_ERROR(logger,"wrong nearest neighbor distance after the compaction: "<<d<<" instead of "<<best_distance);
+      success = false;
+      break;
+    }
+  }
+
+  if(success)
+    CNR_INFO(logger, cnr_logger::RESET() << cnr_logger::GREEN() << "The kdtree releases and compacts the deleted nodes");
 
-  return 0;
+  return success? 0: 1;
 }
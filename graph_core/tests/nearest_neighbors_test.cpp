@@ -0,0 +1,503 @@
+#include <graph_core/datastructure/vector.h>
+#include <graph_core/datastructure/kdtree.h>
+#include <graph_core/datastructure/arena_kdtree.h>
+#include <graph_core/datastructure/bucket_kdtree.h>
+#include <graph_core/datastructure/vp_tree.h>
+#include <graph_core/datastructure/hash_grid.h>
+#include <graph_core/metrics/euclidean_metrics.h>
+#include <cnr_logger/cnr_logger.h>
+#include <random>
+#include <algorithm>
+#include <cmath>
+#include <atomic>
+
+using namespace graph::core;
+
+// Euclidean metrics counting the evaluations of the utopia, which is the distance of the vp-tree (thread-safe, for batch queries)
+class CountingMetrics: public EuclideanMetrics
+{
+public:
+  std::atomic<size_t> evaluations = 0;
+
+  CountingMetrics(const cnr_logger::TraceLoggerPtr& logger):EuclideanMetrics(logger)
+  {}
+
+  using EuclideanMetrics::utopia;
+  virtual double utopia(const Eigen::VectorXd& configuration1,
+                        const Eigen::VectorXd& configuration2) override
+  {
+    evaluations++;
+    return EuclideanMetrics::utopia(configuration1,configuration2);
+  }
+};
+
+bool sameSet(const std::multimap<double,NodePtr>& a, const std::multimap<double,NodePtr>& b)
+{
+  if(a.size() != b.size())
+    return false;
+
+  auto it_a = a.begin();
+  auto it_b = b.begin();
+  for(;it_a != a.end();it_a++,it_b++)
+  {
+    if(std::abs(it_a->first-it_b->first)>1e-9)
+      return false;
+  }
+  return true;
+}
+
+bool sameSet(const std::vector<std::pair<double,Node*>>& a, const std::multimap<double,NodePtr>& b)
+{
+  if(a.size() != b.size())
+    return false;
+
+  auto it_a = a.begin();
+  auto it_b = b.begin();
+  for(;it_a != a.end();it_a++,it_b++)
+  {
+    if(std::abs(it_a->first-it_b->first)>1e-9)
+      return false;
+  }
+  return true;
+}
+
+int main(int argc, char **argv)
+{
+  std::string file_path = std::string(TEST_DIR) + "/logger_param.yaml";
+  std::cout << "file_path = " << file_path << std::endl;
+  // Create the logger
+  cnr_logger::TraceLoggerPtr logger=std::make_shared<cnr_logger::TraceLogger>("nearest_neighbors_test", file_path);
+
+  int n_nodes = 1000;
+  int n_queries = 100;
+  unsigned int dof = 3;
+
+  if(argc > 1)
+    n_nodes = std::atoi(argv[1]);
+  if(argc > 2)
+    dof = std::atoi(argv[2]);
+
+  std::shared_ptr<CountingMetrics> metrics = std::make_shared<CountingMetrics>(logger);
+
+  // The Vector is the brute-force reference
+  NearestNeighborsPtr reference = std::make_shared<Vector>(logger);
+  std::vector<std::pair<std::string,NearestNeighborsPtr>> backends;
+  backends.push_back(std::make_pair("kdtree",      std::make_shared<KdTree>(logger)));
+  backends.push_back(std::make_pair("arena_kdtree",std::make_shared<ArenaKdTree>(logger)));
+  backends.push_back(std::make_pair("bucket_kdtree",std::make_shared<BucketKdTree>(logger)));
+  VpTreePtr vp_tree = std::make_shared<VpTree>(metrics,logger);
+  backends.push_back(std::make_pair("vp_tree",vp_tree));
+  if(dof<=HashGrid::MAX_DIMENSION)
+    backends.push_back(std::make_pair("hash_grid",std::make_shared<HashGrid>(0.2,logger)));
+
+  std::vector<NodePtr> nodes;
+  for(int i=0;i<n_nodes;i++)
+  {
+    Eigen::VectorXd q(dof);
+    q.setRandom();
+    NodePtr node = std::make_shared<Node>(q,logger);
+    nodes.push_back(node);
+
+    reference->insert(node);
+    for(const auto& b:backends)
+      b.second->insert(node);
+  }
+
+  // The same backends, built in a single step
+  std::vector<std::pair<std::string,NearestNeighborsPtr>> built_backends;
+  built_backends.push_back(std::make_pair("kdtree (build)",      std::make_shared<KdTree>(logger)));
+  built_backends.push_back(std::make_pair("arena_kdtree (build)",std::make_shared<ArenaKdTree>(logger)));
+  built_backends.push_back(std::make_pair("bucket_kdtree (build)",std::make_shared<BucketKdTree>(logger)));
+  built_backends.push_back(std::make_pair("vp_tree (build)",std::make_shared<VpTree>(metrics,logger)));
+  if(dof<=HashGrid::MAX_DIMENSION)
+    built_backends.push_back(std::make_pair("hash_grid (build)",std::make_shared<HashGrid>(0.2,logger)));
+
+  bool success = true;
+  for(const auto& b:built_backends)
+  {
+    b.second->build(nodes);
+    if(b.second->getNodes().front() != nodes.front())
+    {
+      CNR_ERROR(logger,b.first<<": the first node is not the first one returned by getNodes");
+      success = false;
+    }
+    backends.push_back(b);
+  }
+
+  // Delete some nodes
+  std::mt19937 rng(0);
+  std::vector<NodePtr> shuffled_nodes = nodes;
+  std::shuffle(shuffled_nodes.begin(),shuffled_nodes.end(),rng);
+  for(int i=0;i<n_nodes/10;i++)
+  {
+    NodePtr n = shuffled_nodes.at(i);
+    reference->deleteNode(n);
+    for(const auto& b:backends)
+    {
+      if(not b.second->deleteNode(n) || b.second->deleteNode(n))
+      {
+        CNR_ERROR(logger,b.first<<": a node should be deleted only once");
+        success = false;
+      }
+    }
+  }
+
+  NodePtr missing_node = std::make_shared<Node>(Eigen::VectorXd::Zero(dof),logger);
+  for(const auto& b:backends)
+  {
+    if(b.second->findNode(missing_node) || b.second->deleteNode(missing_node))
+    {
+      CNR_ERROR(logger,b.first<<": a node never inserted is found");
+      success = false;
+    }
+    for(int i=n_nodes/10;i<n_nodes;i++)
+    {
+      if(not b.second->findNode(shuffled_nodes.at(i)))
+      {
+        CNR_ERROR(logger,b.first<<": node not found");
+        success = false;
+        break;
+      }
+    }
+  }
+
+  double radius = 0.5;
+  size_t k = 10;
+  std::vector<std::pair<double,Node*>> buffer;
+
+  // The queries are repeated with the Euclidean distance and with a weighted one
+  Eigen::VectorXd scale = Eigen::VectorXd::Constant(dof,0.5)+Eigen::VectorXd::Random(dof).cwiseAbs();
+  for(const Eigen::VectorXd& s:{Eigen::VectorXd(),scale})
+  {
+    // The distance of the vp-trees is defined by their metrics, so they are queried only with the Euclidean distance
+    std::vector<std::pair<std::string,NearestNeighborsPtr>> queried_backends;
+    reference->setScale(s);
+    for(const auto& b:backends)
+    {
+      if(s.size()>0 && std::dynamic_pointer_cast<VpTree>(b.second))
+        continue;
+      b.second->setScale(s);
+      queried_backends.push_back(b);
+    }
+
+    for(int i=0;i<n_queries;i++)
+    {
+      // some queries are far from the nodes
+      Eigen::VectorXd q(dof);
+      q.setRandom();
+      if(i%4 == 0)
+        q *= 5.0;
+
+      NodePtr nn_ref;
+      double d_ref;
+      reference->nearestNeighbor(q,nn_ref,d_ref);
+
+      double d_brute_force = std::numeric_limits<double>::infinity();
+      for(const NodePtr& n:reference->getNodes())
+      {
+        Eigen::VectorXd diff = q-n->getConfiguration();
+        if(s.size()>0)
+          diff = s.cwiseProduct(diff);
+        d_brute_force = std::min(d_brute_force,diff.norm());
+      }
+      if(std::abs(d_ref-d_brute_force)>1e-9)
+      {
+        CNR_ERROR(logger,"vector: wrong nearest neighbor distance "<<d_ref<<" instead of "<<d_brute_force);
+        success = false;
+      }
+
+      std::multimap<double,NodePtr> near_ref = reference->near(q,radius);
+      std::multimap<double,NodePtr> knn_ref = reference->kNearestNeighbors(q,k);
+
+      for(const auto& b:queried_backends)
+      {
+        NodePtr nn;
+        double d;
+        b.second->nearestNeighbor(q,nn,d);
+
+        if(std::abs(d-d_ref)>1e-9)
+        {
+          CNR_ERROR(logger,b.first<<": wrong nearest neighbor distance "<<d<<" instead of "<<d_ref);
+          success = false;
+        }
+        if(not sameSet(b.second->near(q,radius),near_ref))
+        {
+          CNR_ERROR(logger,b.first<<": wrong near set");
+          success = false;
+        }
+        if(not sameSet(b.second->kNearestNeighbors(q,k),knn_ref))
+        {
+          CNR_ERROR(logger,b.first<<": wrong k-nearest neighbors set");
+          success = false;
+        }
+
+        b.second->near(q,radius,buffer);
+        if(not sameSet(buffer,near_ref))
+        {
+          CNR_ERROR(logger,b.first<<": wrong near set written into the buffer");
+          success = false;
+        }
+        b.second->kNearestNeighbors(q,k,buffer);
+        if(not sameSet(buffer,knn_ref))
+        {
+          CNR_ERROR(logger,b.first<<": wrong k-nearest neighbors set written into the buffer");
+          success = false;
+        }
+
+        // The visitor stops the search at the first node found
+        size_t visited = 0;
+        bool completed = b.second->near(q,radius,[&visited](const double& distance, const NodePtr& node){
+          visited++;
+          return false;
+        });
+        if(visited != std::min<size_t>(1,near_ref.size()) || completed == (visited>0))
+        {
+          CNR_ERROR(logger,b.first<<": the near visitor did not stop the search");
+          success = false;
+        }
+      }
+    }
+  }
+
+  // Approximate queries: the (k-th) distance returned is at most (1+epsilon) times the exact one
+  double epsilon = 0.5;
+  reference->setScale(Eigen::VectorXd());
+  for(const auto& b:backends)
+  {
+    if(not std::dynamic_pointer_cast<VpTree>(b.second))
+      b.second->setScale(Eigen::VectorXd());
+    b.second->setEpsilon(epsilon);
+  }
+
+  for(int i=0;i<n_queries;i++)
+  {
+    Eigen::VectorXd q(dof);
+    q.setRandom();
+
+    NodePtr nn_ref;
+    double d_ref;
+    reference->nearestNeighbor(q,nn_ref,d_ref);
+    std::multimap<double,NodePtr> knn_ref = reference->kNearestNeighbors(q,k);
+    std::multimap<double,NodePtr> near_ref = reference->near(q,radius);
+
+    for(const auto& b:backends)
+    {
+      NodePtr nn;
+      double d;
+      b.second->nearestNeighbor(q,nn,d);
+      if(d<d_ref-1e-9 || d>(1.0+epsilon)*d_ref+1e-9)
+      {
+        CNR_ERROR(logger,b.first<<": approximate nearest neighbor distance "<<d<<" out of ["<<d_ref<<", "<<(1.0+epsilon)*d_ref<<"]");
+        success = false;
+      }
+
+      std::multimap<double,NodePtr> knn = b.second->kNearestNeighbors(q,k);
+      bool within_bound = (knn.size() == knn_ref.size());
+      for(auto it=knn.begin(),it_ref=knn_ref.begin();within_bound && it!=knn.end();it++,it_ref++)
+        within_bound = (it->first>=it_ref->first-1e-9 && it->first<=(1.0+epsilon)*it_ref->first+1e-9);
+      if(not within_bound)
+      {
+        CNR_ERROR(logger,b.first<<": approximate k-nearest neighbors out of bound");
+        success = false;
+      }
+
+      if(not sameSet(b.second->near(q,radius),near_ref))
+      {
+        CNR_ERROR(logger,b.first<<": the near set should be exact also with epsilon>0");
+        success = false;
+      }
+    }
+  }
+
+  for(const auto& b:backends)
+  {
+    b.second->setEpsilon(0.0);
+    if(b.second->size() != reference->size())
+    {
+      CNR_ERROR(logger,b.first<<": wrong size "<<b.second->size()<<" instead of "<<reference->size());
+      success = false;
+    }
+
+    Eigen::VectorXd q(dof);
+    q.setRandom();
+    if(not b.second->kNearestNeighbors(q,0).empty() ||
+       b.second->kNearestNeighbors(q,2*n_nodes).size() != reference->size())
+    {
+      CNR_ERROR(logger,b.first<<": wrong number of k-nearest neighbors when k is 0 or greater than the size");
+      success = false;
+    }
+  }
+
+  // Batch queries, run in the calling thread or split among threads, give the same results as single queries
+  std::vector<Eigen::VectorXd> batch;
+  for(int i=0;i<n_queries;i++)
+    batch.push_back(Eigen::VectorXd::Random(dof));
+
+  std::vector<std::pair<double,Node*>> batch_nodes;
+  for(const auto& b:backends)
+  {
+    for(unsigned int n_threads:{1,4})
+    {
+      b.second->nearestNeighbors(batch,batch_nodes,n_threads);
+      bool same_results = (batch_nodes.size() == batch.size());
+      for(size_t i=0;same_results && i<batch.size();i++)
+      {
+        NodePtr nn;
+        double d;
+        b.second->nearestNeighbor(batch[i],nn,d);
+        same_results = (batch_nodes[i].second == nn.get() && batch_nodes[i].first == d);
+      }
+      if(not same_results)
+      {
+        CNR_ERROR(logger,b.first<<": wrong batch nearest neighbors with "<<n_threads<<" threads");
+        success = false;
+      }
+
+      size_t batch_k = 2*n_nodes;
+      for(const size_t& kk:{k,batch_k})
+      {
+        b.second->kNearestNeighbors(batch,kk,batch_nodes,n_threads);
+        same_results = (batch_nodes.size() == batch.size()*kk);
+        for(size_t i=0;same_results && i<batch.size();i++)
+        {
+          b.second->kNearestNeighbors(batch[i],kk,buffer);
+          for(size_t j=0;same_results && j<kk;j++)
+          {
+            const std::pair<double,Node*>& n = batch_nodes[i*kk+j];
+            if(j<buffer.size())
+              same_results = (std::abs(n.first-buffer[j].first)<1e-12 && n.second);
+            else
+              same_results = (n.first == std::numeric_limits<double>::infinity() && not n.second);
+          }
+        }
+        if(not same_results)
+        {
+          CNR_ERROR(logger,b.first<<": wrong batch k-nearest neighbors with k = "<<kk<<" and "<<n_threads<<" threads");
+          success = false;
+        }
+      }
+    }
+  }
+
+  ArenaKdTreePtr empty_kdtree = std::make_shared<ArenaKdTree>(logger);
+  empty_kdtree->nearestNeighbors(batch,batch_nodes,4);
+  if(batch_nodes.size() != batch.size() || batch_nodes.front().second || batch_nodes.front().first != std::numeric_limits<double>::infinity())
+  {
+    CNR_ERROR(logger,"arena_kdtree: batch nearest neighbors of an empty data structure should be (infinity, nullptr)");
+    success = false;
+  }
+
+  // A worker pool runs each task once, nested batches included, and can be passed to the batch queries
+  WorkerPoolPtr pool = std::make_shared<WorkerPool>(3);
+  std::vector<std::atomic<int>> task_runs(100);
+  std::atomic<int> nested_runs(0);
+  for(int repetition=0;repetition<10;repetition++)
+  {
+    pool->run(task_runs.size(),[&](const size_t& task){
+      task_runs[task]++;
+      if(task == 0)
+        pool->run(4,[&](const size_t&){nested_runs++;});
+    });
+  }
+  bool pool_ok = (nested_runs == 40) && std::all_of(task_runs.begin(),task_runs.end(),[](const std::atomic<int>& r){return r == 10;});
+
+  std::vector<std::pair<double,Node*>> pool_nodes;
+  for(const auto& b:backends)
+  {
+    b.second->nearestNeighbors(batch,batch_nodes,1);
+    b.second->nearestNeighbors(batch,pool_nodes,0,pool);
+    pool_ok = pool_ok && (batch_nodes == pool_nodes);
+  }
+  if(not pool_ok)
+  {
+    CNR_ERROR(logger,"wrong results of the worker pool");
+    success = false;
+  }
+
+  // Spatially correlated insertions (random walk, as in RRT-like planners) must not degrade the depth of the ArenaKdTree
+  ArenaKdTreePtr balanced_kdtree = std::make_shared<ArenaKdTree>(logger);
+  Eigen::VectorXd q = Eigen::VectorXd::Zero(dof);
+  for(int i=0;i<n_nodes;i++)
+  {
+    q += 0.01*Eigen::VectorXd::Random(dof);
+    balanced_kdtree->insert(std::make_shared<Node>(q,logger));
+  }
+
+  ArenaKdTree::Statistics stats = balanced_kdtree->statistics();
+  unsigned int max_depth = std::floor(std::log(n_nodes)/std::log(1.0/balanced_kdtree->balanceFactor()));
+
+  CNR_INFO(logger,"arena_kdtree random walk: max depth "<<stats.max_depth<<" (bound "<<max_depth<<"), average depth "<<stats.average_depth
+           <<", partial rebuilds "<<stats.partial_rebuilds<<", rebuilt nodes "<<stats.rebuilt_nodes);
+
+  if(stats.max_depth>max_depth+1)
+  {
+    CNR_ERROR(logger,"arena_kdtree: max depth "<<stats.max_depth<<" is greater than the bound "<<max_depth);
+    success = false;
+  }
+
+  // The same holds for the VpTree
+  VpTreePtr balanced_vp_tree = std::make_shared<VpTree>(metrics,logger);
+  q.setZero();
+  for(int i=0;i<n_nodes;i++)
+  {
+    q += 0.01*Eigen::VectorXd::Random(dof);
+    balanced_vp_tree->insert(std::make_shared<Node>(q,logger));
+  }
+
+  VpTree::Statistics vp_stats = balanced_vp_tree->statistics();
+  max_depth = std::floor(std::log(n_nodes)/std::log(1.0/balanced_vp_tree->balanceFactor()));
+
+  CNR_INFO(logger,"vp_tree random walk: max depth "<<vp_stats.max_depth<<" (bound "<<max_depth<<"), average depth "<<vp_stats.average_depth
+           <<", partial rebuilds "<<vp_stats.partial_rebuilds<<", rebuilt nodes "<<vp_stats.rebuilt_nodes);
+
+  if(vp_stats.max_depth>max_depth+1)
+  {
+    CNR_ERROR(logger,"vp_tree: max depth "<<vp_stats.max_depth<<" is greater than the bound "<<max_depth);
+    success = false;
+  }
+
+  // In low dimension, the triangle inequality prunes most of the vp-tree
+  std::vector<Eigen::VectorXd> queries;
+  for(int i=0;i<n_queries;i++)
+    queries.push_back(Eigen::VectorXd::Random(dof));
+
+  metrics->evaluations = 0;
+  for(const Eigen::VectorXd& query:queries)
+  {
+    NodePtr nn;
+    double d;
+    vp_tree->nearestNeighbor(query,nn,d);
+  }
+  double evaluations = static_cast<double>(metrics->evaluations)/n_queries;
+  CNR_INFO(logger,"vp_tree: "<<evaluations<<" metrics evaluations per nearest neighbor query with "<<vp_tree->size()<<" nodes");
+
+  if(dof<=4 && evaluations>0.25*vp_tree->size())
+  {
+    CNR_ERROR(logger,"vp_tree: too many metrics evaluations per query ("<<evaluations<<")");
+    success = false;
+  }
+
+  // Approximate queries prune more
+  vp_tree->setEpsilon(epsilon);
+  metrics->evaluations = 0;
+  for(const Eigen::VectorXd& query:queries)
+  {
+    NodePtr nn;
+    double d;
+    vp_tree->nearestNeighbor(query,nn,d);
+  }
+  double approximate_evaluations = static_cast<double>(metrics->evaluations)/n_queries;
+  CNR_INFO(logger,"vp_tree: "<<approximate_evaluations<<" metrics evaluations per nearest neighbor query with epsilon = "<<epsilon);
+  vp_tree->setEpsilon(0.0);
+
+  if(approximate_evaluations>evaluations)
+  {
+    CNR_ERROR(logger,"vp_tree: approximate queries evaluate the metrics more than exact ones ("<<approximate_evaluations<<" > "<<evaluations<<")");
+    success = false;
+  }
+
+  if(success)
+    CNR_INFO(logger, cnr_logger::RESET() << cnr_logger::GREEN() << "All nearest neighbors backends agree with the brute-force search");
+
+  return success? 0: 1;
+}
@@ -1,8 +1,23 @@
 #include <graph_core/graph/connection.h>
 #include <graph_core/graph/node.h>
+#include <graph_core/graph/node_side_table.h>
+#include <graph_core/graph/flag_set.h>
+#include <graph_core/graph/graph_pool.h>
 #include <cnr_logger/cnr_logger.h>
+#include <thread>
 
 
+/**
+ * @brief Exposes the storage of a PropertySet to check that it does not depend on the registered names.
+ */
+struct InspectablePropertySet: public graph::core::PropertySet
+{
+  size_t storage() const
+  {
+    return values_? values_->capacity(): 0;
+  }
+};
+
 int main(int argc, char **argv)
 {
   std::string file_path = std::string(TEST_DIR) + "/logger_param.yaml";
@@ -199,5 +214,230 @@ int main(int argc, char **argv)
 
   CNR_INFO(logger, cnr_logger::RESET() << cnr_logger::BOLDGREEN() << "Done!");
 
+  CNR_INFO(logger, cnr_logger::RESET() << cnr_logger::WHITE() << "--- Create nodes and connections in a memory pool ---");
+  graph::core::GraphPoolPtr pool = std::make_shared<graph::core::GraphPool>();
+  graph::core::NodePtr pool_parent = pool->makeNode(q1,logger);
+  graph::core::NodePtr pool_child  = pool->makeNode(q2,logger);
+  graph::core::ConnectionPtr pool_connection = pool->makeConnection(pool_parent,pool_child,logger);
+  pool_connection->add();
+  pool_connection.reset();
+
+  if((pool->allocatedObjects() != 3) || (pool_child->getParents().front() != pool_parent) ||
+     (pool_parent->getChildConnections().front()->getChild() != pool_child))
+  {
+    CNR_FATAL(logger,"something went wrong with the memory pool");
+    throw std::runtime_error("something went wrong with the memory pool");
+  }
+
+  // The nodes keep the pool alive
+  graph::core::GraphPool* pool_ptr = pool.get();
+  pool.reset();
+  pool_parent.reset();  //releases the connection too
+  if(pool_ptr->allocatedObjects() != 1 || pool_child->getParentConnectionsSize() != 0)
+  {
+    CNR_FATAL(logger,"something went wrong with the memory pool release");
+    throw std::runtime_error("something went wrong with the memory pool release");
+  }
+  pool_child.reset();
+
+  CNR_INFO(logger, cnr_logger::RESET() << cnr_logger::BOLDGREEN() << "Done!");
+
+  CNR_INFO(logger, cnr_logger::RESET() << cnr_logger::WHITE() << "--- Set and get properties ---");
+  const graph::core::PropertyKey<double> clearance_key("clearance");
+  const graph::core::PropertyKey<std::string> label_key("label");
+
+  bool properties_ok = parent->properties_.empty() && not parent->properties_.has(clearance_key);
+  parent->properties_.set(clearance_key,0.5);
+  parent->properties_["label"] = std::string("start");
+  properties_ok = properties_ok && (*parent->properties_.get(clearance_key) == 0.5) &&
+      (*parent->properties_.get(label_key) == "start") && (parent->properties_.count("clearance") == 1) &&
+      (std::any_cast<double>(parent->properties_.at("clearance")) == 0.5) && (parent->properties_.size() == 2) &&
+      (child->properties_.get(clearance_key) == nullptr) && (child->properties_.count("label") == 0);
+
+  parent->properties_.erase("clearance");
+  properties_ok = properties_ok && not parent->properties_.has(clearance_key) && (parent->properties_.size() == 1);
+
+  // The storage of a set depends on its own properties, not on the number of registered names
+  for(unsigned int i=0;i<1000;i++)
+    graph::core::PropertyRegistry::intern("unused_property_"+std::to_string(i));
+  const graph::core::PropertyKey<int> last_key("last_property");
+
+  InspectablePropertySet sparse;
+  sparse.set(last_key,7);
+  properties_ok = properties_ok && (*sparse.get(last_key) == 7) && (sparse.size() == 1) && (sparse.storage() < 8);
+
+  // String lookups from several threads, while other names are registered
+  const graph::core::PropertySet& shared_properties = parent->properties_;
+  std::vector<size_t> found(4,0);
+  std::vector<std::thread> readers;
+  for(size_t t=0;t<found.size();t++)
+  {
+    readers.emplace_back([&,t](){
+      for(unsigned int i=0;i<1000;i++)
+      {
+        found[t] += shared_properties.count("label");
+        found[t] += shared_properties.count("clearance");
+        if(i%10 == 0)
+          graph::core::PropertyRegistry::intern("thread_property_"+std::to_string(t)+"_"+std::to_string(i));
+      }
+    });
+  }
+  for(std::thread& reader: readers)
+    reader.join();
+  for(const size_t& n: found)
+    properties_ok = properties_ok && (n == 1000);
+
+  if(not properties_ok)
+  {
+    CNR_FATAL(logger,"something went wrong with properties");
+    throw std::runtime_error("something went wrong with properties");
+  }
+
+  CNR_INFO(logger, cnr_logger::RESET() << cnr_logger::BOLDGREEN() << "Done!");
+
+  CNR_INFO(logger, cnr_logger::RESET() << cnr_logger::WHITE() << "--- Update the cached cost to come ---");
+  // root -> n1 -> n2, then n2 is rewired to root
+  graph::core::NodePtr root = std::make_shared<graph::core::Node>(q1,logger);
+  graph::core::NodePtr n1 = std::make_shared<graph::core::Node>(q2,logger);
+  graph::core::NodePtr n2 = std::make_shared<graph::core::Node>(q3,logger);
+  graph::core::ConnectionPtr conn_r1 = std::make_shared<graph::core::Connection>(root,n1,logger);
+  graph::core::ConnectionPtr conn_12 = std::make_shared<graph::core::Connection>(n1,n2,logger);
+  conn_r1->setCost(1.0);
+  conn_r1->add();
+  conn_12->setCost(2.0);
+  conn_12->add();
+
+  graph::core::Node* cost_root;
+  bool cost_ok = (n2->getCostToCome(cost_root) == 3.0) && (cost_root == root.get());
+
+  conn_r1->setCost(4.0);
+  cost_ok = cost_ok && (n2->getCostToCome(cost_root) == 6.0) && (n1->getCostToCome(cost_root) == 4.0);
+
+  conn_12->remove();
+  graph::core::ConnectionPtr conn_r2 = std::make_shared<graph::core::Connection>(root,n2,logger);
+  conn_r2->setCost(5.0);
+  conn_r2->add();
+  cost_ok = cost_ok && (n2->getCostToCome(cost_root) == 5.0) && (cost_root == root.get());
+
+  conn_r2->remove();
+  cost_ok = cost_ok && (n2->getCostToCome(cost_root) == 0.0) && (cost_root == n2.get());
+
+  if(not cost_ok)
+  {
+    CNR_FATAL(logger,"something went wrong with the cost to come");
+    throw std::runtime_error("something went wrong with the cost to come");
+  }
+
+  CNR_INFO(logger, cnr_logger::RESET() << cnr_logger::BOLDGREEN() << "Done!");
+
+  CNR_INFO(logger, cnr_logger::RESET() << cnr_logger::WHITE() << "--- Iterate the adjacency views ---");
+  // root -> n1 and the net connection root -> n2
+  graph::core::ConnectionPtr net_r2 = std::make_shared<graph::core::Connection>(root,n2,logger,true);
+  net_r2->add();
+
+  bool views_ok = (root->childConnectionsView().size() == 1) && (root->childConnectionsView().front() == conn_r1) &&
+      (root->childrenView().front() == n1) && (n1->parentConnectionsView().front() == conn_r1.get()) &&
+      (n1->parentsView().front() == root.get()) && (root->netChildrenView().front() == n2) &&
+      (n2->netParentsView().front() == root.get()) && n2->parentsView().empty() && root->parentsView().empty();
+
+  conn_r1->flip();
+  views_ok = views_ok && (root->parentsView().front() == n1.get()) && n1->parentsView().empty() &&
+      (n1->childrenView().front() == root) && root->childConnectionsView().empty();
+
+  if(not views_ok)
+  {
+    CNR_FATAL(logger,"something went wrong with the adjacency views");
+    throw std::runtime_error("something went wrong with the adjacency views");
+  }
+
+  CNR_INFO(logger, cnr_logger::RESET() << cnr_logger::BOLDGREEN() << "Done!");
+
+  CNR_INFO(logger, cnr_logger::RESET() << cnr_logger::WHITE() << "--- Check node ids and side tables ---");
+  std::vector<graph::core::NodePtr> id_nodes = {root,n1,n2};
+  bool ids_ok = (root->getId() != n1->getId()) && (n1->getId() != n2->getId()) && (root->getId() != n2->getId());
+  for(const graph::core::NodePtr& n: id_nodes)
+    ids_ok = ids_ok && (n->getId() < graph::core::Node::getIdBound());
+
+  graph::core::NodeSideTable<double> table(-1.0);
+  table[n1] = 1.0;
+  ids_ok = ids_ok && (table.get(n1) == 1.0) && (table.get(n2) == -1.0);
+
+  unsigned int released_id;
+  {
+    graph::core::NodePtr tmp = std::make_shared<graph::core::Node>(q1,logger);
+    released_id = tmp->getId();
+    table[tmp] = 2.0;
+  }
+  graph::core::NodePtr reused = std::make_shared<graph::core::Node>(q2,logger);
+  ids_ok = ids_ok && (reused->getId() == released_id);
+
+  table.reset();
+  ids_ok = ids_ok && (table.get(reused) == -1.0) && (table.get(n1) == -1.0);
+
+  if(not ids_ok)
+  {
+    CNR_FATAL(logger,"something went wrong with the node ids");
+    throw std::runtime_error("something went wrong with the node ids");
+  }
+
+  CNR_INFO(logger, cnr_logger::RESET() << cnr_logger::BOLDGREEN() << "Done!");
+
+  CNR_INFO(logger, cnr_logger::RESET() << cnr_logger::WHITE() << "--- Check flags beyond the inline ones ---");
+  const size_t n_flags = 3*graph::core::FlagSet::INLINE_FLAGS+5;
+  auto expected_flag = [](const size_t& i){return i%3 == 0 || i%7 == 0;};
+
+  graph::core::FlagSet flag_set;
+  for(size_t i=0;i<n_flags;i++)
+    flag_set.push_back(expected_flag(i));
+
+  bool flags_ok = (flag_set.size() == n_flags);
+  for(size_t i=0;i<n_flags;i++)
+    flags_ok = flags_ok && (flag_set[i] == expected_flag(i));
+
+  // Copies own their overflow words
+  graph::core::FlagSet copied_set(flag_set);
+  graph::core::FlagSet assigned_set = {true,false};
+  assigned_set = flag_set;
+  assigned_set = assigned_set;
+
+  const size_t overflow_idx = graph::core::FlagSet::INLINE_FLAGS+1;
+  flag_set.set(overflow_idx,not expected_flag(overflow_idx));
+  flag_set.set(n_flags-1,not expected_flag(n_flags-1));
+
+  flags_ok = flags_ok && (copied_set.size() == n_flags) && (assigned_set.size() == n_flags);
+  for(size_t i=0;i<n_flags;i++)
+    flags_ok = flags_ok && (copied_set[i] == expected_flag(i)) && (assigned_set[i] == expected_flag(i));
+  flags_ok = flags_ok && (flag_set[overflow_idx] != expected_flag(overflow_idx)) && (flag_set[n_flags-1] != expected_flag(n_flags-1));
+
+  // setFlag(flag) returns the index of the new flag, which stores the given value
+  graph::core::NodePtr flagged_node = std::make_shared<graph::core::Node>(q1,logger);
+  graph::core::ConnectionPtr flagged_conn = std::make_shared<graph::core::Connection>(parent,flagged_node,logger);
+  for(size_t i=0;i<n_flags;i++)
+  {
+    size_t node_size = flagged_node->getFlagsSize();
+    size_t conn_size = flagged_conn->getFlagsSize();
+    unsigned int node_idx = flagged_node->setFlag(expected_flag(i));
+    unsigned int conn_idx = flagged_conn->setFlag(expected_flag(i));
+
+    flags_ok = flags_ok && (node_idx == node_size) && (flagged_node->getFlag(node_idx,not expected_flag(i)) == expected_flag(i));
+    flags_ok = flags_ok && (conn_idx == conn_size) && (flagged_conn->getFlag(conn_idx,not expected_flag(i)) == expected_flag(i));
+  }
+
+  unsigned int true_idx = flagged_node->setFlag(true);
+  flags_ok = flags_ok && (true_idx > graph::core::FlagSet::INLINE_FLAGS) && flagged_node->getFlag(true_idx,false);
+  flags_ok = flags_ok && flagged_node->setFlag(true_idx,false) && not flagged_node->getFlag(true_idx,true);
+  flags_ok = flags_ok && not flagged_node->setFlag(true_idx+2,true);
+
+  true_idx = flagged_conn->setFlag(true);
+  flags_ok = flags_ok && (true_idx > graph::core::FlagSet::INLINE_FLAGS) && flagged_conn->getFlag(true_idx,false);
+
+  if(not flags_ok)
+  {
+    CNR_FATAL(logger,"something went wrong with the flags");
+    throw std::runtime_error("something went wrong with the flags");
+  }
+
+  CNR_INFO(logger, cnr_logger::RESET() << cnr_logger::BOLDGREEN() << "Done!");
+
   return 0;
 }
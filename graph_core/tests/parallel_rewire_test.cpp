@@ -0,0 +1,76 @@
+#include <graph_core/graph/tree.h>
+#include <graph_core/metrics/euclidean_metrics.h>
+#include <graph_core/collision_checkers/cube_3d_collision_checker.h>
+#include <cnr_logger/cnr_logger.h>
+
+using namespace graph::core;
+
+int main(int argc, char **argv)
+{
+  std::string file_path = std::string(TEST_DIR) + "/logger_param.yaml";
+  std::cout << "file_path = " << file_path << std::endl;
+  // Create the logger
+  cnr_logger::TraceLoggerPtr logger=std::make_shared<cnr_logger::TraceLogger>("parallel_rewire_test", file_path);
+
+  int n_samples = 3000;
+  unsigned int n_threads = 4;
+
+  if(argc > 1)
+    n_samples = std::atoi(argv[1]);
+  if(argc > 2)
+    n_threads = std::atoi(argv[2]);
+
+  MetricsPtr metrics = std::make_shared<EuclideanMetrics>(logger);
+  CollisionCheckerPtr checker = std::make_shared<Cube3dCollisionChecker>(logger);
+
+  // Two trees grown with the same samples, the second one checks the rewire candidates in parallel
+  Eigen::VectorXd root_conf = -2.0*Eigen::VectorXd::Ones(3);
+  TreePtr serial_tree = std::make_shared<Tree>(std::make_shared<Node>(root_conf,logger),0.5,checker,metrics,logger,NearestNeighborsType::KdTree);
+  TreePtr parallel_tree = std::make_shared<Tree>(std::make_shared<Node>(root_conf,logger),0.5,checker->clone(),metrics,logger,NearestNeighborsType::KdTree);
+  parallel_tree->setRewireThreads(n_threads);
+
+  bool success = true;
+  double r_rewire = 1.0;
+  for(int i=0;i<n_samples;i++)
+  {
+    Eigen::VectorXd q = 3.0*Eigen::VectorXd::Random(3);
+    if(serial_tree->rewire(q,r_rewire) != parallel_tree->rewire(q,r_rewire))
+    {
+      CNR_ERROR(logger,"rewire "<<i<<" gives a different result with "<<n_threads<<" threads");
+      success = false;
+      break;
+    }
+  }
+
+  if(serial_tree->getNumberOfNodes() != parallel_tree->getNumberOfNodes())
+  {
+    CNR_ERROR(logger,"the trees have "<<serial_tree->getNumberOfNodes()<<" and "<<parallel_tree->getNumberOfNodes()<<" nodes");
+    success = false;
+  }
+
+  // Same parents and costs
+  for(const NodePtr& n: serial_tree->getNodes())
+  {
+    NodePtr m = parallel_tree->findClosestNode(n->getConfiguration());
+    if(m->getConfiguration() != n->getConfiguration())
+    {
+      CNR_ERROR(logger,"node "<<n<<" not found in the tree rewired in parallel");
+      success = false;
+      continue;
+    }
+    if(n == serial_tree->getRoot())
+      continue;
+
+    if(m->getParents().front()->getConfiguration() != n->getParents().front()->getConfiguration() ||
+       serial_tree->costToNode(n) != parallel_tree->costToNode(m))
+    {
+      CNR_ERROR(logger,"node "<<n<<" has a different parent in the tree rewired in parallel");
+      success = false;
+    }
+  }
+
+  if(success)
+    CNR_INFO(logger, cnr_logger::RESET() << cnr_logger::BOLDGREEN() << "Done!");
+
+  return success? 0: 1;
+}
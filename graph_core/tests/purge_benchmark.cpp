@@ -0,0 +1,69 @@
+#include <graph_core/graph/tree.h>
+#include <graph_core/metrics/euclidean_metrics.h>
+#include <cnr_logger/cnr_logger.h>
+#include <random>
+
+using namespace graph::core;
+
+int main(int argc, char **argv)
+{
+  std::string file_path = std::string(TEST_DIR) + "/logger_param.yaml";
+  std::cout << "file_path = " << file_path << std::endl;
+  // Create the logger
+  cnr_logger::TraceLoggerPtr logger=std::make_shared<cnr_logger::TraceLogger>("purge_benchmark", file_path);
+
+  int n_nodes = 100000;
+  unsigned int dof = 6;
+
+  if(argc > 1)
+    n_nodes = std::atoi(argv[1]);
+  if(argc > 2)
+    dof = std::atoi(argv[2]);
+
+  MetricsPtr metrics = std::make_shared<EuclideanMetrics>(logger);
+
+  bool success = true;
+  for(const NearestNeighborsType& type: {NearestNeighborsType::Vector,
+      NearestNeighborsType::KdTree,
+      NearestNeighborsType::ArenaKdTree,
+      NearestNeighborsType::BucketKdTree,
+      NearestNeighborsType::VpTree,
+      NearestNeighborsType::HashGrid})
+  {
+    // Random tree: each node is connected to a random node added before it
+    std::mt19937 rng(0);
+    NodePtr root = std::make_shared<Node>(Eigen::VectorXd::Zero(dof),logger);
+    std::vector<NodePtr> nodes;
+    nodes.push_back(root);
+    for(int i=0;i<n_nodes;i++)
+    {
+      NodePtr parent = nodes.at(std::uniform_int_distribution<int>(0,nodes.size()-1)(rng));
+      NodePtr node = std::make_shared<Node>(Eigen::VectorXd::Random(dof),logger);
+      ConnectionPtr conn = std::make_shared<Connection>(parent,node,logger);
+      conn->setCost(metrics->cost(parent,node));
+      conn->add();
+      nodes.push_back(node);
+    }
+
+    TreePtr tree = std::make_shared<Tree>(root,1.0,nullptr,metrics,logger,type);
+
+    graph_time_point tic = graph_time::now();
+    for(size_t i=1;i<nodes.size();i++)
+      tree->addNode(nodes.at(i)); //checks if the node is already in the tree
+    double add_time = toSeconds(graph_time::now(),tic);
+
+    tic = graph_time::now();
+    tree->cleanTree(); //purges every node but the root
+    double purge_time = toSeconds(graph_time::now(),tic);
+
+    CNR_INFO(logger,toString(type)<<": "<<n_nodes<<" nodes added in "<<add_time<<" s, purged in "<<purge_time<<" s");
+
+    if(tree->getNumberOfNodes() != 1)
+    {
+      CNR_ERROR(logger,toString(type)<<": "<<tree->getNumberOfNodes()<<" nodes left after the purge instead of 1");
+      success = false;
+    }
+  }
+
+  return success? 0: 1;
+}
@@ -0,0 +1,153 @@
+#include <graph_core/solvers/rrt_star.h>
+#include <graph_core/metrics/euclidean_metrics.h>
+#include <graph_core/samplers/uniform_sampler.h>
+#include <graph_core/collision_checkers/cube_3d_collision_checker.h>
+#include <cnr_logger/cnr_logger.h>
+
+using namespace graph::core;
+
+int main(int argc, char **argv)
+{
+  std::string file_path = std::string(TEST_DIR) + "/logger_param.yaml";
+  std::cout << "file_path = " << file_path << std::endl;
+  // Create the logger
+  cnr_logger::TraceLoggerPtr logger=std::make_shared<cnr_logger::TraceLogger>("roadmap_cache_test", file_path);
+
+  std::string directory = "/tmp";
+  if(argc > 1)
+    directory = argv[1];
+
+  MetricsPtr metrics = std::make_shared<EuclideanMetrics>(logger);
+  CollisionCheckerPtr checker = std::make_shared<Cube3dCollisionChecker>(logger);
+  SamplerPtr sampler = std::make_shared<UniformSampler>(-3.0*Eigen::VectorXd::Ones(3),3.0*Eigen::VectorXd::Ones(3),logger);
+
+  RoadmapCachePtr cache = std::make_shared<RoadmapCache>(directory,logger);
+  std::string environment_id = "roadmap_cache_test/cube";
+  cache->remove(environment_id,checker);
+
+  Eigen::VectorXd start(3), goal(3), new_start(3);
+  start << -2.0, -2.0, -2.0;
+  goal << 2.0, 2.0, 2.0;
+  new_start << -2.1, -2.0, -1.9;
+
+  bool success = true;
+
+  // Without a cached tree, the solver starts from an empty tree
+  TreeSolverPtr solver = std::make_shared<RRT>(metrics,checker,sampler,logger);
+  solver->setRoadmapCache(cache,environment_id);
+  PathPtr solution;
+  if(not solver->computePath(start,goal,"/roadmap_cache_test",solution,5.0,100000))
+  {
+    CNR_ERROR(logger,"no solution found");
+    return 1;
+  }
+  // Settings stored with the tree, different from the ones of the solvers loading it
+  solver->getStartTree()->setNearestNeighborsScale(2.0*Eigen::VectorXd::Ones(3));
+  solver->getStartTree()->setNearestNeighborsEpsilon(0.5);
+  if(not solver->storeToRoadmapCache() || not cache->has(environment_id,checker))
+  {
+    CNR_ERROR(logger,"cannot store the tree");
+    return 1;
+  }
+  unsigned int n_nodes = solver->getStartTree()->getNumberOfNodes();
+
+  // A different checker does not share the cache
+  CollisionCheckerPtr other_checker = std::make_shared<Cube3dCollisionChecker>(logger,0.1);
+  if(cache->has(environment_id,other_checker) || cache->getFileName(environment_id,checker) == cache->getFileName(environment_id,other_checker))
+  {
+    CNR_ERROR(logger,"a tree is cached for a different collision checker");
+    success = false;
+  }
+
+  // A new solver, e.g. after a restart, starts from the cached tree rooted at the new start
+  TreeSolverPtr new_solver = std::make_shared<RRT>(metrics,checker,sampler,logger);
+  new_solver->setRoadmapCache(cache,environment_id);
+  new_solver->config("/roadmap_cache_test");
+  NodePtr new_start_node = std::make_shared<Node>(new_start,logger);
+  if(not new_solver->addStartFromRoadmapCache(new_start_node))
+  {
+    CNR_ERROR(logger,"cannot start from the cached tree");
+    return 1;
+  }
+  TreePtr tree = new_solver->getStartTree();
+  if(tree->getRoot() != new_start_node || tree->getNumberOfNodes() != n_nodes+1)
+  {
+    CNR_ERROR(logger,"the cached tree has "<<tree->getNumberOfNodes()<<" nodes instead of "<<n_nodes+1);
+    success = false;
+  }
+
+  // The cached tree uses the nearest neighbors settings of the solver, as a tree created by addStart
+  if(tree->getNearestNeighborsScale().size() != 0 || tree->getNearestNeighborsEpsilon() != 0.0 || tree->getPool())
+  {
+    CNR_ERROR(logger,"the cached tree does not use the nearest neighbors settings of the solver");
+    success = false;
+  }
+
+  // A start out of the bounds of the sampler is rejected, as by addStart, even if it can be connected to the cached tree
+  SamplerPtr bounded_sampler = std::make_shared<UniformSampler>(-2.0*Eigen::VectorXd::Ones(3),3.0*Eigen::VectorXd::Ones(3),logger);
+  TreeSolverPtr bounded_solver = std::make_shared<RRT>(metrics,checker,bounded_sampler,logger);
+  bounded_solver->setRoadmapCache(cache,environment_id);
+  bounded_solver->config("/roadmap_cache_test");
+  NodePtr out_of_bounds_node = std::make_shared<Node>(new_start,logger);
+  if(bounded_solver->addStartFromRoadmapCache(out_of_bounds_node) || out_of_bounds_node->getParentConnectionsSize()>0)
+  {
+    CNR_ERROR(logger,"a start out of bounds has been connected to the cached tree");
+    success = false;
+  }
+
+  // Every branch of the cached tree is collision-free and starts from the new root
+  std::vector<NodePtr> leaves;
+  tree->getLeaves(leaves);
+  for(const NodePtr& leaf: leaves)
+  {
+    std::vector<ConnectionPtr> branch = tree->getConnectionToNode(leaf);
+    if(branch.empty() || branch.front()->getParent() != new_start_node || not checker->checkConnections(branch))
+    {
+      CNR_ERROR(logger,"invalid branch in the cached tree");
+      success = false;
+      break;
+    }
+  }
+
+  // computePath uses the cached tree as well
+  PathPtr new_solution;
+  if(not new_solver->computePath(new_start,goal,"/roadmap_cache_test",new_solution,5.0,100000) || new_solver->getStartTree()->getNumberOfNodes()<n_nodes)
+  {
+    CNR_ERROR(logger,"computePath does not use the cached tree");
+    success = false;
+  }
+
+  // RRTStar needs the goal to accept a start tree: without it, the cached tree is discarded and the start node is left untouched
+  TreeSolverPtr star_solver = std::make_shared<RRTStar>(metrics,checker,sampler,logger);
+  star_solver->setRoadmapCache(cache,environment_id);
+  star_solver->config("/roadmap_cache_test");
+  NodePtr star_start_node = std::make_shared<Node>(new_start,logger);
+  if(star_solver->addStartFromRoadmapCache(star_start_node) || star_start_node->getChildConnectionsSize()>0 || star_start_node->getParentConnectionsSize()>0)
+  {
+    CNR_ERROR(logger,"the start node is still connected to the discarded cached tree");
+    success = false;
+  }
+
+  // computePath adds the goal first, so RRTStar starts from the cached tree.
+  // The cached tree already reaches the goal: computePath returns false if no better solution is found, so the solver is queried directly
+  PathPtr star_solution;
+  star_solver->computePath(new_start,goal,"/roadmap_cache_test",star_solution,1.0,1000);
+  star_solution = star_solver->getSolution();
+  if(not star_solution || not star_solver->getStartTree() || star_solver->getStartTree()->getNumberOfNodes()<n_nodes)
+  {
+    CNR_ERROR(logger,"RRTStar does not use the cached tree");
+    success = false;
+  }
+  else if(star_solution->getStartNode()->getConfiguration() != new_start || star_solver->getStartTree()->getRoot() != star_solution->getStartNode())
+  {
+    CNR_ERROR(logger,"the solution of RRTStar does not start from the root of the cached tree");
+    success = false;
+  }
+
+  cache->remove(environment_id,checker);
+
+  if(success)
+    CNR_INFO(logger, cnr_logger::RESET() << cnr_logger::BOLDGREEN() << "Done!");
+
+  return success? 0: 1;
+}